@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// ADAPTIVE BATCH SIZING
+// ============================================================================
+//
+// Chooses how many samples the sender packs into the next frame from what the
+// transport reports back: buffer backlog, how long the last send took and the
+// WiFi RSSI. A slow or congested link gets larger frames so per-frame overhead
+// is amortized; an idle link gets small frames so samples arrive with low
+// latency. All bounds come from BatchConfig_t.
+
+typedef struct {
+    uint16_t minBatch;            // Smallest frame, in samples
+    uint16_t maxBatch;            // Largest frame (frame buffer limit)
+    uint16_t maxLatencyMs;        // Frame span allowed while the link keeps up
+    uint16_t maxFramesPerSecond;  // Frame rate ceiling (throughput bound)
+    int8_t weakRssiDbm;           // Below this the link is treated as congested
+} BatchConfig_t;
+
+class BatchController {
+public:
+    BatchController(const BatchConfig_t& config, uint32_t sampleRateSps)
+        : config_(config), sampleRateSps_(1), batchSize_(config.minBatch),
+          lowerBound_(config.minBatch), latencyCap_(config.maxBatch), utilization_(0.0f) {
+        setSampleRate(sampleRateSps);
+        batchSize_ = lowerBound_;
+    }
+
+    void setSampleRate(uint32_t sampleRateSps) {
+        sampleRateSps_ = sampleRateSps ? sampleRateSps : 1;
+
+        uint32_t lower = config_.minBatch;
+        if (config_.maxFramesPerSecond) {
+            uint32_t throughputFloor = (sampleRateSps_ + config_.maxFramesPerSecond - 1) / config_.maxFramesPerSecond;
+            if (throughputFloor > lower) {
+                lower = throughputFloor;
+            }
+        }
+        lowerBound_ = (uint16_t)(lower < config_.maxBatch ? lower : config_.maxBatch);
+
+        uint32_t latencyCap = sampleRateSps_ * config_.maxLatencyMs / 1000;
+        if (latencyCap < lowerBound_) {
+            latencyCap = lowerBound_;
+        }
+        latencyCap_ = (uint16_t)(latencyCap < config_.maxBatch ? latencyCap : config_.maxBatch);
+
+        batchSize_ = clamp(batchSize_, lowerBound_, config_.maxBatch);
+    }
+
+    uint16_t batchSize() const { return batchSize_; }
+    uint16_t latencyCap() const { return latencyCap_; }
+    uint16_t lowerBound() const { return lowerBound_; }
+
+    // Feed back the outcome of one send: samples in the frame, time spent in
+    // the send call, backlog left in the buffer and the current RSSI (0 if
+    // unknown)
+    void onFrameSent(uint16_t samples, uint32_t sendDurationUs, uint32_t backlog, int8_t rssiDbm) {
+        if (samples == 0) {
+            return;
+        }
+
+        // Fraction of the frame's production time spent sending it
+        float productionUs = (float)samples * 1000000.0f / (float)sampleRateSps_;
+        float utilization = (float)sendDurationUs / productionUs;
+        utilization_ += (utilization - utilization_) * 0.25f;
+
+        bool weakSignal = rssiDbm != 0 && rssiDbm < config_.weakRssiDbm;
+        bool congested = utilization_ > 0.5f || backlog > 2u * batchSize_ || weakSignal;
+        bool idle = utilization_ < 0.2f && backlog <= batchSize_ && !weakSignal;
+
+        if (congested) {
+            // Grow multiplicatively: amortize per-frame overhead quickly
+            batchSize_ = clamp((uint16_t)(batchSize_ + batchSize_ / 2 + 1), lowerBound_, config_.maxBatch);
+        } else if (idle || batchSize_ > latencyCap_) {
+            // Shrink gently back towards low-latency frames
+            uint16_t step = batchSize_ / 8 ? batchSize_ / 8 : 1;
+            batchSize_ = clamp((uint16_t)(batchSize_ > step ? batchSize_ - step : 0), lowerBound_, config_.maxBatch);
+        }
+    }
+
+    // How long the sender should wait for the next frame to fill up
+    uint32_t waitMs(uint32_t backlog) const {
+        if (backlog >= batchSize_) {
+            return 0;
+        }
+        uint32_t missing = batchSize_ - backlog;
+        uint32_t ms = (missing * 1000 + sampleRateSps_ - 1) / sampleRateSps_;
+        return ms < config_.maxLatencyMs ? ms : config_.maxLatencyMs;
+    }
+
+    float utilization() const { return utilization_; }
+
+private:
+    static uint16_t clamp(uint16_t value, uint16_t low, uint16_t high) {
+        if (value < low) return low;
+        if (value > high) return high;
+        return value;
+    }
+
+    BatchConfig_t config_;
+    uint32_t sampleRateSps_;
+    uint16_t batchSize_;
+    uint16_t lowerBound_;
+    uint16_t latencyCap_;
+    float utilization_;
+};
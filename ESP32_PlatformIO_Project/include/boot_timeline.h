@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// BOOT TIMELINE
+// ============================================================================
+//
+// setup() brings up the ADCs, sample queue and tasks first, and sampling
+// starts at once; the network connects in the background and the queued
+// samples go out when the backend link is up. The timeline records when each
+// stage was first reached, in microseconds since boot (esp_timer_get_time()
+// on the ESP32), for the telemetry report.
+
+typedef struct {
+    uint64_t readyUs;           // ADCs initialized, queue allocated, tasks running
+    uint64_t firstSampleUs;     // First complete frame read from every channel
+    uint64_t wifiUs;            // WiFi associated
+    uint64_t linkUs;            // WebSocket connected to the backend
+} BootTimeline_t;
+
+// Record a milestone; only the first time it is reached counts
+inline void bootMark(uint64_t& milestone, uint64_t nowUs) {
+    if (milestone == 0) {
+        milestone = nowUs ? nowUs : 1;
+    }
+}
+
+// Milliseconds since boot, or -1 while the milestone has not been reached
+inline int32_t bootMs(uint64_t milestone) {
+    return milestone ? (int32_t)(milestone / 1000) : -1;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "sample_types.h"
+
+// ============================================================================
+// STRUCT-OF-ARRAYS SAMPLE RING
+// ============================================================================
+//
+// Same single-producer / single-consumer scheme as SampleRing, but samples are
+// stored column-wise: one timestamp array plus one value array per channel,
+// all over externally allocated storage (the PSRAM sample buffer). The sender
+// reads contiguous spans of each column, so encoders walk one channel's
+// values sequentially whatever the channel count.
+//
+// Channels fixes the channel count at compile time (the firmware passes
+// Pipeline::channels) so the per-sample channel loops have a constant trip
+// count; ChannelRing<> takes the count from attach() instead.
+
+template <uint8_t Channels = 0>
+class ChannelRing {
+    static_assert(Channels <= MAX_CHANNELS, "more channels than MAX_CHANNELS");
+
+public:
+    ChannelRing() : timestamps_(nullptr), values_(nullptr), channels_(0), capacity_(0),
+                    written_(0), read_(0) {}
+
+    // Bytes of storage needed for capacity samples of channels channels
+    static constexpr size_t storageBytes(uint8_t channels, uint32_t capacity) {
+        return (size_t)capacity * (sizeof(uint64_t) + channels * sizeof(float));
+    }
+
+    // storage must hold storageBytes(channels, capacity) bytes, aligned for uint64_t
+    void attach(void* storage, uint8_t channels, uint32_t capacity) {
+        timestamps_ = (uint64_t*)storage;
+        values_ = (float*)(timestamps_ + capacity);
+        channels_ = Channels ? Channels : (channels > MAX_CHANNELS ? MAX_CHANNELS : channels);
+        capacity_ = capacity;
+        written_.store(0, std::memory_order_relaxed);
+        read_.store(0, std::memory_order_relaxed);
+    }
+
+    uint8_t channels() const { return Channels ? Channels : channels_; }
+    uint32_t capacity() const { return capacity_; }
+
+    // Producer side
+    bool push(const Sample_t& sample) {
+        uint32_t w = written_.load(std::memory_order_relaxed);
+        if (w - read_.load(std::memory_order_acquire) >= capacity_) {
+            return false;
+        }
+        uint32_t index = w % capacity_;
+        timestamps_[index] = sample.timestampUs;
+        for (uint8_t c = 0; c < channels(); ++c) {
+            values_[(size_t)c * capacity_ + index] = sample.values[c];
+        }
+        written_.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t written() const { return written_.load(std::memory_order_acquire); }
+
+    // Consumer side
+    uint32_t available() const {
+        return written_.load(std::memory_order_acquire) - read_.load(std::memory_order_relaxed);
+    }
+
+    // Longest contiguous run of unread samples, capped at maxCount
+    size_t peek(SampleSpan_t& span, size_t maxCount) const {
+        uint32_t r = read_.load(std::memory_order_relaxed);
+        uint32_t count = written_.load(std::memory_order_acquire) - r;
+        uint32_t offset = r % capacity_;
+        if (count > capacity_ - offset) {
+            count = capacity_ - offset;
+        }
+        if (count > maxCount) {
+            count = (uint32_t)maxCount;
+        }
+        span.timestampUs = &timestamps_[offset];
+        for (uint8_t c = 0; c < channels(); ++c) {
+            span.values[c] = &values_[(size_t)c * capacity_ + offset];
+        }
+        span.channels = channels();
+        span.count = count;
+        return count;
+    }
+
+    void consume(size_t count) {
+        read_.store(read_.load(std::memory_order_relaxed) + (uint32_t)count, std::memory_order_release);
+    }
+
+    // Drop everything written before position (a value previously returned by
+    // written()); used to start a new session without racing the producer
+    void skipTo(uint32_t position) {
+        uint32_t r = read_.load(std::memory_order_relaxed);
+        if ((int32_t)(position - r) > 0) {
+            read_.store(position, std::memory_order_release);
+        }
+    }
+
+private:
+    uint64_t* timestamps_;
+    float* values_;
+    uint8_t channels_;
+    uint32_t capacity_;
+    std::atomic<uint32_t> written_;
+    std::atomic<uint32_t> read_;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// SHARED-BUS CHANNEL SCHEDULER
+// ============================================================================
+//
+// All ADS1220s free-run at the same data rate but are not synchronised, so
+// their DRDY edges land at different phases of the conversion period. One
+// frame reads one conversion from every channel: the sampler polls the DRDY
+// lines and reads whichever channels are ready, in table order, over the
+// shared SPI bus until all have been read. The frame has to finish within one
+// conversion period, otherwise a channel's next conversion overwrites one
+// that was never read.
+//
+// The bus is a template parameter so the same code runs against the ADS1220s
+// on the ESP32 and against a simulated bus in the native tests:
+//
+//   bool ready(uint8_t channel);     // DRDY low
+//   float read(uint8_t channel);     // read one conversion over SPI
+//   uint64_t nowUs();
+//   void wait();                     // short pause between DRDY polls
+
+typedef struct {
+    uint32_t lastFrameUs;   // Start of the frame to the last read
+    uint32_t maxFrameUs;
+    uint32_t lastBusUs;     // Time spent in reads during the frame
+    uint32_t maxBusUs;
+    uint32_t frames;
+    uint32_t timeouts;      // Frames that ended with channels unread
+} ScheduleStats_t;
+
+// Read one conversion from each of the first channels channels into values.
+// Channels not ready within timeoutUs keep their previous value. Returns the
+// number of channels read.
+template <typename Bus>
+uint8_t readAllChannels(Bus& bus, uint8_t channels, float* values, uint32_t timeoutUs,
+                        ScheduleStats_t& stats) {
+    uint32_t pending = channels >= 32 ? 0xFFFFFFFFu : ((1u << channels) - 1);
+    uint8_t read = 0;
+    uint64_t busUs = 0;
+    uint64_t started = bus.nowUs();
+    uint64_t finished = started;
+
+    while (pending) {
+        bool progressed = false;
+        for (uint8_t c = 0; c < channels; ++c) {
+            if ((pending & (1u << c)) && bus.ready(c)) {
+                uint64_t readStarted = bus.nowUs();
+                values[c] = bus.read(c);
+                finished = bus.nowUs();
+                busUs += finished - readStarted;
+                pending &= ~(1u << c);
+                read++;
+                progressed = true;
+            }
+        }
+        if (!pending) {
+            break;
+        }
+        if (bus.nowUs() - started > timeoutUs) {
+            stats.timeouts++;
+            break;
+        }
+        if (!progressed) {
+            bus.wait();
+        }
+    }
+
+    stats.lastFrameUs = (uint32_t)(finished - started);
+    stats.lastBusUs = (uint32_t)busUs;
+    if (stats.lastFrameUs > stats.maxFrameUs) {
+        stats.maxFrameUs = stats.lastFrameUs;
+    }
+    if (stats.lastBusUs > stats.maxBusUs) {
+        stats.maxBusUs = stats.lastBusUs;
+    }
+    stats.frames++;
+    return read;
+}
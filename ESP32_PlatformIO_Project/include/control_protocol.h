@@ -0,0 +1,370 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ============================================================================
+// CONTROL CHANNEL PROTOCOL
+// ============================================================================
+//
+// Zero-allocation parser for the small JSON control messages the backend sends
+// over the WebSocket, and that apps send to the device's own WebSocket server
+// in direct-connect mode, e.g.
+//
+//   {"status":"registered","type":"esp32","message":"..."}
+//   {"pong":true}
+//   {"command":"start"}
+//   {"cmd":"rate","value":500}
+//   {"type":"flutter"}                 (client registration, direct mode)
+//   {"ping":true}
+//
+// The parser walks the raw payload in place: no String copies, no JsonDocument,
+// no heap. Only the top-level keys "cmd"/"command", "value", "status", "type",
+// "ping" and "pong" are inspected; everything else (including nested objects
+// and arrays) is skipped. Hardware independent so it can be tested in the
+// native env.
+
+enum ControlCommand : uint8_t {
+    CMD_NONE = 0,
+    CMD_START,
+    CMD_STOP,
+    CMD_RATE,
+    CMD_GAIN,
+    CMD_TARE,
+    CMD_TELEMETRY,
+    CMD_TRIGGER,
+    CMD_TRANSPORT,
+    CMD_FEC,
+    CMD_NACK
+};
+
+enum ControlMessageKind : uint8_t {
+    MSG_UNKNOWN = 0,
+    MSG_REGISTERED,
+    MSG_PONG,
+    MSG_COMMAND,
+    MSG_HELLO,          // Client registration: {"type":...}
+    MSG_PING
+};
+
+// Who registered with a MSG_HELLO
+enum ClientRole : uint8_t {
+    ROLE_UNKNOWN = 0,
+    ROLE_APP,           // "flutter" or "browser": live display and control
+    ROLE_ARCHIVE        // "backend": records sessions
+};
+
+typedef struct {
+    ControlMessageKind kind;
+    ControlCommand command;
+    bool hasValue;
+    int32_t value;
+    ClientRole role;
+} ControlMessage_t;
+
+typedef struct {
+    const char* name;
+    ClientRole role;
+} ClientRoleEntry_t;
+
+static const ClientRoleEntry_t CLIENT_ROLES[] = {
+    { "flutter", ROLE_APP },
+    { "browser", ROLE_APP },
+    { "backend", ROLE_ARCHIVE },
+};
+
+inline ClientRole lookupClientRole(const char* name, size_t length) {
+    for (size_t i = 0; i < sizeof(CLIENT_ROLES) / sizeof(CLIENT_ROLES[0]); ++i) {
+        const char* candidate = CLIENT_ROLES[i].name;
+        if (strlen(candidate) == length && memcmp(candidate, name, length) == 0) {
+            return CLIENT_ROLES[i].role;
+        }
+    }
+    return ROLE_UNKNOWN;
+}
+
+inline const char* clientRoleName(ClientRole role) {
+    return role == ROLE_APP ? "flutter" : role == ROLE_ARCHIVE ? "backend" : "unknown";
+}
+
+typedef struct {
+    const char* name;
+    ControlCommand command;
+} ControlCommandEntry_t;
+
+// Fixed command table, looked up by exact name
+static const ControlCommandEntry_t CONTROL_COMMANDS[] = {
+    { "start",     CMD_START },
+    { "stop",      CMD_STOP },
+    { "rate",      CMD_RATE },
+    { "gain",      CMD_GAIN },
+    { "tare",      CMD_TARE },
+    { "telemetry", CMD_TELEMETRY },
+    { "trigger",   CMD_TRIGGER },
+    { "transport", CMD_TRANSPORT },
+    { "fec",       CMD_FEC },
+    { "nack",      CMD_NACK },
+};
+
+#define CONTROL_COMMAND_COUNT (sizeof(CONTROL_COMMANDS) / sizeof(CONTROL_COMMANDS[0]))
+
+inline ControlCommand lookupControlCommand(const char* name, size_t length) {
+    for (size_t i = 0; i < CONTROL_COMMAND_COUNT; ++i) {
+        const char* candidate = CONTROL_COMMANDS[i].name;
+        if (strlen(candidate) == length && memcmp(candidate, name, length) == 0) {
+            return CONTROL_COMMANDS[i].command;
+        }
+    }
+    return CMD_NONE;
+}
+
+inline const char* controlCommandName(ControlCommand command) {
+    for (size_t i = 0; i < CONTROL_COMMAND_COUNT; ++i) {
+        if (CONTROL_COMMANDS[i].command == command) {
+            return CONTROL_COMMANDS[i].name;
+        }
+    }
+    return "none";
+}
+
+// ----------------------------------------------------------------------------
+// Internal scanner helpers
+// ----------------------------------------------------------------------------
+
+namespace control_detail {
+
+struct Cursor {
+    const char* p;
+    const char* end;
+};
+
+inline void skipWhitespace(Cursor& c) {
+    while (c.p < c.end && (*c.p == ' ' || *c.p == '\t' || *c.p == '\n' || *c.p == '\r')) {
+        ++c.p;
+    }
+}
+
+inline bool consume(Cursor& c, char expected) {
+    skipWhitespace(c);
+    if (c.p < c.end && *c.p == expected) {
+        ++c.p;
+        return true;
+    }
+    return false;
+}
+
+// Scan a string token. On success start/length describe the raw (still
+// escaped) contents between the quotes.
+inline bool scanString(Cursor& c, const char*& start, size_t& length) {
+    skipWhitespace(c);
+    if (c.p >= c.end || *c.p != '"') {
+        return false;
+    }
+    ++c.p;
+    start = c.p;
+    while (c.p < c.end && *c.p != '"') {
+        if (*c.p == '\\' && c.p + 1 < c.end) {
+            ++c.p;
+        }
+        ++c.p;
+    }
+    if (c.p >= c.end) {
+        return false;
+    }
+    length = (size_t)(c.p - start);
+    ++c.p;
+    return true;
+}
+
+inline bool scanInteger(Cursor& c, int32_t& value) {
+    skipWhitespace(c);
+    bool negative = false;
+    if (c.p < c.end && (*c.p == '-' || *c.p == '+')) {
+        negative = (*c.p == '-');
+        ++c.p;
+    }
+    if (c.p >= c.end || *c.p < '0' || *c.p > '9') {
+        return false;
+    }
+    int64_t accumulator = 0;
+    while (c.p < c.end && *c.p >= '0' && *c.p <= '9') {
+        if (accumulator < INT32_MAX) {
+            accumulator = accumulator * 10 + (*c.p - '0');
+        }
+        ++c.p;
+    }
+    // Fractional part and exponent are accepted but truncated
+    while (c.p < c.end && (*c.p == '.' || *c.p == 'e' || *c.p == 'E' ||
+                           *c.p == '-' || *c.p == '+' || (*c.p >= '0' && *c.p <= '9'))) {
+        ++c.p;
+    }
+    if (accumulator > INT32_MAX) {
+        accumulator = INT32_MAX;
+    }
+    value = (int32_t)(negative ? -accumulator : accumulator);
+    return true;
+}
+
+// Skip any JSON value, including nested containers
+inline bool skipValue(Cursor& c) {
+    skipWhitespace(c);
+    if (c.p >= c.end) {
+        return false;
+    }
+    if (*c.p == '"') {
+        const char* start;
+        size_t length;
+        return scanString(c, start, length);
+    }
+    if (*c.p == '{' || *c.p == '[') {
+        int depth = 0;
+        while (c.p < c.end) {
+            char ch = *c.p;
+            if (ch == '"') {
+                const char* start;
+                size_t length;
+                if (!scanString(c, start, length)) {
+                    return false;
+                }
+                continue;
+            }
+            if (ch == '{' || ch == '[') {
+                ++depth;
+            } else if (ch == '}' || ch == ']') {
+                --depth;
+            }
+            ++c.p;
+            if (depth == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+    // Number, true, false, null
+    const char* start = c.p;
+    while (c.p < c.end && *c.p != ',' && *c.p != '}' && *c.p != ']' &&
+           *c.p != ' ' && *c.p != '\t' && *c.p != '\n' && *c.p != '\r') {
+        ++c.p;
+    }
+    return c.p > start;
+}
+
+inline bool keyEquals(const char* key, size_t length, const char* expected) {
+    return strlen(expected) == length && memcmp(key, expected, length) == 0;
+}
+
+} // namespace control_detail
+
+// ----------------------------------------------------------------------------
+// Parse one control message. Returns false for malformed JSON; a well-formed
+// message that carries nothing we recognise is returned as MSG_UNKNOWN.
+// ----------------------------------------------------------------------------
+
+inline bool parseControlMessage(const uint8_t* payload, size_t length, ControlMessage_t& out) {
+    using namespace control_detail;
+
+    out.kind = MSG_UNKNOWN;
+    out.command = CMD_NONE;
+    out.hasValue = false;
+    out.value = 0;
+    out.role = ROLE_UNKNOWN;
+
+    if (payload == nullptr) {
+        return false;
+    }
+
+    Cursor c = { (const char*)payload, (const char*)payload + length };
+    if (!consume(c, '{')) {
+        return false;
+    }
+    if (consume(c, '}')) {
+        return true;
+    }
+
+    bool sawCommandKey = false;
+    bool registered = false;
+    bool hello = false;
+    bool ping = false;
+    bool pong = false;
+
+    for (;;) {
+        const char* key;
+        size_t keyLength;
+        if (!scanString(c, key, keyLength) || !consume(c, ':')) {
+            return false;
+        }
+
+        if (keyEquals(key, keyLength, "cmd") || keyEquals(key, keyLength, "command")) {
+            const char* name;
+            size_t nameLength;
+            if (!scanString(c, name, nameLength)) {
+                return false;
+            }
+            // "cmd" wins over "command" when both are present
+            if (!sawCommandKey || keyEquals(key, keyLength, "cmd")) {
+                out.command = lookupControlCommand(name, nameLength);
+            }
+            sawCommandKey = true;
+        } else if (keyEquals(key, keyLength, "value")) {
+            Cursor probe = c;
+            if (scanInteger(probe, out.value)) {
+                out.hasValue = true;
+                c = probe;
+            } else if (!skipValue(c)) {
+                return false;
+            }
+        } else if (keyEquals(key, keyLength, "status")) {
+            const char* status;
+            size_t statusLength;
+            if (!scanString(c, status, statusLength)) {
+                if (!skipValue(c)) {
+                    return false;
+                }
+            } else if (keyEquals(status, statusLength, "registered")) {
+                registered = true;
+            }
+        } else if (keyEquals(key, keyLength, "type")) {
+            const char* type;
+            size_t typeLength;
+            if (!scanString(c, type, typeLength)) {
+                if (!skipValue(c)) {
+                    return false;
+                }
+            } else {
+                hello = true;
+                out.role = lookupClientRole(type, typeLength);
+            }
+        } else {
+            if (keyEquals(key, keyLength, "pong")) {
+                pong = true;
+            } else if (keyEquals(key, keyLength, "ping")) {
+                ping = true;
+            }
+            if (!skipValue(c)) {
+                return false;
+            }
+        }
+
+        if (consume(c, ',')) {
+            continue;
+        }
+        if (consume(c, '}')) {
+            break;
+        }
+        return false;
+    }
+
+    if (sawCommandKey) {
+        out.kind = MSG_COMMAND;
+    } else if (registered) {
+        out.kind = MSG_REGISTERED;
+    } else if (hello) {
+        out.kind = MSG_HELLO;
+    } else if (ping) {
+        out.kind = MSG_PING;
+    } else if (pong) {
+        out.kind = MSG_PONG;
+    }
+    return true;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "control_protocol.h"
+
+// ============================================================================
+// DIRECT-CONNECT CLIENT HUB
+// ============================================================================
+//
+// In direct-connect mode the ESP32 runs its own WebSocket server so the app
+// can stream from the device without the backend in between. The hub speaks
+// the backend's client protocol on that server:
+//
+//   client -> device   {"type":"flutter"}       registered, receives samples
+//                      {"cmd":"start"}           executed, acked with
+//                                                {"command_ack":"start","success":true}
+//                      {"ping":true}             answered with {"pong":true}
+//   device -> client   sample frames, as sent to the backend
+//
+// Sample frames are encoded once by the sender task and fanned out to every
+// registered client by the network task; the sampler only ever writes the
+// sample queue, so a slow client cannot hold it up. A client whose sends keep
+// failing or keep taking longer than the stall budget is dropped so it cannot
+// hold up the others either.
+//
+// The transport is a template parameter, so the same hub runs on the
+// WebSocketsServer on the ESP32 and on loopback sockets in the native tests:
+//
+//   bool sendText(uint8_t client, const char* data, size_t length);
+//   void disconnect(uint8_t client);
+//   uint64_t nowUs();
+
+#define DIRECT_MAX_CLIENTS         4
+#define DIRECT_STALL_BUDGET_US     20000    // A send slower than this counts as a strike
+#define DIRECT_MAX_STRIKES         3        // Consecutive strikes before a client is dropped
+
+typedef struct {
+    uint32_t frames;            // Frames fanned out
+    uint32_t sends;             // Individual client sends that succeeded
+    uint32_t failedSends;
+    uint32_t slowSends;         // Sends over the stall budget
+    uint32_t evictions;         // Clients dropped for failing or stalling
+    uint32_t rejected;          // Connections refused because the hub was full
+    uint32_t maxFanoutUs;       // Longest fan-out of one frame to all clients
+} DirectHubStats_t;
+
+template <typename Transport, uint8_t MaxClients = DIRECT_MAX_CLIENTS>
+class DirectHub {
+public:
+    explicit DirectHub(Transport& transport, uint32_t stallBudgetUs = DIRECT_STALL_BUDGET_US)
+        : transport_(transport), stallBudgetUs_(stallBudgetUs), stats_() {
+        for (uint8_t i = 0; i < MaxClients; ++i) {
+            clients_[i] = Client();
+        }
+    }
+
+    // A new connection; false if the hub is full and the caller should close it
+    bool onConnect(uint8_t client) {
+        Client* slot = find(client);
+        if (!slot) {
+            slot = find(FREE_SLOT);
+        }
+        if (!slot) {
+            stats_.rejected++;
+            return false;
+        }
+        *slot = Client();
+        slot->id = client;
+        return true;
+    }
+
+    void onDisconnect(uint8_t client) {
+        Client* slot = find(client);
+        if (slot) {
+            *slot = Client();
+        }
+    }
+
+    // Handle a text message from a client. Registration and pings are
+    // answered here; returns true with msg filled in when the client sent a
+    // command for the caller to execute.
+    bool onText(uint8_t client, const uint8_t* payload, size_t length, ControlMessage_t& msg) {
+        Client* slot = find(client);
+        if (!slot || !parseControlMessage(payload, length, msg)) {
+            return false;
+        }
+
+        char reply[64];
+        int replyLength = 0;
+        switch (msg.kind) {
+            case MSG_HELLO:
+                slot->registered = true;
+                slot->role = msg.role;
+                replyLength = snprintf(reply, sizeof(reply), "{\"status\":\"registered\",\"type\":\"%s\"}",
+                                       clientRoleName(msg.role));
+                break;
+            case MSG_PING:
+                replyLength = snprintf(reply, sizeof(reply), "{\"pong\":true}");
+                break;
+            case MSG_COMMAND:
+                if (msg.command == CMD_NONE) {
+                    return false;
+                }
+                replyLength = snprintf(reply, sizeof(reply), "{\"command_ack\":\"%s\",\"success\":true}",
+                                       controlCommandName(msg.command));
+                break;
+            default:
+                return false;
+        }
+        transport_.sendText(client, reply, (size_t)replyLength);
+        return msg.kind == MSG_COMMAND;
+    }
+
+    // Send one encoded frame to every registered client; returns the number
+    // of clients it reached
+    uint8_t broadcast(const char* frame, size_t length) {
+        uint8_t delivered = 0;
+        uint64_t started = transport_.nowUs();
+
+        for (uint8_t i = 0; i < MaxClients; ++i) {
+            Client& c = clients_[i];
+            if (c.id == FREE_SLOT || !c.registered) {
+                continue;
+            }
+            uint64_t sendStarted = transport_.nowUs();
+            bool sent = transport_.sendText(c.id, frame, length);
+            uint64_t sendUs = transport_.nowUs() - sendStarted;
+
+            bool strike = false;
+            if (!sent) {
+                stats_.failedSends++;
+                strike = true;
+            } else {
+                stats_.sends++;
+                delivered++;
+                if (sendUs > stallBudgetUs_) {
+                    stats_.slowSends++;
+                    strike = true;
+                }
+            }
+            c.strikes = strike ? c.strikes + 1 : 0;
+            if (c.strikes >= DIRECT_MAX_STRIKES) {
+                stats_.evictions++;
+                uint8_t id = c.id;
+                c = Client();
+                transport_.disconnect(id);
+            }
+        }
+
+        uint32_t fanoutUs = (uint32_t)(transport_.nowUs() - started);
+        if (fanoutUs > stats_.maxFanoutUs) {
+            stats_.maxFanoutUs = fanoutUs;
+        }
+        stats_.frames++;
+        return delivered;
+    }
+
+    // Registered clients that receive sample frames
+    uint8_t subscribers() const {
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < MaxClients; ++i) {
+            if (clients_[i].id != FREE_SLOT && clients_[i].registered) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    const DirectHubStats_t& stats() const { return stats_; }
+
+private:
+    static const uint8_t FREE_SLOT = 0xFF;
+
+    struct Client {
+        uint8_t id;
+        bool registered;
+        ClientRole role;
+        uint8_t strikes;        // Consecutive failed or stalled sends
+        Client() : id(FREE_SLOT), registered(false), role(ROLE_UNKNOWN), strikes(0) {}
+    };
+
+    Client* find(uint8_t id) {
+        for (uint8_t i = 0; i < MaxClients; ++i) {
+            if (clients_[i].id == id) {
+                return &clients_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    Transport& transport_;
+    uint32_t stallBudgetUs_;
+    Client clients_[MaxClients];
+    DirectHubStats_t stats_;
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ============================================================================
+// NETWORK TASK SEND QUEUE
+// ============================================================================
+//
+// One task, the network task, owns the backend WebSocket: it runs the client
+// library's loop() and is the only task that writes to the socket. Other
+// tasks only queue frames for it. FrameQueue carries encoded frames from the
+// sender task (single producer, single consumer). FrameWriter writes a frame
+// without blocking: it writes as much as the TCP send buffer takes and picks
+// the frame up again on the network task's next pass. A stalled TCP window
+// therefore fills the queue, and the sender sees no free slot and keeps its
+// samples in the ring; nothing blocks inside a send.
+//
+// Each slot reserves FRAME_HEADER_BYTES in front of the payload, so the
+// header is written in place and a frame goes out without being copied. The
+// framing is a template parameter: WebSocket client text frames (RFC 6455,
+// masked) by default, USB serial frames with UsbFraming (usb_frame.h).
+//
+// The writer's transport is a template parameter too, so the same code runs
+// on the ESP32 socket and USB port, and on loopback sockets in the native
+// tests:
+//
+//   int write(const uint8_t* data, size_t length);   // bytes taken without
+//                                                    // blocking, 0 when the
+//                                                    // send buffer is full,
+//                                                    // < 0 when the connection
+//                                                    // is gone
+//   uint64_t nowUs();
+//   uint32_t maskKey();                              // WebSocket framing only
+
+#define FRAME_HEADER_BYTES     14          // Opcode, 64-bit length and mask key
+#define FRAME_STALL_LIMIT_US   5000000     // A frame stuck this long gives up the connection
+
+// Frame destinations
+#define FRAME_TO_BACKEND       0x01
+#define FRAME_TO_DIRECT        0x02
+
+template <uint8_t Slots, size_t PayloadBytes>
+class FrameQueue {
+    static_assert(Slots >= 1, "frame queue needs a slot");
+
+public:
+    FrameQueue() : head_(0), tail_(0), maxDepth_(0), full_(0) {}
+
+    // Producer side: the payload area of the next free slot (PayloadBytes
+    // long), or nullptr while every slot is queued
+    char* acquire() {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= Slots) {
+            full_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return (char*)frames_[head % Slots].bytes + FRAME_HEADER_BYTES;
+    }
+
+    // Queue the acquired slot's first length payload bytes
+    void publish(size_t length, uint8_t destinations) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        Frame& frame = frames_[head % Slots];
+        frame.length = length;
+        frame.destinations = destinations;
+        head_.store(head + 1, std::memory_order_release);
+        uint32_t depth = head + 1 - tail_.load(std::memory_order_acquire);
+        if (depth > maxDepth_.load(std::memory_order_relaxed)) {
+            maxDepth_.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    // Consumer side: the oldest queued frame, which stays queued until pop()
+    bool front(uint8_t*& payload, size_t& length, uint8_t& destinations) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        Frame& frame = frames_[tail % Slots];
+        payload = frame.bytes + FRAME_HEADER_BYTES;
+        length = frame.length;
+        destinations = frame.destinations;
+        return true;
+    }
+
+    void pop() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint32_t depth() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    uint32_t maxDepth() const { return maxDepth_.load(std::memory_order_relaxed); }
+    // acquire() calls that found every slot queued
+    uint32_t fullCount() const { return full_.load(std::memory_order_relaxed); }
+
+private:
+    struct Frame {
+        size_t length;
+        uint8_t destinations;
+        uint8_t bytes[FRAME_HEADER_BYTES + PayloadBytes];
+    };
+
+    Frame frames_[Slots];
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+    std::atomic<uint32_t> maxDepth_;    // Written by the producer
+    std::atomic<uint32_t> full_;
+};
+
+enum FrameWriteState : uint8_t {
+    FrameWrite_Done,
+    FrameWrite_Pending,     // Send buffer full: call service() again later
+    FrameWrite_Failed,      // Connection gone
+    FrameWrite_StalledOut   // Part written and stuck past the stall limit: close the connection
+};
+
+typedef struct {
+    uint32_t frames;            // Frames written completely
+    uint64_t bytes;
+    uint32_t stalls;            // Frames that found the send buffer full
+    uint64_t stallUs;           // Time frames spent waiting for the send buffer
+    uint32_t maxStallUs;
+    uint32_t failures;          // Frames lost to a closed or stalled-out connection
+} FrameWriterStats_t;
+
+// Masked client text frame header; masks the payload in place
+struct WebSocketFraming {
+    template <typename Transport>
+    static size_t encode(uint8_t* header, uint8_t* payload, size_t length, Transport& transport) {
+        size_t headerLength = 2;
+        header[0] = 0x81;   // FIN, text
+        if (length < 126) {
+            header[1] = 0x80 | (uint8_t)length;
+        } else if (length <= 0xFFFF) {
+            header[1] = 0x80 | 126;
+            header[2] = (uint8_t)(length >> 8);
+            header[3] = (uint8_t)length;
+            headerLength = 4;
+        } else {
+            header[1] = 0x80 | 127;
+            for (int i = 0; i < 8; ++i) {
+                header[2 + i] = (uint8_t)((uint64_t)length >> (56 - 8 * i));
+            }
+            headerLength = 10;
+        }
+        uint32_t key = transport.maskKey();
+        memcpy(header + headerLength, &key, 4);
+        mask(payload, length, key);
+        return headerLength + 4;
+    }
+
+    static void mask(uint8_t* payload, size_t length, uint32_t key) {
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            uint32_t word;
+            memcpy(&word, payload + i, 4);
+            word ^= key;
+            memcpy(payload + i, &word, 4);
+        }
+        const uint8_t* keyBytes = (const uint8_t*)&key;
+        for (; i < length; ++i) {
+            payload[i] ^= keyBytes[i & 3];
+        }
+    }
+};
+
+template <typename Transport, typename Framing = WebSocketFraming>
+class FrameWriter {
+public:
+    explicit FrameWriter(Transport& transport, uint32_t stallLimitUs = FRAME_STALL_LIMIT_US)
+        : transport_(transport), stallLimitUs_(stallLimitUs), data_(nullptr), remaining_(0),
+          stalled_(false), stalledSinceUs_(0), stats_() {}
+
+    // Frame length payload bytes. FRAME_HEADER_BYTES in front of payload
+    // must be writable; the framing may rewrite the payload in place.
+    void start(uint8_t* payload, size_t length) {
+        uint8_t header[FRAME_HEADER_BYTES];
+        size_t headerLength = Framing::encode(header, payload, length, transport_);
+        data_ = payload - headerLength;
+        memcpy(data_, header, headerLength);
+        remaining_ = headerLength + length;
+        stalled_ = false;
+    }
+
+    // A frame is partly written; nothing else may write to the connection
+    bool busy() const { return remaining_ > 0; }
+
+    // Write what the send buffer takes now
+    FrameWriteState service() {
+        while (remaining_ > 0) {
+            int written = transport_.write(data_, remaining_);
+            if (written < 0) {
+                finish();
+                stats_.failures++;
+                return FrameWrite_Failed;
+            }
+            if (written == 0) {
+                uint64_t now = transport_.nowUs();
+                if (!stalled_) {
+                    stalled_ = true;
+                    stalledSinceUs_ = now;
+                    stats_.stalls++;
+                } else if (now - stalledSinceUs_ > stallLimitUs_) {
+                    finish();
+                    stats_.failures++;
+                    return FrameWrite_StalledOut;
+                }
+                return FrameWrite_Pending;
+            }
+            data_ += written;
+            remaining_ -= (size_t)written;
+            stats_.bytes += (uint32_t)written;
+        }
+        finish();
+        stats_.frames++;
+        return FrameWrite_Done;
+    }
+
+    // Drop the frame in progress (the connection closed under it)
+    void abort() {
+        if (remaining_ > 0) {
+            stats_.failures++;
+        }
+        remaining_ = 0;
+        stalled_ = false;
+    }
+
+    const FrameWriterStats_t& stats() const { return stats_; }
+
+private:
+    // Account for the time the finished frame waited on the send buffer
+    void finish() {
+        if (stalled_) {
+            uint64_t stallUs = transport_.nowUs() - stalledSinceUs_;
+            stats_.stallUs += stallUs;
+            if (stallUs > stats_.maxStallUs) {
+                stats_.maxStallUs = (uint32_t)stallUs;
+            }
+        }
+        remaining_ = 0;
+        stalled_ = false;
+    }
+
+    Transport& transport_;
+    uint32_t stallLimitUs_;
+    uint8_t* data_;
+    size_t remaining_;
+    bool stalled_;
+    uint64_t stalledSinceUs_;
+    FrameWriterStats_t stats_;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(ESP_PLATFORM) || defined(ARDUINO_ARCH_ESP32)
+#include <esp_heap_caps.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// ============================================================================
+// HEAP FREE-BLOCK STATISTICS
+// ============================================================================
+//
+// Periodic snapshots of the internal heap so long sessions can show whether
+// fragmentation is creeping up. On the ESP32 the numbers come from
+// heap_caps_get_info(); in the native env they come from glibc mallinfo, where
+// the largest free block is not known and is reported as the free total.
+
+typedef struct {
+    uint32_t freeBytes;
+    uint32_t largestFreeBlock;
+    uint32_t minFreeBytes;
+    uint32_t freeBlocks;
+} HeapStats_t;
+
+typedef struct {
+    HeapStats_t baseline;
+    HeapStats_t latest;
+    uint32_t smallestLargestBlock;
+    uint32_t maxFreeBlocks;
+    uint8_t peakFragmentation;
+    uint32_t snapshots;
+} HeapTrend_t;
+
+inline HeapStats_t readHeapStats() {
+    HeapStats_t stats = {};
+#if defined(ESP_PLATFORM) || defined(ARDUINO_ARCH_ESP32)
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    stats.freeBytes = info.total_free_bytes;
+    stats.largestFreeBlock = info.largest_free_block;
+    stats.minFreeBytes = info.minimum_free_bytes;
+    stats.freeBlocks = info.free_blocks;
+#elif defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 info = mallinfo2();
+#else
+    struct mallinfo info = mallinfo();
+#endif
+    stats.freeBytes = (uint32_t)info.fordblks;
+    stats.largestFreeBlock = (uint32_t)info.fordblks;
+    stats.minFreeBytes = (uint32_t)info.fordblks;
+    stats.freeBlocks = (uint32_t)info.ordblks;
+#endif
+    return stats;
+}
+
+// Share of free memory that cannot be handed out as one block, in percent
+inline uint8_t heapFragmentationPercent(const HeapStats_t& stats) {
+    if (stats.freeBytes == 0 || stats.largestFreeBlock >= stats.freeBytes) {
+        return 0;
+    }
+    return (uint8_t)(100 - (uint64_t)stats.largestFreeBlock * 100 / stats.freeBytes);
+}
+
+inline void heapTrendUpdate(HeapTrend_t& trend, const HeapStats_t& stats) {
+    if (trend.snapshots == 0) {
+        trend.baseline = stats;
+        trend.smallestLargestBlock = stats.largestFreeBlock;
+        trend.maxFreeBlocks = stats.freeBlocks;
+        trend.peakFragmentation = heapFragmentationPercent(stats);
+    }
+    trend.latest = stats;
+    if (stats.largestFreeBlock < trend.smallestLargestBlock) {
+        trend.smallestLargestBlock = stats.largestFreeBlock;
+    }
+    if (stats.freeBlocks > trend.maxFreeBlocks) {
+        trend.maxFreeBlocks = stats.freeBlocks;
+    }
+    uint8_t fragmentation = heapFragmentationPercent(stats);
+    if (fragmentation > trend.peakFragmentation) {
+        trend.peakFragmentation = fragmentation;
+    }
+    trend.snapshots++;
+}
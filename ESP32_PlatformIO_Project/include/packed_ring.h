@@ -0,0 +1,289 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "packed_samples.h"
+#include "sample_types.h"
+#include "staged_ring.h"
+
+// ============================================================================
+// PACKED SAMPLE RING
+// ============================================================================
+//
+// StagedRing whose backlog holds packed blocks (packed_samples.h) instead of
+// float and uint64_t columns: 3 bytes per channel value and one timestamp per
+// block, so about 6.5 bytes per 2-channel sample rather than 16. The same
+// PSRAM holds more than twice the samples, and a sender draining a backlog
+// reads less than half the bytes.
+//
+// The sampler fills a staging block in SRAM as before. Values are rounded to
+// whole counts as they are staged, so samples read from staging match what
+// the backlog returns for them. A block is packed into its backlog slot when
+// it is full or when the next timestamp does not continue it; an early block
+// leaves the rest of its slot unused. The sender reads recent samples straight
+// from the staging slots (same hand-over as StagedRing) and unpacks backlog
+// samples into a MaxSpan-sample scratch span held in this object.
+//
+// Backlog timestamps are rebuilt from the block's first timestamp and step,
+// so they can differ from the DRDY times by up to about PACKED_JITTER_US.
+
+template <uint8_t Channels, uint16_t Block, uint16_t MaxSpan>
+class PackedRing {
+    static_assert(Channels >= 1 && Channels <= MAX_CHANNELS, "channel count out of range");
+    static_assert(Block >= 4 && Block <= 1024, "packed block out of range");
+    static_assert(MaxSpan >= 1, "scratch span must hold a sample");
+
+public:
+    PackedRing() : slots_(nullptr), slotCount_(0), fillSlot_(0), fillCount_(0), committed_(0),
+                   written_(0), read_(0), readBlock_(0), readOffset_(0), pinned_(STAGED_NO_SLOT),
+                   readStaged_(false), stagedReads_(0) {
+        slotBlock_[0].store(0, std::memory_order_relaxed);
+        slotBlock_[1].store(STAGED_NO_BLOCK, std::memory_order_relaxed);
+        stageCount_[0].store(0, std::memory_order_relaxed);
+        stageCount_[1].store(0, std::memory_order_relaxed);
+    }
+
+    // One backlog slot: header and Block values per channel, 8-byte aligned
+    static constexpr size_t slotBytes(uint8_t channels) {
+        return sizeof(PackedBlockHeader_t) + (((size_t)channels * Block * 3 + 7) & ~(size_t)7);
+    }
+
+    static constexpr size_t storageBytes(uint8_t channels, uint32_t capacity) {
+        return (size_t)(capacity / Block) * slotBytes(channels);
+    }
+
+    static constexpr size_t stagingBytes() {
+        return 2 * (size_t)Block * (sizeof(uint64_t) + Channels * sizeof(float));
+    }
+
+    // storage must hold storageBytes(Channels, capacity) bytes, aligned for
+    // uint64_t. Not safe while either task is running.
+    void attach(void* storage, uint8_t channels, uint32_t capacity) {
+        (void)channels;
+        slots_ = (uint8_t*)storage;
+        slotCount_ = capacity / Block;
+        fillSlot_ = 0;
+        fillCount_ = 0;
+        slotBlock_[0].store(0, std::memory_order_relaxed);
+        slotBlock_[1].store(STAGED_NO_BLOCK, std::memory_order_relaxed);
+        stageCount_[0].store(0, std::memory_order_relaxed);
+        stageCount_[1].store(0, std::memory_order_relaxed);
+        committed_.store(0, std::memory_order_relaxed);
+        written_.store(0, std::memory_order_relaxed);
+        read_.store(0, std::memory_order_relaxed);
+        readBlock_.store(0, std::memory_order_relaxed);
+        readOffset_ = 0;
+        pinned_.store(STAGED_NO_SLOT, std::memory_order_relaxed);
+        readStaged_ = false;
+        stagedReads_ = 0;
+    }
+
+    uint8_t channels() const { return Channels; }
+    // Samples when every block is full; early blocks hold fewer
+    uint32_t capacity() const { return slotCount_ * Block; }
+
+    // Producer side
+    bool push(const Sample_t& sample) {
+        uint8_t slot = fillSlot_;
+        uint32_t offset = fillCount_;
+        if (offset > 0 && (offset == Block || !packedContinues(stageTimestamps_[slot][0],
+                                                               stageTimestamps_[slot][offset - 1],
+                                                               offset, sample.timestampUs))) {
+            uint32_t block = committed_.load(std::memory_order_relaxed);
+            if (block - readBlock_.load(std::memory_order_acquire) >= slotCount_) {
+                return false;
+            }
+            commit(slot, block, offset);
+            slot = fillSlot_;
+            offset = 0;
+        }
+        stageTimestamps_[slot][offset] = sample.timestampUs;
+        for (uint8_t c = 0; c < Channels; ++c) {
+            stageValues_[slot][c][offset] = (float)packedQuantize(sample.values[c]);
+        }
+        fillCount_ = offset + 1;
+        stageCount_[slot].store(offset + 1, std::memory_order_release);
+        written_.store(written_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t written() const { return written_.load(std::memory_order_acquire); }
+
+    // Consumer side
+    uint32_t available() const {
+        return written_.load(std::memory_order_acquire) - read_.load(std::memory_order_relaxed);
+    }
+
+    // Longest contiguous run of unread samples, capped at maxCount: from a
+    // staging slot if one still holds the read position's block, else
+    // unpacked from the backlog block (at most MaxSpan samples)
+    size_t peek(SampleSpan_t& span, size_t maxCount) {
+        return next(span, maxCount, true);
+    }
+
+    void consume(size_t count) {
+        if (readStaged_) {
+            stagedReads_ += (uint32_t)count;
+        }
+        advance((uint32_t)count);
+    }
+
+    // Drop everything written before position (a value previously returned by
+    // written()); used to start a new session without racing the producer
+    void skipTo(uint32_t position) {
+        int32_t skip = (int32_t)(position - read_.load(std::memory_order_relaxed));
+        while (skip > 0) {
+            SampleSpan_t span;
+            size_t count = next(span, (size_t)skip, false);
+            if (count == 0) {
+                break;
+            }
+            advance((uint32_t)count);
+            skip -= (int32_t)count;
+        }
+        unpin();
+    }
+
+    // Samples the consumer has read from the staging blocks rather than the backlog
+    uint32_t stagedReads() const { return stagedReads_; }
+
+private:
+    uint8_t* slotAt(uint32_t block) const { return slots_ + (size_t)(block % slotCount_) * slotBytes(Channels); }
+
+    void unpin() {
+        if (readStaged_) {
+            pinned_.store(STAGED_NO_SLOT, std::memory_order_seq_cst);
+            readStaged_ = false;
+        }
+    }
+
+    // The run peek returns; without decode a backlog run is only counted
+    size_t next(SampleSpan_t& span, size_t maxCount, bool decode) {
+        span.channels = Channels;
+        span.count = 0;
+        unpin();
+        if (maxCount > MaxSpan) {
+            maxCount = MaxSpan;
+        }
+
+        // Each pass either returns or moves past a block that has been read
+        for (;;) {
+            uint32_t block = readBlock_.load(std::memory_order_relaxed);
+
+            for (uint8_t slot = 0; slot < 2; ++slot) {
+                if (slotBlock_[slot].load(std::memory_order_relaxed) != block) {
+                    continue;
+                }
+                pinned_.store(slot, std::memory_order_seq_cst);
+                if (slotBlock_[slot].load(std::memory_order_seq_cst) == block) {
+                    uint32_t staged = stageCount_[slot].load(std::memory_order_acquire);
+                    if (readOffset_ < staged) {
+                        uint32_t count = staged - readOffset_;
+                        if (count > maxCount) {
+                            count = (uint32_t)maxCount;
+                        }
+                        span.timestampUs = &stageTimestamps_[slot][readOffset_];
+                        for (uint8_t c = 0; c < Channels; ++c) {
+                            span.values[c] = &stageValues_[slot][c][readOffset_];
+                        }
+                        span.count = count;
+                        readStaged_ = true;
+                        return count;
+                    }
+                }
+                // Reclaimed meanwhile, or read to its end: use the backlog
+                pinned_.store(STAGED_NO_SLOT, std::memory_order_seq_cst);
+                break;
+            }
+
+            // Loaded after the slot check, so a reclaimed slot's block is in
+            if (block == committed_.load(std::memory_order_acquire)) {
+                return 0;   // Caught up with the block being filled
+            }
+            const uint8_t* packed = slotAt(block);
+            PackedBlockHeader_t header;
+            memcpy(&header, packed, sizeof(header));
+            if (readOffset_ >= header.count) {
+                readOffset_ = 0;
+                readBlock_.store(block + 1, std::memory_order_release);
+                continue;
+            }
+            uint32_t count = header.count - readOffset_;
+            if (count > maxCount) {
+                count = (uint32_t)maxCount;
+            }
+            if (decode) {
+                unpackTimestamps(header, readOffset_, scratchTimestamps_, count);
+                const uint8_t* columns = packed + sizeof(PackedBlockHeader_t);
+                for (uint8_t c = 0; c < Channels; ++c) {
+                    unpackInt24(columns + ((size_t)c * Block + readOffset_) * 3, scratchValues_[c], count);
+                    span.values[c] = scratchValues_[c];
+                }
+                span.timestampUs = scratchTimestamps_;
+            }
+            span.count = count;
+            return count;
+        }
+    }
+
+    void advance(uint32_t count) {
+        readOffset_ += count;
+        read_.store(read_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        unpin();
+    }
+
+    // Pack the staged block into its backlog slot and pick the staging slot
+    // for the next block. The committed block stays readable in its slot
+    // until that slot is needed again.
+    void commit(uint8_t slot, uint32_t block, uint32_t count) {
+        uint8_t* packed = slotAt(block);
+        PackedBlockHeader_t header = {};
+        header.t0Us = stageTimestamps_[slot][0];
+        header.stepQ8 = packedStepQ8(stageTimestamps_[slot][0], stageTimestamps_[slot][count - 1], count);
+        header.count = (uint16_t)count;
+        memcpy(packed, &header, sizeof(header));
+        uint8_t* columns = packed + sizeof(PackedBlockHeader_t);
+        for (uint8_t c = 0; c < Channels; ++c) {
+            packInt24(stageValues_[slot][c], columns + (size_t)c * Block * 3, count);
+        }
+        committed_.store(block + 1, std::memory_order_release);
+
+        // As in StagedRing: the other slot, unless the consumer has it pinned
+        uint8_t next = slot ^ 1;
+        slotBlock_[next].store(STAGED_NO_BLOCK, std::memory_order_seq_cst);
+        if (pinned_.load(std::memory_order_seq_cst) == next) {
+            slotBlock_[slot].store(STAGED_NO_BLOCK, std::memory_order_seq_cst);
+            if (pinned_.load(std::memory_order_seq_cst) != slot) {
+                next = slot;
+            }
+        }
+        stageCount_[next].store(0, std::memory_order_relaxed);
+        slotBlock_[next].store(block + 1, std::memory_order_seq_cst);
+        fillSlot_ = next;
+        fillCount_ = 0;
+    }
+
+    uint8_t* slots_;
+    uint32_t slotCount_;
+
+    uint64_t stageTimestamps_[2][Block];
+    float stageValues_[2][Channels][Block];
+    std::atomic<uint32_t> slotBlock_[2];    // Block each slot holds, or STAGED_NO_BLOCK
+    std::atomic<uint32_t> stageCount_[2];   // Samples staged in each slot
+    uint8_t fillSlot_;                      // Slot the producer is filling
+    uint32_t fillCount_;                    // Producer side copy of stageCount_[fillSlot_]
+
+    std::atomic<uint32_t> committed_;       // Blocks packed into the backlog
+    std::atomic<uint32_t> written_;         // Samples
+    std::atomic<uint32_t> read_;            // Samples
+    std::atomic<uint32_t> readBlock_;       // Block the consumer is in
+    uint32_t readOffset_;                   // Consumer side: samples read of readBlock_
+    std::atomic<uint8_t> pinned_;           // Slot the consumer is reading, or STAGED_NO_SLOT
+    bool readStaged_;                       // Consumer side only
+    uint32_t stagedReads_;
+
+    uint64_t scratchTimestamps_[MaxSpan];   // Backlog samples unpacked for the last peek
+    float scratchValues_[Channels][MaxSpan];
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ============================================================================
+// PACKED 24-BIT SAMPLES
+// ============================================================================
+//
+// Storage format for queued samples. The ADS1220 converts to 24-bit two's
+// complement, and the sampler subtracts a tare offset of the same scale, so a
+// value needs 3 bytes rather than a float's 4 once it is rounded to a whole
+// count. Each channel of a block is one array of 3-byte little-endian
+// integers (struct-of-arrays, like ChannelRing).
+//
+// Samples arrive at a fixed rate, so a block keeps a single timestamp: that
+// of its first sample, plus the step between samples in 1/256 us. A sample
+// only joins a block if its timestamp is within PACKED_JITTER_US of where the
+// step puts it; a gap, a rate change or a restart closes the block early.
+//
+//   PackedBlockHeader_t   16 bytes
+//   channel 0             count * 3 bytes (room for the full block)
+//   ...
+//   channel N-1
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "packed samples assume a little-endian target"
+#endif
+
+#define PACKED_VALUE_MAX     8388607     // 2^23 - 1
+#define PACKED_VALUE_MIN     (-8388608)  // -2^23
+#define PACKED_JITTER_US     25          // Timestamp deviation a block absorbs
+#define PACKED_MAX_STEP_US   1000000     // Longest sample interval kept in one block
+
+typedef struct {
+    uint64_t t0Us;          // Timestamp of the first sample
+    uint32_t stepQ8;        // Sample interval, 1/256 microsecond
+    uint16_t count;         // Samples in the block
+    uint16_t reserved;
+} PackedBlockHeader_t;
+
+// Nearest whole count, saturated to the 24-bit range (clamped as a float, so
+// the conversion cannot overflow)
+inline int32_t packedQuantize(float value) {
+    float rounded = value + (value < 0.0f ? -0.5f : 0.5f);
+    rounded = rounded < (float)PACKED_VALUE_MIN ? (float)PACKED_VALUE_MIN : rounded;
+    rounded = rounded > (float)PACKED_VALUE_MAX ? (float)PACKED_VALUE_MAX : rounded;
+    return (int32_t)rounded;
+}
+
+// count values from src as 3-byte integers into dst (3 * count bytes).
+// Four samples make three 32-bit words.
+inline void packInt24(const float* src, uint8_t* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4, dst += 12) {
+        uint32_t a = (uint32_t)packedQuantize(src[i]) & 0xFFFFFF;
+        uint32_t b = (uint32_t)packedQuantize(src[i + 1]) & 0xFFFFFF;
+        uint32_t c = (uint32_t)packedQuantize(src[i + 2]) & 0xFFFFFF;
+        uint32_t d = (uint32_t)packedQuantize(src[i + 3]) & 0xFFFFFF;
+        uint32_t words[3] = { a | (b << 24), (b >> 8) | (c << 16), (c >> 16) | (d << 8) };
+        memcpy(dst, words, sizeof(words));
+    }
+    for (; i < count; ++i, dst += 3) {
+        uint32_t v = (uint32_t)packedQuantize(src[i]);
+        dst[0] = (uint8_t)v;
+        dst[1] = (uint8_t)(v >> 8);
+        dst[2] = (uint8_t)(v >> 16);
+    }
+}
+
+// Inverse of packInt24; values come back as floats of whole counts
+inline void unpackInt24(const uint8_t* src, float* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4, src += 12) {
+        uint32_t w[3];
+        memcpy(w, src, sizeof(w));
+        dst[i] = (float)((int32_t)(w[0] << 8) >> 8);
+        dst[i + 1] = (float)((int32_t)(((w[0] >> 24) | (w[1] << 8)) << 8) >> 8);
+        dst[i + 2] = (float)((int32_t)(((w[1] >> 16) | (w[2] << 16)) << 8) >> 8);
+        dst[i + 3] = (float)((int32_t)w[2] >> 8);
+    }
+    for (; i < count; ++i, src += 3) {
+        uint32_t v = (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16);
+        dst[i] = (float)((int32_t)(v << 8) >> 8);
+    }
+}
+
+// Whether a sample at t continues a block of count samples that starts at t0
+// and whose last sample is at last
+inline bool packedContinues(uint64_t t0, uint64_t last, uint32_t count, uint64_t t) {
+    if (t <= last) {
+        return false;
+    }
+    if (count == 1) {
+        return t - last <= PACKED_MAX_STEP_US;
+    }
+    // Distance from where the block's mean step so far puts the next sample,
+    // scaled by count - 1 to keep the division off the sampler's path
+    uint64_t actual = (t - t0) * (count - 1);
+    uint64_t expected = (last - t0) * count;
+    uint64_t deviation = actual > expected ? actual - expected : expected - actual;
+    return deviation <= (uint64_t)PACKED_JITTER_US * (count - 1);
+}
+
+inline uint32_t packedStepQ8(uint64_t t0, uint64_t last, uint32_t count) {
+    if (count < 2) {
+        return 0;
+    }
+    return (uint32_t)((((last - t0) << 8) + (count - 1) / 2) / (count - 1));
+}
+
+// Timestamps of samples first .. first + count - 1 of a block
+inline void unpackTimestamps(const PackedBlockHeader_t& header, uint32_t first, uint64_t* dst, size_t count) {
+    uint64_t offsetQ8 = (uint64_t)first * header.stepQ8 + 128;
+    for (size_t i = 0; i < count; ++i, offsetQ8 += header.stepQ8) {
+        dst[i] = header.t0Us + (offsetQ8 >> 8);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// COMPILE-TIME PIPELINE CONFIGURATION
+// ============================================================================
+//
+// The acquisition -> buffer -> encode pipeline is sized by one config struct
+// per PlatformIO environment, chosen with a PIPELINE_* build flag in
+// platformio.ini. Everything is constexpr: the sampler and sender tasks,
+// ChannelRing and the frame buffers are instantiated from it, so channel
+// loops have a constant trip count, buffers are statically sized and stages
+// an environment leaves out are discarded with `if constexpr`. With a
+// stagingBlock the queue is a StagedRing: the sampler writes SRAM blocks
+// that are copied to the PSRAM queue whole. packedQueue makes it a
+// PackedRing, which stores those blocks as 24-bit values with one timestamp
+// per block, so queueLength buys about 40% of the bytes.
+
+struct DefaultPipeline {
+    static constexpr uint8_t channels = 2;              // Rows in the channel table
+    static constexpr uint32_t queueLength = 240000;     // Samples buffered between sampler and sender
+    static constexpr bool psramQueue = true;            // Queue in PSRAM, else a static DRAM array
+    static constexpr uint16_t stagingBlock = 32;        // Samples staged in SRAM per PSRAM copy, 0 = none
+    static constexpr bool packedQueue = true;           // 24-bit packed blocks (needs a stagingBlock)
+    static constexpr uint32_t samplingIntervalMs = 1;   // 1ms = 1000 Hz sampling
+
+    // Adaptive batch bounds (BatchConfig_t)
+    static constexpr uint16_t minBatch = 20;            // Smallest frame, used on an idle link
+    static constexpr uint16_t maxBatch = 250;           // Largest frame, used on a slow link
+    static constexpr uint16_t maxLatencyMs = 100;       // Frame span while the link keeps up
+    static constexpr uint16_t maxFramesPerSecond = 50;  // Frame rate ceiling
+    static constexpr uint8_t sendQueueFrames = 4;       // Encoded frames queued for the network task
+
+    // Optional stages
+    static constexpr bool udpTransport = true;          // UDP datagrams with parity/NACK recovery
+    static constexpr uint16_t udpHistorySlots = 64;     // Datagrams kept for NACK retransmits
+    static constexpr bool triggerCapture = true;        // Threshold trigger with pre-trigger history
+    static constexpr uint16_t preTriggerMs = 1000;      // History emitted ahead of a trigger
+    static constexpr bool directServer = true;          // WebSocket server for apps connecting directly
+    static constexpr bool usbTransport = true;          // Backend link over native USB CDC when a host is attached
+};
+
+// ESP32-S3 DevKitC with 8 MB PSRAM
+struct Esp32s3Pipeline : DefaultPipeline {};
+
+// Arduino Nano ESP32 (ESP32-S3, 8 MB PSRAM)
+struct NanoEsp32Pipeline : DefaultPipeline {};
+
+// Classic ESP32 modules usually have no PSRAM: a short queue in DRAM (with
+// nothing to stage in front of it), and no UDP retransmit history or
+// direct-client sockets to hold
+struct Esp32devPipeline : DefaultPipeline {
+    static constexpr uint32_t queueLength = 4000;
+    static constexpr bool psramQueue = false;
+    static constexpr uint16_t stagingBlock = 0;
+    static constexpr bool packedQueue = false;
+    static constexpr uint8_t sendQueueFrames = 2;
+    static constexpr bool udpTransport = false;
+    static constexpr bool directServer = false;
+    static constexpr bool usbTransport = false;         // Serial is a UART bridge
+};
+
+// Host build for the native tests and benchmarks
+struct NativePipeline : DefaultPipeline {
+    static constexpr uint32_t queueLength = 4096;
+    static constexpr bool psramQueue = false;
+};
+
+#if defined(PIPELINE_ESP32S3)
+typedef Esp32s3Pipeline Pipeline;
+#elif defined(PIPELINE_NANO_ESP32)
+typedef NanoEsp32Pipeline Pipeline;
+#elif defined(PIPELINE_ESP32DEV)
+typedef Esp32devPipeline Pipeline;
+#elif defined(PIPELINE_NATIVE)
+typedef NativePipeline Pipeline;
+#else
+typedef DefaultPipeline Pipeline;
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// IDLE POWER STATE AND WAKE LATENCY
+// ============================================================================
+//
+// While idle the ADS1220s are powered down, the sampler and sender block on a
+// task notification and WiFi uses modem sleep. A start command brings
+// everything back; the time from the command to the first sample handed to
+// the sender is the wake latency, tracked here against a fixed budget.
+// Timestamps are microseconds (esp_timer_get_time() on the ESP32).
+
+#define WAKE_LATENCY_BUDGET_US   5000       // Start command to first sample
+
+typedef struct {
+    uint64_t requestedAt;       // Time of the pending start command
+    bool pending;               // Waiting for the first sample after a wake
+    uint32_t last;
+    uint32_t max;
+    uint64_t total;
+    uint32_t count;
+    uint32_t overBudget;        // Wakes that took longer than the budget
+} WakeLatency_t;
+
+// Called when a start command arrives
+inline void wakeLatencyStart(WakeLatency_t& wake, uint64_t nowUs) {
+    wake.requestedAt = nowUs;
+    wake.pending = true;
+}
+
+// Called for every sample; only the first one after a start is recorded.
+// Returns true when it was, so the latency can be reported.
+inline bool wakeLatencyFirstSample(WakeLatency_t& wake, uint64_t nowUs,
+                                   uint32_t budgetUs = WAKE_LATENCY_BUDGET_US) {
+    if (!wake.pending) {
+        return false;
+    }
+    wake.pending = false;
+    uint64_t elapsed = nowUs > wake.requestedAt ? nowUs - wake.requestedAt : 0;
+    uint32_t latency = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+
+    wake.last = latency;
+    if (latency > wake.max) {
+        wake.max = latency;
+    }
+    wake.total += latency;
+    wake.count++;
+    if (latency > budgetUs) {
+        wake.overBudget++;
+    }
+    return true;
+}
+
+inline uint32_t wakeLatencyMean(const WakeLatency_t& wake) {
+    return wake.count ? (uint32_t)(wake.total / wake.count) : 0;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include "sample_types.h"
+
+// ============================================================================
+// SAMPLE BATCH ENCODER
+// ============================================================================
+//
+// Serializes a batch of samples as
+//
+//   {"t0":12345678901,"ch":2,"samples":[{"dt":0,"v":[-1.5,2]},{"dt":1000,...},...]}
+//
+// straight into a caller-owned buffer. No JsonDocument, no String and no heap:
+// the sender encodes into a FrameQueue slot, and the network task's
+// FrameWriter frames and masks it in place (frame_sender.h). Values are
+// written with at most two decimals, which is well below the resolution of
+// the raw ADC counts.
+//
+// t0 is the 64-bit microsecond timestamp of the first sample and dt the
+// offset of each sample from it, which keeps frames compact while preserving
+// full timestamp precision. ch is the channel count and v holds one value per
+// channel in channel-table order.
+
+#define SAMPLE_FRAME_BASE         "{\"t0\":"
+#define SAMPLE_FRAME_CHANNELS     ",\"ch\":"
+#define SAMPLE_FRAME_PREFIX       ",\"samples\":["
+#define SAMPLE_FRAME_SUFFIX       "]}"
+#define SAMPLE_FRAME_BASE_DIGITS  20   // uint64 t0
+#define SAMPLE_FRAME_OVERHEAD     (sizeof(SAMPLE_FRAME_BASE) - 1 + SAMPLE_FRAME_BASE_DIGITS + \
+                                   sizeof(SAMPLE_FRAME_CHANNELS) - 1 + 3 + \
+                                   sizeof(SAMPLE_FRAME_PREFIX) - 1 + sizeof(SAMPLE_FRAME_SUFFIX) - 1)
+// {"dt":4294967295,"v":[-2000000000.00,...]} plus comma
+#define SAMPLE_JSON_MAX_BYTES(channels) (24 + 15 * (channels))
+#define SAMPLE_VALUE_LIMIT        2.0e9f
+
+namespace encoder_detail {
+
+inline char* appendLiteral(char* p, const char* text) {
+    while (*text) {
+        *p++ = *text++;
+    }
+    return p;
+}
+
+inline char* appendUnsigned(char* p, uint64_t value) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+inline char* appendFixed2(char* p, float value) {
+    if (isnan(value) || isinf(value)) {
+        *p++ = '0';
+        return p;
+    }
+    if (value > SAMPLE_VALUE_LIMIT) {
+        value = SAMPLE_VALUE_LIMIT;
+    } else if (value < -SAMPLE_VALUE_LIMIT) {
+        value = -SAMPLE_VALUE_LIMIT;
+    }
+    // Split before scaling: value * 100 would exceed float precision for
+    // large counts, while value - truncf(value) is exact
+    bool negative = value < 0.0f;
+    float magnitude = negative ? -value : value;
+    float whole = truncf(magnitude);
+    uint64_t integer = (uint64_t)whole;
+    uint32_t fraction = (uint32_t)lroundf((magnitude - whole) * 100.0f);
+    if (fraction >= 100) {
+        integer++;
+        fraction -= 100;
+    }
+    if (negative && (integer || fraction)) {
+        *p++ = '-';
+    }
+    p = appendUnsigned(p, integer);
+    if (fraction) {
+        *p++ = '.';
+        *p++ = (char)('0' + fraction / 10);
+        if (fraction % 10) {
+            *p++ = (char)('0' + fraction % 10);
+        }
+    }
+    return p;
+}
+
+} // namespace encoder_detail
+
+// Encode as many samples as fit into out[0..capacity). Returns the frame
+// length in bytes (not NUL terminated) and the number of samples consumed in
+// encodedCount; returns 0 if not even one sample fits. A sample more than
+// UINT32_MAX microseconds after the first ends the frame early.
+inline size_t encodeSampleBatch(const SampleSpan_t& span,
+                                char* out, size_t capacity, size_t& encodedCount) {
+    using namespace encoder_detail;
+
+    const size_t sampleBytes = SAMPLE_JSON_MAX_BYTES(span.channels);
+    encodedCount = 0;
+    if (span.count == 0 || span.channels == 0 || capacity < SAMPLE_FRAME_OVERHEAD + sampleBytes) {
+        return 0;
+    }
+
+    const uint64_t base = span.timestampUs[0];
+    char* p = appendLiteral(out, SAMPLE_FRAME_BASE);
+    p = appendUnsigned(p, base);
+    p = appendLiteral(p, SAMPLE_FRAME_CHANNELS);
+    p = appendUnsigned(p, span.channels);
+    p = appendLiteral(p, SAMPLE_FRAME_PREFIX);
+    const char* limit = out + capacity - (sizeof(SAMPLE_FRAME_SUFFIX) - 1);
+
+    while (encodedCount < span.count && p + sampleBytes <= limit) {
+        uint64_t timestamp = span.timestampUs[encodedCount];
+        if (timestamp < base || timestamp - base > UINT32_MAX) {
+            break;
+        }
+        if (encodedCount) {
+            *p++ = ',';
+        }
+        p = appendLiteral(p, "{\"dt\":");
+        p = appendUnsigned(p, timestamp - base);
+        p = appendLiteral(p, ",\"v\":[");
+        for (uint8_t c = 0; c < span.channels; ++c) {
+            if (c) {
+                *p++ = ',';
+            }
+            p = appendFixed2(p, span.values[c][encodedCount]);
+        }
+        *p++ = ']';
+        *p++ = '}';
+        encodedCount++;
+    }
+
+    p = appendLiteral(p, SAMPLE_FRAME_SUFFIX);
+    return (size_t)(p - out);
+}
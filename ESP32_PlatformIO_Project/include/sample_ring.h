@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// SAMPLE RING BUFFER
+// ============================================================================
+//
+// Single-producer (sampler) / single-consumer (sender) ring over externally
+// allocated storage, e.g. the PSRAM sample buffer. Positions are free-running
+// 32-bit counters, so backlog = written - read even across wrap-around.
+
+template <typename T>
+class SampleRing {
+public:
+    SampleRing() : storage_(nullptr), capacity_(0), written_(0), read_(0) {}
+
+    void attach(T* storage, uint32_t capacity) {
+        storage_ = storage;
+        capacity_ = capacity;
+        written_.store(0, std::memory_order_relaxed);
+        read_.store(0, std::memory_order_relaxed);
+    }
+
+    uint32_t capacity() const { return capacity_; }
+
+    // Producer side
+    bool push(const T& item) {
+        uint32_t w = written_.load(std::memory_order_relaxed);
+        if (w - read_.load(std::memory_order_acquire) >= capacity_) {
+            return false;
+        }
+        storage_[w % capacity_] = item;
+        written_.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t written() const { return written_.load(std::memory_order_acquire); }
+
+    // Consumer side
+    uint32_t available() const {
+        return written_.load(std::memory_order_acquire) - read_.load(std::memory_order_relaxed);
+    }
+
+    // Longest contiguous run of unread items, capped at maxCount
+    size_t peek(const T*& first, size_t maxCount) const {
+        uint32_t r = read_.load(std::memory_order_relaxed);
+        uint32_t count = written_.load(std::memory_order_acquire) - r;
+        uint32_t offset = r % capacity_;
+        if (count > capacity_ - offset) {
+            count = capacity_ - offset;
+        }
+        if (count > maxCount) {
+            count = (uint32_t)maxCount;
+        }
+        first = &storage_[offset];
+        return count;
+    }
+
+    void consume(size_t count) {
+        read_.store(read_.load(std::memory_order_relaxed) + (uint32_t)count, std::memory_order_release);
+    }
+
+    // Drop everything written before position (a value previously returned by
+    // written()); used to start a new session without racing the producer
+    void skipTo(uint32_t position) {
+        uint32_t r = read_.load(std::memory_order_relaxed);
+        if ((int32_t)(position - r) > 0) {
+            read_.store(position, std::memory_order_release);
+        }
+    }
+
+private:
+    T* storage_;
+    uint32_t capacity_;
+    std::atomic<uint32_t> written_;
+    std::atomic<uint32_t> read_;
+};
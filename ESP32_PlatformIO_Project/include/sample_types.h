@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// SAMPLE TYPES
+// ============================================================================
+
+#ifndef MAX_CHANNELS
+#define MAX_CHANNELS 8                      // ADS1220 devices on the SPI bus
+#endif
+
+// One conversion of every channel. timestampUs is esp_timer time
+// (microseconds since boot) captured at the DRDY edge of the conversion, so
+// it does not wrap. Only the first channelCount values are used.
+typedef struct {
+    uint64_t timestampUs;
+    float values[MAX_CHANNELS];
+} Sample_t;
+
+// Contiguous run of samples in struct-of-arrays layout: one timestamp array
+// and one value array per channel
+typedef struct {
+    const uint64_t* timestampUs;
+    const float* values[MAX_CHANNELS];
+    uint8_t channels;
+    size_t count;
+} SampleSpan_t;
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "sample_types.h"
+
+// ============================================================================
+// SRAM-STAGED SAMPLE RING
+// ============================================================================
+//
+// ChannelRing with internal-SRAM staging in front of the backlog. The backlog
+// columns live in external storage (the PSRAM sample buffer); the sampler
+// never writes them sample by sample. It fills a Block-sample staging block
+// held in this object (internal DRAM when the ring is a global), and when
+// the block is full copies each column into the backlog with one memcpy.
+//
+// There are two staging slots: the block being filled and the one committed
+// before it. The sender reads either straight from SRAM, so a sender that
+// keeps up never touches PSRAM; samples it has fallen behind on are read from
+// the backlog.
+//
+// Slot hand-over: the sender pins a slot, then checks the slot still holds
+// its block; the sampler invalidates a slot, then checks it is not pinned
+// before reusing it. Both sides use sequentially consistent operations, so
+// either the sampler sees the pin and fills the other slot, or the sender
+// sees the invalidation and reads the backlog, which already holds the
+// committed block. Neither side waits.
+//
+// Capacity must be a multiple of Block, so a block never wraps the backlog.
+
+#define STAGED_NO_SLOT   0xFF
+#define STAGED_NO_BLOCK  0xFFFFFFFFu
+
+template <uint8_t Channels, uint16_t Block>
+class StagedRing {
+    static_assert(Channels >= 1 && Channels <= MAX_CHANNELS, "channel count out of range");
+    static_assert(Block >= 2 && (Block & (Block - 1)) == 0,
+                  "staging block must be a power of two, so blocks stay aligned when positions wrap");
+
+public:
+    StagedRing() : timestamps_(nullptr), values_(nullptr), capacity_(0), fillSlot_(0),
+                   committed_(0), written_(0), read_(0), pinned_(STAGED_NO_SLOT),
+                   readStaged_(false), stagedReads_(0) {
+        slotBlock_[0].store(0, std::memory_order_relaxed);
+        slotBlock_[1].store(STAGED_NO_BLOCK, std::memory_order_relaxed);
+    }
+
+    // Backlog bytes; the staging blocks are part of the object
+    static constexpr size_t storageBytes(uint8_t channels, uint32_t capacity) {
+        return (size_t)capacity * (sizeof(uint64_t) + channels * sizeof(float));
+    }
+
+    static constexpr size_t stagingBytes() {
+        return 2 * (size_t)Block * (sizeof(uint64_t) + Channels * sizeof(float));
+    }
+
+    // storage must hold storageBytes(Channels, capacity) bytes, aligned for
+    // uint64_t; capacity must be a multiple of Block. Not safe while either
+    // task is running.
+    void attach(void* storage, uint8_t channels, uint32_t capacity) {
+        (void)channels;
+        timestamps_ = (uint64_t*)storage;
+        values_ = (float*)(timestamps_ + capacity);
+        capacity_ = capacity - capacity % Block;
+        fillSlot_ = 0;
+        slotBlock_[0].store(0, std::memory_order_relaxed);
+        slotBlock_[1].store(STAGED_NO_BLOCK, std::memory_order_relaxed);
+        committed_.store(0, std::memory_order_relaxed);
+        written_.store(0, std::memory_order_relaxed);
+        read_.store(0, std::memory_order_relaxed);
+        pinned_.store(STAGED_NO_SLOT, std::memory_order_relaxed);
+        readStaged_ = false;
+        stagedReads_ = 0;
+    }
+
+    uint8_t channels() const { return Channels; }
+    uint32_t capacity() const { return capacity_; }
+
+    // Producer side
+    bool push(const Sample_t& sample) {
+        uint32_t w = written_.load(std::memory_order_relaxed);
+        if (w - read_.load(std::memory_order_acquire) >= capacity_) {
+            return false;
+        }
+        uint8_t slot = fillSlot_;
+        uint32_t offset = w % Block;
+        stageTimestamps_[slot][offset] = sample.timestampUs;
+        for (uint8_t c = 0; c < Channels; ++c) {
+            stageValues_[slot][c][offset] = sample.values[c];
+        }
+        written_.store(w + 1, std::memory_order_release);
+        if (offset == Block - 1) {
+            commit(slot, w + 1 - Block);
+        }
+        return true;
+    }
+
+    uint32_t written() const { return written_.load(std::memory_order_acquire); }
+
+    // Consumer side
+    uint32_t available() const {
+        return written_.load(std::memory_order_acquire) - read_.load(std::memory_order_relaxed);
+    }
+
+    // Longest contiguous run of unread samples, capped at maxCount: from a
+    // staging slot if one still holds the read position's block, else from
+    // the backlog (up to the end of the committed blocks)
+    size_t peek(SampleSpan_t& span, size_t maxCount) {
+        uint32_t r = read_.load(std::memory_order_relaxed);
+        uint32_t w = written_.load(std::memory_order_acquire);
+        uint32_t block = r / Block;
+        span.channels = Channels;
+        if (readStaged_) {
+            pinned_.store(STAGED_NO_SLOT, std::memory_order_seq_cst);
+            readStaged_ = false;
+        }
+
+        for (uint8_t slot = 0; slot < 2; ++slot) {
+            if (slotBlock_[slot].load(std::memory_order_relaxed) != block) {
+                continue;
+            }
+            pinned_.store(slot, std::memory_order_seq_cst);
+            if (slotBlock_[slot].load(std::memory_order_seq_cst) != block) {
+                // Reclaimed meanwhile: the block is in the backlog by now
+                pinned_.store(STAGED_NO_SLOT, std::memory_order_seq_cst);
+                break;
+            }
+            uint32_t offset = r % Block;
+            uint32_t count = w - r;
+            if (count > Block - offset) {
+                count = Block - offset;
+            }
+            if (count > maxCount) {
+                count = (uint32_t)maxCount;
+            }
+            span.timestampUs = &stageTimestamps_[slot][offset];
+            for (uint8_t c = 0; c < Channels; ++c) {
+                span.values[c] = &stageValues_[slot][c][offset];
+            }
+            span.count = count;
+            readStaged_ = true;
+            return count;
+        }
+
+        // Nothing committed past r while the producer is between blocks
+        int32_t committed = (int32_t)(committed_.load(std::memory_order_acquire) - r);
+        uint32_t count = committed > 0 ? (uint32_t)committed : 0;
+        uint32_t offset = r % capacity_;
+        if (count > capacity_ - offset) {
+            count = capacity_ - offset;
+        }
+        if (count > maxCount) {
+            count = (uint32_t)maxCount;
+        }
+        span.timestampUs = &timestamps_[offset];
+        for (uint8_t c = 0; c < Channels; ++c) {
+            span.values[c] = &values_[(size_t)c * capacity_ + offset];
+        }
+        span.count = count;
+        return count;
+    }
+
+    void consume(size_t count) {
+        if (readStaged_) {
+            stagedReads_ += (uint32_t)count;
+        }
+        read_.store(read_.load(std::memory_order_relaxed) + (uint32_t)count, std::memory_order_release);
+        readStaged_ = false;
+        pinned_.store(STAGED_NO_SLOT, std::memory_order_seq_cst);
+    }
+
+    // Drop everything written before position (a value previously returned by
+    // written()); used to start a new session without racing the producer
+    void skipTo(uint32_t position) {
+        uint32_t r = read_.load(std::memory_order_relaxed);
+        if ((int32_t)(position - r) > 0) {
+            read_.store(position, std::memory_order_release);
+        }
+        readStaged_ = false;
+        pinned_.store(STAGED_NO_SLOT, std::memory_order_seq_cst);
+    }
+
+    // Samples the consumer has read from the staging blocks rather than the backlog
+    uint32_t stagedReads() const { return stagedReads_; }
+
+private:
+    // Copy a full staging block into the backlog and pick the slot for the
+    // next block. The committed block stays readable in its slot until that
+    // slot is needed again.
+    void commit(uint8_t slot, uint32_t position) {
+        uint32_t offset = position % capacity_;
+        memcpy(&timestamps_[offset], stageTimestamps_[slot], sizeof(stageTimestamps_[slot]));
+        for (uint8_t c = 0; c < Channels; ++c) {
+            memcpy(&values_[(size_t)c * capacity_ + offset], stageValues_[slot][c], sizeof(stageValues_[slot][c]));
+        }
+        committed_.store(position + Block, std::memory_order_release);
+
+        // Normally the other slot (the block before this one). If the
+        // consumer is reading it, take this one instead: the consumer holds a
+        // single pin, and once both are invalidated it cannot pin either.
+        uint8_t next = slot ^ 1;
+        slotBlock_[next].store(STAGED_NO_BLOCK, std::memory_order_seq_cst);
+        if (pinned_.load(std::memory_order_seq_cst) == next) {
+            slotBlock_[slot].store(STAGED_NO_BLOCK, std::memory_order_seq_cst);
+            if (pinned_.load(std::memory_order_seq_cst) != slot) {
+                next = slot;
+            }
+        }
+        slotBlock_[next].store((position + Block) / Block, std::memory_order_seq_cst);
+        fillSlot_ = next;
+    }
+
+    uint64_t* timestamps_;
+    float* values_;
+    uint32_t capacity_;
+
+    uint64_t stageTimestamps_[2][Block];
+    float stageValues_[2][Channels][Block];
+    std::atomic<uint32_t> slotBlock_[2];    // Block each slot holds, or STAGED_NO_BLOCK
+    uint8_t fillSlot_;                      // Slot the producer is filling
+
+    std::atomic<uint32_t> committed_;       // Samples copied to the backlog (a multiple of Block)
+    std::atomic<uint32_t> written_;
+    std::atomic<uint32_t> read_;
+    std::atomic<uint8_t> pinned_;           // Slot the consumer is reading, or STAGED_NO_SLOT
+    bool readStaged_;                       // Consumer side only
+    uint32_t stagedReads_;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// TRIGGERED CAPTURE
+// ============================================================================
+//
+// While armed, the last preTriggerSamples are kept in a rolling history and
+// nothing is emitted. When the total force crosses the threshold the history
+// is emitted first (so onset detection still sees the baseline), followed by
+// every live sample until the force has stayed below the threshold for
+// postTriggerHoldSamples. Then the capture re-arms for the next trial.
+
+typedef struct {
+    float threshold;                  // Total force above tare that starts a capture
+    uint32_t preTriggerSamples;       // History emitted ahead of the trigger
+    uint32_t postTriggerHoldSamples;  // Samples below threshold that end a capture
+} TriggerConfig_t;
+
+template <typename T, uint32_t HistoryCapacity>
+class TriggerCapture {
+public:
+    enum State : uint8_t {
+        Armed,
+        Capturing
+    };
+
+    TriggerCapture() : head_(0), count_(0), state_(Armed), belowCount_(0), captures_(0) {
+        config_.threshold = 0.0f;
+        config_.preTriggerSamples = HistoryCapacity;
+        config_.postTriggerHoldSamples = 0;
+    }
+
+    void configure(const TriggerConfig_t& config) {
+        config_ = config;
+        if (config_.preTriggerSamples > HistoryCapacity) {
+            config_.preTriggerSamples = HistoryCapacity;
+        }
+        captures_ = 0;
+        reset();
+    }
+
+    // Drop history and re-arm
+    void reset() {
+        head_ = 0;
+        count_ = 0;
+        state_ = Armed;
+        belowCount_ = 0;
+    }
+
+    // Feed one sample with its total force; emit(const T&) is called for
+    // every sample that belongs to a capture, in order
+    template <typename Emit>
+    void process(const T& sample, float force, Emit&& emit) {
+        bool above = force > config_.threshold;
+
+        if (state_ == Armed) {
+            remember(sample);
+            if (!above) {
+                return;
+            }
+            // History already ends with the triggering sample
+            uint32_t start = (head_ + HistoryCapacity - count_) % HistoryCapacity;
+            for (uint32_t i = 0; i < count_; ++i) {
+                emit(history_[(start + i) % HistoryCapacity]);
+            }
+            count_ = 0;
+            state_ = Capturing;
+            belowCount_ = 0;
+            captures_++;
+            return;
+        }
+
+        emit(sample);
+        if (above) {
+            belowCount_ = 0;
+        } else if (++belowCount_ >= config_.postTriggerHoldSamples) {
+            reset();
+        }
+    }
+
+    State state() const { return state_; }
+    uint32_t captures() const { return captures_; }
+    const TriggerConfig_t& config() const { return config_; }
+
+private:
+    void remember(const T& sample) {
+        if (config_.preTriggerSamples == 0) {
+            // No history requested: only the triggering sample is emitted
+            head_ = 0;
+            count_ = 0;
+        }
+        history_[head_] = sample;
+        head_ = (head_ + 1) % HistoryCapacity;
+        uint32_t keep = config_.preTriggerSamples ? config_.preTriggerSamples : 1;
+        if (count_ < keep) {
+            count_++;
+        }
+    }
+
+    T history_[HistoryCapacity];
+    uint32_t head_;
+    uint32_t count_;
+    TriggerConfig_t config_;
+    State state_;
+    uint32_t belowCount_;
+    uint32_t captures_;
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "sample_types.h"
+
+// ============================================================================
+// UDP SAMPLE DATAGRAMS
+// ============================================================================
+//
+// Binary datagram format for the UDP transport (all fields little-endian):
+//
+//   offset  size  field
+//   0       2     magic 0x4C55 ("UL")
+//   2       1     version
+//   3       1     type: 0 = data, 1 = XOR parity
+//   4       4     sequence number (data) / first sequence covered (parity)
+//   8       2     sample count (data) / parity block length (parity)
+//   10      2     datagrams covered by a parity frame, 0 for data
+//   12      ...   data: uint8 channels, uint8 reserved, uint64 t0 (microseconds),
+//                 then count * { uint32 dt (microseconds after t0),
+//                                float32 value per channel }
+//                 parity: XOR of the covered data blocks, where a block is
+//                 [uint16 count][channels, t0][samples...] zero-padded to the
+//                 longest one
+//
+// One parity datagram after every group of data datagrams lets the receiver
+// rebuild a single lost datagram per group without a round trip. Anything
+// else is requested again with a NACK on the WebSocket control channel and
+// served from a small history of recent datagrams. A parity datagram covering
+// zero datagrams is a position marker, sent when the stream pauses so the
+// receiver also notices losses at the tail.
+
+#define UDP_FRAME_MAGIC        0x4C55
+#define UDP_FRAME_VERSION      3
+#define UDP_FRAME_DATA         0
+#define UDP_FRAME_PARITY       1
+#define UDP_HEADER_BYTES       12
+#define UDP_BASE_BYTES         10
+#define UDP_MAX_SAMPLES        100
+#define UDP_MAX_DATAGRAM       1400          // Stays below a 1500-byte MTU
+#define UDP_MAX_BLOCK          (2 + UDP_MAX_DATAGRAM - UDP_HEADER_BYTES)
+#define UDP_HISTORY_SLOT_BYTES (2 + UDP_MAX_DATAGRAM)
+#define UDP_SAMPLE_BYTES(channels) (4 + 4 * (channels))
+
+// Samples that fit one datagram for a channel count
+inline size_t udpSamplesPerDatagram(uint8_t channels) {
+    size_t fit = (UDP_MAX_DATAGRAM - UDP_HEADER_BYTES - UDP_BASE_BYTES) / UDP_SAMPLE_BYTES(channels);
+    return fit < UDP_MAX_SAMPLES ? fit : UDP_MAX_SAMPLES;
+}
+
+namespace udp_detail {
+
+inline void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+inline void put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+inline void put64(uint8_t* p, uint64_t v) {
+    put32(p, (uint32_t)v);
+    put32(p + 4, (uint32_t)(v >> 32));
+}
+
+inline uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t get32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline void putHeader(uint8_t* p, uint8_t type, uint32_t seq, uint16_t count, uint16_t group) {
+    put16(p, UDP_FRAME_MAGIC);
+    p[2] = UDP_FRAME_VERSION;
+    p[3] = type;
+    put32(p + 4, seq);
+    put16(p + 8, count);
+    put16(p + 10, group);
+}
+
+} // namespace udp_detail
+
+class UdpFramer {
+public:
+    UdpFramer()
+        : history_(nullptr), historySlots_(0), parityGroup_(0), nextSeq_(0),
+          groupStart_(0), groupCount_(0), parityLength_(0) {}
+
+    // Optional retransmit history: slots * UDP_HISTORY_SLOT_BYTES of storage
+    void attachHistory(uint8_t* storage, uint16_t slots) {
+        history_ = storage;
+        historySlots_ = storage ? slots : 0;
+        if (history_) {
+            memset(history_, 0, (size_t)historySlots_ * UDP_HISTORY_SLOT_BYTES);
+        }
+    }
+
+    // Send one parity datagram per group data datagrams; 0 disables parity
+    void setParityGroup(uint8_t group) {
+        parityGroup_ = group;
+        groupCount_ = 0;
+        parityLength_ = 0;
+    }
+
+    uint8_t parityGroup() const { return parityGroup_; }
+    uint32_t nextSeq() const { return nextSeq_; }
+
+    void reset() {
+        nextSeq_ = 0;
+        groupCount_ = 0;
+        parityLength_ = 0;
+        if (history_) {
+            memset(history_, 0, (size_t)historySlots_ * UDP_HISTORY_SLOT_BYTES);
+        }
+    }
+
+    // Encode as many samples of span as fit one datagram into out
+    // (UDP_MAX_DATAGRAM bytes). Returns the datagram length; encodedCount
+    // receives the samples used. A sample more than UINT32_MAX microseconds
+    // after the first ends the datagram early.
+    size_t encodeData(const SampleSpan_t& span, uint8_t* out, size_t& encodedCount) {
+        using namespace udp_detail;
+
+        size_t count = span.count;
+        size_t fit = span.channels ? udpSamplesPerDatagram(span.channels) : 0;
+        if (count > fit) {
+            count = fit;
+        }
+        encodedCount = 0;
+        if (count == 0) {
+            return 0;
+        }
+
+        const uint64_t base = span.timestampUs[0];
+        while (encodedCount < count && span.timestampUs[encodedCount] >= base &&
+               span.timestampUs[encodedCount] - base <= UINT32_MAX) {
+            encodedCount++;
+        }
+        count = encodedCount;
+
+        uint32_t seq = nextSeq_++;
+        putHeader(out, UDP_FRAME_DATA, seq, (uint16_t)count, 0);
+        out[UDP_HEADER_BYTES] = span.channels;
+        out[UDP_HEADER_BYTES + 1] = 0;
+        put64(out + UDP_HEADER_BYTES + 2, base);
+        uint8_t* p = out + UDP_HEADER_BYTES + UDP_BASE_BYTES;
+        for (size_t i = 0; i < count; ++i) {
+            put32(p, (uint32_t)(span.timestampUs[i] - base));
+            p += 4;
+            for (uint8_t c = 0; c < span.channels; ++c) {
+                uint32_t bits;
+                memcpy(&bits, &span.values[c][i], sizeof(bits));
+                put32(p, bits);
+                p += 4;
+            }
+        }
+        size_t length = (size_t)(p - out);
+
+        remember(seq, out, length);
+        accumulateParity(seq, out, length);
+        return length;
+    }
+
+    // Parity datagram for the group just completed, or 0 if none is due.
+    // flush emits parity for a partial group, e.g. when the stream pauses.
+    size_t takeParity(uint8_t* out, bool flush = false) {
+        using namespace udp_detail;
+
+        if (parityGroup_ == 0 || groupCount_ == 0 || (groupCount_ < parityGroup_ && !flush)) {
+            return 0;
+        }
+        putHeader(out, UDP_FRAME_PARITY, groupStart_, parityLength_, groupCount_);
+        memcpy(out + UDP_HEADER_BYTES, parity_, parityLength_);
+        size_t length = UDP_HEADER_BYTES + parityLength_;
+        groupCount_ = 0;
+        parityLength_ = 0;
+        return length;
+    }
+
+    // Position marker announcing the next sequence number
+    size_t encodeMarker(uint8_t* out) const {
+        udp_detail::putHeader(out, UDP_FRAME_PARITY, nextSeq_, 0, 0);
+        return UDP_HEADER_BYTES;
+    }
+
+    // Copy a recent datagram back out for a NACK; 0 if it has been overwritten
+    size_t retransmit(uint32_t seq, uint8_t* out) const {
+        using namespace udp_detail;
+
+        if (historySlots_ == 0) {
+            return 0;
+        }
+        const uint8_t* slot = history_ + (size_t)(seq % historySlots_) * UDP_HISTORY_SLOT_BYTES;
+        uint16_t length = get16(slot);
+        if (length < UDP_HEADER_BYTES || get32(slot + 2 + 4) != seq) {
+            return 0;
+        }
+        memcpy(out, slot + 2, length);
+        return length;
+    }
+
+private:
+    void remember(uint32_t seq, const uint8_t* datagram, size_t length) {
+        if (historySlots_ == 0) {
+            return;
+        }
+        uint8_t* slot = history_ + (size_t)(seq % historySlots_) * UDP_HISTORY_SLOT_BYTES;
+        udp_detail::put16(slot, (uint16_t)length);
+        memcpy(slot + 2, datagram, length);
+    }
+
+    void accumulateParity(uint32_t seq, const uint8_t* datagram, size_t length) {
+        if (parityGroup_ == 0) {
+            return;
+        }
+        if (groupCount_ == 0) {
+            groupStart_ = seq;
+            memset(parity_, 0, sizeof(parity_));
+        }
+        // Block = count field + channels/t0 + samples, i.e. the datagram from offset 8
+        // without the trailing group field in between
+        uint16_t blockLength = (uint16_t)(2 + length - UDP_HEADER_BYTES);
+        parity_[0] ^= datagram[8];
+        parity_[1] ^= datagram[9];
+        for (size_t i = UDP_HEADER_BYTES; i < length; ++i) {
+            parity_[2 + i - UDP_HEADER_BYTES] ^= datagram[i];
+        }
+        if (blockLength > parityLength_) {
+            parityLength_ = blockLength;
+        }
+        groupCount_++;
+    }
+
+    uint8_t* history_;
+    uint16_t historySlots_;
+    uint8_t parityGroup_;
+    uint32_t nextSeq_;
+    uint32_t groupStart_;
+    uint8_t groupCount_;
+    uint16_t parityLength_;
+    uint8_t parity_[UDP_MAX_BLOCK];
+};
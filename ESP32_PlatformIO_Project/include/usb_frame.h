@@ -0,0 +1,178 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ============================================================================
+// USB SERIAL FRAMES
+// ============================================================================
+//
+// Framing for the wired transport over the native USB CDC port. The port is
+// a plain byte stream that also carries the firmware's log lines, so every
+// message is framed (all fields little-endian):
+//
+//   offset  size  field
+//   0       2     sync 0xA5 0x5A
+//   2       1     type: 1 = message
+//   3       1     reserved, 0
+//   4       2     payload length
+//   6       4     CRC-32 (IEEE 802.3) of bytes 2..5 and the payload
+//   10      ...   payload
+//
+// A message payload is the same JSON text as a WebSocket message in either
+// direction: sample frames, registration, telemetry and session notices from
+// the device, commands and pings from the host. Bytes outside frames (log
+// text) are skipped by the receiver. A frame that fails its CRC is dropped,
+// and the receiver resynchronises one byte after its sync word, so a
+// corrupted length cannot swallow the frames behind it.
+//
+// The host's reader is backend/serial_ingest.py.
+
+#define USB_FRAME_SYNC0         0xA5
+#define USB_FRAME_SYNC1         0x5A
+#define USB_FRAME_MESSAGE       1
+#define USB_FRAME_HEADER_BYTES  10
+#define USB_FRAME_MAX_PAYLOAD   0xFFFF
+
+namespace usb_detail {
+
+struct Crc32Table {
+    uint32_t entries[256];
+
+    constexpr Crc32Table() : entries() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+inline constexpr Crc32Table CRC32_TABLE{};
+
+inline uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t get32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+} // namespace usb_detail
+
+// Running CRC-32: start with crc = 0, feed the bytes in any number of calls
+inline uint32_t usbCrc32(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) {
+        crc = (crc >> 8) ^ usb_detail::CRC32_TABLE.entries[(crc ^ data[i]) & 0xFF];
+    }
+    return ~crc;
+}
+
+// Write the header for length payload bytes; returns USB_FRAME_HEADER_BYTES
+inline size_t encodeUsbHeader(uint8_t* header, uint8_t type, const uint8_t* payload, size_t length) {
+    header[0] = USB_FRAME_SYNC0;
+    header[1] = USB_FRAME_SYNC1;
+    header[2] = type;
+    header[3] = 0;
+    header[4] = (uint8_t)length;
+    header[5] = (uint8_t)(length >> 8);
+    uint32_t crc = usbCrc32(usbCrc32(0, header + 2, 4), payload, length);
+    for (int i = 0; i < 4; ++i) {
+        header[6 + i] = (uint8_t)(crc >> (8 * i));
+    }
+    return USB_FRAME_HEADER_BYTES;
+}
+
+// FrameWriter framing (frame_sender.h) for messages to the host
+struct UsbFraming {
+    template <typename Transport>
+    static size_t encode(uint8_t* header, uint8_t* payload, size_t length, Transport&) {
+        return encodeUsbHeader(header, USB_FRAME_MESSAGE, payload, length);
+    }
+};
+
+typedef struct {
+    uint32_t frames;            // Frames delivered
+    uint32_t crcErrors;         // Frames dropped for a bad CRC
+    uint32_t oversize;          // Headers announcing more than MaxPayload bytes
+    uint32_t skippedBytes;      // Bytes outside frames (log text, line noise)
+} UsbDeframerStats_t;
+
+// Splits a received byte stream into frames. Frames longer than MaxPayload
+// are dropped; the buffer holds one frame.
+template <size_t MaxPayload>
+class UsbDeframer {
+    static_assert(MaxPayload <= USB_FRAME_MAX_PAYLOAD, "payload length is 16 bits");
+
+public:
+    UsbDeframer() : fill_(0), stats_() {}
+
+    // Feed received bytes; onFrame(type, payload, length) runs for every
+    // complete frame, with the payload valid only during the call
+    template <typename OnFrame>
+    void feed(const uint8_t* data, size_t length, OnFrame&& onFrame) {
+        while (length > 0) {
+            size_t take = sizeof(buffer_) - fill_;
+            take = take < length ? take : length;
+            memcpy(buffer_ + fill_, data, take);
+            fill_ += take;
+            data += take;
+            length -= take;
+            parse(onFrame);
+        }
+    }
+
+    const UsbDeframerStats_t& stats() const { return stats_; }
+
+private:
+    template <typename OnFrame>
+    void parse(OnFrame& onFrame) {
+        size_t start = 0;
+        for (;;) {
+            // Up to the next sync word
+            size_t sync = start;
+            while (sync + 1 < fill_ && !(buffer_[sync] == USB_FRAME_SYNC0 && buffer_[sync + 1] == USB_FRAME_SYNC1)) {
+                sync++;
+            }
+            if (sync + 1 >= fill_ && !(sync < fill_ && buffer_[sync] == USB_FRAME_SYNC0)) {
+                sync = fill_;   // No sync, and no first half of one at the end
+            }
+            stats_.skippedBytes += (uint32_t)(sync - start);
+            start = sync;
+            if (fill_ - start < USB_FRAME_HEADER_BYTES) {
+                break;
+            }
+
+            const uint8_t* header = buffer_ + start;
+            size_t payloadLength = usb_detail::get16(header + 4);
+            if (payloadLength > MaxPayload) {
+                stats_.oversize++;
+                start += 1;
+                continue;
+            }
+            if (fill_ - start < USB_FRAME_HEADER_BYTES + payloadLength) {
+                break;
+            }
+            uint8_t* payload = buffer_ + start + USB_FRAME_HEADER_BYTES;
+            uint32_t crc = usbCrc32(usbCrc32(0, header + 2, 4), payload, payloadLength);
+            if (crc != usb_detail::get32(header + 6)) {
+                stats_.crcErrors++;
+                start += 1;
+                continue;
+            }
+            stats_.frames++;
+            onFrame(header[2], payload, payloadLength);
+            start += USB_FRAME_HEADER_BYTES + payloadLength;
+        }
+        memmove(buffer_, buffer_ + start, fill_ - start);
+        fill_ -= start;
+    }
+
+    uint8_t buffer_[USB_FRAME_HEADER_BYTES + MaxPayload];
+    size_t fill_;
+    UsbDeframerStats_t stats_;
+};
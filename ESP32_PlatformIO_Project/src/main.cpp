@@ -2,63 +2,292 @@
 #include "Protocentral_ADS1220.h"
 #include <task.h>
 #include <WiFi.h>
-#include <ArduinoJson.h>
+#include <WiFiUdp.h>
 #include <WebSocketsClient.h>
+#include <WebSocketsServer.h>
+#include "control_protocol.h"
+#include "direct_hub.h"
+#include "pipeline_config.h"
+#include "heap_stats.h"
+#include "sample_types.h"
+#include "sample_encoder.h"
+#include "sample_ring.h"
+#include "channel_ring.h"
+#include "packed_ring.h"
+#include "staged_ring.h"
+#include "channel_scheduler.h"
+#include "batch_controller.h"
+#include "trigger_capture.h"
+#include "udp_frame.h"
+#include "frame_sender.h"
+#include "usb_frame.h"
+#include "power_state.h"
+#include "boot_timeline.h"
+#include <esp_timer.h>
+#include <lwip/sockets.h>
+#include <type_traits>
 
 // ============================================================================
-// ADS1220 CONFIGURATION 
+// ADS1220 CHANNEL TABLE
 // ============================================================================
 
 // Constants 
 #define PGA 128
 #define VREF 3.300
-#define LEFT_OFFSET -12700 
-#define RIGHT_OFFSET -17500 
-#define COUNTS_TO_NEWTONS_LEFT 0.001095f 
-#define COUNTS_TO_NEWTONS_RIGHT 0.0008938f
 
-// Pin Config
-#define LEFT_ADS1220_CS_PIN     8
-#define LEFT_ADS1220_DRDY_PIN   4
-#define RIGHT_ADS1220_CS_PIN    7
-#define RIGHT_ADS1220_DRDY_PIN  2
+// SPI bus shared by all converters
+#define SPI_SCK_PIN   13
+#define SPI_MISO_PIN  12
+#define SPI_MOSI_PIN  11
 
-// ADS1220 instances
-Protocentral_ADS1220 pc_ads1220right;
-Protocentral_ADS1220 pc_ads1220left;
+typedef struct {
+    const char* name;
+    uint8_t csPin;
+    uint8_t drdyPin;
+    uint8_t gain;               // PGA gain, 1-128
+    uint16_t sps;               // Normal-mode data rate
+    float countsToNewtons;      // Calibration
+} ChannelConfig_t;
+
+// One entry per ADS1220 on the shared SPI bus, in wire order. Force plates
+// list the left plate's cells first, then the right plate's. All channels are
+// read as one frame, so they run at channel 0's rate until a rate command.
+static const ChannelConfig_t CHANNELS[] = {
+    { "left",  8, 4, PGA, 1000, 0.001095f },
+    { "right", 7, 2, PGA, 1000, 0.0008938f },
+};
+
+#define CHANNEL_COUNT (sizeof(CHANNELS) / sizeof(CHANNELS[0]))
+static_assert(CHANNEL_COUNT == Pipeline::channels, "channel table does not match the pipeline config");
+
+// ADS1220 instances, one per table entry
+Protocentral_ADS1220 adcs[CHANNEL_COUNT];
+
+// Channel 0 DRDY falling edge (conversion complete) time from esp_timer,
+// captured in the GPIO interrupt. The sampler reads it right after the data,
+// well before the next edge, so the 64-bit value is not torn.
+volatile int64_t drdyEdgeUs = 0;
+
+void IRAM_ATTR onDrdyEdge() {
+    drdyEdgeUs = esp_timer_get_time();
+}
+
+// The shared SPI bus as seen by the channel scheduler
+struct Ads1220Bus {
+    uint64_t conversionUs;      // Channel 0 DRDY edge of the last frame
+
+    bool ready(uint8_t channel) { return digitalRead(CHANNELS[channel].drdyPin) == LOW; }
+
+    float read(uint8_t channel) {
+        float value = adcs[channel].Read_Data_Samples();
+        if (channel == 0) {
+            conversionUs = (uint64_t)drdyEdgeUs;
+        }
+        return value;
+    }
+
+    uint64_t nowUs() { return esp_timer_get_time(); }
+    void wait() { delayMicroseconds(10); }  // Short delay to avoid tight loop
+};
+
+Ads1220Bus adcBus;
+ScheduleStats_t scheduleStats = {};
 
 // ============================================================================
 // FREERTOS MULTI-TASKING CONFIGURATION
 // ============================================================================
 
-#define ADC_QUEUE_LENGTH    120000          // 120,000 samples buffer
-#define SAMPLING_INTERVAL   1               // 1ms = 1000 Hz sampling
-#define SENDER_BATCH_SIZE   100             // 100 samples per transmission
+// Queue length, sampling interval and batch bounds come from the
+// environment's Pipeline (include/pipeline_config.h)
+#define WEAK_RSSI_DBM       -75             // RSSI treated as a congested link
+#define RSSI_POLL_INTERVAL_MS 1000
 #define SAMPLER_TASK_PRIORITY (configMAX_PRIORITIES - 1)
 #define SENDER_TASK_PRIORITY  (tskIDLE_PRIORITY + 2)
 #define SAMPLER_STACK_SIZE   (configMINIMAL_STACK_SIZE * 16)
 #define SENDER_STACK_SIZE    (configMINIMAL_STACK_SIZE * 10)
-#define JSON_BUFFER_SIZE     5000
+#define JSON_BUFFER_SIZE     (Pipeline::maxBatch * SAMPLE_JSON_MAX_BYTES(Pipeline::channels) + SAMPLE_FRAME_OVERHEAD)
+
+// UDP datagrams are built here by the sender, which sends them itself;
+// WebSocket frames go through the network task's queue (sampleFrames)
+static uint8_t datagramBuffer[Pipeline::udpTransport ? UDP_MAX_DATAGRAM : 1];
 
+// Sample queue shared as a ring between sampler and sender; samples are
+// stored column-wise, one array per channel. It lives in PSRAM on boards that
+// have it, otherwise in a static DRAM array. In front of a PSRAM queue the
+// sampler writes staging blocks in internal SRAM (part of sampleRing, a
+// global), copied to PSRAM a block at a time; the sender reads recent
+// samples from the staging blocks. With packedQueue the blocks are packed to
+// 24-bit values on the way, and the sender unpacks backlog spans.
+typedef std::conditional<(Pipeline::stagingBlock > 0),
+                         StagedRing<Pipeline::channels, Pipeline::stagingBlock>,
+                         ChannelRing<Pipeline::channels>>::type UnpackedQueue;
+typedef std::conditional<Pipeline::packedQueue,
+                         PackedRing<Pipeline::channels, Pipeline::stagingBlock, Pipeline::maxBatch>,
+                         UnpackedQueue>::type SampleQueue;
+#define SAMPLE_QUEUE_BYTES   SampleQueue::storageBytes(Pipeline::channels, Pipeline::queueLength)
+static uint64_t dramQueue[Pipeline::psramQueue ? 1 : (SAMPLE_QUEUE_BYTES + 7) / 8];
+void* sampleBuffer = nullptr;
+SampleQueue sampleRing;
+volatile uint32_t ringOverflows = 0;        // Samples dropped because the ring was full
+volatile uint32_t sessionStartPosition = 0; // Ring position of the first sample after start
+volatile bool discardPending = false;       // Sender drops samples before sessionStartPosition
+
+// Sampler cost of one ring push, in CPU cycles: compare environments with and
+// without a stagingBlock
 typedef struct {
-    float right;
-    float left;
-    uint32_t timestamp;
-} Sample_t;
-
-// Dynamic buffer allocation in PSRAM
-Sample_t* sampleBuffer = nullptr;
-int sampleIndex = 0;
+    uint32_t max;
+    uint64_t total;
+    uint32_t count;
+} PushTiming_t;
+PushTiming_t pushTiming = {};
+
+uint32_t cyclesToNs(uint64_t cycles) {
+    return (uint32_t)(cycles * 1000 / getCpuFrequencyMhz());
+}
+
+// Samples the sender read from the SRAM staging blocks (0 without staging)
+template <typename Queue>
+uint32_t stagedReads(const Queue& queue) {
+    if constexpr (Pipeline::stagingBlock > 0) {
+        return queue.stagedReads();
+    } else {
+        return 0;
+    }
+}
+
+// Batch size adapts to backlog, send duration and RSSI
+static const BatchConfig_t batchConfig = {
+    Pipeline::minBatch, Pipeline::maxBatch, Pipeline::maxLatencyMs, Pipeline::maxFramesPerSecond, WEAK_RSSI_DBM
+};
+BatchController batchController(batchConfig, 1000);
+volatile int8_t wifiRssi = 0;
 TaskHandle_t xSamplerTaskHandle = NULL;
 TaskHandle_t xSenderTaskHandle = NULL;
+TaskHandle_t xNetworkTaskHandle = NULL;     // Arduino loop task, which owns the sockets
 
 // System state 
 enum SystemState {
     Idle_state,
-    Sampling_state,
-    Sending_state
+    Sampling_state
 };
 volatile SystemState systemState = Idle_state;
+// Sampling since boot, before the first backend link: the samples wait in
+// the ring and are delivered when the link comes up
+volatile bool bootCapture = false;
+
+// ============================================================================
+// IDLE POWER MANAGEMENT
+// ============================================================================
+
+#define ADS1220_CMD_POWERDOWN    0x02       // Power-down until the next START/SYNC
+#define IDLE_CPU_FREQ_MHZ        80         // Lowest frequency WiFi keeps running at
+#define ACTIVE_CPU_FREQ_MHZ      240
+
+bool adcsPoweredDown = false;               // Owned by the sampler (SPI bus)
+WakeLatency_t wakeLatency = {};
+volatile bool startLatencyPending = false;  // First sample taken; report the wake latency
+volatile uint32_t idleWakeups = 0;          // Task wake-ups while idle
+
+// Boot milestones for telemetry; the network comes up after acquisition
+BootTimeline_t bootTimeline = {};
+bool webSocketStarted = false;              // Started by loop() once WiFi is up
+
+// ============================================================================
+// RUNTIME ACQUISITION SETTINGS (changed via control commands)
+// ============================================================================
+
+#define TARE_SAMPLE_COUNT        500        // Samples averaged per tare
+#define HEAP_STATS_INTERVAL_MS   10000      // Heap snapshot period
+#define TELEMETRY_BUFFER_SIZE    (1400 + CHANNEL_COUNT * 13)
+
+typedef struct {
+    uint16_t sps;
+    int drBits;
+} DataRateEntry_t;
+
+// ADS1220 normal-mode data rates
+static constexpr DataRateEntry_t DATA_RATES[] = {
+    { 20,   DR_20SPS },
+    { 45,   DR_45SPS },
+    { 90,   DR_90SPS },
+    { 175,  DR_175SPS },
+    { 330,  DR_330SPS },
+    { 600,  DR_600SPS },
+    { 1000, DR_1000SPS },
+};
+
+typedef struct {
+    uint8_t gain;
+    int pgaBits;
+} GainEntry_t;
+
+static const GainEntry_t PGA_GAINS[] = {
+    { 1,   PGA_GAIN_1 },
+    { 2,   PGA_GAIN_2 },
+    { 4,   PGA_GAIN_4 },
+    { 8,   PGA_GAIN_8 },
+    { 16,  PGA_GAIN_16 },
+    { 32,  PGA_GAIN_32 },
+    { 64,  PGA_GAIN_64 },
+    { 128, PGA_GAIN_128 },
+};
+
+constexpr uint16_t maxDataRateSps() {
+    uint16_t sps = 0;
+    for (const DataRateEntry_t& rate : DATA_RATES) {
+        if (rate.sps > sps) {
+            sps = rate.sps;
+        }
+    }
+    return sps;
+}
+
+inline int dataRateBits(uint16_t sps) {
+    for (size_t i = 0; i < sizeof(DATA_RATES) / sizeof(DATA_RATES[0]); ++i) {
+        if (DATA_RATES[i].sps == sps) {
+            return DATA_RATES[i].drBits;
+        }
+    }
+    return DR_1000SPS;
+}
+
+inline int pgaGainBits(uint8_t gain) {
+    for (size_t i = 0; i < sizeof(PGA_GAINS) / sizeof(PGA_GAINS[0]); ++i) {
+        if (PGA_GAINS[i].gain == gain) {
+            return PGA_GAINS[i].pgaBits;
+        }
+    }
+    return PGA_GAIN_128;
+}
+
+volatile uint16_t sampleRateSps = CHANNELS[0].sps;
+volatile uint8_t channelGain[CHANNEL_COUNT];   // From the table, then the gain command
+volatile uint32_t samplingIntervalMs = Pipeline::samplingIntervalMs;
+volatile bool adcConfigPending = false;    // Applied by the sampler, which owns the SPI bus
+volatile uint16_t tareSamplesRemaining = 0;
+float tareOffset[CHANNEL_COUNT] = {};
+
+HeapTrend_t heapTrend = {};
+
+// ============================================================================
+// TRIGGERED CAPTURE
+// ============================================================================
+
+#define PRE_TRIGGER_MS           Pipeline::preTriggerMs
+#define POST_TRIGGER_HOLD_MS     500        // Time below threshold that ends a capture
+// Enough history for PRE_TRIGGER_MS at the fastest data rate, so it is never cut short
+#define PRE_TRIGGER_CAPACITY     (Pipeline::triggerCapture ? (uint32_t)PRE_TRIGGER_MS * maxDataRateSps() / 1000 : 1)
+
+// History entry: a Sample_t without the unused MAX_CHANNELS columns
+typedef struct {
+    uint64_t timestampUs;
+    float values[CHANNEL_COUNT];
+} TriggerSample_t;
+
+// Trigger threshold on total force in newtons above tare; 0 streams continuously
+volatile int32_t triggerThresholdN = 0;
+volatile bool captureConfigPending = false;    // Applied by the sampler
+TriggerCapture<TriggerSample_t, PRE_TRIGGER_CAPACITY> triggerCapture;
 
 // ============================================================================
 // WIFI AND WEBSOCKET CONFIGURATION
@@ -73,130 +302,843 @@ const char* websocket_host = "192.168.1.158";  // Change this to your computer's
 const uint16_t websocket_port = 5000;           // Backend port
 const char* websocket_path = "/ws";  // Raw WebSocket path
 
-WebSocketsClient webSocket;
+// The client library keeps its connection protected; the network task
+// writes frames to the socket itself, without blocking
+struct BackendSocket : WebSocketsClient {
+    int fd() { return _client.tcp ? _client.tcp->fd() : -1; }
+};
+
+BackendSocket webSocket;
+volatile bool backendConnected = false;     // Set by the network task's event handler
+
+// ============================================================================
+// NETWORK TASK SEND QUEUE
+// ============================================================================
+
+// Only the network task (Arduino loop()) touches the WebSocket client and
+// server. The sender task encodes sample frames into sampleFrames; the
+// network task's own messages (registration, telemetry, session notices,
+// pings) go through controlFrames and are written ahead of samples. See
+// frame_sender.h.
+#define CONTROL_FRAME_SLOTS      4
+#define CONTROL_FRAME_BYTES      TELEMETRY_BUFFER_SIZE
+#define NETWORK_POLL_MS          10         // Network task pass without new frames
+#define NETWORK_STALL_POLL_MS    1          // Retry period while the socket send buffer is full
+
+struct BackendSocketTransport {
+    int write(const uint8_t* data, size_t length) {
+        int fd = webSocket.fd();
+        if (fd < 0) {
+            return -1;
+        }
+        int sent = send(fd, data, length, MSG_DONTWAIT);
+        if (sent < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        return sent;
+    }
+    uint64_t nowUs() { return esp_timer_get_time(); }
+    uint32_t maskKey() { return esp_random(); }
+};
+
+FrameQueue<Pipeline::sendQueueFrames, JSON_BUFFER_SIZE> sampleFrames;
+FrameQueue<CONTROL_FRAME_SLOTS, CONTROL_FRAME_BYTES> controlFrames;
+BackendSocketTransport backendTransport;
+FrameWriter<BackendSocketTransport> backendWriter(backendTransport);
+uint32_t controlDrops = 0;                  // Control messages dropped with the queue full
+
+// ============================================================================
+// USB SERIAL TRANSPORT
+// ============================================================================
+
+// With a host reading the native USB port (backend/serial_ingest.py), the
+// backend link runs over USB instead of WiFi: the same messages, framed with
+// a CRC (usb_frame.h). The host pings every second; while it does, frames
+// for the backend go to the port and the WebSocket stays closed. When the
+// pings stop the WebSocket reconnects. Boards whose Serial is a UART bridge
+// cannot carry the sample rate and keep the port for logs.
+#if ARDUINO_USB_CDC_ON_BOOT
+#define USB_TRANSPORT            Pipeline::usbTransport
+#else
+#define USB_TRANSPORT            false
+#endif
+#define USB_HOST_TIMEOUT_MS      3000       // Host silent this long: back to WiFi
+#define USB_MESSAGE_BYTES        256        // Longest message from the host
+#define USB_READ_CHUNK           64
+
+static_assert(USB_FRAME_HEADER_BYTES <= FRAME_HEADER_BYTES, "USB header must fit a send queue slot");
+static_assert(JSON_BUFFER_SIZE <= USB_FRAME_MAX_PAYLOAD, "sample frames must fit a USB frame");
+
+struct UsbSerialTransport {
+    int write(const uint8_t* data, size_t length) {
+        int room = Serial.availableForWrite();
+        if (room <= 0) {
+            return 0;
+        }
+        return (int)Serial.write(data, length < (size_t)room ? length : (size_t)room);
+    }
+    uint64_t nowUs() { return esp_timer_get_time(); }
+};
+
+UsbSerialTransport usbTransport;
+FrameWriter<UsbSerialTransport, UsbFraming> usbWriter(usbTransport);
+UsbDeframer<USB_MESSAGE_BYTES> usbDeframer;
+volatile bool usbLinkUp = false;            // The USB host is the backend link; set by the network task
+uint32_t usbHostSeenMs = 0;
+
+// Where FRAME_TO_BACKEND frames go: the USB host while one is attached,
+// otherwise the WebSocket
+bool backendLinkUp() {
+    return usbLinkUp || backendConnected;
+}
+
+// Log output shares the port with USB frames. Everything is logged from the
+// network task, which also writes the frames: lines logged while a frame is
+// partly written are held and written after it, so they never land inside
+// one. The host skips text between frames.
+#define CONSOLE_HOLD_BYTES       512
+
+class Console : public Print {
+public:
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* data, size_t length) override {
+        if (!usbWriter.busy() && heldLength_ == 0) {
+            return Serial.write(data, length);
+        }
+        size_t take = sizeof(held_) - heldLength_;
+        take = length < take ? length : take;
+        memcpy(held_ + heldLength_, data, take);
+        heldLength_ += take;
+        return length;
+    }
+
+    // Write held lines once no frame is in progress
+    void release() {
+        if (heldLength_ > 0 && !usbWriter.busy()) {
+            Serial.write(held_, heldLength_);
+            heldLength_ = 0;
+        }
+    }
+
+private:
+    uint8_t held_[CONSOLE_HOLD_BYTES];
+    size_t heldLength_ = 0;
+};
+
+Console console;
+
+// ============================================================================
+// DIRECT-CONNECT SERVER
+// ============================================================================
+
+// Apps can also connect straight to the ESP32 and stream without the backend;
+// the backend stays an optional archival subscriber. Frames are fanned out by
+// the network task in startFrame() (see direct_hub.h).
+#define DIRECT_SERVER_PORT    81
+
+WebSocketsServer directSocket(DIRECT_SERVER_PORT);
+
+// Evicted clients are closed after the fan-out; closing them during it would
+// run the server's event callback while the hub is locked
+uint32_t directDisconnectsPending = 0;      // Bit per client, set and cleared atomically
+
+struct DirectSocketTransport {
+    bool sendText(uint8_t client, const char* data, size_t length) {
+        return directSocket.sendTXT(client, (uint8_t*)data, length);
+    }
+    void disconnect(uint8_t client) {
+        __atomic_fetch_or(&directDisconnectsPending, 1UL << client, __ATOMIC_RELAXED);
+    }
+    uint64_t nowUs() { return esp_timer_get_time(); }
+};
+
+DirectSocketTransport directTransport;
+DirectHub<DirectSocketTransport> directHub(directTransport);
+SemaphoreHandle_t directHubMutex = NULL;    // loop() registers clients and fans out, the sender counts them
+
+uint8_t directSubscribers() {
+    if (!Pipeline::directServer) {
+        return 0;
+    }
+    xSemaphoreTake(directHubMutex, portMAX_DELAY);
+    uint8_t count = directHub.subscribers();
+    xSemaphoreGive(directHubMutex);
+    return count;
+}
+
+void broadcastDirect(const char* frame, size_t length) {
+    if (!Pipeline::directServer) {
+        return;
+    }
+    xSemaphoreTake(directHubMutex, portMAX_DELAY);
+    directHub.broadcast(frame, length);
+    xSemaphoreGive(directHubMutex);
+}
+
+// ============================================================================
+// NETWORK TASK FRAME WRITING
+// ============================================================================
+
+// Queue one of the network task's own messages (copied)
+bool queueControl(const char* text, uint8_t destinations = FRAME_TO_BACKEND) {
+    size_t length = strlen(text);
+    char* payload = controlFrames.acquire();
+    if (!payload || length > CONTROL_FRAME_BYTES) {
+        controlDrops++;
+        return false;
+    }
+    memcpy(payload, text, length);
+    controlFrames.publish(length, destinations);
+    return true;
+}
+
+// Hand the oldest frame of a queue to its destinations: direct clients first,
+// since the backend writer masks the payload in place
+template <typename Queue>
+bool startFrame(Queue& queue) {
+    uint8_t* payload;
+    size_t length;
+    uint8_t destinations;
+    if (!queue.front(payload, length, destinations)) {
+        return false;
+    }
+    if (destinations & FRAME_TO_DIRECT) {
+        broadcastDirect((const char*)payload, length);
+    }
+    if (destinations & FRAME_TO_BACKEND) {
+        if (usbLinkUp) {
+            usbWriter.start(payload, length);
+        } else if (backendConnected) {
+            backendWriter.start(payload, length);
+        }
+    }
+    return true;
+}
+
+enum FrameSource : uint8_t {
+    FrameSource_None,
+    FrameSource_Control,
+    FrameSource_Samples
+};
+FrameSource frameInFlight = FrameSource_None;   // Queue whose front frame is being written
+
+// Write queued frames, control messages first, until the queues are empty or
+// the socket would block; a partly written frame is resumed on the next call
+void drainSendQueues() {
+    for (;;) {
+        if (frameInFlight == FrameSource_None) {
+            if (startFrame(controlFrames)) {
+                frameInFlight = FrameSource_Control;
+            } else if (startFrame(sampleFrames)) {
+                frameInFlight = FrameSource_Samples;
+            } else {
+                return;
+            }
+        }
+        if (usbWriter.busy()) {
+            // A frame cut short is dropped by the host's CRC check, which
+            // resynchronises on the next one
+            if (usbWriter.service() == FrameWrite_Pending) {
+                return;
+            }
+            console.release();
+        }
+        if (backendWriter.busy()) {
+            FrameWriteState state = backendWriter.service();
+            if (state == FrameWrite_Pending) {
+                return;
+            }
+            if (state == FrameWrite_StalledOut) {
+                // Part of a frame is on the wire, so the stream cannot go on
+                console.println("Backend send stalled out, reconnecting");
+                webSocket.disconnect();
+            }
+        }
+        if (frameInFlight == FrameSource_Control) {
+            controlFrames.pop();
+        } else {
+            sampleFrames.pop();
+        }
+        frameInFlight = FrameSource_None;
+    }
+}
+
+// ============================================================================
+// UDP SAMPLE TRANSPORT
+// ============================================================================
+
+// Sample frames can go over UDP instead of the WebSocket; commands, NACKs
+// and telemetry stay on the WebSocket
+#define UDP_SAMPLE_PORT       5005          // Backend UDP receiver port
+#define UDP_PARITY_GROUP      4             // Data datagrams per XOR parity datagram
+#define NACK_QUEUE_LENGTH     32
+#define UDP_MARKER_REPEATS    3             // Position markers sent when the stream pauses
+
+enum SampleTransport : uint8_t {
+    Transport_WebSocket = 0,
+    Transport_Udp = 1
+};
+
+WiFiUDP udp;
+UdpFramer udpFramer;
+volatile SampleTransport sampleTransport = Transport_WebSocket;
+volatile uint8_t udpParityGroup = UDP_PARITY_GROUP;
+volatile bool udpConfigPending = false;   // Applied by the sender, which owns udpFramer
+
+// NACKed sequence numbers, queued by the WebSocket handler for the sender
+static uint32_t nackStorage[NACK_QUEUE_LENGTH];
+SampleRing<uint32_t> nackQueue;
+uint32_t udpRetransmits = 0;
+
+// ============================================================================
+// CONTROL COMMANDS AND TELEMETRY
+// ============================================================================
+
+void sendTelemetry() {
+    const HeapStats_t& heap = heapTrend.latest;
+    const FrameWriterStats_t& writer = backendWriter.stats();
+    char* telemetry = controlFrames.acquire();
+    if (!telemetry) {
+        controlDrops++;
+        return;
+    }
+
+    // Per-channel tare offsets as a JSON array
+    char tare[CHANNEL_COUNT * 13 + 2];
+    int tareLength = 0;
+    for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+        tareLength += snprintf(tare + tareLength, sizeof(tare) - tareLength, "%c%ld",
+                               c ? ',' : '[', (long)tareOffset[c]);
+    }
+    snprintf(tare + tareLength, sizeof(tare) - tareLength, "]");
+
+    int length = snprintf(telemetry, CONTROL_FRAME_BYTES,
+        "{\"telemetry\":{\"state\":%d,\"rate\":%u,\"gain\":%u,\"channels\":%u,"
+        "\"tare\":%s,\"uptime_ms\":%lu,"
+        "\"heap_free\":%lu,\"heap_largest\":%lu,\"heap_min\":%lu,"
+        "\"heap_blocks\":%lu,\"heap_frag\":%u,\"heap_frag_peak\":%u,"
+        "\"batch\":%u,\"backlog\":%lu,\"overflows\":%lu,\"rssi\":%d,"
+        "\"trigger_n\":%ld,\"trigger_state\":%u,\"captures\":%lu,"
+        "\"transport\":%u,\"fec\":%u,\"udp_seq\":%lu,\"retransmits\":%lu,"
+        "\"adc_powered\":%u,\"cpu_mhz\":%lu,\"idle_wakeups\":%lu,\"wake_us\":%lu,"
+        "\"wake_max_us\":%lu,\"wake_mean_us\":%lu,\"wakes\":%lu,\"wake_over_budget\":%lu,"
+        "\"bus_us\":%lu,\"bus_us_max\":%lu,\"frame_timeouts\":%lu,"
+        "\"boot_ready_ms\":%ld,\"boot_first_sample_ms\":%ld,\"boot_wifi_ms\":%ld,\"boot_link_ms\":%ld,"
+        "\"direct_clients\":%u,\"direct_evictions\":%lu,\"direct_fanout_us_max\":%lu,"
+        "\"push_ns_mean\":%lu,\"push_ns_max\":%lu,\"staged_reads\":%lu,"
+        "\"send_queue\":%lu,\"send_queue_max\":%lu,\"send_queue_full\":%lu,\"control_drops\":%lu,"
+        "\"tcp_stalls\":%lu,\"tcp_stall_ms\":%lu,\"tcp_stall_us_max\":%lu,\"send_failures\":%lu,"
+        "\"usb_link\":%u,\"usb_stalls\":%lu,\"usb_rx_errors\":%lu}}",
+        (int)systemState, (unsigned)sampleRateSps, (unsigned)channelGain[0], (unsigned)CHANNEL_COUNT,
+        tare, (unsigned long)millis(),
+        (unsigned long)heap.freeBytes, (unsigned long)heap.largestFreeBlock,
+        (unsigned long)heap.minFreeBytes, (unsigned long)heap.freeBlocks,
+        (unsigned)heapFragmentationPercent(heap), (unsigned)heapTrend.peakFragmentation,
+        (unsigned)batchController.batchSize(), (unsigned long)sampleRing.available(),
+        (unsigned long)ringOverflows, (int)wifiRssi,
+        (long)triggerThresholdN, (unsigned)triggerCapture.state(), (unsigned long)triggerCapture.captures(),
+        (unsigned)sampleTransport, (unsigned)udpParityGroup, (unsigned long)udpFramer.nextSeq(),
+        (unsigned long)udpRetransmits,
+        (unsigned)!adcsPoweredDown, (unsigned long)getCpuFrequencyMhz(), (unsigned long)idleWakeups,
+        (unsigned long)wakeLatency.last, (unsigned long)wakeLatency.max,
+        (unsigned long)wakeLatencyMean(wakeLatency), (unsigned long)wakeLatency.count,
+        (unsigned long)wakeLatency.overBudget,
+        (unsigned long)scheduleStats.lastBusUs, (unsigned long)scheduleStats.maxBusUs,
+        (unsigned long)scheduleStats.timeouts,
+        (long)bootMs(bootTimeline.readyUs), (long)bootMs(bootTimeline.firstSampleUs),
+        (long)bootMs(bootTimeline.wifiUs), (long)bootMs(bootTimeline.linkUs),
+        (unsigned)directSubscribers(), (unsigned long)directHub.stats().evictions,
+        (unsigned long)directHub.stats().maxFanoutUs,
+        (unsigned long)cyclesToNs(pushTiming.count ? pushTiming.total / pushTiming.count : 0),
+        (unsigned long)cyclesToNs(pushTiming.max), (unsigned long)stagedReads(sampleRing),
+        (unsigned long)sampleFrames.depth(), (unsigned long)sampleFrames.maxDepth(),
+        (unsigned long)sampleFrames.fullCount(), (unsigned long)controlDrops,
+        (unsigned long)writer.stalls, (unsigned long)(writer.stallUs / 1000),
+        (unsigned long)writer.maxStallUs, (unsigned long)(writer.failures + usbWriter.stats().failures),
+        (unsigned)usbLinkUp, (unsigned long)usbWriter.stats().stalls,
+        (unsigned long)(usbDeframer.stats().crcErrors + usbDeframer.stats().oversize));
+
+    if (length > 0 && length < (int)CONTROL_FRAME_BYTES) {
+        controlFrames.publish((size_t)length, FRAME_TO_BACKEND | FRAME_TO_DIRECT);
+    }
+}
+
+// Idle: WiFi modem sleep and a lower CPU clock. The ADCs are powered down by
+// the sampler, which owns the SPI bus.
+void enterIdlePower() {
+    WiFi.setSleep(WIFI_PS_MIN_MODEM);
+    setCpuFrequencyMhz(IDLE_CPU_FREQ_MHZ);
+}
+
+void enterActivePower() {
+    setCpuFrequencyMhz(ACTIVE_CPU_FREQ_MHZ);
+    WiFi.setSleep(WIFI_PS_NONE);
+}
+
+// Sampler and sender wait on a notification, so state changes reach them at
+// once instead of at their next timed pass
+void wakeTasks() {
+    if (xSamplerTaskHandle) {
+        xTaskNotifyGive(xSamplerTaskHandle);
+    }
+    if (xSenderTaskHandle) {
+        xTaskNotifyGive(xSenderTaskHandle);
+    }
+}
+
+// Wake the network task to write a newly queued frame
+void notifyNetworkTask() {
+    if (xNetworkTaskHandle) {
+        xTaskNotifyGive(xNetworkTaskHandle);
+    }
+}
+
+// Leftover samples from a previous session, or the boot capture, are
+// dropped by the sender
+void startSession() {
+    bootCapture = false;
+    sessionStartPosition = sampleRing.written();
+    discardPending = true;
+    captureConfigPending = true;
+}
+
+void handleControlCommand(const ControlMessage_t& msg) {
+    switch (msg.command) {
+        case CMD_START:
+            // The sampler powers up the ADCs while the clock and WiFi change
+            wakeLatencyStart(wakeLatency, esp_timer_get_time());
+            startSession();
+            systemState = Sampling_state;
+            wakeTasks();
+            enterActivePower();
+            console.println("Backend commanded: START");
+            break;
+
+        case CMD_STOP:
+            systemState = Idle_state;
+            wakeTasks();
+            enterIdlePower();
+            console.println("Backend commanded: STOP - Sampling paused");
+            break;
+
+        case CMD_RATE:
+            for (size_t i = 0; msg.hasValue && i < sizeof(DATA_RATES) / sizeof(DATA_RATES[0]); ++i) {
+                if (DATA_RATES[i].sps == msg.value) {
+                    sampleRateSps = DATA_RATES[i].sps;
+                    samplingIntervalMs = max(1, 1000 / (int)sampleRateSps);
+                    adcConfigPending = true;
+                    wakeTasks();
+                    console.printf("Backend commanded: RATE %u SPS\n", (unsigned)sampleRateSps);
+                    return;
+                }
+            }
+            console.println("Backend commanded: RATE - unsupported value ignored");
+            break;
+
+        case CMD_GAIN:
+            for (size_t i = 0; msg.hasValue && i < sizeof(PGA_GAINS) / sizeof(PGA_GAINS[0]); ++i) {
+                if (PGA_GAINS[i].gain == msg.value) {
+                    for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+                        channelGain[c] = PGA_GAINS[i].gain;
+                    }
+                    adcConfigPending = true;
+                    wakeTasks();
+                    console.printf("Backend commanded: GAIN %u\n", (unsigned)PGA_GAINS[i].gain);
+                    return;
+                }
+            }
+            console.println("Backend commanded: GAIN - unsupported value ignored");
+            break;
+
+        case CMD_TARE:
+            tareSamplesRemaining = TARE_SAMPLE_COUNT;
+            console.println("Backend commanded: TARE");
+            break;
+
+        case CMD_TELEMETRY:
+            sendTelemetry();
+            break;
+
+        case CMD_TRIGGER:
+            if (Pipeline::triggerCapture && msg.hasValue && msg.value >= 0) {
+                triggerThresholdN = msg.value;
+                captureConfigPending = true;
+                wakeTasks();
+                console.printf("Backend commanded: TRIGGER %ld N%s\n", (long)msg.value,
+                               msg.value == 0 ? " (continuous)" : "");
+            }
+            break;
+
+        case CMD_TRANSPORT:
+            if (msg.hasValue && (msg.value == Transport_WebSocket ||
+                                 (msg.value == Transport_Udp && Pipeline::udpTransport))) {
+                sampleTransport = (SampleTransport)msg.value;
+                console.printf("Backend commanded: TRANSPORT %s\n",
+                               sampleTransport == Transport_Udp ? "UDP" : "WebSocket");
+            }
+            break;
+
+        case CMD_FEC:
+            if (msg.hasValue && msg.value >= 0 && msg.value <= 16) {
+                udpParityGroup = (uint8_t)msg.value;
+                udpConfigPending = true;
+            }
+            break;
+
+        case CMD_NACK:
+            if (msg.hasValue && msg.value >= 0) {
+                nackQueue.push((uint32_t)msg.value);
+                wakeTasks();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
 
 // ============================================================================
 // WEBSOCKET EVENT HANDLER
 // ============================================================================
 
+// The MAC address identifies the device in the backend's session catalog
+void sendRegistration() {
+    char registration[64];
+    snprintf(registration, sizeof(registration), "{\"type\":\"esp32\",\"device\":\"%s\"}",
+             WiFi.macAddress().c_str());
+    queueControl(registration);
+}
+
+// The backend link (WebSocket or USB) is up: register, then wait for a
+// start command
+void onBackendLinkUp() {
+    bootMark(bootTimeline.linkUs, esp_timer_get_time());
+    sendRegistration();
+    bool bootSamples = bootCapture;
+    bootCapture = false;
+    if (!bootSamples && systemState == Sampling_state && directSubscribers() > 0) {
+        // Joining a session started by a direct client: archive it
+        queueControl("{\"session\":\"start\"}");
+        return;
+    }
+    // Wait for start command from frontend. Samples still queued (taken
+    // since boot, or while the link was down) go out first; with nothing
+    // queued the ring moves on to the next session.
+    systemState = Idle_state;
+    uint32_t backlog = sampleRing.available();
+    if (backlog == 0) {
+        startSession();
+    } else {
+        console.printf("Delivering %u samples queued while the link was down\n", (unsigned)backlog);
+    }
+    wakeTasks();
+    enterIdlePower();
+    console.println("Waiting for frontend to start test");
+}
+
+// A session run by directly connected apps carries on
+void onBackendLinkDown() {
+    if (directSubscribers() == 0) {
+        systemState = Idle_state;
+        enterIdlePower();
+    }
+}
+
 void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
     switch(type) {
         case WStype_DISCONNECTED:
-            Serial.println("Disconnected from backend");
-            systemState = Idle_state;
+            console.println("Disconnected from backend");
+            backendConnected = false;
+            backendWriter.abort();
+            if (!usbLinkUp) {
+                onBackendLinkDown();
+            }
             break;
 
         case WStype_CONNECTED:
-            Serial.println("Connected to backend server (Raw WebSocket)");
-            // Send simple registration message
-            webSocket.sendTXT("{\"type\":\"esp32\"}");
-            // Wait for start command from frontend
-            systemState = Idle_state;
-            sampleIndex = 0;
-            Serial.println("Waiting for frontend to start test");
+            console.println("Connected to backend server (Raw WebSocket)");
+            backendConnected = true;
+            onBackendLinkUp();
             break;
 
         case WStype_TEXT: {
-            String msg = String((char*)payload).substring(0, length);
-            
-            // Handle registration confirmation
-            if (msg.indexOf("registered") > 0) {
-                Serial.println("Registration confirmed by backend");
+            ControlMessage_t msg;
+            if (!parseControlMessage(payload, length, msg)) {
                 break;
             }
 
-            // Handle pong responses
-            if (msg.indexOf("pong") > 0) {
-                break; // Ignore pong responses
+            if (msg.kind == MSG_REGISTERED) {
+                console.println("Registration confirmed by backend");
+            } else if (msg.kind == MSG_COMMAND) {
+                handleControlCommand(msg);
             }
+            // Pong and unknown messages are ignored
+            break;
+        }
 
-            // Parse JSON commands (simple format)
-            JsonDocument doc;
-            DeserializationError error = deserializeJson(doc, msg);
-            if (error) {
-                break;
-            }
+        case WStype_ERROR:
+            console.printf("WebSocket Error: %s\n", payload);
+            break;
+
+        default:
+            break;
+    }
+}
 
-            String cmd = "";
-            if (doc["cmd"].is<String>()) {
-                cmd = doc["cmd"].as<String>();
-            } else if (doc["command"].is<String>()) {
-                cmd = doc["command"].as<String>();
+// Events from apps connected to the direct-connect server
+void onDirectEvent(uint8_t client, WStype_t type, uint8_t * payload, size_t length) {
+    switch(type) {
+        case WStype_CONNECTED: {
+            xSemaphoreTake(directHubMutex, portMAX_DELAY);
+            bool accepted = directHub.onConnect(client);
+            xSemaphoreGive(directHubMutex);
+            if (!accepted) {
+                console.printf("Direct client %u refused: %u clients already connected\n",
+                               (unsigned)client, (unsigned)DIRECT_MAX_CLIENTS);
+                directSocket.disconnect(client);
+                break;
             }
+            console.printf("Direct client %u connected\n", (unsigned)client);
+            wakeTasks();    // Held samples go out to it
+            break;
+        }
 
-            if (cmd == "start") {
-                sampleIndex = 0;
-                systemState = Sampling_state;
-                Serial.println("Backend commanded: START");
-            } else if (cmd == "stop") {
+        case WStype_DISCONNECTED: {
+            xSemaphoreTake(directHubMutex, portMAX_DELAY);
+            directHub.onDisconnect(client);
+            uint8_t remaining = directHub.subscribers();
+            xSemaphoreGive(directHubMutex);
+            console.printf("Direct client %u disconnected\n", (unsigned)client);
+            // Nobody left to stream to; a boot capture keeps waiting for the backend
+            if (remaining == 0 && !backendLinkUp() && systemState == Sampling_state && !bootCapture) {
                 systemState = Idle_state;
-                Serial.println("Backend commanded: STOP - Sampling paused");
+                enterIdlePower();
             }
             break;
         }
 
-        case WStype_ERROR:
-            Serial.printf("WebSocket Error: %s\n", payload);
+        case WStype_TEXT: {
+            ControlMessage_t msg;
+            xSemaphoreTake(directHubMutex, portMAX_DELAY);
+            bool command = directHub.onText(client, payload, length, msg);
+            xSemaphoreGive(directHubMutex);
+            if (!command) {
+                break;
+            }
+            handleControlCommand(msg);
+            // Let the backend archive sessions the app runs directly
+            if (backendLinkUp() && (msg.command == CMD_START || msg.command == CMD_STOP)) {
+                queueControl(msg.command == CMD_START ? "{\"session\":\"start\"}" : "{\"session\":\"stop\"}");
+            }
             break;
+        }
 
         default:
             break;
     }
 }
 
+// ============================================================================
+// USB HOST LINK
+// ============================================================================
+
+// A message from the USB host; any valid frame shows it is there
+void onUsbFrame(uint8_t type, uint8_t* payload, size_t length) {
+    ControlMessage_t msg;
+    if (type != USB_FRAME_MESSAGE || !parseControlMessage(payload, length, msg)) {
+        return;
+    }
+    usbHostSeenMs = millis();
+    if (!usbLinkUp) {
+        console.println("USB host attached: backend link over USB");
+        usbLinkUp = true;
+        if (backendConnected) {
+            backendWriter.abort();
+            webSocket.disconnect();
+            backendConnected = false;
+        }
+        onBackendLinkUp();
+    } else if (msg.kind == MSG_HELLO) {
+        // The host's reader restarted within the timeout: register again
+        onBackendLinkUp();
+    }
+
+    if (msg.kind == MSG_REGISTERED) {
+        console.println("Registration confirmed by backend");
+    } else if (msg.kind == MSG_COMMAND) {
+        handleControlCommand(msg);
+    }
+}
+
+// Read what the host sent, and fall back to WiFi once it goes quiet
+void serviceUsb() {
+    uint8_t chunk[USB_READ_CHUNK];
+    int available;
+    while ((available = Serial.available()) > 0) {
+        size_t length = Serial.read(chunk, available < USB_READ_CHUNK ? (size_t)available : USB_READ_CHUNK);
+        usbDeframer.feed(chunk, length, onUsbFrame);
+    }
+    if (usbLinkUp && millis() - usbHostSeenMs > USB_HOST_TIMEOUT_MS) {
+        usbLinkUp = false;
+        usbWriter.abort();
+        console.release();
+        console.println("USB host gone: backend link back to WiFi");
+        onBackendLinkDown();
+    }
+}
+
 // ============================================================================
 // FREERTOS SAMPLING TASK
 // ============================================================================
 
+void applyAdcConfig() {
+    int drBits = dataRateBits(sampleRateSps);
+    for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+        adcs[c].set_data_rate(drBits);
+        adcs[c].set_pga_gain(pgaGainBits(channelGain[c]));
+    }
+    adcConfigPending = false;
+}
+
+// All converters enter power-down; a START command powers them up and
+// restarts continuous conversion
+void powerDownAdcs() {
+    for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+        adcs[c].SPI_Command(ADS1220_CMD_POWERDOWN);
+    }
+    adcsPoweredDown = true;
+}
+
+void powerUpAdcs() {
+    for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+        adcs[c].Start_Conv();
+    }
+    adcsPoweredDown = false;
+}
+
+void applyCaptureConfig() {
+    TriggerConfig_t config;
+    config.threshold = (float)triggerThresholdN;
+    config.preTriggerSamples = (uint32_t)sampleRateSps * PRE_TRIGGER_MS / 1000;
+    config.postTriggerHoldSamples = (uint32_t)sampleRateSps * POST_TRIGGER_HOLD_MS / 1000;
+    triggerCapture.configure(config);
+    captureConfigPending = false;
+}
+
+// Hand a sample to the sender; if the ring is full the link has fallen too
+// far behind and the sample is dropped
+void emitSample(const Sample_t& sample) {
+    uint32_t started = ESP.getCycleCount();
+    bool pushed = sampleRing.push(sample);
+    uint32_t cycles = ESP.getCycleCount() - started;
+    if (!pushed) {
+        ringOverflows++;
+    }
+    pushTiming.total += cycles;
+    pushTiming.count++;
+    if (cycles > pushTiming.max) {
+        pushTiming.max = cycles;
+    }
+}
+
+// Widen a capture's sample back to a Sample_t for the queue
+void emitTriggerSample(const TriggerSample_t& entry) {
+    Sample_t sample;
+    sample.timestampUs = entry.timestampUs;
+    for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+        sample.values[c] = entry.values[c];
+    }
+    emitSample(sample);
+}
+
+template <typename Config>
 void vSamplerTask(void *pvParameters) {
-    sampleIndex = 0;
+    float tareSum[CHANNEL_COUNT] = {};
+    uint16_t tareCount = 0;
+    float raw[CHANNEL_COUNT] = {};  // A channel that misses a frame keeps its last reading
 
     for(;;) {
+        if (adcConfigPending) {
+            applyAdcConfig();
+            captureConfigPending = true;  // History length follows the rate
+        }
+        if (Config::triggerCapture && captureConfigPending) {
+            applyCaptureConfig();
+        }
+
         if (systemState != Sampling_state) {
-            vTaskDelay(pdMS_TO_TICKS(100));
+            if (!adcsPoweredDown) {
+                powerDownAdcs();
+            }
+            // Sleep until a start or configuration command
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            idleWakeups++;
             continue;
         }
+        if (adcsPoweredDown) {
+            powerUpAdcs();
+        }
 
-        bool gotLeft = false, gotRight = false;
+        // One conversion from every channel; channel 0's DRDY edge stamps it.
+        // A frame longer than two conversion periods has lost a channel.
+        uint32_t frameTimeoutUs = 2000000UL / sampleRateSps;
+        if (readAllChannels(adcBus, CHANNEL_COUNT, raw, frameTimeoutUs, scheduleStats) == CHANNEL_COUNT) {
+            bootMark(bootTimeline.firstSampleUs, esp_timer_get_time());
+        }
         Sample_t sample;
-        uint32_t now = millis();
-
-        // Poll both sensors until we get readings
-        while (!gotLeft || !gotRight) {
-            if (!gotLeft && digitalRead(LEFT_ADS1220_DRDY_PIN) == LOW) {
-                int32_t raw_left = pc_ads1220left.Read_Data_Samples();
-                gotLeft = true;
-                sample.left = raw_left;
-            }
+        sample.timestampUs = adcBus.conversionUs;
 
-            if (!gotRight && digitalRead(RIGHT_ADS1220_DRDY_PIN) == LOW) {
-                int32_t raw_right = pc_ads1220right.Read_Data_Samples();
-                gotRight = true;
-                sample.right = raw_right;
-            }
-            
-            delayMicroseconds(10); // Short delay to avoid tight loop
+        if (wakeLatencyFirstSample(wakeLatency, esp_timer_get_time())) {
+            startLatencyPending = true;
+            notifyNetworkTask();
         }
 
-        sample.timestamp = now;
+        // Accumulate raw readings while a tare is in progress
+        if (tareSamplesRemaining > 0) {
+            for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+                tareSum[c] += raw[c];
+            }
+            tareCount++;
+            if (--tareSamplesRemaining == 0) {
+                for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+                    tareOffset[c] = tareSum[c] / tareCount;
+                    tareSum[c] = 0.0f;
+                }
+                tareCount = 0;
+            }
+        }
+        float force = 0.0f;
+        for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+            sample.values[c] = raw[c] - tareOffset[c];
+            force += sample.values[c] * CHANNELS[c].countsToNewtons;
+        }
 
-        // Store sample in buffer if space available
-        if (sampleIndex < ADC_QUEUE_LENGTH) {
-            sampleBuffer[sampleIndex++] = sample;
+        uint32_t overflows = ringOverflows;
+        if constexpr (Config::triggerCapture) {
+            if (triggerThresholdN > 0) {
+                TriggerSample_t entry;
+                entry.timestampUs = sample.timestampUs;
+                for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+                    entry.values[c] = sample.values[c];
+                }
+                triggerCapture.process(entry, fabsf(force), emitTriggerSample);
+            } else {
+                emitSample(sample);
+            }
         } else {
-            Serial.println("Sampler: Buffer full, switching to sending state");
-            systemState = Sending_state;
-            Serial.println(millis());
+            emitSample(sample);
         }
-
-        // Auto-send every 100 samples for real-time streaming
-        if (sampleIndex % 100 == 0) {
-            systemState = Sending_state; // Auto-send every 100 samples
-            vTaskDelay(5); // Yield to other tasks
+        if (bootCapture && ringOverflows != overflows) {
+            // The queue is full of boot samples: keep them for the link and
+            // stop, rather than count every later sample as an overflow
+            ringOverflows = overflows;
+            bootCapture = false;
+            systemState = Idle_state;
         }
 
-        // Wait for next sampling interval
-        vTaskDelay(pdMS_TO_TICKS(SAMPLING_INTERVAL));
+        // Wait for next sampling interval, or a stop
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(samplingIntervalMs));
     }
 }
 
@@ -204,38 +1146,146 @@ void vSamplerTask(void *pvParameters) {
 // FREERTOS SENDING TASK
 // ============================================================================
 
+void sendDatagram(const uint8_t* datagram, size_t length) {
+    udp.beginPacket(websocket_host, UDP_SAMPLE_PORT);
+    udp.write(datagram, length);
+    udp.endPacket();
+}
+
+// Resend datagrams the backend reported missing, while still in history
+void serviceNacks() {
+    const uint32_t* seq;
+    while (nackQueue.peek(seq, 1)) {
+        size_t length = udpFramer.retransmit(*seq, datagramBuffer);
+        if (length) {
+            sendDatagram(datagramBuffer, length);
+            udpRetransmits++;
+        }
+        nackQueue.consume(1);
+    }
+}
+
+template <typename Config>
 void vSenderTask(void *pvParameters) {
-    JsonDocument doc;
+    uint16_t appliedRate = 0;
+    bool udpStreamPaused = true;
+    bool waitingForFrame = false;   // Every sampleFrames slot was queued
+    uint32_t frameWaitStartedUs = 0;
 
     for (;;) {
-        if (systemState != Sending_state) {
-            vTaskDelay(pdMS_TO_TICKS(100));
+        if (discardPending) {
+            sampleRing.skipTo(sessionStartPosition);
+            discardPending = false;
+        }
+        if (appliedRate != sampleRateSps) {
+            appliedRate = sampleRateSps;
+            batchController.setSampleRate(appliedRate);
+        }
+        if (Config::udpTransport && udpConfigPending) {
+            udpFramer.setParityGroup(udpParityGroup);
+            udpConfigPending = false;
+        }
+
+        // Constant false, and the UDP path compiled out, without udpTransport.
+        // A USB host takes the samples as frames.
+        bool useUdp = Config::udpTransport && sampleTransport == Transport_Udp && !usbLinkUp;
+        if (useUdp) {
+            serviceNacks();
+        }
+
+        // Samples go to the backend and to any directly connected apps
+        uint8_t directClients = Config::directServer ? directSubscribers() : 0;
+        bool backendLink = backendLinkUp();
+        bool linkUp = backendLink || directClients > 0;
+
+        uint32_t backlog = sampleRing.available();
+        if (backlog == 0 || !linkUp) {
+            waitingForFrame = false;
+            // Stream paused: close the parity group and announce the position
+            // so the receiver can detect losses at the tail
+            if (useUdp && !udpStreamPaused) {
+                size_t length = udpFramer.takeParity(datagramBuffer, true);
+                if (length) {
+                    sendDatagram(datagramBuffer, length);
+                }
+                size_t markerLength = udpFramer.encodeMarker(datagramBuffer);
+                for (int i = 0; i < UDP_MARKER_REPEATS; ++i) {
+                    sendDatagram(datagramBuffer, markerLength);
+                }
+                udpStreamPaused = true;
+            }
+            // Idle and drained: sleep until a start command or NACK
+            if (backlog == 0 && systemState != Sampling_state && nackQueue.available() == 0) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                idleWakeups++;
+                continue;
+            }
+            // Until the next sample, or a link-up or state change
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(systemState == Sampling_state ? samplingIntervalMs : 100));
             continue;
         }
 
-        size_t i = 0;
-        while (i < sampleIndex) {
-            doc.clear();
-            JsonArray batch = doc["samples"].to<JsonArray>();
+        // While sampling, wait for the frame to fill; after stop, flush the rest
+        uint32_t waitMs = batchController.waitMs(backlog);
+        if (waitMs > 0 && systemState == Sampling_state) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+            continue;
+        }
 
-            // Send batches of SENDER_BATCH_SIZE samples
-            for (int j = 0; j < SENDER_BATCH_SIZE && i < sampleIndex; ++j, ++i) {
-                JsonObject obj = batch.add<JsonObject>();
-                obj["t"] = sampleBuffer[i].timestamp;
-                obj["l"] = sampleBuffer[i].left;
-                obj["r"] = sampleBuffer[i].right;
+        // WebSocket frames are encoded straight into a send queue slot. With
+        // every slot still queued the link is behind: the samples stay in
+        // the ring, and the wait counts as send time for the batch controller.
+        char* json = nullptr;
+        if (!useUdp || directClients > 0) {
+            json = sampleFrames.acquire();
+            if (!json) {
+                if (!waitingForFrame) {
+                    waitingForFrame = true;
+                    frameWaitStartedUs = micros();
+                }
+                vTaskDelay(pdMS_TO_TICKS(1));
+                continue;
             }
+        }
+        uint32_t sendStarted = waitingForFrame ? frameWaitStartedUs : micros();
+        waitingForFrame = false;
+
+        SampleSpan_t span;
+        sampleRing.peek(span, batchController.batchSize());
+        size_t encoded = 0;
 
-            String payload;
-            serializeJson(doc, payload);
-            // Send data via Raw WebSocket (optimal for Flutter)
-            webSocket.sendTXT(payload);
-            vTaskDelay(pdMS_TO_TICKS(1)); // Minimal delay for real-time streaming
+        if (useUdp) {
+            size_t length = udpFramer.encodeData(span, datagramBuffer, encoded);
+            sendDatagram(datagramBuffer, length);
+            length = udpFramer.takeParity(datagramBuffer);
+            if (length) {
+                sendDatagram(datagramBuffer, length);
+            }
+            udpStreamPaused = false;
+
+            // Direct clients only speak JSON: the same samples as a frame
+            if (directClients > 0) {
+                span.count = encoded;
+                size_t jsonEncoded = 0;
+                length = encodeSampleBatch(span, json, JSON_BUFFER_SIZE, jsonEncoded);
+                sampleFrames.publish(length, FRAME_TO_DIRECT);
+                notifyNetworkTask();
+            }
+        } else {
+            size_t length = encodeSampleBatch(span, json, JSON_BUFFER_SIZE, encoded);
+            if (encoded == 0) {
+                vTaskDelay(pdMS_TO_TICKS(1));
+                continue;
+            }
+            sampleFrames.publish(length, (backendLink ? FRAME_TO_BACKEND : 0) |
+                                         (directClients > 0 ? FRAME_TO_DIRECT : 0));
+            notifyNetworkTask();
         }
-        
-        // Reset sample index and restart sampling for continuous operation
-        sampleIndex = 0;
-        systemState = Sampling_state;
+        uint32_t sendDurationUs = micros() - sendStarted;
+
+        sampleRing.consume(encoded);
+        batchController.onFrameSent((uint16_t)encoded, sendDurationUs, sampleRing.available(), wifiRssi);
+        taskYIELD();
     }
 }
 
@@ -244,48 +1294,34 @@ void vSenderTask(void *pvParameters) {
 // ============================================================================
 
 void initializeADS1220() {
-    Serial.println("Initializing ADS1220 modules ...");
+    console.println("Initializing ADS1220 modules ...");
     
-    SPI.begin(13, 12, 11); 
-
-    pinMode(LEFT_ADS1220_DRDY_PIN, INPUT_PULLUP);
-    pinMode(RIGHT_ADS1220_DRDY_PIN, INPUT_PULLUP);
-
-    // Initialize left ADS1220 
-    pc_ads1220left.begin(LEFT_ADS1220_CS_PIN, LEFT_ADS1220_DRDY_PIN);
-    pc_ads1220left.set_pga_gain(PGA_GAIN_128);
-    pc_ads1220left.set_OperationMode(MODE_NORMAL);
-    pc_ads1220left.set_data_rate(DR_1000SPS);
-    pc_ads1220left.set_conv_mode_continuous();
-    pc_ads1220left.select_mux_channels(MUX_AIN0_AIN1);
-    pc_ads1220left.Start_Conv();
-    delayMicroseconds(50); // Allow time for ADS1220 to stabilize
-
-    // Print left registers for verification
-    Serial.println("Left ADS1220 registers:");
-    Serial.println(pc_ads1220left.readRegister(CONFIG_REG0_ADDRESS), HEX);
-    Serial.println(pc_ads1220left.readRegister(CONFIG_REG1_ADDRESS), HEX);
-    Serial.println(pc_ads1220left.readRegister(CONFIG_REG2_ADDRESS), HEX);
-    Serial.println(pc_ads1220left.readRegister(CONFIG_REG3_ADDRESS), HEX);
-
-    // Initialize right ADS1220 
-    pc_ads1220right.begin(RIGHT_ADS1220_CS_PIN, RIGHT_ADS1220_DRDY_PIN);
-    pc_ads1220right.set_pga_gain(PGA_GAIN_128);
-    pc_ads1220right.set_OperationMode(MODE_NORMAL);
-    pc_ads1220right.set_data_rate(DR_1000SPS);
-    pc_ads1220right.set_conv_mode_continuous();
-    pc_ads1220right.select_mux_channels(MUX_AIN0_AIN1);
-    pc_ads1220right.Start_Conv();
-    delayMicroseconds(50); // Allow time for ADS1220 to stabilize
-
-    // Print right registers for verification 
-    Serial.println("Right ADS1220 registers:");
-    Serial.println(pc_ads1220right.readRegister(CONFIG_REG0_ADDRESS), HEX);
-    Serial.println(pc_ads1220right.readRegister(CONFIG_REG1_ADDRESS), HEX);
-    Serial.println(pc_ads1220right.readRegister(CONFIG_REG2_ADDRESS), HEX);
-    Serial.println(pc_ads1220right.readRegister(CONFIG_REG3_ADDRESS), HEX);
-
-    Serial.println("ADS1220 modules initialized");
+    SPI.begin(SPI_SCK_PIN, SPI_MISO_PIN, SPI_MOSI_PIN);
+
+    for (size_t c = 0; c < CHANNEL_COUNT; ++c) {
+        const ChannelConfig_t& channel = CHANNELS[c];
+        channelGain[c] = channel.gain;
+        pinMode(channel.drdyPin, INPUT_PULLUP);
+
+        adcs[c].begin(channel.csPin, channel.drdyPin);
+        adcs[c].set_pga_gain(pgaGainBits(channel.gain));
+        adcs[c].set_OperationMode(MODE_NORMAL);
+        adcs[c].set_data_rate(dataRateBits(channel.sps));
+        adcs[c].set_conv_mode_continuous();
+        adcs[c].select_mux_channels(MUX_AIN0_AIN1);
+        adcs[c].Start_Conv();
+        delayMicroseconds(50); // Allow time for ADS1220 to stabilize
+
+        // Print registers for verification
+        console.printf("%s ADS1220 registers:\n", channel.name);
+        console.println(adcs[c].readRegister(CONFIG_REG0_ADDRESS), HEX);
+        console.println(adcs[c].readRegister(CONFIG_REG1_ADDRESS), HEX);
+        console.println(adcs[c].readRegister(CONFIG_REG2_ADDRESS), HEX);
+        console.println(adcs[c].readRegister(CONFIG_REG3_ADDRESS), HEX);
+    }
+    attachInterrupt(digitalPinToInterrupt(CHANNELS[0].drdyPin), onDrdyEdge, FALLING);
+
+    console.println("ADS1220 modules initialized");
 }
 
 // ============================================================================
@@ -293,52 +1329,125 @@ void initializeADS1220() {
 // ============================================================================
 
 void setup() {
+    // No wait for a USB host: the rig has to come up on a plain power supply
     Serial.begin(115200);
-    while (!Serial);
-    Serial.println("--- ADS1220 Dual Polling Sampler ---");
-    Serial.println("FreeRTOS Multi-Tasking Architecture");
-    Serial.println("=====================================================================");
+#if ARDUINO_USB_CDC_ON_BOOT
+    Serial.setTxTimeoutMs(0);   // Drop log output rather than block when nobody reads it
+#endif
+    console.println("--- ADS1220 Dual Polling Sampler ---");
+    console.println("FreeRTOS Multi-Tasking Architecture");
+    console.println("=====================================================================");
     
     // Initialize ADS1220
     initializeADS1220();
 
     // Initialize FreeRTOS buffer in PSRAM
-    sampleBuffer = (Sample_t*)ps_malloc(sizeof(Sample_t) * ADC_QUEUE_LENGTH);
+    sampleBuffer = Pipeline::psramQueue ? ps_malloc(SAMPLE_QUEUE_BYTES) : (void*)dramQueue;
     if (!sampleBuffer) {
-        Serial.println("ERROR: Failed to allocate sample buffer in PSRAM.");
+        console.println("ERROR: Failed to allocate sample buffer in PSRAM.");
         while (1);  // halt
     }
+    sampleRing.attach(sampleBuffer, Pipeline::channels, Pipeline::queueLength);
 
-    // Connect WiFi 
-    Serial.printf("Connecting to WiFi: %s\n", ssid);
-    WiFi.begin(ssid, password);
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(1000);
-        Serial.print(".");
+    // UDP transport: retransmit history in PSRAM (optional) and NACK queue
+    if (Pipeline::udpTransport) {
+        udpFramer.attachHistory((uint8_t*)ps_malloc(Pipeline::udpHistorySlots * UDP_HISTORY_SLOT_BYTES),
+                                Pipeline::udpHistorySlots);
+        udpFramer.setParityGroup(UDP_PARITY_GROUP);
+    }
+    nackQueue.attach(nackStorage, NACK_QUEUE_LENGTH);
+    if (Pipeline::directServer) {
+        directHubMutex = xSemaphoreCreateMutex();
     }
-    Serial.println();
-    Serial.printf("WiFi connected! IP: %s\n", WiFi.localIP().toString().c_str());
 
-    // Setup Raw WebSocket connection  
-    Serial.printf("Connecting to Raw WebSocket: %s:%d%s\n", websocket_host, websocket_port, websocket_path);
-    webSocket.begin(websocket_host, websocket_port, websocket_path);
-    webSocket.onEvent(onWebSocketEvent);
-    webSocket.setReconnectInterval(2000); // Fast reconnection for real-time
+    // Create FreeRTOS tasks before touching the network. The sampler starts
+    // at once; its samples stay queued (up to the ring's capacity) until the
+    // backend link is up and the sender can deliver them. setup() runs on
+    // the loop task, which becomes the network task.
+    bootCapture = true;
+    systemState = Sampling_state;
+    xNetworkTaskHandle = xTaskGetCurrentTaskHandle();
+    xTaskCreate(vSamplerTask<Pipeline>, "SamplerTask", SAMPLER_STACK_SIZE, NULL, SAMPLER_TASK_PRIORITY, &xSamplerTaskHandle);
+    xTaskCreate(vSenderTask<Pipeline>, "SenderTask", SENDER_STACK_SIZE, NULL, SENDER_TASK_PRIORITY, &xSenderTaskHandle);
+    bootMark(bootTimeline.readyUs, esp_timer_get_time());
+    console.printf("Acquisition ready after %ld ms\n", (long)bootMs(bootTimeline.readyUs));
+
+    // Connect WiFi in the background; loop() starts the WebSocket once it is up
+    console.printf("Connecting to WiFi: %s\n", ssid);
+    WiFi.begin(ssid, password);
 
     // Memory info
-    Serial.printf("Free heap: %u bytes\n", ESP.getFreeHeap());
-    Serial.printf("Free PSRAM: %u bytes\n", ESP.getFreePsram());
+    console.printf("Free heap: %u bytes\n", ESP.getFreeHeap());
+    console.printf("Free PSRAM: %u bytes\n", ESP.getFreePsram());
 
-    // Create FreeRTOS tasks
-    xTaskCreate(vSamplerTask, "SamplerTask", SAMPLER_STACK_SIZE, NULL, SAMPLER_TASK_PRIORITY, &xSamplerTaskHandle);
-    xTaskCreate(vSenderTask, "SenderTask", SENDER_STACK_SIZE, NULL, SENDER_TASK_PRIORITY, &xSenderTaskHandle);
-    
-    Serial.println("Setup complete. FreeRTOS tasks created.");
-    Serial.println("Waiting for WebSocket connection...");
-    Serial.println();
-    Serial.println("=== REAL-TIME DATA STREAMING ===");
-    Serial.println("Sampling at 1000 Hz, sending to backend in batches");
-    Serial.println("==================================");
+    // Full speed while sampling from boot; the first backend link idles the
+    // rig until the backend sends start
+    enterActivePower();
+
+    console.println("Setup complete. FreeRTOS tasks created.");
+    console.println("Waiting for WiFi and WebSocket connection...");
+    console.println();
+    console.println("=== REAL-TIME DATA STREAMING ===");
+    console.println("Sampling at 1000 Hz, sending to backend in batches");
+    console.println("==================================");
+}
+
+// The first sample after a start: tell the backend how long the wake took
+void reportStartLatency() {
+    if (!startLatencyPending) {
+        return;
+    }
+    startLatencyPending = false;
+    char report[40];
+    snprintf(report, sizeof(report), "{\"start_latency_us\":%lu}", (unsigned long)wakeLatency.last);
+    queueControl(report, FRAME_TO_BACKEND | FRAME_TO_DIRECT);
+}
+
+// Start the WebSocket once WiFi has associated, then keep it serviced and
+// write queued frames. WiFi itself reconnects in the background. The USB link
+// needs neither.
+void serviceNetwork() {
+    if (USB_TRANSPORT) {
+        serviceUsb();
+    }
+    if (!webSocketStarted && WiFi.status() == WL_CONNECTED) {
+        bootMark(bootTimeline.wifiUs, esp_timer_get_time());
+        console.printf("WiFi connected after %ld ms! IP: %s\n", (long)bootMs(bootTimeline.wifiUs),
+                       WiFi.localIP().toString().c_str());
+
+        // Setup Raw WebSocket connection  
+        console.printf("Connecting to Raw WebSocket: %s:%d%s\n", websocket_host, websocket_port, websocket_path);
+        webSocket.begin(websocket_host, websocket_port, websocket_path);
+        webSocket.onEvent(onWebSocketEvent);
+        webSocket.setReconnectInterval(2000); // Fast reconnection for real-time
+
+        if (Pipeline::directServer) {
+            directSocket.begin();
+            directSocket.onEvent(onDirectEvent);
+            console.printf("Direct-connect server: ws://%s:%u\n", WiFi.localIP().toString().c_str(),
+                           (unsigned)DIRECT_SERVER_PORT);
+        }
+        webSocketStarted = true;
+    }
+    // The library writes too (handshake, pongs, close): never in the middle of
+    // one of our frames. Not serviced at all while USB carries the backend
+    // link, so it does not reconnect.
+    if (webSocketStarted && !usbLinkUp && !backendWriter.busy()) {
+        webSocket.loop();
+    }
+    reportStartLatency();
+    drainSendQueues();
+
+    if (Pipeline::directServer && webSocketStarted) {
+        directSocket.loop();
+        uint32_t evicted = __atomic_exchange_n(&directDisconnectsPending, 0, __ATOMIC_RELAXED);
+        for (uint8_t client = 0; evicted; ++client, evicted >>= 1) {
+            if (evicted & 1) {
+                console.printf("Direct client %u dropped: not keeping up\n", (unsigned)client);
+                directSocket.disconnect(client);
+            }
+        }
+    }
 }
 
 // ============================================================================
@@ -346,16 +1455,33 @@ void setup() {
 // ============================================================================
 
 void loop() {
-    // Handle WebSocket communication (real-time)
-    webSocket.loop();
+    // Handle WiFi bring-up and WebSocket communication (real-time)
+    serviceNetwork();
     
     // Send periodic ping to keep connection alive (Raw WebSocket format)
     static unsigned long lastPing = 0;
     if (millis() - lastPing > 25000) { // Every 25 seconds
-        webSocket.sendTXT("{\"ping\":true}"); // Simple JSON ping
+        if (backendConnected) {
+            queueControl("{\"ping\":true}"); // Simple JSON ping
+        }
         lastPing = millis();
     }
+
+    // RSSI feeds the sender's batch sizing
+    static unsigned long lastRssiPoll = 0;
+    if (millis() - lastRssiPoll > RSSI_POLL_INTERVAL_MS) {
+        wifiRssi = (int8_t)WiFi.RSSI();
+        lastRssiPoll = millis();
+    }
+
+    // Track heap free-block statistics for fragmentation monitoring
+    static unsigned long lastHeapSnapshot = 0;
+    if (heapTrend.snapshots == 0 || millis() - lastHeapSnapshot > HEAP_STATS_INTERVAL_MS) {
+        heapTrendUpdate(heapTrend, readHeapStats());
+        lastHeapSnapshot = millis();
+    }
     
-    // Minimal delay for real-time performance
-    vTaskDelay(pdMS_TO_TICKS(10));
+    // Until the sender queues a frame, or sooner to retry a stalled write
+    bool writing = backendWriter.busy() || usbWriter.busy();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(writing ? NETWORK_STALL_POLL_MS : NETWORK_POLL_MS));
 }
\ No newline at end of file
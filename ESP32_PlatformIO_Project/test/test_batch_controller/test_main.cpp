@@ -0,0 +1,178 @@
+#include <unity.h>
+#include <stdio.h>
+#include "batch_controller.h"
+#include "sample_ring.h"
+
+#define SAMPLE_RATE_SPS   1000
+#define BYTES_PER_SAMPLE  40
+#define RING_CAPACITY     120000
+
+static const BatchConfig_t CONFIG = { 20, 250, 100, 50, -75 };
+
+// Simulated WiFi link: fixed cost per frame plus a cost per byte
+typedef struct {
+    uint32_t frameOverheadUs;
+    float usPerByte;
+    int8_t rssiDbm;
+} SimLink_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t maxBacklog;
+    uint32_t finalBacklog;
+    uint32_t maxLatencyMs;
+    uint16_t minBatchSeen;
+    uint16_t maxBatchSeen;
+    uint16_t finalBatch;
+    uint32_t dropped;
+} SimResult_t;
+
+static uint32_t storage[RING_CAPACITY];
+
+// Run sampler + sender against the link for the given simulated duration.
+// Time advances in microseconds; samples carry their production time.
+static SimResult_t simulate(const SimLink_t& link, uint32_t seconds) {
+    SampleRing<uint32_t> ring;
+    ring.attach(storage, RING_CAPACITY);
+    BatchController controller(CONFIG, SAMPLE_RATE_SPS);
+
+    SimResult_t result = {};
+    result.minBatchSeen = 0xFFFF;
+
+    const uint64_t samplePeriodUs = 1000000 / SAMPLE_RATE_SPS;
+    const uint64_t endUs = (uint64_t)seconds * 1000000;
+    uint64_t nowUs = 0;
+    uint64_t nextSampleUs = 0;
+
+    auto produceUntil = [&](uint64_t t) {
+        while (nextSampleUs <= t) {
+            if (!ring.push((uint32_t)(nextSampleUs / 1000))) {
+                result.dropped++;
+            }
+            nextSampleUs += samplePeriodUs;
+        }
+    };
+
+    while (nowUs < endUs) {
+        produceUntil(nowUs);
+        uint32_t backlog = ring.available();
+        uint32_t wait = controller.waitMs(backlog);
+        if (backlog == 0 || wait > 0) {
+            nowUs += (uint64_t)(wait ? wait : 1) * 1000;
+            continue;
+        }
+
+        const uint32_t* first;
+        size_t count = ring.peek(first, controller.batchSize());
+        uint32_t oldestMs = first[0];
+        uint32_t sendUs = link.frameOverheadUs + (uint32_t)(count * BYTES_PER_SAMPLE * link.usPerByte);
+        nowUs += sendUs;
+        produceUntil(nowUs);
+        ring.consume(count);
+
+        uint32_t latencyMs = (uint32_t)(nowUs / 1000) - oldestMs;
+        if (latencyMs > result.maxLatencyMs) result.maxLatencyMs = latencyMs;
+        controller.onFrameSent((uint16_t)count, sendUs, ring.available(), link.rssiDbm);
+
+        uint16_t batch = controller.batchSize();
+        if (batch < result.minBatchSeen) result.minBatchSeen = batch;
+        if (batch > result.maxBatchSeen) result.maxBatchSeen = batch;
+        if (ring.available() > result.maxBacklog) result.maxBacklog = ring.available();
+        result.frames++;
+    }
+
+    result.finalBacklog = ring.available();
+    result.finalBatch = controller.batchSize();
+    return result;
+}
+
+static void report(const char* name, const SimResult_t& r, uint32_t seconds) {
+    char line[200];
+    snprintf(line, sizeof(line), "%s: batch %u..%u (final %u), %.1f frames/s, max backlog %lu, max latency %lu ms",
+             name, r.minBatchSeen, r.maxBatchSeen, r.finalBatch, (double)r.frames / seconds,
+             (unsigned long)r.maxBacklog, (unsigned long)r.maxLatencyMs);
+    TEST_MESSAGE(line);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_bounds_from_config() {
+    BatchController controller(CONFIG, SAMPLE_RATE_SPS);
+    TEST_ASSERT_EQUAL(20, controller.lowerBound());
+    TEST_ASSERT_EQUAL(100, controller.latencyCap());
+    TEST_ASSERT_EQUAL(20, controller.batchSize());
+
+    // Frame rate ceiling raises the floor at higher sample rates
+    controller.setSampleRate(2000);
+    TEST_ASSERT_EQUAL(40, controller.lowerBound());
+    TEST_ASSERT_EQUAL(200, controller.latencyCap());
+
+    // Low rates keep at least minBatch
+    controller.setSampleRate(20);
+    TEST_ASSERT_EQUAL(20, controller.lowerBound());
+    TEST_ASSERT_EQUAL(20, controller.latencyCap());
+}
+
+void test_idle_link_keeps_small_frames() {
+    SimLink_t link = { 800, 0.1f, -55 };
+    SimResult_t r = simulate(link, 30);
+    report("idle link", r, 30);
+
+    TEST_ASSERT_EQUAL(CONFIG.minBatch, r.finalBatch);
+    TEST_ASSERT_LESS_OR_EQUAL(CONFIG.maxLatencyMs, r.maxLatencyMs);
+    TEST_ASSERT_LESS_OR_EQUAL(CONFIG.maxFramesPerSecond, r.frames / 30);
+    TEST_ASSERT_EQUAL(0, r.dropped);
+}
+
+void test_congested_link_grows_frames_and_drains() {
+    // 30 ms of TCP/ACK overhead per frame: 20-sample frames cannot keep up
+    SimLink_t link = { 30000, 0.5f, -60 };
+    SimResult_t r = simulate(link, 60);
+    report("congested link", r, 60);
+
+    TEST_ASSERT_GREATER_THAN(60, r.finalBatch);
+    TEST_ASSERT_LESS_OR_EQUAL(CONFIG.maxBatch, r.maxBatchSeen);
+    TEST_ASSERT_LESS_OR_EQUAL(2u * CONFIG.maxBatch, r.finalBacklog);
+    TEST_ASSERT_EQUAL(0, r.dropped);
+}
+
+void test_weak_signal_prefers_large_frames() {
+    SimLink_t link = { 800, 0.1f, -85 };
+    SimResult_t r = simulate(link, 10);
+    report("weak RSSI", r, 10);
+
+    TEST_ASSERT_EQUAL(CONFIG.maxBatch, r.finalBatch);
+}
+
+void test_recovers_latency_after_congestion() {
+    BatchController controller(CONFIG, SAMPLE_RATE_SPS);
+    for (int i = 0; i < 20; ++i) {
+        controller.onFrameSent(controller.batchSize(), 200000, 1000, -60);
+    }
+    TEST_ASSERT_EQUAL(CONFIG.maxBatch, controller.batchSize());
+
+    for (int i = 0; i < 100; ++i) {
+        controller.onFrameSent(controller.batchSize(), 500, 0, -60);
+    }
+    TEST_ASSERT_EQUAL(CONFIG.minBatch, controller.batchSize());
+}
+
+void test_wait_for_frame_to_fill() {
+    BatchController controller(CONFIG, SAMPLE_RATE_SPS);
+    TEST_ASSERT_EQUAL(0, controller.waitMs(20));
+    TEST_ASSERT_EQUAL(0, controller.waitMs(500));
+    TEST_ASSERT_EQUAL(15, controller.waitMs(5));
+    TEST_ASSERT_EQUAL(20, controller.waitMs(0));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bounds_from_config);
+    RUN_TEST(test_idle_link_keeps_small_frames);
+    RUN_TEST(test_congested_link_grows_frames_and_drains);
+    RUN_TEST(test_weak_signal_prefers_large_frames);
+    RUN_TEST(test_recovers_latency_after_congestion);
+    RUN_TEST(test_wait_for_frame_to_fill);
+    return UNITY_END();
+}
@@ -0,0 +1,53 @@
+#include <unity.h>
+#include "boot_timeline.h"
+
+static BootTimeline_t boot;
+
+void setUp() {
+    boot = BootTimeline_t();
+}
+
+void tearDown() {}
+
+void test_unreached_milestones_report_minus_one() {
+    TEST_ASSERT_EQUAL(-1, bootMs(boot.readyUs));
+    TEST_ASSERT_EQUAL(-1, bootMs(boot.linkUs));
+}
+
+void test_only_first_mark_counts() {
+    bootMark(boot.readyUs, 180000);
+    bootMark(boot.firstSampleUs, 182500);
+    bootMark(boot.firstSampleUs, 190000);
+    bootMark(boot.wifiUs, 2400000);
+    bootMark(boot.linkUs, 2650000);
+    bootMark(boot.linkUs, 9000000);     // Reconnect later on
+
+    TEST_ASSERT_EQUAL(180, bootMs(boot.readyUs));
+    TEST_ASSERT_EQUAL(182, bootMs(boot.firstSampleUs));
+    TEST_ASSERT_EQUAL(2400, bootMs(boot.wifiUs));
+    TEST_ASSERT_EQUAL(2650, bootMs(boot.linkUs));
+}
+
+// Acquisition does not depend on the network coming up
+void test_sampling_ready_before_network() {
+    bootMark(boot.readyUs, 150000);
+    bootMark(boot.firstSampleUs, 152000);
+    TEST_ASSERT_TRUE(bootMs(boot.firstSampleUs) >= 0);
+    TEST_ASSERT_EQUAL(-1, bootMs(boot.wifiUs));
+}
+
+void test_mark_at_time_zero_still_counts() {
+    bootMark(boot.readyUs, 0);
+    TEST_ASSERT_EQUAL(0, bootMs(boot.readyUs));
+    bootMark(boot.readyUs, 5000);
+    TEST_ASSERT_EQUAL(0, bootMs(boot.readyUs));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_unreached_milestones_report_minus_one);
+    RUN_TEST(test_only_first_mark_counts);
+    RUN_TEST(test_sampling_ready_before_network);
+    RUN_TEST(test_mark_at_time_zero_still_counts);
+    return UNITY_END();
+}
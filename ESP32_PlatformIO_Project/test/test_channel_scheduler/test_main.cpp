@@ -0,0 +1,162 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "channel_scheduler.h"
+
+#define PERIOD_US         1000      // 1000 SPS
+#define FRAMES            2000
+#define POLL_US           10        // delayMicroseconds() between DRDY polls
+#define DRDY_READ_US      1         // digitalRead() of one DRDY line
+#define SPI_READ_US       20        // CS, 24-bit transfer at 2 MHz, library overhead
+
+// Free-running converters with random phases on one simulated SPI bus
+class SimBus {
+public:
+    SimBus(uint8_t channels, uint32_t readUs, unsigned seed)
+        : channels_(channels), readUs_(readUs), now_(0), missed_(0), maxLatency_(0) {
+        srand(seed);
+        for (uint8_t c = 0; c < channels_; ++c) {
+            phase_[c] = (uint64_t)(rand() % PERIOD_US);
+            lastRead_[c] = -1;
+        }
+    }
+
+    bool ready(uint8_t c) {
+        now_ += DRDY_READ_US;
+        int64_t conversion = latestConversion(c);
+        return conversion >= 0 && conversion > lastRead_[c];
+    }
+
+    float read(uint8_t c) {
+        int64_t conversion = latestConversion(c);
+        uint64_t latency = now_ - (phase_[c] + (uint64_t)conversion * PERIOD_US);
+        if (latency > maxLatency_) {
+            maxLatency_ = latency;
+        }
+        // Conversions that came and went without being read
+        if (lastRead_[c] >= 0 && conversion - lastRead_[c] > 1) {
+            missed_ += (uint32_t)(conversion - lastRead_[c] - 1);
+        }
+        lastRead_[c] = conversion;
+        now_ += readUs_;
+        return (float)conversion;
+    }
+
+    uint64_t nowUs() { return now_; }
+    void wait() { now_ += POLL_US; }
+
+    uint32_t missed() const { return missed_; }
+    uint64_t maxLatency() const { return maxLatency_; }
+
+private:
+    int64_t latestConversion(uint8_t c) const {
+        if (now_ < phase_[c]) {
+            return -1;
+        }
+        return (int64_t)((now_ - phase_[c]) / PERIOD_US);
+    }
+
+    uint8_t channels_;
+    uint32_t readUs_;
+    uint64_t now_;
+    uint64_t phase_[32];
+    int64_t lastRead_[32];
+    uint32_t missed_;
+    uint64_t maxLatency_;
+};
+
+typedef struct {
+    ScheduleStats_t stats;
+    uint32_t missed;
+    uint64_t maxLatency;
+    bool aligned;           // Every frame read the same conversion on every channel
+} RunResult_t;
+
+static RunResult_t runSampler(uint8_t channels, uint32_t readUs) {
+    SimBus bus(channels, readUs, 1234 + channels);
+    RunResult_t result = {};
+    float values[32];
+    result.aligned = true;
+
+    for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+        readAllChannels(bus, channels, values, 2 * PERIOD_US, result.stats);
+        for (uint8_t c = 1; c < channels; ++c) {
+            float spread = values[c] - values[0];
+            if (spread > 1.0f || spread < -1.0f) {
+                result.aligned = false;
+            }
+        }
+    }
+    result.missed = bus.missed();
+    result.maxLatency = bus.maxLatency();
+    return result;
+}
+
+static void report(uint8_t channels, const RunResult_t& r) {
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%u channels: bus busy max %lu us of %d us period, worst DRDY-to-read %llu us, "
+             "frame span max %lu us, missed %lu, timeouts %lu",
+             (unsigned)channels, (unsigned long)r.stats.maxBusUs, PERIOD_US,
+             (unsigned long long)r.maxLatency, (unsigned long)r.stats.maxFrameUs,
+             (unsigned long)r.missed, (unsigned long)r.stats.timeouts);
+    TEST_MESSAGE(line);
+}
+
+static void checkBudget(uint8_t channels) {
+    RunResult_t r = runSampler(channels, SPI_READ_US);
+    report(channels, r);
+
+    TEST_ASSERT_EQUAL(FRAMES, r.stats.frames);
+    TEST_ASSERT_EQUAL(0, r.stats.timeouts);
+    TEST_ASSERT_EQUAL(0, r.missed);
+    TEST_ASSERT_TRUE(r.aligned);
+    TEST_ASSERT_LESS_THAN(PERIOD_US, (uint32_t)r.maxLatency);
+    TEST_ASSERT_LESS_THAN(PERIOD_US, r.stats.maxBusUs);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_two_channels_fit_budget() {
+    checkBudget(2);
+}
+
+void test_four_channels_fit_budget() {
+    checkBudget(4);
+}
+
+void test_eight_channels_fit_budget() {
+    checkBudget(8);
+}
+
+// A bus too slow for eight channels must show up as a blown budget
+void test_slow_bus_is_detected() {
+    RunResult_t r = runSampler(8, 150);
+    report(8, r);
+    TEST_ASSERT_TRUE(r.missed > 0 || r.maxLatency >= PERIOD_US || r.stats.maxBusUs >= PERIOD_US);
+}
+
+void test_missing_channel_times_out() {
+    class DeadChannelBus : public SimBus {
+    public:
+        DeadChannelBus() : SimBus(2, SPI_READ_US, 7) {}
+        bool ready(uint8_t c) { return c == 0 && SimBus::ready(c); }
+    } bus;
+
+    ScheduleStats_t stats = {};
+    float values[2] = { -1.0f, -1.0f };
+    TEST_ASSERT_EQUAL(1, readAllChannels(bus, 2, values, 2 * PERIOD_US, stats));
+    TEST_ASSERT_EQUAL(1, stats.timeouts);
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, values[1]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_two_channels_fit_budget);
+    RUN_TEST(test_four_channels_fit_budget);
+    RUN_TEST(test_eight_channels_fit_budget);
+    RUN_TEST(test_slow_bus_is_detected);
+    RUN_TEST(test_missing_channel_times_out);
+    return UNITY_END();
+}
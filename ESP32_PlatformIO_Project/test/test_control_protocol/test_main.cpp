@@ -0,0 +1,196 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include "control_protocol.h"
+#include "heap_stats.h"
+
+// Count every operator new so the soak can prove the parser never allocates
+static size_t allocationCount = 0;
+
+void* operator new(size_t size) {
+    allocationCount++;
+    void* p = malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static bool parse(const char* text, ControlMessage_t& msg) {
+    return parseControlMessage((const uint8_t*)text, strlen(text), msg);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_command_table() {
+    const char* names[] = { "start", "stop", "rate", "gain", "tare", "telemetry", "trigger",
+                            "transport", "fec", "nack" };
+    const ControlCommand commands[] = { CMD_START, CMD_STOP, CMD_RATE, CMD_GAIN, CMD_TARE, CMD_TELEMETRY, CMD_TRIGGER,
+                                        CMD_TRANSPORT, CMD_FEC, CMD_NACK };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        TEST_ASSERT_EQUAL(commands[i], lookupControlCommand(names[i], strlen(names[i])));
+        TEST_ASSERT_EQUAL_STRING(names[i], controlCommandName(commands[i]));
+    }
+    TEST_ASSERT_EQUAL(CMD_NONE, lookupControlCommand("sta", 3));
+    TEST_ASSERT_EQUAL(CMD_NONE, lookupControlCommand("starts", 6));
+}
+
+void test_backend_messages() {
+    ControlMessage_t msg;
+
+    TEST_ASSERT_TRUE(parse("{\"status\":\"registered\",\"type\":\"esp32\",\"message\":\"Waiting for test start command\"}", msg));
+    TEST_ASSERT_EQUAL(MSG_REGISTERED, msg.kind);
+
+    TEST_ASSERT_TRUE(parse("{\"pong\":true}", msg));
+    TEST_ASSERT_EQUAL(MSG_PONG, msg.kind);
+
+    TEST_ASSERT_TRUE(parse("{\"command\": \"start\"}", msg));
+    TEST_ASSERT_EQUAL(MSG_COMMAND, msg.kind);
+    TEST_ASSERT_EQUAL(CMD_START, msg.command);
+    TEST_ASSERT_FALSE(msg.hasValue);
+
+    TEST_ASSERT_TRUE(parse("{\"cmd\":\"stop\"}", msg));
+    TEST_ASSERT_EQUAL(CMD_STOP, msg.command);
+}
+
+// Messages apps send to the device's own server in direct-connect mode
+void test_direct_client_messages() {
+    ControlMessage_t msg;
+
+    TEST_ASSERT_TRUE(parse("{\"type\":\"flutter\"}", msg));
+    TEST_ASSERT_EQUAL(MSG_HELLO, msg.kind);
+    TEST_ASSERT_EQUAL(ROLE_APP, msg.role);
+
+    TEST_ASSERT_TRUE(parse("{\"type\": \"backend\"}", msg));
+    TEST_ASSERT_EQUAL(ROLE_ARCHIVE, msg.role);
+    TEST_ASSERT_EQUAL_STRING("backend", clientRoleName(msg.role));
+
+    TEST_ASSERT_TRUE(parse("{\"type\":\"toaster\"}", msg));
+    TEST_ASSERT_EQUAL(MSG_HELLO, msg.kind);
+    TEST_ASSERT_EQUAL(ROLE_UNKNOWN, msg.role);
+
+    TEST_ASSERT_TRUE(parse("{\"ping\":true}", msg));
+    TEST_ASSERT_EQUAL(MSG_PING, msg.kind);
+
+    // The backend's registration reply also carries "type"
+    TEST_ASSERT_TRUE(parse("{\"type\":\"esp32\",\"status\":\"registered\"}", msg));
+    TEST_ASSERT_EQUAL(MSG_REGISTERED, msg.kind);
+}
+
+void test_command_values() {
+    ControlMessage_t msg;
+
+    TEST_ASSERT_TRUE(parse("{\"command\":\"rate\",\"value\":500}", msg));
+    TEST_ASSERT_EQUAL(CMD_RATE, msg.command);
+    TEST_ASSERT_TRUE(msg.hasValue);
+    TEST_ASSERT_EQUAL(500, msg.value);
+
+    TEST_ASSERT_TRUE(parse("{ \"value\" : -12.75 , \"cmd\" : \"gain\" }", msg));
+    TEST_ASSERT_EQUAL(CMD_GAIN, msg.command);
+    TEST_ASSERT_EQUAL(-12, msg.value);
+
+    TEST_ASSERT_TRUE(parse("{\"cmd\":\"tare\",\"value\":\"soon\"}", msg));
+    TEST_ASSERT_EQUAL(CMD_TARE, msg.command);
+    TEST_ASSERT_FALSE(msg.hasValue);
+}
+
+void test_skips_nested_and_escaped_values() {
+    ControlMessage_t msg;
+
+    TEST_ASSERT_TRUE(parse("{\"meta\":{\"cmd\":\"stop\",\"list\":[1,{\"a\":\"}\"}]},"
+                           "\"note\":\"say \\\"stop\\\"\",\"cmd\":\"telemetry\"}", msg));
+    TEST_ASSERT_EQUAL(MSG_COMMAND, msg.kind);
+    TEST_ASSERT_EQUAL(CMD_TELEMETRY, msg.command);
+
+    TEST_ASSERT_TRUE(parse("{\"cmd\":\"reboot\"}", msg));
+    TEST_ASSERT_EQUAL(MSG_COMMAND, msg.kind);
+    TEST_ASSERT_EQUAL(CMD_NONE, msg.command);
+
+    TEST_ASSERT_TRUE(parse("{\"command_ack\":\"start\",\"success\":true}", msg));
+    TEST_ASSERT_EQUAL(MSG_UNKNOWN, msg.kind);
+}
+
+void test_rejects_malformed_input() {
+    ControlMessage_t msg;
+    const char* bad[] = {
+        "", "registered", "{", "{\"cmd\"", "{\"cmd\":\"start\"", "{\"cmd\":start}",
+        "{\"cmd\":\"start\",}", "[\"cmd\",\"start\"]", "{\"a\":{\"b\":1}",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        TEST_ASSERT_FALSE(parse(bad[i], msg));
+    }
+
+    // Payload is not NUL terminated: parser must respect the length
+    const char truncated[] = "{\"cmd\":\"start\"}garbage";
+    TEST_ASSERT_TRUE(parseControlMessage((const uint8_t*)truncated, 15, msg));
+    TEST_ASSERT_EQUAL(CMD_START, msg.command);
+    TEST_ASSERT_FALSE(parseControlMessage((const uint8_t*)truncated, 10, msg));
+}
+
+// Eight hours of control traffic at 10 messages/s, replayed without delays.
+// The parser must not allocate, and the heap free-block count must not grow.
+void test_eight_hour_soak_is_allocation_free() {
+    const char* traffic[] = {
+        "{\"pong\":true}",
+        "{\"status\":\"registered\",\"type\":\"esp32\",\"message\":\"Waiting for test start command\"}",
+        "{\"command\":\"start\"}",
+        "{\"command\":\"rate\",\"value\":1000}",
+        "{\"command\":\"gain\",\"value\":128}",
+        "{\"command\":\"tare\"}",
+        "{\"command\":\"telemetry\"}",
+        "{\"command\":\"stop\"}",
+        "{\"cmd\":\"unknown\",\"extra\":[1,2,3]}",
+        "{not json",
+    };
+    const size_t trafficCount = sizeof(traffic) / sizeof(traffic[0]);
+    size_t lengths[trafficCount];
+    for (size_t i = 0; i < trafficCount; ++i) {
+        lengths[i] = strlen(traffic[i]);
+    }
+
+    const uint32_t messages = 8UL * 3600UL * 10UL;
+    HeapTrend_t trend = {};
+    heapTrendUpdate(trend, readHeapStats());
+    size_t allocationsBefore = allocationCount;
+    uint32_t commands = 0;
+
+    for (uint32_t i = 0; i < messages; ++i) {
+        ControlMessage_t msg;
+        size_t k = i % trafficCount;
+        if (parseControlMessage((const uint8_t*)traffic[k], lengths[k], msg) && msg.kind == MSG_COMMAND) {
+            commands++;
+        }
+        if (i % 36000 == 0) {
+            heapTrendUpdate(trend, readHeapStats());
+        }
+    }
+    heapTrendUpdate(trend, readHeapStats());
+
+    TEST_ASSERT_EQUAL(0, allocationCount - allocationsBefore);
+    TEST_ASSERT_EQUAL(messages / trafficCount * 7, commands);
+    TEST_ASSERT_LESS_OR_EQUAL(trend.baseline.freeBlocks, trend.maxFreeBlocks);
+    TEST_ASSERT_EQUAL(trend.baseline.freeBytes, trend.latest.freeBytes);
+
+    char report[160];
+    snprintf(report, sizeof(report), "soak: %lu messages, %lu heap snapshots, free blocks %lu -> %lu",
+             (unsigned long)messages, (unsigned long)trend.snapshots,
+             (unsigned long)trend.baseline.freeBlocks, (unsigned long)trend.latest.freeBlocks);
+    TEST_MESSAGE(report);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_command_table);
+    RUN_TEST(test_backend_messages);
+    RUN_TEST(test_direct_client_messages);
+    RUN_TEST(test_command_values);
+    RUN_TEST(test_skips_nested_and_escaped_values);
+    RUN_TEST(test_rejects_malformed_input);
+    RUN_TEST(test_eight_hour_soak_is_allocation_free);
+    return UNITY_END();
+}
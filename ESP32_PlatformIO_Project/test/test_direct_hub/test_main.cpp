@@ -0,0 +1,356 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "direct_hub.h"
+#include "channel_ring.h"
+#include "sample_encoder.h"
+
+static uint64_t steadyUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ----------------------------------------------------------------------------
+// In-memory transport for the protocol tests
+// ----------------------------------------------------------------------------
+
+struct FakeTransport {
+    std::vector<std::string> sent[8];
+    bool failing[8] = {};
+    bool disconnected[8] = {};
+    uint64_t now = 0;
+    uint32_t sendCostUs[8] = {};
+
+    bool sendText(uint8_t client, const char* data, size_t length) {
+        now += sendCostUs[client];
+        if (failing[client]) {
+            return false;
+        }
+        sent[client].push_back(std::string(data, length));
+        return true;
+    }
+    void disconnect(uint8_t client) { disconnected[client] = true; }
+    uint64_t nowUs() { return now; }
+};
+
+static bool text(DirectHub<FakeTransport>& hub, uint8_t client, const char* message, ControlMessage_t& msg) {
+    return hub.onText(client, (const uint8_t*)message, strlen(message), msg);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_registration_ping_and_commands() {
+    FakeTransport transport;
+    DirectHub<FakeTransport> hub(transport);
+    ControlMessage_t msg;
+
+    TEST_ASSERT_TRUE(hub.onConnect(2));
+    TEST_ASSERT_FALSE(text(hub, 2, "{\"type\":\"flutter\"}", msg));
+    TEST_ASSERT_EQUAL_STRING("{\"status\":\"registered\",\"type\":\"flutter\"}", transport.sent[2].back().c_str());
+    TEST_ASSERT_EQUAL(1, hub.subscribers());
+
+    TEST_ASSERT_FALSE(text(hub, 2, "{\"ping\":true}", msg));
+    TEST_ASSERT_EQUAL_STRING("{\"pong\":true}", transport.sent[2].back().c_str());
+
+    TEST_ASSERT_TRUE(text(hub, 2, "{\"cmd\":\"rate\",\"value\":500}", msg));
+    TEST_ASSERT_EQUAL(CMD_RATE, msg.command);
+    TEST_ASSERT_EQUAL(500, msg.value);
+    TEST_ASSERT_EQUAL_STRING("{\"command_ack\":\"rate\",\"success\":true}", transport.sent[2].back().c_str());
+
+    // Unknown commands and malformed JSON are not executed
+    TEST_ASSERT_FALSE(text(hub, 2, "{\"cmd\":\"reboot\"}", msg));
+    TEST_ASSERT_FALSE(text(hub, 2, "{\"cmd\":", msg));
+    // Messages from a connection the hub does not know are ignored
+    TEST_ASSERT_FALSE(text(hub, 3, "{\"cmd\":\"start\"}", msg));
+}
+
+void test_frames_go_to_registered_clients_only() {
+    FakeTransport transport;
+    DirectHub<FakeTransport> hub(transport);
+    ControlMessage_t msg;
+
+    hub.onConnect(0);
+    hub.onConnect(1);
+    hub.onConnect(2);
+    text(hub, 0, "{\"type\":\"flutter\"}", msg);
+    text(hub, 2, "{\"type\":\"backend\"}", msg);
+
+    TEST_ASSERT_EQUAL(2, hub.broadcast("{\"samples\":[]}", 14));
+    TEST_ASSERT_EQUAL_STRING("{\"samples\":[]}", transport.sent[0].back().c_str());
+    TEST_ASSERT_EQUAL(0, transport.sent[1].size());
+    TEST_ASSERT_EQUAL(2, transport.sent[2].size());
+
+    hub.onDisconnect(0);
+    TEST_ASSERT_EQUAL(1, hub.subscribers());
+}
+
+void test_full_hub_rejects_connections() {
+    FakeTransport transport;
+    DirectHub<FakeTransport, 2> hub(transport);
+    TEST_ASSERT_TRUE(hub.onConnect(0));
+    TEST_ASSERT_TRUE(hub.onConnect(1));
+    TEST_ASSERT_FALSE(hub.onConnect(2));
+    TEST_ASSERT_EQUAL(1, hub.stats().rejected);
+    hub.onDisconnect(1);
+    TEST_ASSERT_TRUE(hub.onConnect(2));
+}
+
+void test_failing_and_stalling_clients_are_dropped() {
+    FakeTransport transport;
+    DirectHub<FakeTransport> hub(transport, 1000);
+    ControlMessage_t msg;
+    for (uint8_t c = 0; c < 3; ++c) {
+        hub.onConnect(c);
+        text(hub, c, "{\"type\":\"flutter\"}", msg);
+    }
+    transport.failing[1] = true;
+    transport.sendCostUs[2] = 5000;
+
+    for (int frame = 0; frame < DIRECT_MAX_STRIKES; ++frame) {
+        hub.broadcast("x", 1);
+    }
+    TEST_ASSERT_TRUE(transport.disconnected[1]);
+    TEST_ASSERT_TRUE(transport.disconnected[2]);
+    TEST_ASSERT_FALSE(transport.disconnected[0]);
+    TEST_ASSERT_EQUAL(2, hub.stats().evictions);
+    TEST_ASSERT_EQUAL(1, hub.subscribers());
+
+    // A single slow send is forgiven once sends are fast again
+    hub.onConnect(2);
+    text(hub, 2, "{\"type\":\"flutter\"}", msg);
+    hub.broadcast("x", 1);
+    transport.sendCostUs[2] = 0;
+    for (int frame = 0; frame < 10; ++frame) {
+        hub.broadcast("x", 1);
+    }
+    TEST_ASSERT_EQUAL(2, hub.subscribers());
+}
+
+// ----------------------------------------------------------------------------
+// TCP loopback: the hub fans real sample frames out to socket clients while a
+// sampler thread keeps filling the queue
+// ----------------------------------------------------------------------------
+
+#define LOOPBACK_CLIENTS     3
+#define LOOPBACK_FRAMES      400
+#define LOOPBACK_SEND_TIMEOUT_MS 5
+
+// Length-prefixed messages over TCP with a send timeout, which is how the
+// ESP32's WiFiClient behaves towards a peer that stops reading
+struct TcpTransport {
+    int fds[LOOPBACK_CLIENTS];
+
+    bool sendText(uint8_t client, const char* data, size_t length) {
+        uint32_t prefix = (uint32_t)length;
+        if (!sendAll(fds[client], (const char*)&prefix, sizeof(prefix))) {
+            return false;
+        }
+        return sendAll(fds[client], data, length);
+    }
+
+    void disconnect(uint8_t client) {
+        shutdown(fds[client], SHUT_RDWR);
+    }
+
+    uint64_t nowUs() { return steadyUs(); }
+
+    static bool sendAll(int fd, const char* data, size_t length) {
+        while (length) {
+            ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            length -= (size_t)n;
+        }
+        return true;
+    }
+};
+
+static bool recvAll(int fd, char* data, size_t length) {
+    while (length) {
+        ssize_t n = recv(fd, data, length, 0);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+// Connected loopback TCP pair: device side in fds[0], app side in fds[1]
+static void tcpPair(int listener, uint16_t port, int fds[2]) {
+    fds[1] = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL(0, connect(fds[1], (sockaddr*)&address, sizeof(address)));
+    fds[0] = accept(listener, nullptr, nullptr);
+    TEST_ASSERT_TRUE(fds[0] >= 0);
+
+    int small = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+    timeval timeout = { 0, LOOPBACK_SEND_TIMEOUT_MS * 1000 };
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+void test_loopback_fanout_survives_a_stalled_client() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL(0, bind(listener, (sockaddr*)&address, sizeof(address)));
+    socklen_t addressLength = sizeof(address);
+    getsockname(listener, (sockaddr*)&address, &addressLength);
+    listen(listener, LOOPBACK_CLIENTS);
+
+    TcpTransport transport;
+    int appFds[LOOPBACK_CLIENTS];
+    for (int c = 0; c < LOOPBACK_CLIENTS; ++c) {
+        int fds[2];
+        tcpPair(listener, ntohs(address.sin_port), fds);
+        transport.fds[c] = fds[0];
+        appFds[c] = fds[1];
+    }
+
+    DirectHub<TcpTransport> hub(transport, 2 * LOOPBACK_SEND_TIMEOUT_MS * 1000);
+    const char* hello = "{\"type\":\"flutter\"}";
+    ControlMessage_t msg;
+    for (uint8_t c = 0; c < LOOPBACK_CLIENTS; ++c) {
+        hub.onConnect(c);
+        hub.onText(c, (const uint8_t*)hello, strlen(hello), msg);
+    }
+
+    // Apps 0 and 1 read everything; app 2 reads its registration reply and
+    // then stops reading
+    std::atomic<uint32_t> framesRead[LOOPBACK_CLIENTS];
+    std::atomic<uint32_t> samplesRead[LOOPBACK_CLIENTS];
+    std::vector<std::thread> readers;
+    for (int c = 0; c < LOOPBACK_CLIENTS; ++c) {
+        framesRead[c] = 0;
+        samplesRead[c] = 0;
+        readers.emplace_back([&, c]() {
+            std::vector<char> buffer(1 << 16);
+            for (;;) {
+                uint32_t length;
+                if (!recvAll(appFds[c], (char*)&length, sizeof(length)) || length > buffer.size() ||
+                    !recvAll(appFds[c], buffer.data(), length)) {
+                    return;
+                }
+                if (c == 2 && framesRead[c] > 0) {
+                    return;     // Leave the socket open but unread
+                }
+                framesRead[c]++;
+                std::string frame(buffer.data(), length);
+                size_t at = 0;
+                while ((at = frame.find("\"dt\":", at)) != std::string::npos) {
+                    samplesRead[c]++;
+                    at++;
+                }
+            }
+        });
+    }
+
+    // Sampler: pushes one sample every 250 us and records its slowest push
+    const uint32_t capacity = 8192;
+    std::vector<uint64_t> storage(ChannelRing<2>::storageBytes(2, capacity) / 8 + 1);
+    ChannelRing<2> ring;
+    ring.attach(storage.data(), 2, capacity);
+    std::atomic<bool> sampling(true);
+    std::atomic<uint32_t> overflows(0), produced(0);
+    uint64_t maxPushUs = 0;
+    std::thread sampler([&]() {
+        Sample_t sample = {};
+        while (sampling) {
+            sample.timestampUs = steadyUs();
+            sample.values[0] = (float)produced;
+            sample.values[1] = -(float)produced;
+            uint64_t started = steadyUs();
+            if (!ring.push(sample)) {
+                overflows++;
+            }
+            uint64_t pushUs = steadyUs() - started;
+            if (pushUs > maxPushUs) {
+                maxPushUs = pushUs;
+            }
+            produced++;
+            std::this_thread::sleep_for(std::chrono::microseconds(250));
+        }
+    });
+
+    // Sender: encode each batch once and fan it out
+    static char json[20 * SAMPLE_JSON_MAX_BYTES(2) + SAMPLE_FRAME_OVERHEAD];
+    uint32_t framesSent = 0, samplesSent = 0;
+    while (framesSent < LOOPBACK_FRAMES) {
+        if (ring.available() < 20) {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            continue;
+        }
+        SampleSpan_t span;
+        ring.peek(span, 20);
+        size_t encoded = 0;
+        size_t length = encodeSampleBatch(span, json, sizeof(json), encoded);
+        hub.broadcast(json, length);
+        ring.consume(encoded);
+        framesSent++;
+        samplesSent += (uint32_t)encoded;
+    }
+    sampling = false;
+    sampler.join();
+
+    for (int c = 0; c < LOOPBACK_CLIENTS; ++c) {
+        shutdown(transport.fds[c], SHUT_RDWR);
+    }
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    for (int c = 0; c < LOOPBACK_CLIENTS; ++c) {
+        close(transport.fds[c]);
+        close(appFds[c]);
+    }
+    close(listener);
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "%lu frames (%lu samples): fast apps got %lu/%lu frames, stalled app evicted %lu, "
+             "slow sends %lu, max fan-out %lu us, max sampler push %llu us, overflows %lu",
+             (unsigned long)framesSent, (unsigned long)samplesSent,
+             (unsigned long)framesRead[0].load(), (unsigned long)framesRead[1].load(),
+             (unsigned long)hub.stats().evictions, (unsigned long)hub.stats().slowSends,
+             (unsigned long)hub.stats().maxFanoutUs, (unsigned long long)maxPushUs,
+             (unsigned long)overflows.load());
+    TEST_MESSAGE(line);
+
+    // The registration reply is the first message each app reads
+    TEST_ASSERT_EQUAL(LOOPBACK_FRAMES + 1, framesRead[0].load());
+    TEST_ASSERT_EQUAL(LOOPBACK_FRAMES + 1, framesRead[1].load());
+    TEST_ASSERT_EQUAL(samplesSent, samplesRead[0].load());
+    TEST_ASSERT_EQUAL(samplesSent, samplesRead[1].load());
+    TEST_ASSERT_EQUAL(1, hub.stats().evictions);
+    TEST_ASSERT_EQUAL(2, hub.subscribers());
+    TEST_ASSERT_EQUAL(0, overflows.load());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_registration_ping_and_commands);
+    RUN_TEST(test_frames_go_to_registered_clients_only);
+    RUN_TEST(test_full_hub_rejects_connections);
+    RUN_TEST(test_failing_and_stalling_clients_are_dropped);
+    RUN_TEST(test_loopback_fanout_survives_a_stalled_client);
+    return UNITY_END();
+}
@@ -0,0 +1,436 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "frame_sender.h"
+
+static uint64_t steadyUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Split a byte stream of masked client text frames into their payloads
+static std::vector<std::string> parseFrames(const std::string& stream) {
+    std::vector<std::string> frames;
+    size_t p = 0;
+    while (p + 2 <= stream.size()) {
+        const uint8_t* b = (const uint8_t*)stream.data() + p;
+        TEST_ASSERT_EQUAL_UINT8(0x81, b[0]);
+        TEST_ASSERT_TRUE(b[1] & 0x80);
+        uint64_t length = b[1] & 0x7F;
+        size_t header = 2;
+        if (length == 126) {
+            length = ((uint64_t)b[2] << 8) | b[3];
+            header = 4;
+        } else if (length == 127) {
+            length = 0;
+            for (int i = 0; i < 8; ++i) {
+                length = (length << 8) | b[2 + i];
+            }
+            header = 10;
+        }
+        const uint8_t* key = b + header;
+        header += 4;
+        TEST_ASSERT_TRUE(p + header + length <= stream.size());
+        std::string payload(length, '\0');
+        for (uint64_t i = 0; i < length; ++i) {
+            payload[i] = (char)(b[header + i] ^ key[i & 3]);
+        }
+        frames.push_back(payload);
+        p += header + length;
+    }
+    TEST_ASSERT_EQUAL(stream.size(), p);
+    return frames;
+}
+
+static std::string makePayload(size_t length, uint32_t seed) {
+    std::string payload(length, '\0');
+    for (size_t i = 0; i < length; ++i) {
+        payload[i] = (char)('a' + (seed + i * 7) % 26);
+    }
+    return payload;
+}
+
+// ----------------------------------------------------------------------------
+// In-memory transport: takes up to `room` bytes, then reports a full buffer
+// ----------------------------------------------------------------------------
+
+struct FakeTransport {
+    std::string wire;
+    size_t room = SIZE_MAX;
+    bool closed = false;
+    uint64_t now = 0;
+    uint32_t key = 0x9A3C5E71;
+
+    int write(const uint8_t* data, size_t length) {
+        if (closed) {
+            return -1;
+        }
+        size_t taken = length < room ? length : room;
+        if (taken > 65536) {
+            taken = 65536;  // Like a socket, never all of a large frame at once
+        }
+        wire.append((const char*)data, taken);
+        room -= room == SIZE_MAX ? 0 : taken;
+        return (int)taken;
+    }
+    uint64_t nowUs() { return now; }
+    uint32_t maskKey() { return key++; }
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_queue_is_fifo_and_reports_full() {
+    FrameQueue<3, 64> queue;
+    for (int i = 0; i < 3; ++i) {
+        char* payload = queue.acquire();
+        TEST_ASSERT_NOT_NULL(payload);
+        int length = snprintf(payload, 64, "frame %d", i);
+        queue.publish((size_t)length, i == 1 ? FRAME_TO_DIRECT : FRAME_TO_BACKEND);
+    }
+    TEST_ASSERT_NULL(queue.acquire());
+    TEST_ASSERT_EQUAL(1, queue.fullCount());
+    TEST_ASSERT_EQUAL(3, queue.depth());
+    TEST_ASSERT_EQUAL(3, queue.maxDepth());
+
+    for (int i = 0; i < 3; ++i) {
+        uint8_t* payload = nullptr;
+        size_t length = 0;
+        uint8_t destinations = 0;
+        TEST_ASSERT_TRUE(queue.front(payload, length, destinations));
+        char expected[16];
+        snprintf(expected, sizeof(expected), "frame %d", i);
+        TEST_ASSERT_EQUAL(strlen(expected), length);
+        TEST_ASSERT_EQUAL_MEMORY(expected, payload, length);
+        TEST_ASSERT_EQUAL(i == 1 ? FRAME_TO_DIRECT : FRAME_TO_BACKEND, destinations);
+        queue.pop();
+    }
+    uint8_t* payload = nullptr;
+    size_t length = 0;
+    uint8_t destinations = 0;
+    TEST_ASSERT_FALSE(queue.front(payload, length, destinations));
+    TEST_ASSERT_NOT_NULL(queue.acquire());
+}
+
+// 7-bit, 16-bit and 64-bit length forms, each side of the boundaries
+void test_frames_are_masked_text_frames() {
+    const size_t lengths[] = { 0, 5, 125, 126, 65535, 65536, 70001 };
+    FakeTransport transport;
+    FrameWriter<FakeTransport> writer(transport);
+    std::vector<uint8_t> slot(FRAME_HEADER_BYTES + 70001);
+    std::vector<std::string> sent;
+
+    for (size_t length : lengths) {
+        std::string payload = makePayload(length, (uint32_t)length);
+        memcpy(slot.data() + FRAME_HEADER_BYTES, payload.data(), length);
+        writer.start(slot.data() + FRAME_HEADER_BYTES, length);
+        TEST_ASSERT_EQUAL(FrameWrite_Done, writer.service());
+        TEST_ASSERT_FALSE(writer.busy());
+        sent.push_back(payload);
+    }
+    std::vector<std::string> frames = parseFrames(transport.wire);
+    TEST_ASSERT_EQUAL(sent.size(), frames.size());
+    for (size_t i = 0; i < sent.size(); ++i) {
+        TEST_ASSERT_TRUE(frames[i] == sent[i]);
+    }
+    TEST_ASSERT_EQUAL(sent.size(), writer.stats().frames);
+    TEST_ASSERT_EQUAL(0, writer.stats().stalls);
+}
+
+// A full send buffer returns at once; the frame resumes where it stopped
+void test_partial_write_resumes_and_counts_the_stall() {
+    FakeTransport transport;
+    FrameWriter<FakeTransport> writer(transport);
+    std::vector<uint8_t> slot(FRAME_HEADER_BYTES + 5000);
+    std::string payload = makePayload(5000, 3);
+    memcpy(slot.data() + FRAME_HEADER_BYTES, payload.data(), payload.size());
+
+    transport.room = 1000;
+    writer.start(slot.data() + FRAME_HEADER_BYTES, payload.size());
+    TEST_ASSERT_EQUAL(FrameWrite_Pending, writer.service());
+    TEST_ASSERT_TRUE(writer.busy());
+    for (int pass = 0; pass < 3; ++pass) {
+        transport.now += 4000;
+        TEST_ASSERT_EQUAL(FrameWrite_Pending, writer.service());
+    }
+    for (int pass = 0; writer.busy(); ++pass) {
+        transport.now += 1000;
+        transport.room = 1500;
+        writer.service();
+        TEST_ASSERT_TRUE(pass < 10);
+    }
+    std::vector<std::string> frames = parseFrames(transport.wire);
+    TEST_ASSERT_EQUAL(1, frames.size());
+    TEST_ASSERT_TRUE(frames[0] == payload);
+
+    const FrameWriterStats_t& stats = writer.stats();
+    TEST_ASSERT_EQUAL(1, stats.frames);
+    TEST_ASSERT_EQUAL(1, stats.stalls);
+    TEST_ASSERT_EQUAL(transport.now, stats.stallUs);
+    TEST_ASSERT_EQUAL(transport.now, stats.maxStallUs);
+    TEST_ASSERT_TRUE(stats.bytes == 5000 + 8);
+}
+
+void test_stuck_frame_stalls_out_and_closed_socket_fails() {
+    FakeTransport transport;
+    FrameWriter<FakeTransport> writer(transport, 100000);
+    uint8_t slot[FRAME_HEADER_BYTES + 300];
+    memset(slot, 'x', sizeof(slot));
+
+    transport.room = 10;
+    writer.start(slot + FRAME_HEADER_BYTES, 300);
+    TEST_ASSERT_EQUAL(FrameWrite_Pending, writer.service());
+    transport.now = 100000;
+    TEST_ASSERT_EQUAL(FrameWrite_Pending, writer.service());
+    transport.now = 100001;
+    TEST_ASSERT_EQUAL(FrameWrite_StalledOut, writer.service());
+    TEST_ASSERT_FALSE(writer.busy());
+    TEST_ASSERT_EQUAL(1, writer.stats().failures);
+
+    transport.room = SIZE_MAX;
+    transport.closed = true;
+    writer.start(slot + FRAME_HEADER_BYTES, 300);
+    TEST_ASSERT_EQUAL(FrameWrite_Failed, writer.service());
+    TEST_ASSERT_EQUAL(2, writer.stats().failures);
+
+    // Disconnect in the middle of a frame
+    transport.closed = false;
+    transport.room = 10;
+    writer.start(slot + FRAME_HEADER_BYTES, 300);
+    writer.service();
+    writer.abort();
+    TEST_ASSERT_FALSE(writer.busy());
+    TEST_ASSERT_EQUAL(3, writer.stats().failures);
+}
+
+// Producer and consumer on their own threads
+void test_concurrent_queue_keeps_frames_intact() {
+    static FrameQueue<4, 256> queue;
+    const uint32_t total = 200000;
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < total;) {
+            char* payload = queue.acquire();
+            if (!payload) {
+                std::this_thread::yield();
+                continue;
+            }
+            int length = snprintf(payload, 256, "%u:%s", (unsigned)i, makePayload(i % 200, i).c_str());
+            queue.publish((size_t)length, FRAME_TO_BACKEND);
+            i++;
+        }
+    });
+
+    for (uint32_t i = 0; i < total;) {
+        uint8_t* payload = nullptr;
+        size_t length = 0;
+        uint8_t destinations = 0;
+        if (!queue.front(payload, length, destinations)) {
+            std::this_thread::yield();
+            continue;
+        }
+        char expected[256];
+        int expectedLength = snprintf(expected, sizeof(expected), "%u:%s", (unsigned)i,
+                                      makePayload(i % 200, i).c_str());
+        TEST_ASSERT_EQUAL((size_t)expectedLength, length);
+        TEST_ASSERT_EQUAL_MEMORY(expected, payload, length);
+        queue.pop();
+        i++;
+    }
+    producer.join();
+    TEST_ASSERT_EQUAL(4, queue.maxDepth());
+}
+
+// ----------------------------------------------------------------------------
+// Loopback TCP: a receiver that stops reading for a while, as a backend
+// behind a stalled WiFi link does. Blocking sends freeze the calling task
+// for the whole stall; the frame writer never waits in a call and the stall
+// shows up as queue depth and stall time instead.
+// ----------------------------------------------------------------------------
+
+#define LOOPBACK_FRAMES       120
+#define LOOPBACK_FRAME_BYTES  13500     // DefaultPipeline JSON frame
+#define LOOPBACK_PAUSE_MS     300
+#define LOOPBACK_SOCKET_BUF   16384     // Roughly an ESP32 lwIP send window
+
+struct SocketTransport {
+    int fd;
+    int write(const uint8_t* data, size_t length) {
+        ssize_t sent = send(fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        return (int)sent;
+    }
+    uint64_t nowUs() { return steadyUs(); }
+    uint32_t maskKey() { return 0x5A5AA5A5; }
+};
+
+static void connectedPair(int& client, int& server) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL(0, bind(listener, (sockaddr*)&addr, sizeof(addr)));
+    socklen_t len = sizeof(addr);
+    getsockname(listener, (sockaddr*)&addr, &len);
+    listen(listener, 1);
+    client = socket(AF_INET, SOCK_STREAM, 0);
+    int buffer = LOOPBACK_SOCKET_BUF;
+    setsockopt(client, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL(0, connect(client, (sockaddr*)&addr, sizeof(addr)));
+    server = accept(listener, nullptr, nullptr);
+    close(listener);
+}
+
+// Reads everything after an initial pause
+static std::thread slowReader(int fd, std::string& received) {
+    return std::thread([fd, &received]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(LOOPBACK_PAUSE_MS));
+        char buffer[65536];
+        for (;;) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                break;
+            }
+            received.append(buffer, (size_t)n);
+        }
+    });
+}
+
+void test_stalled_receiver_blocking_vs_queued_writes() {
+    static FrameQueue<4, LOOPBACK_FRAME_BYTES> queue;
+    std::vector<std::string> payloads;
+    for (uint32_t i = 0; i < LOOPBACK_FRAMES; ++i) {
+        payloads.push_back(makePayload(LOOPBACK_FRAME_BYTES - (i % 50), i));
+    }
+
+    // Blocking: the sender writes each frame itself
+    int client, server;
+    connectedPair(client, server);
+    std::string received;
+    std::thread reader = slowReader(server, received);
+    std::vector<uint8_t> slot(FRAME_HEADER_BYTES + LOOPBACK_FRAME_BYTES);
+    uint64_t longestBlockingUs = 0;
+    {
+        SocketTransport transport = { client };
+        FrameWriter<SocketTransport> writer(transport);
+        for (const std::string& payload : payloads) {
+            memcpy(slot.data() + FRAME_HEADER_BYTES, payload.data(), payload.size());
+            writer.start(slot.data() + FRAME_HEADER_BYTES, payload.size());
+            uint64_t started = steadyUs();
+            while (writer.service() == FrameWrite_Pending) {
+                // What a blocking send does inside the call
+            }
+            uint64_t elapsed = steadyUs() - started;
+            if (elapsed > longestBlockingUs) {
+                longestBlockingUs = elapsed;
+            }
+        }
+    }
+    shutdown(client, SHUT_WR);
+    reader.join();
+    close(client);
+    close(server);
+    TEST_ASSERT_EQUAL(LOOPBACK_FRAMES, parseFrames(received).size());
+
+    // Queued: the sender only enqueues, the network task writes
+    connectedPair(client, server);
+    received.clear();
+    reader = slowReader(server, received);
+    SocketTransport transport = { client };
+    FrameWriter<SocketTransport> writer(transport);
+    uint64_t longestEnqueueUs = 0;
+    uint64_t longestServiceUs = 0;
+    uint32_t enqueued = 0;
+    uint32_t passes = 0;
+    bool inFlight = false;
+    uint64_t started = steadyUs();
+    while (enqueued < LOOPBACK_FRAMES || queue.depth() > 0) {
+        // Sender task
+        if (enqueued < LOOPBACK_FRAMES) {
+            uint64_t enqueueStarted = steadyUs();
+            char* payload = queue.acquire();
+            if (payload) {
+                memcpy(payload, payloads[enqueued].data(), payloads[enqueued].size());
+                queue.publish(payloads[enqueued].size(), FRAME_TO_BACKEND);
+                enqueued++;
+            }
+            uint64_t elapsed = steadyUs() - enqueueStarted;
+            if (elapsed > longestEnqueueUs) {
+                longestEnqueueUs = elapsed;
+            }
+        }
+        // Network task pass
+        uint64_t serviceStarted = steadyUs();
+        for (;;) {
+            uint8_t* payload = nullptr;
+            size_t length = 0;
+            uint8_t destinations = 0;
+            if (!inFlight) {
+                if (!queue.front(payload, length, destinations)) {
+                    break;
+                }
+                writer.start(payload, length);
+                inFlight = true;
+            }
+            FrameWriteState state = writer.service();
+            if (state == FrameWrite_Pending) {
+                break;
+            }
+            TEST_ASSERT_EQUAL(FrameWrite_Done, state);
+            queue.pop();
+            inFlight = false;
+        }
+        uint64_t elapsed = steadyUs() - serviceStarted;
+        if (elapsed > longestServiceUs) {
+            longestServiceUs = elapsed;
+        }
+        passes++;
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    uint64_t totalUs = steadyUs() - started;
+    shutdown(client, SHUT_WR);
+    reader.join();
+    close(client);
+    close(server);
+
+    std::vector<std::string> frames = parseFrames(received);
+    TEST_ASSERT_EQUAL(LOOPBACK_FRAMES, frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        TEST_ASSERT_TRUE(frames[i] == payloads[i]);
+    }
+    TEST_ASSERT_EQUAL(4, queue.maxDepth());
+    TEST_ASSERT_TRUE(writer.stats().stalls > 0);
+    TEST_ASSERT_TRUE(longestServiceUs < LOOPBACK_PAUSE_MS * 1000 / 4);
+
+    char line[240];
+    snprintf(line, sizeof(line),
+             "receiver paused %d ms: blocking send held the sender up to %.1f ms; queued: enqueue max %.0f us, "
+             "network pass max %.2f ms, queue depth max %u, %u stalls (%.0f ms, max %.1f ms), %u passes in %.0f ms",
+             LOOPBACK_PAUSE_MS, longestBlockingUs / 1e3, (double)longestEnqueueUs, longestServiceUs / 1e3,
+             (unsigned)queue.maxDepth(), (unsigned)writer.stats().stalls, writer.stats().stallUs / 1e3,
+             writer.stats().maxStallUs / 1e3, (unsigned)passes, totalUs / 1e3);
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_queue_is_fifo_and_reports_full);
+    RUN_TEST(test_frames_are_masked_text_frames);
+    RUN_TEST(test_partial_write_resumes_and_counts_the_stall);
+    RUN_TEST(test_stuck_frame_stalls_out_and_closed_socket_fails);
+    RUN_TEST(test_concurrent_queue_keeps_frames_intact);
+    RUN_TEST(test_stalled_receiver_blocking_vs_queued_writes);
+    return UNITY_END();
+}
@@ -0,0 +1,366 @@
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "channel_ring.h"
+#include "packed_ring.h"
+#include "staged_ring.h"
+
+#define BLOCK           32
+#define MAX_SPAN        250             // DefaultPipeline::maxBatch
+#define BENCH_BYTES     (1920000)       // PSRAM of the 120000-sample float queue
+#define BENCH_RUNS      3               // Best of, to keep scheduler noise out
+
+typedef PackedRing<2, BLOCK, MAX_SPAN> Packed2;
+
+// 1 kHz, whole-count values that use all 24 bits
+static Sample_t makeSample(uint32_t i) {
+    Sample_t sample = {};
+    sample.timestampUs = 1000000ULL + 1000ULL * i;
+    sample.values[0] = (float)(int32_t)((i * 2654435761u) >> 8) - 8388608.0f;
+    sample.values[1] = -(float)(i % 100000);
+    return sample;
+}
+
+// Every sample of the span is the next one in sequence
+static void checkSpan(const SampleSpan_t& span, uint32_t& expected) {
+    for (size_t k = 0; k < span.count; ++k, ++expected) {
+        Sample_t sample = makeSample(expected);
+        TEST_ASSERT_TRUE(span.timestampUs[k] == sample.timestampUs);
+        TEST_ASSERT_EQUAL_FLOAT(sample.values[0], span.values[0][k]);
+        TEST_ASSERT_EQUAL_FLOAT(sample.values[1], span.values[1][k]);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_storage_is_under_half_the_float_queue() {
+    // 2 channels: 16-byte header + 192 bytes per 32 samples
+    TEST_ASSERT_EQUAL(208, Packed2::slotBytes(2));
+    size_t packed = Packed2::storageBytes(2, 240000);
+    size_t columns = ChannelRing<2>::storageBytes(2, 120000);
+    TEST_ASSERT_LESS_THAN(columns, packed);
+    TEST_ASSERT_TRUE(2 * Packed2::slotBytes(2) < BLOCK * (sizeof(uint64_t) + 2 * sizeof(float)));
+}
+
+void test_backlog_is_unpacked_then_staging_read() {
+    std::vector<uint64_t> storage(Packed2::storageBytes(2, 256) / 8);
+    static Packed2 ring;
+    ring.attach(storage.data(), 2, 256);
+
+    // 5 packed blocks, 10 samples staged
+    for (uint32_t i = 0; i < 5 * BLOCK + 10; ++i) {
+        TEST_ASSERT_TRUE(ring.push(makeSample(i)));
+    }
+    TEST_ASSERT_EQUAL(5 * BLOCK + 10, ring.available());
+
+    // Backlog spans stop at block ends
+    SampleSpan_t span;
+    uint32_t expected = 0;
+    TEST_ASSERT_EQUAL(20, ring.peek(span, 20));
+    checkSpan(span, expected);
+    ring.consume(span.count);
+    TEST_ASSERT_EQUAL(BLOCK - 20, ring.peek(span, 250));
+    checkSpan(span, expected);
+    ring.consume(span.count);
+    while (expected < 5 * BLOCK) {
+        TEST_ASSERT_EQUAL(BLOCK, ring.peek(span, 250));
+        checkSpan(span, expected);
+        ring.consume(span.count);
+    }
+    // The last packed block is still in its staging slot
+    TEST_ASSERT_EQUAL(BLOCK, ring.stagedReads());
+
+    TEST_ASSERT_EQUAL(10, ring.peek(span, 250));
+    checkSpan(span, expected);
+    ring.consume(span.count);
+    TEST_ASSERT_EQUAL(BLOCK + 10, ring.stagedReads());
+    TEST_ASSERT_EQUAL(0, ring.peek(span, 250));
+    TEST_ASSERT_EQUAL(0, ring.available());
+}
+
+void test_reader_that_keeps_up_reads_only_staging() {
+    std::vector<uint64_t> storage(Packed2::storageBytes(2, 256) / 8);
+    static Packed2 ring;
+    ring.attach(storage.data(), 2, 256);
+
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        TEST_ASSERT_TRUE(ring.push(makeSample(i)));
+        if (i % 8 == 7) {
+            SampleSpan_t span;
+            while (ring.peek(span, 20) > 0) {
+                checkSpan(span, expected);
+                ring.consume(span.count);
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(1000, expected);
+    TEST_ASSERT_EQUAL(1000, ring.stagedReads());
+}
+
+// Staged samples are rounded to whole counts, like the backlog
+void test_staged_and_packed_values_agree() {
+    std::vector<uint64_t> storage(Packed2::storageBytes(2, 256) / 8);
+    static Packed2 ring;
+    ring.attach(storage.data(), 2, 256);
+    for (uint32_t i = 0; i < BLOCK + 1; ++i) {
+        Sample_t sample = makeSample(i);
+        sample.values[0] = 100.4f + i;
+        sample.values[1] = 9e6f;
+        ring.push(sample);
+    }
+    SampleSpan_t span;
+    TEST_ASSERT_EQUAL(BLOCK, ring.peek(span, 250));
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, span.values[0][0]);
+    TEST_ASSERT_EQUAL_FLOAT((float)PACKED_VALUE_MAX, span.values[1][0]);
+    ring.consume(BLOCK);
+    TEST_ASSERT_EQUAL(1, ring.peek(span, 250));
+    TEST_ASSERT_EQUAL_FLOAT(100.0f + BLOCK, span.values[0][0]);
+    TEST_ASSERT_EQUAL_FLOAT((float)PACKED_VALUE_MAX, span.values[1][0]);
+}
+
+// A gap or a rate change closes the block, so every timestamp comes back
+void test_irregular_timestamps_close_blocks_early() {
+    std::vector<uint64_t> storage(Packed2::storageBytes(2, 256) / 8);
+    static Packed2 ring;
+    ring.attach(storage.data(), 2, 256);
+
+    std::vector<uint64_t> times;
+    uint64_t t = 1000000;
+    for (uint32_t i = 0; i < 100; ++i) {
+        times.push_back(t);
+        // 1 kHz, a 2 s gap at 10, 500 Hz from 50, a capture restart at 70
+        t += i == 10 ? 2000000 : (i >= 50 ? 2000 : 1000);
+        if (i == 70) {
+            t = 500000;
+        }
+    }
+    for (uint32_t i = 0; i < times.size(); ++i) {
+        Sample_t sample = {};
+        sample.timestampUs = times[i];
+        sample.values[0] = (float)i;
+        TEST_ASSERT_TRUE(ring.push(sample));
+    }
+    // Push one more block so everything above is packed
+    for (uint32_t i = 0; i < BLOCK + 1; ++i) {
+        Sample_t sample = {};
+        sample.timestampUs = 9000000 + 100000ULL * i;
+        ring.push(sample);
+    }
+
+    SampleSpan_t span;
+    uint32_t read = 0;
+    std::vector<size_t> spans;
+    while (read < times.size()) {
+        size_t count = ring.peek(span, std::min<size_t>(250, times.size() - read));
+        TEST_ASSERT_TRUE(count > 0);
+        for (size_t k = 0; k < count; ++k, ++read) {
+            TEST_ASSERT_TRUE(span.timestampUs[k] == times[read]);
+            TEST_ASSERT_EQUAL_FLOAT((float)read, span.values[0][k]);
+        }
+        spans.push_back(count);
+        ring.consume(count);
+    }
+    // 0-10 | 11-42 | 43-50 (step change) | 51-70 | 71-99
+    TEST_ASSERT_EQUAL(5, spans.size());
+    TEST_ASSERT_EQUAL(11, spans[0]);
+    TEST_ASSERT_EQUAL(0, ring.stagedReads());
+}
+
+void test_full_ring_drops_and_wraps() {
+    const uint32_t capacity = 4 * BLOCK;
+    std::vector<uint64_t> storage(Packed2::storageBytes(2, capacity) / 8);
+    static Packed2 ring;
+    ring.attach(storage.data(), 2, capacity);
+
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    for (int lap = 0; lap < 10; ++lap) {
+        while (ring.push(makeSample(next))) {
+            next++;
+        }
+        // Every slot packed (less what was read of the oldest), plus a full
+        // staging block
+        TEST_ASSERT_TRUE(ring.available() >= capacity && ring.available() <= capacity + BLOCK);
+        uint32_t drain = 3 * BLOCK - 7 + lap;
+        while (drain > 0) {
+            SampleSpan_t span;
+            size_t count = ring.peek(span, std::min<uint32_t>(drain, 45));
+            TEST_ASSERT_TRUE(count > 0);
+            checkSpan(span, expected);
+            ring.consume(count);
+            drain -= (uint32_t)count;
+        }
+    }
+}
+
+void test_skip_to_drops_earlier_samples() {
+    std::vector<uint64_t> storage(Packed2::storageBytes(2, 256) / 8);
+    static Packed2 ring;
+    ring.attach(storage.data(), 2, 256);
+    for (uint32_t i = 0; i < 70; ++i) {
+        ring.push(makeSample(i));
+    }
+    uint32_t start = ring.written();
+    for (uint32_t i = 70; i < 80; ++i) {
+        ring.push(makeSample(i));
+    }
+    ring.skipTo(start);
+    SampleSpan_t span;
+    uint32_t expected = 70;
+    TEST_ASSERT_EQUAL(10, ring.peek(span, 250));
+    checkSpan(span, expected);
+    ring.consume(span.count);
+
+    // Into the block being filled
+    start = ring.written() + 3;
+    for (uint32_t i = 80; i < 90; ++i) {
+        ring.push(makeSample(i));
+    }
+    ring.skipTo(start);
+    expected = 83;
+    TEST_ASSERT_EQUAL(7, ring.peek(span, 250));
+    checkSpan(span, expected);
+}
+
+// Sampler and sender on their own threads, the sender holding each span for
+// a while: every sample must arrive intact and in order across block commits,
+// slot hand-overs and backlog unpacking
+void test_concurrent_slot_handover() {
+    const uint32_t capacity = 8 * BLOCK;
+    const uint32_t total = 400000;
+    std::vector<uint64_t> storage(Packed2::storageBytes(2, capacity) / 8);
+    static Packed2 ring;
+    ring.attach(storage.data(), 2, capacity);
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < total;) {
+            if (!ring.push(makeSample(i))) {
+                std::this_thread::yield();
+            } else if (++i % 8 == 0) {
+                // Hand over often, also on a single-core host
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t spins = 0;
+    while (expected < total) {
+        SampleSpan_t span;
+        size_t count = ring.peek(span, 1 + expected % 40);
+        if (count == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (volatile uint32_t k = 0; k < (spins++ % 7) * 200; ++k) {
+        }
+        checkSpan(span, expected);
+        ring.consume(count);
+        // Now and then fall behind, so blocks are unpacked from the backlog too
+        if (spins % 1000 == 0) {
+            for (int k = 0; k < 50; ++k) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    producer.join();
+
+    char line[96];
+    snprintf(line, sizeof(line), "%u of %u samples read from staging", (unsigned)ring.stagedReads(),
+             (unsigned)total);
+    TEST_MESSAGE(line);
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark: the float staged ring vs. the packed ring in the same PSRAM
+// budget. Capacity is how long a backlog survives a link outage; the drain
+// rate and the backlog bytes per sample are what the sender pays to catch up.
+// ----------------------------------------------------------------------------
+
+static double elapsedNs(std::chrono::steady_clock::time_point started) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+}
+
+struct BenchResult {
+    uint32_t held;          // Samples the budget holds before the ring drops
+    double pushNs;          // Mean per-sample push while filling
+    double drainNs;         // Per-sample peek + read + consume of the full backlog
+};
+
+template <typename Ring>
+static BenchResult bench(Ring& ring, void* storage, uint32_t capacity) {
+    BenchResult best = {};
+    double sum = 0.0;
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        BenchResult result = {};
+        ring.attach(storage, 2, capacity);
+        auto started = std::chrono::steady_clock::now();
+        uint32_t i = 0;
+        while (ring.push(makeSample(i))) {
+            i++;
+        }
+        result.pushNs = elapsedNs(started) / i;
+        result.held = i;
+
+        started = std::chrono::steady_clock::now();
+        while (ring.available() > 0) {
+            SampleSpan_t span;
+            size_t count = ring.peek(span, MAX_SPAN);
+            for (size_t k = 0; k < count; ++k) {
+                sum += span.values[0][k] + span.values[1][k] + (double)span.timestampUs[k];
+            }
+            ring.consume(count);
+        }
+        result.drainNs = elapsedNs(started) / i;
+
+        best.held = result.held;
+        if (run == 0 || result.pushNs < best.pushNs) {
+            best.pushNs = result.pushNs;
+        }
+        if (run == 0 || result.drainNs < best.drainNs) {
+            best.drainNs = result.drainNs;
+        }
+    }
+    TEST_ASSERT_TRUE(sum != 0.0);
+    return best;
+}
+
+void test_benchmark_staged_vs_packed() {
+    const uint32_t floatCapacity = BENCH_BYTES / (sizeof(uint64_t) + 2 * sizeof(float));
+    const uint32_t packedCapacity = BENCH_BYTES / Packed2::slotBytes(2) * BLOCK;
+    std::vector<uint64_t> storage(BENCH_BYTES / 8);
+    static StagedRing<2, BLOCK> staged;
+    static Packed2 packed;
+
+    BenchResult a = bench(staged, storage.data(), floatCapacity);
+    BenchResult b = bench(packed, storage.data(), packedCapacity);
+    TEST_ASSERT_TRUE(b.held > 2 * a.held);
+
+    char line[240];
+    snprintf(line, sizeof(line),
+             "%.2f MB holds %u / %u samples (%.0f / %.0f s at 1 kHz), backlog %.1f / %.1f bytes per sample, "
+             "push %.1f / %.1f ns, drain %.1f / %.1f ns per sample (staged float / packed)",
+             BENCH_BYTES / 1e6, (unsigned)a.held, (unsigned)b.held, a.held / 1e3, b.held / 1e3,
+             (double)BENCH_BYTES / floatCapacity, (double)BENCH_BYTES / packedCapacity, a.pushNs, b.pushNs,
+             a.drainNs, b.drainNs);
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_storage_is_under_half_the_float_queue);
+    RUN_TEST(test_backlog_is_unpacked_then_staging_read);
+    RUN_TEST(test_reader_that_keeps_up_reads_only_staging);
+    RUN_TEST(test_staged_and_packed_values_agree);
+    RUN_TEST(test_irregular_timestamps_close_blocks_early);
+    RUN_TEST(test_full_ring_drops_and_wraps);
+    RUN_TEST(test_skip_to_drops_earlier_samples);
+    RUN_TEST(test_concurrent_slot_handover);
+    RUN_TEST(test_benchmark_staged_vs_packed);
+    return UNITY_END();
+}
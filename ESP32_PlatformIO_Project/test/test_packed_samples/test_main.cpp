@@ -0,0 +1,169 @@
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "packed_samples.h"
+
+#define BENCH_VALUES  (1 << 20)
+#define BENCH_RUNS    5                 // Best of, to keep scheduler noise out
+
+void setUp() {}
+void tearDown() {}
+
+void test_quantize_rounds_and_saturates() {
+    TEST_ASSERT_EQUAL(0, packedQuantize(0.0f));
+    TEST_ASSERT_EQUAL(0, packedQuantize(0.49f));
+    TEST_ASSERT_EQUAL(1, packedQuantize(0.5f));
+    TEST_ASSERT_EQUAL(-1, packedQuantize(-0.5f));
+    TEST_ASSERT_EQUAL(-1235, packedQuantize(-1234.56f));
+    TEST_ASSERT_EQUAL(PACKED_VALUE_MAX, packedQuantize(8388607.0f));
+    TEST_ASSERT_EQUAL(PACKED_VALUE_MIN, packedQuantize(-8388608.0f));
+    // Tare subtraction can leave the 24-bit range
+    TEST_ASSERT_EQUAL(PACKED_VALUE_MAX, packedQuantize(12000000.0f));
+    TEST_ASSERT_EQUAL(PACKED_VALUE_MIN, packedQuantize(-12000000.0f));
+}
+
+// Every length, so both the 4-sample words and the tail are covered
+void test_pack_unpack_round_trip() {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int32_t> counts(PACKED_VALUE_MIN, PACKED_VALUE_MAX);
+    for (size_t count = 0; count <= 37; ++count) {
+        std::vector<float> src(count);
+        for (size_t i = 0; i < count; ++i) {
+            src[i] = (float)counts(rng);
+        }
+        if (count > 2) {
+            src[0] = (float)PACKED_VALUE_MAX;
+            src[1] = (float)PACKED_VALUE_MIN;
+            src[2] = -1.0f;
+        }
+        std::vector<uint8_t> packed(3 * count + 1, 0xA5);
+        std::vector<float> dst(count, 0.5f);
+        packInt24(src.data(), packed.data(), count);
+        TEST_ASSERT_EQUAL_HEX8(0xA5, packed[3 * count]);   // Nothing written past the end
+        unpackInt24(packed.data(), dst.data(), count);
+        for (size_t i = 0; i < count; ++i) {
+            TEST_ASSERT_EQUAL_FLOAT(src[i], dst[i]);
+        }
+    }
+}
+
+void test_packed_layout_is_little_endian_24_bit() {
+    const float src[5] = { 0x123456, -2.0f, 1.0f, -8388608.0f, 0x0A0B0C };
+    uint8_t packed[15];
+    packInt24(src, packed, 5);
+    const uint8_t expected[15] = { 0x56, 0x34, 0x12, 0xFE, 0xFF, 0xFF, 0x01, 0x00, 0x00,
+                                   0x00, 0x00, 0x80, 0x0C, 0x0B, 0x0A };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, packed, 15);
+}
+
+void test_regular_timestamps_continue_a_block() {
+    // 1 kHz with a few microseconds of jitter
+    TEST_ASSERT_TRUE(packedContinues(1000, 1000, 1, 2003));
+    TEST_ASSERT_TRUE(packedContinues(1000, 2003, 2, 2998));
+    TEST_ASSERT_TRUE(packedContinues(1000, 31000, 31, 32000 + PACKED_JITTER_US));
+    TEST_ASSERT_FALSE(packedContinues(1000, 31000, 31, 32000 + PACKED_JITTER_US + 1));
+    // A gap, a rate change, a restart
+    TEST_ASSERT_FALSE(packedContinues(1000, 5000, 5, 8000));
+    TEST_ASSERT_FALSE(packedContinues(1000, 5000, 5, 5500));
+    TEST_ASSERT_FALSE(packedContinues(1000, 5000, 5, 400));
+    TEST_ASSERT_FALSE(packedContinues(1000, 1000, 1, 1000 + PACKED_MAX_STEP_US + 1));
+}
+
+// Timestamps rebuilt from t0 and the step stay within the jitter a block
+// absorbs, also for rates that are not a whole number of microseconds
+void test_timestamps_rebuilt_from_step() {
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> jitter(-8, 8);
+    const double intervals[3] = { 1000.0, 1e6 / 330.0, 1e6 / 2000.0 };
+    for (double interval : intervals) {
+        uint64_t t[32];
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < 32; ++i) {
+            uint64_t ts = 5000000 + (uint64_t)(i * interval) + jitter(rng);
+            if (count > 0 && !packedContinues(t[0], t[count - 1], count, ts)) {
+                break;
+            }
+            t[count++] = ts;
+        }
+        TEST_ASSERT_EQUAL(32, count);
+
+        PackedBlockHeader_t header = {};
+        header.t0Us = t[0];
+        header.stepQ8 = packedStepQ8(t[0], t[count - 1], count);
+        header.count = (uint16_t)count;
+        uint64_t rebuilt[32];
+        unpackTimestamps(header, 0, rebuilt, count);
+        TEST_ASSERT_TRUE(rebuilt[0] == t[0]);
+        TEST_ASSERT_TRUE(rebuilt[count - 1] == t[count - 1]);
+        for (uint32_t i = 0; i < count; ++i) {
+            int64_t error = (int64_t)rebuilt[i] - (int64_t)t[i];
+            TEST_ASSERT_TRUE(error <= PACKED_JITTER_US && error >= -PACKED_JITTER_US);
+        }
+        // From an offset, as the sender reads a partly sent block
+        uint64_t tail[10];
+        unpackTimestamps(header, 22, tail, 10);
+        TEST_ASSERT_EQUAL_MEMORY(&rebuilt[22], tail, sizeof(tail));
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark: kernel throughput, against the float memcpy the packed format
+// replaces in the staged ring's commit and the sender's backlog read
+// ----------------------------------------------------------------------------
+
+static double nsPerValue(void (*run)(const std::vector<float>&, std::vector<uint8_t>&, std::vector<float>&),
+                         const std::vector<float>& src, std::vector<uint8_t>& packed, std::vector<float>& dst) {
+    double best = 0.0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        auto started = std::chrono::steady_clock::now();
+        run(src, packed, dst);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+        if (r == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best / src.size();
+}
+
+void test_benchmark_pack_unpack() {
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(400000.0f, 3000.0f);
+    std::vector<float> src(BENCH_VALUES);
+    for (float& v : src) {
+        v = noise(rng);
+    }
+    std::vector<uint8_t> packed(BENCH_VALUES * 4);
+    std::vector<float> dst(BENCH_VALUES);
+
+    double pack = nsPerValue([](const std::vector<float>& s, std::vector<uint8_t>& p, std::vector<float>&) {
+        packInt24(s.data(), p.data(), s.size());
+    }, src, packed, dst);
+    double unpack = nsPerValue([](const std::vector<float>& s, std::vector<uint8_t>& p, std::vector<float>& d) {
+        unpackInt24(p.data(), d.data(), s.size());
+    }, src, packed, dst);
+    double copy = nsPerValue([](const std::vector<float>& s, std::vector<uint8_t>& p, std::vector<float>&) {
+        memcpy(p.data(), s.data(), s.size() * sizeof(float));
+    }, src, packed, dst);
+    for (size_t i = 0; i < src.size(); i += 4099) {
+        TEST_ASSERT_EQUAL_FLOAT((float)packedQuantize(src[i]), dst[i]);
+    }
+
+    char line[160];
+    snprintf(line, sizeof(line),
+             "pack %.2f ns/value (%.0f MB/s in), unpack %.2f ns/value, float memcpy %.2f ns/value",
+             pack, sizeof(float) / pack * 1e3, unpack, copy);
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_quantize_rounds_and_saturates);
+    RUN_TEST(test_pack_unpack_round_trip);
+    RUN_TEST(test_packed_layout_is_little_endian_24_bit);
+    RUN_TEST(test_regular_timestamps_continue_a_block);
+    RUN_TEST(test_timestamps_rebuilt_from_step);
+    RUN_TEST(test_benchmark_pack_unpack);
+    return UNITY_END();
+}
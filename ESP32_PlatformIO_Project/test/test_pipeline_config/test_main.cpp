@@ -0,0 +1,171 @@
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "pipeline_config.h"
+#include "channel_ring.h"
+#include "packed_ring.h"
+#include "sample_encoder.h"
+#include "udp_frame.h"
+
+#define BENCH_SAMPLES  1000000
+#define BENCH_RUNS     5                // Best of, to keep scheduler noise out
+#define DRAM_QUEUE_BUDGET (96 * 1024)   // Static DRAM left for the queue on a PSRAM-less board
+
+// Bytes of the queue the environment selects (a StagedRing stores as much as
+// a ChannelRing)
+template <typename P>
+static size_t sampleQueueBytes() {
+    if constexpr (P::packedQueue) {
+        return PackedRing<P::channels, P::stagingBlock, P::maxBatch>::storageBytes(P::channels, P::queueLength);
+    } else {
+        return ChannelRing<P::channels>::storageBytes(P::channels, P::queueLength);
+    }
+}
+
+template <typename P>
+static void checkPipeline(const char* name) {
+    size_t queueBytes = sampleQueueBytes<P>();
+    size_t jsonBytes = P::maxBatch * SAMPLE_JSON_MAX_BYTES(P::channels) + SAMPLE_FRAME_OVERHEAD;
+    char line[160];
+    snprintf(line, sizeof(line), "%s: %u channels, queue %lu samples (%lu bytes, %s), JSON frame %lu bytes",
+             name, (unsigned)P::channels, (unsigned long)P::queueLength, (unsigned long)queueBytes,
+             P::packedQueue ? (P::psramQueue ? "packed, PSRAM" : "packed, DRAM") : (P::psramQueue ? "PSRAM" : "DRAM"),
+             (unsigned long)jsonBytes);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_TRUE(P::channels >= 1 && P::channels <= MAX_CHANNELS);
+    TEST_ASSERT_TRUE(P::minBatch <= P::maxBatch);
+    TEST_ASSERT_TRUE(P::maxBatch < P::queueLength);
+    // At least half a second of history ahead of a trigger
+    TEST_ASSERT_TRUE(!P::triggerCapture || P::preTriggerMs >= 500);
+    if (!P::psramQueue) {
+        TEST_ASSERT_LESS_OR_EQUAL(DRAM_QUEUE_BUDGET, queueBytes);
+    }
+    // Staging blocks never wrap the queue; packing works on staged blocks
+    if (P::stagingBlock > 0) {
+        TEST_ASSERT_EQUAL(0, P::queueLength % P::stagingBlock);
+    }
+    TEST_ASSERT_TRUE(!P::packedQueue || P::stagingBlock > 0);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_environment_pipelines_fit() {
+    checkPipeline<Esp32s3Pipeline>("esp32s3");
+    checkPipeline<NanoEsp32Pipeline>("arduino_nano_esp32");
+    checkPipeline<Esp32devPipeline>("esp32dev");
+    checkPipeline<NativePipeline>("native");
+    TEST_ASSERT_FALSE(Esp32devPipeline::udpTransport);
+}
+
+void test_native_build_selects_native_pipeline() {
+#if defined(PIPELINE_NATIVE)
+    TEST_ASSERT_EQUAL(NativePipeline::queueLength, Pipeline::queueLength);
+#else
+    TEST_IGNORE_MESSAGE("built without -DPIPELINE_NATIVE");
+#endif
+}
+
+void test_fixed_and_runtime_channel_rings_match() {
+    const uint32_t capacity = 64;
+    std::vector<uint64_t> fixedStorage(ChannelRing<4>::storageBytes(4, capacity) / 8 + 1);
+    std::vector<uint64_t> runtimeStorage(ChannelRing<>::storageBytes(4, capacity) / 8 + 1);
+    ChannelRing<4> fixed;
+    ChannelRing<> runtime;
+    fixed.attach(fixedStorage.data(), 4, capacity);
+    runtime.attach(runtimeStorage.data(), 4, capacity);
+    TEST_ASSERT_EQUAL(4, fixed.channels());
+
+    for (uint32_t i = 0; i < 100; ++i) {
+        Sample_t sample;
+        sample.timestampUs = 1000ULL * i;
+        for (uint8_t c = 0; c < 4; ++c) {
+            sample.values[c] = i * 10.0f + c;
+        }
+        TEST_ASSERT_TRUE(fixed.push(sample));
+        TEST_ASSERT_TRUE(runtime.push(sample));
+
+        SampleSpan_t a, b;
+        TEST_ASSERT_EQUAL(fixed.peek(a, 1), runtime.peek(b, 1));
+        TEST_ASSERT_TRUE(a.timestampUs[0] == b.timestampUs[0]);
+        for (uint8_t c = 0; c < 4; ++c) {
+            TEST_ASSERT_EQUAL_FLOAT(b.values[c][0], a.values[c][0]);
+        }
+        fixed.consume(1);
+        runtime.consume(1);
+    }
+}
+
+// Sampler push plus sender peek/consume in batches of 20, per sample; with
+// encode set the sender also builds the UDP datagram
+template <typename Ring>
+static double nsPerSample(Ring& ring, uint8_t channels, bool encode) {
+    static uint8_t datagram[UDP_MAX_DATAGRAM];
+    UdpFramer framer;
+    framer.setParityGroup(0);
+    Sample_t sample = {};
+    double best = 0.0;
+
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        uint64_t checksum = 0;
+        auto started = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < BENCH_SAMPLES; ++i) {
+            sample.timestampUs = 1000ULL * i;
+            for (uint8_t c = 0; c < channels; ++c) {
+                sample.values[c] = (float)(i + c);
+            }
+            ring.push(sample);
+            if (ring.available() >= 20) {
+                SampleSpan_t span;
+                size_t count = ring.peek(span, 20);
+                if (encode) {
+                    framer.encodeData(span, datagram, count);
+                }
+                checksum += span.values[channels - 1][0];
+                ring.consume(count);
+            }
+        }
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        TEST_ASSERT_TRUE(checksum > 0);
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / BENCH_SAMPLES;
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+template <uint8_t Channels>
+static void benchmark(uint64_t* storage, uint32_t capacity) {
+    ChannelRing<> runtime;
+    ChannelRing<Channels> fixed;
+    runtime.attach(storage, Channels, capacity);
+    fixed.attach(storage, Channels, capacity);
+
+    char line[160];
+    snprintf(line, sizeof(line),
+             "%u channels: ring runtime count %.1f ns/sample, compile-time %.1f; "
+             "with UDP encode %.1f / %.1f",
+             (unsigned)Channels, nsPerSample(runtime, Channels, false), nsPerSample(fixed, Channels, false),
+             nsPerSample(runtime, Channels, true), nsPerSample(fixed, Channels, true));
+    TEST_MESSAGE(line);
+}
+
+void test_benchmark_fixed_vs_runtime_channels() {
+    const uint32_t capacity = 4096;
+    std::vector<uint64_t> storage(ChannelRing<>::storageBytes(MAX_CHANNELS, capacity) / 8 + 1);
+    benchmark<2>(storage.data(), capacity);
+    benchmark<4>(storage.data(), capacity);
+    benchmark<8>(storage.data(), capacity);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_environment_pipelines_fit);
+    RUN_TEST(test_native_build_selects_native_pipeline);
+    RUN_TEST(test_fixed_and_runtime_channel_rings_match);
+    RUN_TEST(test_benchmark_fixed_vs_runtime_channels);
+    return UNITY_END();
+}
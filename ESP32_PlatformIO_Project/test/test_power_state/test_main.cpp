@@ -0,0 +1,69 @@
+#include <unity.h>
+#include <stdio.h>
+#include "power_state.h"
+
+static WakeLatency_t wake;
+
+void setUp() {
+    wake = WakeLatency_t();
+}
+
+void tearDown() {}
+
+void test_only_first_sample_after_start_is_recorded() {
+    TEST_ASSERT_FALSE(wakeLatencyFirstSample(wake, 500));
+    TEST_ASSERT_EQUAL(0, wake.count);
+
+    wakeLatencyStart(wake, 1000);
+    TEST_ASSERT_TRUE(wakeLatencyFirstSample(wake, 3200));
+    TEST_ASSERT_FALSE(wakeLatencyFirstSample(wake, 4200));
+    TEST_ASSERT_FALSE(wakeLatencyFirstSample(wake, 5200));
+
+    TEST_ASSERT_EQUAL(1, wake.count);
+    TEST_ASSERT_EQUAL(2200, wake.last);
+    TEST_ASSERT_FALSE(wake.pending);
+}
+
+void test_statistics_and_budget() {
+    const uint32_t latencies[] = { 1200, 1800, 6500, 1500 };
+    uint64_t now = 10000000ULL;
+    for (uint32_t latency : latencies) {
+        wakeLatencyStart(wake, now);
+        wakeLatencyFirstSample(wake, now + latency);
+        now += 60000000ULL;
+    }
+
+    TEST_ASSERT_EQUAL(4, wake.count);
+    TEST_ASSERT_EQUAL(1500, wake.last);
+    TEST_ASSERT_EQUAL(6500, wake.max);
+    TEST_ASSERT_EQUAL(2750, wakeLatencyMean(wake));
+    TEST_ASSERT_EQUAL(1, wake.overBudget);
+}
+
+void test_repeated_start_restarts_measurement() {
+    wakeLatencyStart(wake, 1000);
+    wakeLatencyStart(wake, 9000);
+    wakeLatencyFirstSample(wake, 10000);
+    TEST_ASSERT_EQUAL(1000, wake.last);
+}
+
+void test_clock_going_backwards_records_zero() {
+    wakeLatencyStart(wake, 5000);
+    wakeLatencyFirstSample(wake, 4000);
+    TEST_ASSERT_EQUAL(0, wake.last);
+    TEST_ASSERT_EQUAL(0, wakeLatencyMean(wake));
+}
+
+void test_empty_mean_is_zero() {
+    TEST_ASSERT_EQUAL(0, wakeLatencyMean(wake));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_only_first_sample_after_start_is_recorded);
+    RUN_TEST(test_statistics_and_budget);
+    RUN_TEST(test_repeated_start_restarts_measurement);
+    RUN_TEST(test_clock_going_backwards_records_zero);
+    RUN_TEST(test_empty_mean_is_zero);
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "sample_encoder.h"
+
+#define BATCH_SIZE        100
+#define CHANNELS          2
+#define FRAME_CAPACITY    5000
+#define BENCH_BATCHES     2000
+
+// Allocation counters for both paths: operator new covers std::string (the
+// host stand-in for Arduino String), CountingAllocator covers JsonDocument.
+static size_t allocationCount = 0;
+
+void* operator new(size_t size) {
+    allocationCount++;
+    void* p = malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override {
+        allocationCount++;
+        return malloc(size);
+    }
+    void deallocate(void* ptr) override {
+        free(ptr);
+    }
+    void* reallocate(void* ptr, size_t newSize) override {
+        allocationCount++;
+        return realloc(ptr, newSize);
+    }
+};
+
+static uint64_t timestamps[BATCH_SIZE];
+static float values[CHANNELS][BATCH_SIZE];
+static SampleSpan_t samples;
+static char frame[FRAME_CAPACITY];
+
+static void fillSamples(uint32_t start) {
+    for (uint32_t i = 0; i < BATCH_SIZE; ++i) {
+        timestamps[i] = 5000000000ULL + (uint64_t)(start + i) * 1000;
+        values[0][i] = (float)(-8388608 + (int32_t)((start + i) * 7919u % 16777216u));
+        values[1][i] = (float)((int32_t)((start + i) * 104729u % 200000u) - 100000) + 0.25f;
+    }
+    samples.timestampUs = timestamps;
+    samples.values[0] = values[0];
+    samples.values[1] = values[1];
+    samples.channels = CHANNELS;
+    samples.count = BATCH_SIZE;
+}
+
+// Previous vSenderTask path: reused JsonDocument plus a fresh String per batch
+static size_t encodeWithJsonDocument(JsonDocument& doc, const SampleSpan_t& batchSamples) {
+    doc.clear();
+    JsonArray batch = doc["samples"].to<JsonArray>();
+    for (size_t j = 0; j < batchSamples.count; ++j) {
+        JsonObject obj = batch.add<JsonObject>();
+        obj["t"] = (uint32_t)(batchSamples.timestampUs[j] / 1000);
+        obj["l"] = batchSamples.values[0][j];
+        obj["r"] = batchSamples.values[1][j];
+    }
+    std::string payload;
+    serializeJson(doc, payload);
+    return payload.size();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_frame_round_trips_through_json_parser() {
+    fillSamples(4000000000u);
+    values[0][0] = -0.004f;
+    values[1][1] = 12.5f;
+
+    size_t encoded = 0;
+    size_t length = encodeSampleBatch(samples, frame, sizeof(frame), encoded);
+    TEST_ASSERT_EQUAL(BATCH_SIZE, encoded);
+
+    CountingAllocator allocator;
+    JsonDocument doc(&allocator);
+    TEST_ASSERT_TRUE(deserializeJson(doc, frame, length) == DeserializationError::Ok);
+
+    uint64_t base = doc["t0"].as<uint64_t>();
+    TEST_ASSERT_TRUE(base == timestamps[0]);
+    TEST_ASSERT_EQUAL(CHANNELS, doc["ch"].as<int>());
+    JsonArray parsed = doc["samples"].as<JsonArray>();
+    TEST_ASSERT_EQUAL(BATCH_SIZE, parsed.size());
+    for (size_t i = 0; i < BATCH_SIZE; ++i) {
+        TEST_ASSERT_TRUE(timestamps[i] == base + parsed[i]["dt"].as<uint32_t>());
+        TEST_ASSERT_EQUAL(CHANNELS, parsed[i]["v"].size());
+        TEST_ASSERT_FLOAT_WITHIN(0.005, values[0][i], parsed[i]["v"][0].as<double>());
+        TEST_ASSERT_FLOAT_WITHIN(0.005, values[1][i], parsed[i]["v"][1].as<double>());
+    }
+}
+
+void test_partial_batch_when_buffer_is_small() {
+    fillSamples(0);
+    size_t encoded = 0;
+    size_t length = encodeSampleBatch(samples, frame, 600, encoded);
+    TEST_ASSERT_GREATER_THAN(0, encoded);
+    TEST_ASSERT_LESS_THAN(BATCH_SIZE, encoded);
+    TEST_ASSERT_LESS_OR_EQUAL(600, length);
+    TEST_ASSERT_EQUAL('}', frame[length - 1]);
+    TEST_ASSERT_EQUAL(']', frame[length - 2]);
+
+    TEST_ASSERT_EQUAL(0, encodeSampleBatch(samples, frame, 40, encoded));
+    TEST_ASSERT_EQUAL(0, encoded);
+}
+
+void test_offset_overflow_ends_frame() {
+    fillSamples(0);
+    timestamps[5] = timestamps[0] + UINT32_MAX + 1ULL;
+    size_t encoded = 0;
+    encodeSampleBatch(samples, frame, sizeof(frame), encoded);
+    TEST_ASSERT_EQUAL(5, encoded);
+}
+
+void test_benchmark_old_and_new_path() {
+    CountingAllocator allocator;
+    JsonDocument doc(&allocator);
+
+    // Old path
+    size_t oldBytes = 0;
+    size_t allocationsBefore = allocationCount;
+    auto started = std::chrono::steady_clock::now();
+    for (uint32_t b = 0; b < BENCH_BATCHES; ++b) {
+        fillSamples(b * BATCH_SIZE);
+        oldBytes += encodeWithJsonDocument(doc, samples);
+    }
+    double oldSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    double oldAllocations = (double)(allocationCount - allocationsBefore) / BENCH_BATCHES;
+
+    // New path
+    size_t newBytes = 0;
+    allocationsBefore = allocationCount;
+    started = std::chrono::steady_clock::now();
+    for (uint32_t b = 0; b < BENCH_BATCHES; ++b) {
+        fillSamples(b * BATCH_SIZE);
+        size_t encoded = 0;
+        newBytes += encodeSampleBatch(samples, frame, sizeof(frame), encoded);
+    }
+    double newSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    size_t newAllocations = allocationCount - allocationsBefore;
+
+    TEST_ASSERT_EQUAL(0, newAllocations);
+
+    char report[200];
+    snprintf(report, sizeof(report),
+             "JsonDocument+String: %.1f allocs/batch, %.1f MB/s, %.0f samples/s",
+             oldAllocations, oldBytes / oldSeconds / 1e6, BENCH_BATCHES * BATCH_SIZE / oldSeconds);
+    TEST_MESSAGE(report);
+    snprintf(report, sizeof(report),
+             "static frame buffer:  %.1f allocs/batch, %.1f MB/s, %.0f samples/s",
+             (double)newAllocations / BENCH_BATCHES, newBytes / newSeconds / 1e6,
+             BENCH_BATCHES * BATCH_SIZE / newSeconds);
+    TEST_MESSAGE(report);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_round_trips_through_json_parser);
+    RUN_TEST(test_partial_batch_when_buffer_is_small);
+    RUN_TEST(test_offset_overflow_ends_frame);
+    RUN_TEST(test_benchmark_old_and_new_path);
+    return UNITY_END();
+}
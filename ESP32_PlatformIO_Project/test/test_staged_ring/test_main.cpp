@@ -0,0 +1,293 @@
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "channel_ring.h"
+#include "staged_ring.h"
+
+#define BLOCK           32
+#define BENCH_CAPACITY  120000          // DefaultPipeline::queueLength
+#define BENCH_SAMPLES   2000000
+#define BENCH_RUNS      3               // Best of, to keep scheduler noise out
+
+typedef StagedRing<2, BLOCK> Staged2;
+
+static Sample_t makeSample(uint32_t i) {
+    Sample_t sample = {};
+    sample.timestampUs = 1000ULL * i;
+    sample.values[0] = (float)i;
+    sample.values[1] = -(float)i;
+    return sample;
+}
+
+// Every sample of the span is the next one in sequence
+static void checkSpan(const SampleSpan_t& span, uint32_t& expected) {
+    for (size_t k = 0; k < span.count; ++k, ++expected) {
+        TEST_ASSERT_TRUE(span.timestampUs[k] == 1000ULL * expected);
+        TEST_ASSERT_EQUAL_FLOAT((float)expected, span.values[0][k]);
+        TEST_ASSERT_EQUAL_FLOAT(-(float)expected, span.values[1][k]);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_reader_that_keeps_up_reads_only_staging() {
+    std::vector<uint64_t> storage(Staged2::storageBytes(2, 256) / 8);
+    static Staged2 ring;
+    ring.attach(storage.data(), 2, 256);
+
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        TEST_ASSERT_TRUE(ring.push(makeSample(i)));
+        // Caught up before each block is committed
+        if (i % 8 == 7) {
+            SampleSpan_t span;
+            while (ring.peek(span, 20) > 0) {
+                checkSpan(span, expected);
+                ring.consume(span.count);
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(1000, expected);
+    TEST_ASSERT_EQUAL(1000, ring.stagedReads());
+}
+
+void test_backlog_is_read_from_committed_blocks_then_staging() {
+    std::vector<uint64_t> storage(Staged2::storageBytes(2, 256) / 8);
+    static Staged2 ring;
+    ring.attach(storage.data(), 2, 256);
+
+    // 5 full blocks in the backlog, 10 samples staged
+    for (uint32_t i = 0; i < 5 * BLOCK + 10; ++i) {
+        TEST_ASSERT_TRUE(ring.push(makeSample(i)));
+    }
+    TEST_ASSERT_EQUAL(5 * BLOCK + 10, ring.available());
+
+    SampleSpan_t span;
+    uint32_t expected = 0;
+    TEST_ASSERT_EQUAL(100, ring.peek(span, 100));
+    checkSpan(span, expected);
+    ring.consume(span.count);
+    TEST_ASSERT_EQUAL(0, ring.stagedReads());
+
+    // The backlog span stops at the staging block
+    TEST_ASSERT_EQUAL(5 * BLOCK - 100, ring.peek(span, 250));
+    checkSpan(span, expected);
+    ring.consume(span.count);
+    TEST_ASSERT_EQUAL(10, ring.peek(span, 250));
+    checkSpan(span, expected);
+    ring.consume(span.count);
+    TEST_ASSERT_EQUAL(10, ring.stagedReads());
+    TEST_ASSERT_EQUAL(0, ring.peek(span, 250));
+}
+
+void test_full_ring_drops_and_wraps() {
+    const uint32_t capacity = 4 * BLOCK;
+    std::vector<uint64_t> storage(Staged2::storageBytes(2, capacity) / 8);
+    static Staged2 ring;
+    ring.attach(storage.data(), 2, capacity);
+
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    for (int lap = 0; lap < 10; ++lap) {
+        while (ring.push(makeSample(next))) {
+            next++;
+        }
+        TEST_ASSERT_EQUAL(capacity, ring.available());
+        // Drain an uneven amount so reads straddle blocks and the wrap
+        uint32_t drain = 3 * BLOCK - 7 + lap;
+        while (drain > 0) {
+            SampleSpan_t span;
+            size_t count = ring.peek(span, std::min<uint32_t>(drain, 45));
+            TEST_ASSERT_TRUE(count > 0);
+            checkSpan(span, expected);
+            ring.consume(count);
+            drain -= (uint32_t)count;
+        }
+    }
+}
+
+void test_skip_to_drops_earlier_samples() {
+    std::vector<uint64_t> storage(Staged2::storageBytes(2, 256) / 8);
+    static Staged2 ring;
+    ring.attach(storage.data(), 2, 256);
+    for (uint32_t i = 0; i < 70; ++i) {
+        ring.push(makeSample(i));
+    }
+    uint32_t start = ring.written();
+    for (uint32_t i = 70; i < 80; ++i) {
+        ring.push(makeSample(i));
+    }
+    ring.skipTo(start);
+    SampleSpan_t span;
+    uint32_t expected = 70;
+    TEST_ASSERT_EQUAL(10, ring.peek(span, 250));
+    checkSpan(span, expected);
+}
+
+// Sampler and sender on their own threads. The sender holds each span for a
+// while before reading it, so the sampler commits blocks (and would reuse
+// the slot) under it; every sample must still arrive intact and in order.
+void test_concurrent_slot_handover() {
+    const uint32_t capacity = 8 * BLOCK;
+    const uint32_t total = 400000;
+    std::vector<uint64_t> storage(Staged2::storageBytes(2, capacity) / 8);
+    static Staged2 ring;
+    ring.attach(storage.data(), 2, capacity);
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < total;) {
+            if (!ring.push(makeSample(i))) {
+                std::this_thread::yield();
+            } else if (++i % 8 == 0) {
+                // Hand over often, also on a single-core host
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t spins = 0;
+    while (expected < total) {
+        SampleSpan_t span;
+        size_t count = ring.peek(span, 1 + expected % 40);
+        if (count == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (volatile uint32_t k = 0; k < (spins++ % 7) * 200; ++k) {
+        }
+        checkSpan(span, expected);
+        ring.consume(count);
+    }
+    producer.join();
+
+    char line[96];
+    snprintf(line, sizeof(line), "%u of %u samples read from staging", (unsigned)ring.stagedReads(),
+             (unsigned)total);
+    TEST_MESSAGE(line);
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark: the ring written directly vs. staged, over a DefaultPipeline-size
+// backlog. On the host the backlog is ordinary cached RAM, so this measures
+// the staging overhead; on the ESP32 the telemetry reports push_ns_mean/max
+// and staged_reads for the layout the environment selects.
+// ----------------------------------------------------------------------------
+
+struct BenchResult {
+    double pushNs;          // Mean per-sample push
+    double pushP999Ns;      // 99.9th percentile push (block commits for the staged ring)
+    double liveMBs;         // Sender keeping up, batches of 20
+    double drainMBs;        // Sender draining a full backlog, batches of 250
+};
+
+static double elapsedNs(std::chrono::steady_clock::time_point started) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+}
+
+template <typename Ring>
+static double readSpan(Ring& ring, size_t maxCount, double& sum) {
+    SampleSpan_t span;
+    size_t count = ring.peek(span, maxCount);
+    for (size_t k = 0; k < count; ++k) {
+        sum += span.values[0][k] + span.values[1][k] + (double)span.timestampUs[k];
+    }
+    ring.consume(count);
+    return (double)count;
+}
+
+template <typename Ring>
+static BenchResult bench(Ring& ring, void* storage) {
+    const double sampleBytes = sizeof(uint64_t) + 2 * sizeof(float);
+    BenchResult best = {};
+    double sum = 0.0;
+
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        BenchResult result = {};
+        ring.attach(storage, 2, BENCH_CAPACITY);
+
+        // Per-sample push: the mean from one timed pass, the tail from timing
+        // every push of a second pass
+        auto started = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < BENCH_CAPACITY; ++i) {
+            ring.push(makeSample(i));
+        }
+        result.pushNs = elapsedNs(started) / BENCH_CAPACITY;
+
+        // Drain the full backlog
+        started = std::chrono::steady_clock::now();
+        double read = 0;
+        while (ring.available() > 0) {
+            read += readSpan(ring, 250, sum);
+        }
+        result.drainMBs = read * sampleBytes / elapsedNs(started) * 1e3;
+
+        std::vector<double> pushNs(BENCH_CAPACITY);
+        for (uint32_t i = 0; i < BENCH_CAPACITY; ++i) {
+            auto pushStarted = std::chrono::steady_clock::now();
+            ring.push(makeSample(i));
+            pushNs[i] = elapsedNs(pushStarted);
+        }
+        std::nth_element(pushNs.begin(), pushNs.begin() + BENCH_CAPACITY * 999 / 1000, pushNs.end());
+        result.pushP999Ns = pushNs[BENCH_CAPACITY * 999 / 1000];
+        while (ring.available() > 0) {
+            readSpan(ring, 250, sum);
+        }
+
+        // Live: the sender reads each batch of 20 as soon as it is written
+        double liveNs = 0.0;
+        read = 0;
+        for (uint32_t i = 0; i < BENCH_SAMPLES; ++i) {
+            ring.push(makeSample(i));
+            if (ring.available() >= 20) {
+                started = std::chrono::steady_clock::now();
+                read += readSpan(ring, 20, sum);
+                liveNs += elapsedNs(started);
+            }
+        }
+        result.liveMBs = read * sampleBytes / liveNs * 1e3;
+
+        if (run == 0 || result.pushNs < best.pushNs) {
+            best.pushNs = result.pushNs;
+        }
+        if (run == 0 || result.pushP999Ns < best.pushP999Ns) {
+            best.pushP999Ns = result.pushP999Ns;
+        }
+        best.liveMBs = std::max(best.liveMBs, result.liveMBs);
+        best.drainMBs = std::max(best.drainMBs, result.drainMBs);
+    }
+    TEST_ASSERT_TRUE(sum != 0.0);
+    return best;
+}
+
+void test_benchmark_direct_vs_staged() {
+    std::vector<uint64_t> storage(ChannelRing<2>::storageBytes(2, BENCH_CAPACITY) / 8);
+    static ChannelRing<2> direct;
+    static Staged2 staged;
+
+    BenchResult a = bench(direct, storage.data());
+    BenchResult b = bench(staged, storage.data());
+    char line[200];
+    snprintf(line, sizeof(line),
+             "push %.1f / %.1f ns/sample (p99.9 %.0f / %.0f ns), sender live %.0f / %.0f MB/s, "
+             "backlog drain %.0f / %.0f MB/s (direct / staged, block %d)",
+             a.pushNs, b.pushNs, a.pushP999Ns, b.pushP999Ns, a.liveMBs, b.liveMBs,
+             a.drainMBs, b.drainMBs, BLOCK);
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_reader_that_keeps_up_reads_only_staging);
+    RUN_TEST(test_backlog_is_read_from_committed_blocks_then_staging);
+    RUN_TEST(test_full_ring_drops_and_wraps);
+    RUN_TEST(test_skip_to_drops_earlier_samples);
+    RUN_TEST(test_concurrent_slot_handover);
+    RUN_TEST(test_benchmark_direct_vs_staged);
+    return UNITY_END();
+}
@@ -0,0 +1,121 @@
+#include <unity.h>
+#include <stdio.h>
+#include <vector>
+#include "trigger_capture.h"
+
+#define HISTORY 1000
+
+typedef struct {
+    uint32_t t;
+    float force;
+} Reading_t;
+
+static TriggerCapture<Reading_t, HISTORY> capture;
+static std::vector<Reading_t> emitted;
+
+static void feed(uint32_t t, float force) {
+    Reading_t r = { t, force };
+    capture.process(r, force, [](const Reading_t& out) { emitted.push_back(out); });
+}
+
+void setUp() {
+    TriggerConfig_t config = { 100.0f, 1000, 500 };
+    capture.configure(config);
+    emitted.clear();
+}
+
+void tearDown() {}
+
+void test_idle_emits_nothing() {
+    for (uint32_t t = 0; t < 10000; ++t) {
+        feed(t, (t % 7) * 5.0f);
+    }
+    TEST_ASSERT_EQUAL(0, emitted.size());
+    TEST_ASSERT_EQUAL(capture.Armed, capture.state());
+}
+
+void test_capture_includes_pre_trigger_history() {
+    for (uint32_t t = 0; t < 5000; ++t) {
+        feed(t, 2.0f);
+    }
+    // Pull: 3 s above threshold
+    for (uint32_t t = 5000; t < 8000; ++t) {
+        feed(t, 1500.0f);
+    }
+    TEST_ASSERT_EQUAL(capture.Capturing, capture.state());
+
+    // First emitted sample is 1 s (999 samples + trigger) before the trigger
+    TEST_ASSERT_EQUAL(1000 + 2999, emitted.size());
+    TEST_ASSERT_EQUAL(4001, emitted.front().t);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, emitted.front().force);
+    for (size_t i = 1; i < emitted.size(); ++i) {
+        TEST_ASSERT_EQUAL(emitted[i - 1].t + 1, emitted[i].t);
+    }
+}
+
+void test_post_trigger_hold_then_rearm() {
+    for (uint32_t t = 0; t < 2000; ++t) {
+        feed(t, 0.0f);
+    }
+    for (uint32_t t = 2000; t < 3000; ++t) {
+        feed(t, 800.0f);
+    }
+    // Brief dip shorter than the hold keeps the capture open
+    for (uint32_t t = 3000; t < 3200; ++t) {
+        feed(t, 10.0f);
+    }
+    for (uint32_t t = 3200; t < 3500; ++t) {
+        feed(t, 800.0f);
+    }
+    // Release: capture ends after 500 samples below threshold
+    for (uint32_t t = 3500; t < 6000; ++t) {
+        feed(t, 0.0f);
+    }
+
+    TEST_ASSERT_EQUAL(capture.Armed, capture.state());
+    TEST_ASSERT_EQUAL(1, capture.captures());
+    TEST_ASSERT_EQUAL(1000 + 1499 + 500, emitted.size());
+    TEST_ASSERT_EQUAL(3999, emitted.back().t);
+
+    // Second trial gets its own history
+    size_t before = emitted.size();
+    for (uint32_t t = 6000; t < 6100; ++t) {
+        feed(t, 500.0f);
+    }
+    TEST_ASSERT_EQUAL(2, capture.captures());
+    TEST_ASSERT_EQUAL(5001, emitted[before].t);
+}
+
+void test_shorter_history_and_data_reduction() {
+    TriggerConfig_t config = { 100.0f, 200, 250 };
+    capture.configure(config);
+
+    // Ten 3 s pulls inside a 10 minute session at 1 kHz
+    uint32_t total = 0;
+    for (uint32_t trial = 0; trial < 10; ++trial) {
+        for (uint32_t i = 0; i < 57000; ++i, ++total) {
+            feed(total, 3.0f);
+        }
+        for (uint32_t i = 0; i < 3000; ++i, ++total) {
+            feed(total, 1200.0f);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(10, capture.captures());
+    // The last pull is still open, so only nine post-trigger holds
+    TEST_ASSERT_EQUAL(10 * (200 + 2999) + 9 * 250, emitted.size());
+
+    char line[120];
+    snprintf(line, sizeof(line), "streamed %lu of %lu samples (%.1fx reduction)",
+             (unsigned long)emitted.size(), (unsigned long)total, (double)total / emitted.size());
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_emits_nothing);
+    RUN_TEST(test_capture_includes_pre_trigger_history);
+    RUN_TEST(test_post_trigger_hold_then_rearm);
+    RUN_TEST(test_shorter_history_and_data_reduction);
+    return UNITY_END();
+}
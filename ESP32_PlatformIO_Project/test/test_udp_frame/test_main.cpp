@@ -0,0 +1,184 @@
+#include <unity.h>
+#include <string.h>
+#include "udp_frame.h"
+
+#define HISTORY_SLOTS 8
+#define CHANNELS      2
+#define SAMPLES       (UDP_MAX_SAMPLES * 4)
+
+static UdpFramer framer;
+static uint8_t history[HISTORY_SLOTS * UDP_HISTORY_SLOT_BYTES];
+static uint64_t timestamps[SAMPLES];
+static float values[MAX_CHANNELS][SAMPLES];
+static uint8_t datagrams[4][UDP_MAX_DATAGRAM];
+static size_t lengths[4];
+
+static SampleSpan_t span(size_t first, size_t count, uint8_t channels = CHANNELS) {
+    SampleSpan_t s;
+    s.timestampUs = &timestamps[first];
+    for (uint8_t c = 0; c < MAX_CHANNELS; ++c) {
+        s.values[c] = &values[c][first];
+    }
+    s.channels = channels;
+    s.count = count;
+    return s;
+}
+
+static float valueAt(const uint8_t* datagram, uint8_t channels, size_t sample, uint8_t channel) {
+    const uint8_t* p = datagram + UDP_HEADER_BYTES + UDP_BASE_BYTES +
+                       sample * UDP_SAMPLE_BYTES(channels) + 4 + channel * 4;
+    uint32_t bits = udp_detail::get32(p);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void setUp() {
+    framer.attachHistory(history, HISTORY_SLOTS);
+    framer.setParityGroup(4);
+    framer.reset();
+    for (uint32_t i = 0; i < SAMPLES; ++i) {
+        timestamps[i] = 5000000000ULL + i * 1000;
+        for (uint8_t c = 0; c < MAX_CHANNELS; ++c) {
+            values[c][i] = -12345.5f + i + 1000.0f * c;
+        }
+    }
+}
+
+void tearDown() {}
+
+void test_data_layout() {
+    size_t encoded = 0;
+    size_t length = framer.encodeData(span(0, 3), datagrams[0], encoded);
+    TEST_ASSERT_EQUAL(3, encoded);
+    TEST_ASSERT_EQUAL(UDP_HEADER_BYTES + UDP_BASE_BYTES + 3 * UDP_SAMPLE_BYTES(CHANNELS), length);
+
+    const uint8_t* d = datagrams[0];
+    TEST_ASSERT_EQUAL(UDP_FRAME_MAGIC, udp_detail::get16(d));
+    TEST_ASSERT_EQUAL(UDP_FRAME_VERSION, d[2]);
+    TEST_ASSERT_EQUAL(UDP_FRAME_DATA, d[3]);
+    TEST_ASSERT_EQUAL(0, udp_detail::get32(d + 4));
+    TEST_ASSERT_EQUAL(3, udp_detail::get16(d + 8));
+    TEST_ASSERT_EQUAL(CHANNELS, d[UDP_HEADER_BYTES]);
+
+    uint64_t base = udp_detail::get32(d + UDP_HEADER_BYTES + 2) |
+                    ((uint64_t)udp_detail::get32(d + UDP_HEADER_BYTES + 6) << 32);
+    TEST_ASSERT_TRUE(base == timestamps[0]);
+
+    const uint8_t* second = d + UDP_HEADER_BYTES + UDP_BASE_BYTES + UDP_SAMPLE_BYTES(CHANNELS);
+    TEST_ASSERT_EQUAL(1000, udp_detail::get32(second));
+    TEST_ASSERT_EQUAL_FLOAT(values[0][1], valueAt(d, CHANNELS, 1, 0));
+    TEST_ASSERT_EQUAL_FLOAT(values[1][1], valueAt(d, CHANNELS, 1, 1));
+
+    // Oversized batches are split at UDP_MAX_SAMPLES
+    length = framer.encodeData(span(0, UDP_MAX_SAMPLES + 20), datagrams[1], encoded);
+    TEST_ASSERT_EQUAL(UDP_MAX_SAMPLES, encoded);
+    TEST_ASSERT_LESS_OR_EQUAL(UDP_MAX_DATAGRAM, length);
+    TEST_ASSERT_EQUAL(1, udp_detail::get32(datagrams[1] + 4));
+}
+
+void test_samples_per_datagram_follow_channel_count() {
+    const uint8_t channelCounts[] = { 2, 4, 8 };
+    for (uint8_t channels : channelCounts) {
+        size_t encoded = 0;
+        size_t length = framer.encodeData(span(0, SAMPLES, channels), datagrams[0], encoded);
+        TEST_ASSERT_EQUAL(udpSamplesPerDatagram(channels), encoded);
+        TEST_ASSERT_LESS_OR_EQUAL(UDP_MAX_DATAGRAM, length);
+        TEST_ASSERT_EQUAL(channels, datagrams[0][UDP_HEADER_BYTES]);
+        TEST_ASSERT_EQUAL_FLOAT(values[channels - 1][encoded - 1],
+                                valueAt(datagrams[0], channels, encoded - 1, channels - 1));
+    }
+    TEST_ASSERT_EQUAL(100, udpSamplesPerDatagram(2));
+    TEST_ASSERT_EQUAL(68, udpSamplesPerDatagram(4));
+    TEST_ASSERT_EQUAL(38, udpSamplesPerDatagram(8));
+}
+
+void test_parity_rebuilds_any_single_loss() {
+    const size_t counts[4] = { 100, 37, 100, 5 };
+    size_t offset = 0;
+    for (int i = 0; i < 4; ++i) {
+        size_t encoded = 0;
+        lengths[i] = framer.encodeData(span(offset, counts[i]), datagrams[i], encoded);
+        offset += encoded;
+        if (i < 3) {
+            TEST_ASSERT_EQUAL(0, framer.takeParity(datagrams[3]));
+        }
+    }
+
+    uint8_t parity[UDP_MAX_DATAGRAM] = {};
+    size_t parityLength = framer.takeParity(parity);
+    TEST_ASSERT_EQUAL(lengths[0] + 2, parityLength);
+    TEST_ASSERT_EQUAL(UDP_FRAME_PARITY, parity[3]);
+    TEST_ASSERT_EQUAL(0, udp_detail::get32(parity + 4));
+    TEST_ASSERT_EQUAL(4, udp_detail::get16(parity + 10));
+    TEST_ASSERT_EQUAL(0, framer.takeParity(parity + 0));
+
+    for (int lost = 0; lost < 4; ++lost) {
+        uint8_t block[UDP_MAX_BLOCK];
+        memcpy(block, parity + UDP_HEADER_BYTES, parityLength - UDP_HEADER_BYTES);
+        for (int i = 0; i < 4; ++i) {
+            if (i == lost) continue;
+            block[0] ^= datagrams[i][8];
+            block[1] ^= datagrams[i][9];
+            for (size_t k = UDP_HEADER_BYTES; k < lengths[i]; ++k) {
+                block[2 + k - UDP_HEADER_BYTES] ^= datagrams[i][k];
+            }
+        }
+        uint16_t count = udp_detail::get16(block);
+        TEST_ASSERT_EQUAL(counts[lost], count);
+        TEST_ASSERT_EQUAL_MEMORY(datagrams[lost] + UDP_HEADER_BYTES, block + 2,
+                                 UDP_BASE_BYTES + count * UDP_SAMPLE_BYTES(CHANNELS));
+    }
+}
+
+void test_flush_partial_group() {
+    size_t encoded = 0;
+    framer.encodeData(span(0, 10), datagrams[0], encoded);
+    uint8_t parity[UDP_MAX_DATAGRAM] = {};
+    TEST_ASSERT_EQUAL(0, framer.takeParity(parity));
+    TEST_ASSERT_EQUAL(UDP_HEADER_BYTES + 2 + UDP_BASE_BYTES + 10 * UDP_SAMPLE_BYTES(CHANNELS),
+                      framer.takeParity(parity, true));
+    TEST_ASSERT_EQUAL(1, udp_detail::get16(parity + 10));
+
+    TEST_ASSERT_EQUAL(UDP_HEADER_BYTES, framer.encodeMarker(parity));
+    TEST_ASSERT_EQUAL(UDP_FRAME_PARITY, parity[3]);
+    TEST_ASSERT_EQUAL(1, udp_detail::get32(parity + 4));
+    TEST_ASSERT_EQUAL(0, udp_detail::get16(parity + 10));
+}
+
+void test_offset_overflow_ends_datagram() {
+    timestamps[3] = timestamps[0] + UINT32_MAX;
+    timestamps[4] = timestamps[0] + UINT32_MAX + 1ULL;
+    size_t encoded = 0;
+    framer.encodeData(span(0, 10), datagrams[0], encoded);
+    TEST_ASSERT_EQUAL(4, encoded);
+    TEST_ASSERT_EQUAL(4, udp_detail::get16(datagrams[0] + 8));
+}
+
+void test_retransmit_from_history() {
+    uint8_t out[UDP_MAX_DATAGRAM];
+    size_t encoded = 0;
+    for (uint32_t seq = 0; seq < 12; ++seq) {
+        lengths[0] = framer.encodeData(span(seq, 2), datagrams[0], encoded);
+    }
+
+    TEST_ASSERT_EQUAL(lengths[0], framer.retransmit(11, out));
+    TEST_ASSERT_EQUAL_MEMORY(datagrams[0], out, lengths[0]);
+    TEST_ASSERT_TRUE(framer.retransmit(4, out) > 0);
+    TEST_ASSERT_EQUAL(4, udp_detail::get32(out + 4));
+
+    // Overwritten and never-sent datagrams are not served
+    TEST_ASSERT_EQUAL(0, framer.retransmit(3, out));
+    TEST_ASSERT_EQUAL(0, framer.retransmit(12, out));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_data_layout);
+    RUN_TEST(test_samples_per_datagram_follow_channel_count);
+    RUN_TEST(test_parity_rebuilds_any_single_loss);
+    RUN_TEST(test_flush_partial_group);
+    RUN_TEST(test_offset_overflow_ends_datagram);
+    RUN_TEST(test_retransmit_from_history);
+    return UNITY_END();
+}
@@ -0,0 +1,215 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "frame_sender.h"
+#include "usb_frame.h"
+
+struct Received {
+    std::vector<std::string> payloads;
+    void operator()(uint8_t type, const uint8_t* payload, size_t length) {
+        TEST_ASSERT_EQUAL_UINT8(USB_FRAME_MESSAGE, type);
+        payloads.push_back(std::string((const char*)payload, length));
+    }
+};
+
+static std::string frame(const std::string& payload) {
+    uint8_t header[USB_FRAME_HEADER_BYTES];
+    encodeUsbHeader(header, USB_FRAME_MESSAGE, (const uint8_t*)payload.data(), payload.size());
+    return std::string((const char*)header, sizeof(header)) + payload;
+}
+
+static void feed(UsbDeframer<1024>& deframer, const std::string& bytes, Received& received) {
+    deframer.feed((const uint8_t*)bytes.data(), bytes.size(), received);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_crc_matches_the_standard_check_value() {
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, usbCrc32(0, (const uint8_t*)"123456789", 9));
+    // In pieces
+    uint32_t crc = usbCrc32(0, (const uint8_t*)"1234", 4);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, usbCrc32(crc, (const uint8_t*)"56789", 5));
+}
+
+// Same bytes as encode_frame('{"ping":true}') in backend/serial_ingest.py
+void test_header_layout_matches_the_backend() {
+    const uint8_t expected[] = { 0xA5, 0x5A, 0x01, 0x00, 0x0D, 0x00, 0xD1, 0x5A, 0x8C, 0xD2 };
+    std::string bytes = frame("{\"ping\":true}");
+    TEST_ASSERT_EQUAL(USB_FRAME_HEADER_BYTES + 13, bytes.size());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, (const uint8_t*)bytes.data(), sizeof(expected));
+}
+
+void test_frames_split_anywhere_come_out_whole() {
+    std::string stream;
+    std::vector<std::string> sent;
+    for (int i = 0; i < 20; ++i) {
+        std::string payload = "{\"cmd\":\"rate\",\"value\":" + std::to_string(i * 37) + "}";
+        sent.push_back(payload);
+        stream += frame(payload);
+    }
+    sent.push_back("");
+    stream += frame("");
+
+    for (size_t chunk : { (size_t)1, (size_t)3, (size_t)64, stream.size() }) {
+        UsbDeframer<1024> deframer;
+        Received received;
+        for (size_t p = 0; p < stream.size(); p += chunk) {
+            feed(deframer, stream.substr(p, chunk), received);
+        }
+        TEST_ASSERT_EQUAL(sent.size(), received.payloads.size());
+        for (size_t i = 0; i < sent.size(); ++i) {
+            TEST_ASSERT_TRUE(received.payloads[i] == sent[i]);
+        }
+        TEST_ASSERT_EQUAL(0, deframer.stats().skippedBytes);
+    }
+}
+
+// Log lines between frames, including a byte that looks like half a sync word
+void test_text_between_frames_is_skipped() {
+    std::string log = "Backend commanded: START\r\n\xA5 stray\n";
+    std::string stream = log + frame("{\"command\":\"start\"}") + log + frame("{\"ping\":true}") + "\xA5";
+    UsbDeframer<1024> deframer;
+    Received received;
+    feed(deframer, stream, received);
+    TEST_ASSERT_EQUAL(2, received.payloads.size());
+    TEST_ASSERT_TRUE(received.payloads[1] == "{\"ping\":true}");
+    TEST_ASSERT_EQUAL(2 * log.size(), deframer.stats().skippedBytes);
+
+    // The trailing 0xA5 is kept as the start of a possible frame
+    feed(deframer, "\x5A", received);
+    feed(deframer, frame("{}"), received);
+    TEST_ASSERT_EQUAL(3, received.payloads.size());
+    TEST_ASSERT_EQUAL(1, deframer.stats().crcErrors + deframer.stats().oversize);
+}
+
+// A corrupted frame is dropped and the next one is still found, even when
+// the corruption hits the length field
+void test_corrupted_frames_are_dropped_and_the_stream_resyncs() {
+    std::string good = frame("{\"command\":\"stop\"}");
+    std::string badPayload = frame("{\"command\":\"start\"}");
+    badPayload[USB_FRAME_HEADER_BYTES + 3] ^= 0x04;
+    std::string badLength = frame("{\"command\":\"tare\"}");
+    badLength[4] = (char)0xF0;  // Claims 240 bytes, swallowing what follows
+
+    UsbDeframer<1024> deframer;
+    Received received;
+    feed(deframer, badPayload + good + badLength + good + good, received);
+    TEST_ASSERT_EQUAL(1, received.payloads.size());
+    TEST_ASSERT_EQUAL(1, deframer.stats().crcErrors);
+    // The frames behind the bad length wait for 240 bytes; more traffic
+    // completes the bogus frame, which fails its CRC and releases them
+    std::string traffic;
+    for (int i = 0; i < 12; ++i) {
+        traffic += frame("{\"ping\":true}");
+    }
+    feed(deframer, traffic, received);
+    TEST_ASSERT_EQUAL(2, deframer.stats().crcErrors);
+    TEST_ASSERT_EQUAL(3 + 12, received.payloads.size());
+    TEST_ASSERT_TRUE(received.payloads[0] == "{\"command\":\"stop\"}");
+    TEST_ASSERT_TRUE(received.payloads[1] == "{\"command\":\"stop\"}");
+    TEST_ASSERT_TRUE(received.payloads[2] == "{\"command\":\"stop\"}");
+}
+
+void test_oversize_frames_are_refused() {
+    std::string big(2000, 'x');
+    UsbDeframer<1024> deframer;
+    Received received;
+    feed(deframer, frame(big) + frame("{\"ping\":true}"), received);
+    TEST_ASSERT_EQUAL(1, received.payloads.size());
+    TEST_ASSERT_TRUE(deframer.stats().oversize >= 1);
+}
+
+// ----------------------------------------------------------------------------
+// FrameWriter with USB framing over a port that takes a few bytes at a time
+// ----------------------------------------------------------------------------
+
+struct FakePort {
+    std::string wire;
+    size_t room = 0;
+    uint64_t now = 0;
+
+    int write(const uint8_t* data, size_t length) {
+        size_t taken = length < room ? length : room;
+        wire.append((const char*)data, taken);
+        room -= taken;
+        return (int)taken;
+    }
+    uint64_t nowUs() { return now; }
+};
+
+void test_writer_frames_messages_for_the_port() {
+    FakePort port;
+    FrameWriter<FakePort, UsbFraming> writer(port);
+    std::vector<uint8_t> slot(FRAME_HEADER_BYTES + 600);
+    std::vector<std::string> sent;
+    for (int i = 0; i < 5; ++i) {
+        std::string payload = "{\"t0\":" + std::to_string(1000000 + i) + ",\"samples\":[" +
+                              std::string(100 * i, ' ') + "]}";
+        memcpy(slot.data() + FRAME_HEADER_BYTES, payload.data(), payload.size());
+        writer.start(slot.data() + FRAME_HEADER_BYTES, payload.size());
+        while (writer.busy()) {
+            port.room = 64;     // One USB packet per pass
+            port.now += 1000;
+            TEST_ASSERT_NOT_EQUAL(FrameWrite_Failed, writer.service());
+        }
+        sent.push_back(payload);
+    }
+    UsbDeframer<1024> deframer;
+    Received received;
+    deframer.feed((const uint8_t*)port.wire.data(), port.wire.size(), received);
+    TEST_ASSERT_EQUAL(sent.size(), received.payloads.size());
+    for (size_t i = 0; i < sent.size(); ++i) {
+        TEST_ASSERT_TRUE(received.payloads[i] == sent[i]);
+    }
+    TEST_ASSERT_EQUAL(5, writer.stats().frames);
+}
+
+// CRC and deframing cost per byte, against a 1 MB/s full-speed CDC link
+void test_deframer_throughput() {
+    std::string payload = "{\"t0\":123456789012,\"ch\":2,\"samples\":[";
+    while (payload.size() < 13000) {
+        payload += "{\"dt\":1000,\"v\":[-12345.5,67890.25]},";
+    }
+    payload += "{}]}";
+    std::string stream;
+    for (int i = 0; i < 8; ++i) {
+        stream += "log line\n" + frame(payload);
+    }
+
+    static UsbDeframer<16384> deframer;
+    size_t frames = 0;
+    auto count = [&](uint8_t, const uint8_t*, size_t) { frames++; };
+    const int rounds = 40;
+    auto started = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t p = 0; p < stream.size(); p += 512) {
+            size_t chunk = stream.size() - p < 512 ? stream.size() - p : 512;
+            deframer.feed((const uint8_t*)stream.data() + p, chunk, count);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    TEST_ASSERT_EQUAL(8 * rounds, frames);
+    TEST_ASSERT_EQUAL(0, deframer.stats().crcErrors);
+
+    char line[160];
+    snprintf(line, sizeof(line), "deframed %zu frames of %zu bytes at %.0f MB/s (host)",
+             frames, payload.size(), stream.size() * rounds / seconds / 1e6);
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_matches_the_standard_check_value);
+    RUN_TEST(test_header_layout_matches_the_backend);
+    RUN_TEST(test_frames_split_anywhere_come_out_whole);
+    RUN_TEST(test_text_between_frames_is_skipped);
+    RUN_TEST(test_corrupted_frames_are_dropped_and_the_stream_resyncs);
+    RUN_TEST(test_oversize_frames_are_refused);
+    RUN_TEST(test_writer_frames_messages_for_the_port);
+    RUN_TEST(test_deframer_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,255 @@
+"""IMTP analysis: peak force, force/RFD/impulse at 50-250 ms, time to peak.
+
+The Flutter app's results screens show these metrics (lib/services/
+session_results.dart); they run once per session, on the backend, with
+NumPy. Nothing loops over samples in Python:
+- force at a time is a binary search over the sample times
+- impulse up to a time is a lookup in a cumulative sum
+
+Time is measured from the session's first sample, using the ESP32 conversion
+time (t_us). Force is left + right in the units recorded: tared ADC counts
+summed per plate, not newtons (the firmware converts only for its trigger).
+The app's charts get their samples on the same time base (chart_samples).
+
+During a test RunningMetrics updates the same metrics batch by batch. At
+stop_test the session's arrays are analysed in full, and the summary is saved
+next to the CSV as <name>.summary.json, so opening the results later only
+reads that file.
+"""
+import csv
+import json
+import os
+import threading
+from datetime import datetime
+
+import numpy as np
+
+import archive
+
+WINDOWS_MS = (50, 100, 150, 200, 250)
+SUMMARY_SUFFIX = '.summary.json'
+
+
+def force_at(t, force, seconds):
+    """Force of the first sample at or after `seconds`, else the last sample"""
+    index = np.searchsorted(t, seconds, side='left')
+    return float(force[min(index, len(force) - 1)])
+
+
+def impulse_table(t, force):
+    """Cumulative impulse after each sample (force units * s), rectangle
+    rule: each sample counts for the time since the previous one"""
+    return np.cumsum(force * np.diff(t, prepend=0.0))
+
+
+def impulse_at(t, cumulative, seconds):
+    """Impulse over the samples at or before `seconds`"""
+    index = np.searchsorted(t, seconds, side='right') - 1
+    return float(cumulative[index]) if index >= 0 else 0.0
+
+
+def analyze(t, left, right, positive_only=False):
+    """Metrics for one session; t in seconds from the first sample.
+
+    With positive_only, negative sensor readings count as zero (the results
+    screen's "positive values only" view)."""
+    t = np.asarray(t, dtype=np.float64)
+    left = np.asarray(left, dtype=np.float64)
+    right = np.asarray(right, dtype=np.float64)
+    if len(t) == 0:
+        return None
+    if positive_only:
+        left = np.maximum(left, 0.0)
+        right = np.maximum(right, 0.0)
+    total = left + right
+
+    peak_index = int(np.argmax(total))
+    peak = float(total[peak_index])
+    left_peak = float(left.max())
+    right_peak = float(right.max())
+    cumulative = impulse_table(t, total)
+
+    forces = {str(ms): force_at(t, total, ms / 1000.0) for ms in WINDOWS_MS}
+    return {
+        'peak_force': peak,
+        'left_peak_force': left_peak,
+        'right_peak_force': right_peak,
+        'force_ms': forces,
+        'force_percent': {ms: (f / peak * 100.0 if peak else 0.0) for ms, f in forces.items()},
+        'rfd': {ms: f / (int(ms) / 1000.0) for ms, f in forces.items()},
+        'impulse': {str(ms): impulse_at(t, cumulative, ms / 1000.0) for ms in WINDOWS_MS},
+        'time_to_peak': float(t[peak_index]) if peak > 0 else 0.0,
+        'test_duration': float(t[-1]),
+        'asymmetry': (left_peak - right_peak) / peak * 100.0 if peak else 0.0,
+    }
+
+
+def summarize(filename, t, left, right):
+    """Session summary: both the raw and the positive-only metrics"""
+    t = np.asarray(t, dtype=np.float64)
+    rate = (len(t) - 1) / t[-1] if len(t) > 1 and t[-1] > 0 else 0.0
+    return {
+        'filename': filename,
+        'sample_count': int(len(t)),
+        'sample_rate_hz': round(float(rate), 1),
+        'metrics': analyze(t, left, right),
+        'metrics_positive': analyze(t, left, right, positive_only=True),
+        'computed_at': datetime.now().isoformat(),
+    }
+
+
+def load_session_csv(path):
+    """Read (t, left, right) from a session CSV, plain or archived; t in
+    seconds from the first sample. Older files without esp32_time_us fall
+    back to the millisecond ESP32 time."""
+    with archive.open_text(path) as f:
+        header = next(csv.reader([f.readline()]), [])
+        columns = {name: i for i, name in enumerate(header)}
+        time_column = columns.get('esp32_time_us', columns.get('esp32_time_ms'))
+        if time_column is None or 'left_sensor' not in columns or 'right_sensor' not in columns:
+            return np.empty(0), np.empty(0), np.empty(0)
+
+        data = np.genfromtxt(f, delimiter=',', dtype=np.float64,
+                             usecols=(columns['left_sensor'], columns['right_sensor'], time_column,
+                                      columns.get('esp32_time_ms', time_column)))
+    data = np.atleast_2d(data)
+    if data.size == 0:
+        return np.empty(0), np.empty(0), np.empty(0)
+
+    if header[time_column] == 'esp32_time_us' and not np.isnan(data[:, 2]).any():
+        t_us = data[:, 2]
+    else:
+        t_us = data[:, 3] * 1000.0
+    return (t_us - t_us[0]) / 1e6, data[:, 0], data[:, 1]
+
+
+def chart_samples(t, left, right, points=None):
+    """A session's samples for a chart, on the summary's time base, as
+    {'t', 'left', 'right', 'total'}. With `points`, sessions longer than
+    that are cut into `points` equal runs of samples, each given as its min
+    and max per series at the time of its first sample (as LodSeries in the
+    app draws them), so the chart keeps every peak."""
+    t = np.asarray(t, dtype=np.float64)
+    left = np.asarray(left, dtype=np.float64)
+    right = np.asarray(right, dtype=np.float64)
+    series = {'t': t, 'left': left, 'right': right, 'total': left + right}
+    if points is not None and len(t) > 2 * points:
+        starts = np.linspace(0, len(t), points, endpoint=False).astype(np.int64)
+        reduced = {'t': np.repeat(t[starts], 2)}
+        for name in ('left', 'right', 'total'):
+            values = np.empty(2 * points)
+            values[0::2] = np.minimum.reduceat(series[name], starts)
+            values[1::2] = np.maximum.reduceat(series[name], starts)
+            reduced[name] = values
+        series = reduced
+    # Microseconds and hundredths of a count keep the JSON short
+    return {name: np.round(values, 6 if name == 't' else 2).tolist() for name, values in series.items()}
+
+
+def summary_path(csv_path):
+    return os.path.splitext(csv_path)[0] + SUMMARY_SUFFIX
+
+
+def save_summary(csv_path, summary):
+    # Written to a temporary file first so readers never see half a summary
+    path = summary_path(csv_path)
+    with open(path + '.tmp', 'w') as f:
+        json.dump(summary, f)
+    os.replace(path + '.tmp', path)
+
+
+def stored_summary(csv_path):
+    """Summary saved for a session CSV, or None if there is none yet"""
+    path = summary_path(csv_path)
+    if not os.path.exists(path):
+        return None
+    with open(path) as f:
+        return json.load(f)
+
+
+def load_summary(csv_path):
+    """Stored summary for a session CSV, computed and stored on first use for
+    sessions recorded before summaries existed; None if the CSV is missing"""
+    summary = stored_summary(csv_path)
+    if summary is not None:
+        return summary
+    path = archive.locate(csv_path)
+    if path is None:
+        return None
+    t, left, right = load_session_csv(path)
+    summary = summarize(os.path.basename(csv_path), t, left, right)
+    save_summary(csv_path, summary)
+    return summary
+
+
+class RunningMetrics:
+    """Metrics of the test in progress, updated per sample batch.
+
+    Peak, time to peak and impulse are kept as running values. Each window's
+    force is fixed by the first batch that reaches it. Batches are also kept
+    as arrays, so stop_test can analyse the whole session without reading
+    the CSV back. Batches arrive from the WebSocket and UDP threads."""
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self.reset()
+
+    def reset(self):
+        with self._lock:
+            self._chunks = []
+            self._t0_us = None
+            self._last_t = 0.0
+            self._count = 0
+            self._peak = 0.0
+            self._time_to_peak = 0.0
+            self._impulse = 0.0
+            self._current = 0.0
+            self._forces = {}
+
+    def add(self, t_us, left, right):
+        """Append one batch; t_us are ESP32 conversion times in microseconds"""
+        t_us = np.asarray(t_us, dtype=np.float64)
+        if len(t_us) == 0:
+            return
+        left = np.asarray(left, dtype=np.float64)
+        right = np.asarray(right, dtype=np.float64)
+        with self._lock:
+            if self._t0_us is None:
+                self._t0_us = t_us[0]
+            t = (t_us - self._t0_us) / 1e6
+            total = left + right
+
+            index = int(np.argmax(total))
+            if total[index] > self._peak:
+                self._peak = float(total[index])
+                self._time_to_peak = float(t[index])
+            self._impulse += float(np.dot(total, np.diff(t, prepend=self._last_t)))
+            for ms in WINDOWS_MS:
+                key = str(ms)
+                if key not in self._forces and t[-1] >= ms / 1000.0:
+                    self._forces[key] = force_at(t, total, ms / 1000.0)
+
+            self._last_t = float(t[-1])
+            self._count += len(t)
+            self._current = float(total[-1])
+            self._chunks.append((t, left, right))
+
+    def snapshot(self):
+        with self._lock:
+            return {
+                'sample_count': self._count,
+                'elapsed': self._last_t,
+                'current_force': self._current,
+                'peak_force': self._peak,
+                'time_to_peak': self._time_to_peak,
+                'impulse': self._impulse,
+                'force_ms': dict(self._forces),
+                'rfd': {ms: f / (int(ms) / 1000.0) for ms, f in self._forces.items()},
+            }
+
+    def arrays(self):
+        """The whole session so far as (t, left, right)"""
+        with self._lock:
+            if not self._chunks:
+                return np.empty(0), np.empty(0), np.empty(0)
+            return tuple(np.concatenate(column) for column in zip(*self._chunks))
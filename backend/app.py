@@ -1,14 +1,22 @@
 import os
 import json
+import atexit
 import time
 import threading
+import functools
 import csv
 from datetime import datetime
-from flask import Flask, request, jsonify, render_template, send_file
+from flask import Flask, request, jsonify, render_template, send_file, Response, stream_with_context
 
 from flask_sock import Sock
 from flask_cors import CORS
 import logging
+from udp_ingest import UdpIngestServer
+from serial_ingest import SerialIngest, DEFAULT_PORTS
+from ingest_workers import IngestPool, SAMPLE_FRAME_PREFIXES, expand_sample_timestamps, derive_plate_sides
+import analysis
+import archive
+from catalog import SessionCatalog, MAX_PAGE_SIZE
 
 # Set up logging
 logging.basicConfig(level=logging.INFO)
@@ -56,10 +64,47 @@ latest_readings = {
     'timestamp': None
 }
 
+# Latest telemetry report from the ESP32 (rate, gain, tare, heap statistics)
+latest_telemetry = {}
+
+# After a start command the ESP32 reports the time from receiving it to the
+# first sample; start_test waits this long for the report
+START_REPORT_TIMEOUT = 1.0
+start_report = threading.Event()
+start_latency_us = None
+start_reported_at = None
+
+# UDP sample transport (ESP32 'transport' command, value 1); NACKs go back
+# over the ESP32 WebSocket
+UDP_PORT = int(os.environ.get('UDP_PORT', 5005))
+udp_server = None
+
+# USB serial transport (serial_ingest.py): ESP32s plugged in over USB are
+# served like WebSocket clients. SERIAL_PORTS is 'auto' (native USB CDC
+# ports of ESP32 boards), a comma-separated list of ports or patterns, or
+# 'off'
+SERIAL_PORTS = os.environ.get('SERIAL_PORTS', 'auto')
+serial_ingest = None
+
+# Sample decode and CSV writing run in worker processes (ingest_workers.py);
+# INGEST_WORKERS=0 keeps them in the request threads
+INGEST_WORKERS = int(os.environ.get('INGEST_WORKERS', min(4, os.cpu_count() or 1)))
+ingest_pool = None
+device_by_addr = {}  # ESP32 IP address -> device id, to route its UDP datagrams
+
 # Data storage
 DATA_FOLDER = 'test_data'
 current_csv_file = None
 
+# IMTP metrics of the test in progress; a summary is stored per session at stop
+running_metrics = analysis.RunningMetrics()
+
+# SQLite catalog of recorded sessions (athlete, device, counts, peak force)
+CATALOG_DB = os.environ.get('CATALOG_DB', os.path.join(DATA_FOLDER, 'catalog.db'))
+session_catalog = None
+_catalog_lock = threading.Lock()
+esp_device = None  # Device id of the connected ESP32, recorded with each session
+
 def ensure_data_folder():
     """Ensure the data folder exists"""
     if not os.path.exists(DATA_FOLDER):
@@ -78,7 +123,8 @@ def create_csv_file():
     # Create CSV with headers
     with open(current_csv_file, 'w', newline='') as csvfile:
         writer = csv.writer(csvfile)
-        writer.writerow(['timestamp', 'left_sensor', 'right_sensor', 'esp32_time_ms'])
+        writer.writerow(['timestamp', 'left_sensor', 'right_sensor', 'esp32_time_ms', 'esp32_time_us',
+                         'channels'])
     
     logger.info(f"Created CSV file: {current_csv_file}")
     return current_csv_file
@@ -95,31 +141,43 @@ def save_to_csv(sample_data):
                     precise_timestamp,
                     sample_data.get('left', 0),
                     sample_data.get('right', 0),
-                    sample_data.get('esp32_time', sample_data.get('t', 0))  # ESP32 internal time
+                    sample_data.get('esp32_time', sample_data.get('t', 0)),  # ESP32 internal time
+                    sample_data.get('t_us', ''),  # Conversion time in microseconds
+                    ';'.join(str(v) for v in sample_data.get('channels', []))  # Every ADS1220
                 ])
         except Exception as e:
             logger.error(f"Error saving to CSV: {e}")
 
-def get_csv_files():
-    """Get list of all CSV test files"""
-    ensure_data_folder()
+def get_catalog():
+    """Session catalog, opened on first use; CSV files not in it yet are
+    imported then (one folder scan per server start)"""
+    global session_catalog
+    with _catalog_lock:
+        if session_catalog is None:
+            ensure_data_folder()
+            session_catalog = SessionCatalog(CATALOG_DB)
+            session_catalog.import_folder(DATA_FOLDER, analysis.stored_summary)
+        return session_catalog
+
+def get_csv_files(limit=None, offset=0):
+    """Get the newest CSV test files from the session catalog; every file
+    unless limit is given"""
     try:
-        files = []
-        for filename in os.listdir(DATA_FOLDER):
-            if filename.endswith('.csv'):
-                filepath = os.path.join(DATA_FOLDER, filename)
-                stat = os.stat(filepath)
-                files.append({
-                    'filename': filename,
-                    'filepath': filepath,
-                    'size': stat.st_size,
-                    'created': datetime.fromtimestamp(stat.st_ctime).isoformat(),
-                    'modified': datetime.fromtimestamp(stat.st_mtime).isoformat()
-                })
-        return sorted(files, key=lambda x: x['created'], reverse=True)
+        sessions, total = get_catalog().list_sessions(per_page=limit, offset=offset)
+        files = [{
+            'filename': s['filename'],
+            'filepath': os.path.join(DATA_FOLDER, s['filename']),
+            'size': s['size_bytes'],
+            'created': s['started_at'],
+            'modified': s['stopped_at'] or s['started_at'],
+            'athlete': s['athlete'],
+            'sample_count': s['sample_count'],
+            'peak_force': s['peak_force']
+        } for s in sessions]
+        return files, total
     except Exception as e:
-        logger.error(f"Error reading CSV files: {e}")
-        return []
+        logger.error(f"Error reading session catalog: {e}")
+        return [], 0
 
 @app.route('/')
 def index():
@@ -137,17 +195,15 @@ def get_status():
             'flutter': len(flutter_clients)
         },
         'latest_readings': latest_readings,
-        'session_sample_count': len(current_session_data)
+        'session_sample_count': sample_counter,
+        'ingest': ingest_pool.status() if ingest_pool else None,
+        'serial': serial_ingest.status() if serial_ingest else None
     })
 
-@app.route('/api/start_test', methods=['POST'])
-def start_test():
-    """Start a new test session"""
+def begin_recording(athlete=None):
+    """Start recording a session to a new CSV file; returns the file path"""
     global is_testing, current_session_data, session_start_time, sample_counter
     
-    if len(esp_clients) == 0:
-        return jsonify({'error': 'No ESP32 device connected'}), 400
-    
     is_testing = True
     current_session_data = []
     session_start_time = datetime.now()
@@ -158,43 +214,59 @@ def start_test():
     
     # Create new CSV file for this test session
     csv_file = create_csv_file()
+    running_metrics.reset()
+    if ingest_pool and esp_device:
+        ingest_pool.start_session(esp_device, csv_file)
+    try:
+        get_catalog().begin_session(os.path.basename(csv_file), session_start_time, athlete, esp_device)
+    except Exception as e:
+        logger.error(f"Error adding session to catalog: {e}")
     
-    # Send start command to ESP32 devices via Raw WebSocket
-    send_command_to_esp32('start')
-    
-    logger.info(f"Test started via API - CSV file: {csv_file}")
     print(f"\n=== LOAD CELL TEST STARTED ===")
     print(f"Start Time: {session_start_time.strftime('%Y-%m-%d %H:%M:%S')}")
     print(f"CSV File: {os.path.basename(csv_file)}")
     print("=====================================\n")
-    
-    # Note: WebSocket clients get data automatically via raw WebSocket
-    
-    return jsonify({
-        'message': 'Test started successfully', 
-        'status': 'started',
-        'csv_file': os.path.basename(csv_file)
-    })
+    return csv_file
 
-@app.route('/api/stop_test', methods=['POST'])
-def stop_test():
-    """Stop the current test session"""
-    global is_testing, session_start_time
-    
-    if len(esp_clients) == 0:
-        return jsonify({'error': 'No ESP32 device connected'}), 400
+def end_recording():
+    """Stop recording the current session; returns its analysis summary"""
+    global is_testing
     
     is_testing = False
     
+    # The worker closes the file once every sample before the stop is written;
+    # until it confirms, it may still be appending, so the CSV is not archived
+    closed = True
+    if ingest_pool and esp_device and current_csv_file:
+        on_late = functools.partial(archive_late_session, current_csv_file)
+        if ingest_pool.stop_session(esp_device, on_late=on_late) is None:
+            closed = False
+            logger.error("Ingest worker did not confirm the end of the session; "
+                         "archiving it once the worker does")
+    
+    # Analyse the whole session from memory and store the summary next to the CSV
+    summary = None
+    if current_csv_file:
+        try:
+            summary = analysis.summarize(os.path.basename(current_csv_file), *running_metrics.arrays())
+            analysis.save_summary(current_csv_file, summary)
+        except Exception as e:
+            logger.error(f"Error analysing session: {e}")
+        try:
+            metrics = (summary or {}).get('metrics') or {}
+            get_catalog().finish_session(os.path.basename(current_csv_file), datetime.now(), sample_counter,
+                                         metrics.get('peak_force'), os.path.getsize(current_csv_file))
+        except Exception as e:
+            logger.error(f"Error updating session catalog: {e}")
+        # Compress the closed session off the request thread
+        if closed:
+            threading.Thread(target=archive_closed_session, args=(current_csv_file,), daemon=True).start()
+    
     # Enable quiet mode when testing stops (suppress status/reading logs)
     set_quiet_mode(True)
     
-    # Send stop command to ESP32 devices via Raw WebSocket
-    send_command_to_esp32('stop')
-    
     # Show final session info
     if session_start_time:
-        from datetime import datetime
         session_end_time = datetime.now()
         duration = session_end_time - session_start_time
         
@@ -205,16 +277,89 @@ def stop_test():
         if current_csv_file:
             print(f"CSV File: {os.path.basename(current_csv_file)}")
         print("===============================\n")
+    return summary
+
+def archive_late_session(csv_path, recorded):
+    """The worker confirmed a stop after end_recording gave up waiting"""
+    logger.info(f"Ingest worker closed {os.path.basename(csv_path)} ({recorded} samples); archiving it")
+    threading.Thread(target=archive_closed_session, args=(csv_path,), daemon=True).start()
+
+def archive_leftover_sessions():
+    """Archive session CSVs left uncompressed by an earlier run (a worker
+    that never confirmed its stop, or a server stopped mid-archive). Nothing
+    is recording at startup, so every one of them is closed."""
+    ensure_data_folder()
+    for name in sorted(os.listdir(DATA_FOLDER)):
+        path = os.path.join(DATA_FOLDER, name)
+        if is_testing and path == current_csv_file:
+            continue
+        if name.endswith('.csv') and not os.path.exists(path + archive.ARCHIVE_SUFFIX):
+            archive_closed_session(path)
+
+def archive_closed_session(csv_path):
+    """Replace a closed session's CSV with its zstd archive"""
+    archive.archive_session(csv_path)
+    path = archive.locate(csv_path)
+    if path and archive.is_archived(path):
+        try:
+            get_catalog().set_size(os.path.basename(csv_path), os.path.getsize(path))
+        except Exception as e:
+            logger.error(f"Error updating session catalog: {e}")
+
+@app.route('/api/start_test', methods=['POST'])
+def start_test():
+    """Start a new test session"""
+    if len(esp_clients) == 0:
+        return jsonify({'error': 'No ESP32 device connected'}), 400
     
-    logger.info(f"Test stopped via API - Samples collected: {len(current_session_data)}")
+    # Optional {"athlete": "..."} body, recorded in the session catalog
+    body = request.get_json(silent=True) or {}
+    csv_file = begin_recording(body.get('athlete'))
+    
+    # Send start command to ESP32 devices via Raw WebSocket
+    start_report.clear()
+    sent_at = time.monotonic()
+    send_command_to_esp32('start')
+    
+    logger.info(f"Test started via API - CSV file: {csv_file}")
+    
+    # Note: WebSocket clients get data automatically via raw WebSocket
+
+    # Device latency (command received to first sample) and the round trip
+    # from sending the command to the report; None if no report came
+    reported = start_report.wait(START_REPORT_TIMEOUT)
+    if reported:
+        logger.info(f"ESP32 first sample {start_latency_us} us after the start command")
+    
+    return jsonify({
+        'message': 'Test started successfully', 
+        'status': 'started',
+        'csv_file': os.path.basename(csv_file),
+        'start_latency_us': start_latency_us if reported else None,
+        'start_round_trip_ms': round((start_reported_at - sent_at) * 1000, 1) if reported else None
+    })
+
+@app.route('/api/stop_test', methods=['POST'])
+def stop_test():
+    """Stop the current test session"""
+    if len(esp_clients) == 0:
+        return jsonify({'error': 'No ESP32 device connected'}), 400
+    
+    summary = end_recording()
+    
+    # Send stop command to ESP32 devices via Raw WebSocket
+    send_command_to_esp32('stop')
+    
+    logger.info(f"Test stopped via API - Samples collected: {sample_counter}")
     
     # Note: WebSocket clients get updates automatically via raw WebSocket
     
     return jsonify({
         'message': 'Test stopped successfully', 
         'status': 'stopped',
-        'sample_count': len(current_session_data),
-        'csv_file': os.path.basename(current_csv_file) if current_csv_file else None
+        'sample_count': sample_counter,
+        'csv_file': os.path.basename(current_csv_file) if current_csv_file else None,
+        'summary': summary
     })
 
 @app.route('/api/session_data')
@@ -222,7 +367,7 @@ def get_session_data():
     """Get current session data"""
     return jsonify({
         'is_testing': is_testing,
-        'sample_count': len(current_session_data),
+        'sample_count': sample_counter,
         'data': current_session_data[-100:] if len(current_session_data) > 100 else current_session_data
     })
 
@@ -271,26 +416,124 @@ def get_raw_data_csv():
         return csv_data, 200, {'Content-Type': 'text/plain'}
     return "No data available", 404
 
+@app.route('/api/live_metrics')
+def get_live_metrics():
+    """IMTP metrics of the test in progress, updated as samples arrive"""
+    return jsonify({'is_testing': is_testing, **running_metrics.snapshot()})
+
+@app.route('/api/sessions/<filename>/summary')
+def get_session_summary(filename):
+    """Stored analysis summary of a session (computed once for older sessions)"""
+    filepath = os.path.join(DATA_FOLDER, os.path.basename(filename))
+    if not filename.endswith('.csv'):
+        return jsonify({'error': 'File not found'}), 404
+    try:
+        summary = analysis.load_summary(filepath)
+    except Exception as e:
+        logger.error(f"Error analysing {filename}: {e}")
+        return jsonify({'error': f'Failed to analyse session: {e}'}), 500
+    if summary is None:
+        return jsonify({'error': 'File not found'}), 404
+    return jsonify(summary)
+
+@app.route('/api/sessions/<filename>/samples')
+def get_session_samples(filename):
+    """A session's samples for charts, time in seconds from its first sample
+    as in the summary (?points= reduces them to min/max pairs)"""
+    filepath = os.path.join(DATA_FOLDER, os.path.basename(filename))
+    if not filename.endswith('.csv'):
+        return jsonify({'error': 'File not found'}), 404
+    try:
+        points = request.args.get('points')
+        points = int(points) if points is not None else None
+        if points is not None and points < 1:
+            raise ValueError(points)
+    except ValueError:
+        return jsonify({'error': 'points must be a positive integer'}), 400
+    path = archive.locate(filepath)
+    if path is None:
+        return jsonify({'error': 'File not found'}), 404
+    try:
+        samples = analysis.chart_samples(*analysis.load_session_csv(path), points=points)
+    except Exception as e:
+        logger.error(f"Error reading {filename}: {e}")
+        return jsonify({'error': f'Failed to read session: {e}'}), 500
+    return jsonify(samples)
+
 @app.route('/api/csv_files')
 def get_csv_files_api():
-    """Get list of CSV files"""
-    return jsonify({'files': get_csv_files()})
+    """Get the newest CSV files (?limit=, default all, at most 500, and ?offset=)"""
+    try:
+        limit = request.args.get('limit')
+        limit = int(limit) if limit is not None else None
+        offset = int(request.args.get('offset', 0))
+    except ValueError:
+        return jsonify({'error': 'limit and offset must be integers'}), 400
+    if (limit is not None and limit < 1) or offset < 0:
+        return jsonify({'error': 'limit must be positive and offset not negative'}), 400
+    files, total = get_csv_files(limit, offset)
+    return jsonify({'files': files, 'total': total})
+
+@app.route('/api/sessions')
+def list_sessions_api():
+    """Paginated session catalog, newest first. Filters: athlete, device,
+    from/to (ISO dates, to inclusive); paging: page, per_page (max 500)"""
+    try:
+        page = max(1, int(request.args.get('page', 1)))
+        per_page = max(1, min(int(request.args.get('per_page', 50)), MAX_PAGE_SIZE))
+    except ValueError:
+        return jsonify({'error': 'page and per_page must be integers'}), 400
+    sessions, total = get_catalog().list_sessions(
+        athlete=request.args.get('athlete'),
+        device=request.args.get('device'),
+        date_from=request.args.get('from'),
+        date_to=request.args.get('to'),
+        page=page,
+        per_page=per_page)
+    return jsonify({
+        'sessions': sessions,
+        'total': total,
+        'page': page,
+        'per_page': per_page
+    })
+
+@app.route('/api/athletes')
+def list_athletes_api():
+    """Athletes in the session catalog with their session counts"""
+    return jsonify({'athletes': get_catalog().athletes()})
 
 @app.route('/api/download/<filename>')
 def download_csv(filename):
-    """Download a specific CSV file"""
-    filepath = os.path.join(DATA_FOLDER, filename)
-    if os.path.exists(filepath) and filename.endswith('.csv'):
-        return send_file(filepath, as_attachment=True)
-    return jsonify({'error': 'File not found'}), 404
+    """Download a session CSV. Archived sessions are streamed from disk:
+    as stored with Content-Encoding: zstd when the client accepts it,
+    otherwise decompressed on the fly."""
+    path = archive.locate(os.path.join(DATA_FOLDER, os.path.basename(filename)))
+    if path is None or not filename.endswith('.csv'):
+        return jsonify({'error': 'File not found'}), 404
+    if not archive.is_archived(path):
+        return send_file(path, as_attachment=True)
+
+    headers = {
+        'Content-Disposition': f'attachment; filename={os.path.basename(filename)}',
+        'Vary': 'Accept-Encoding'
+    }
+    if archive.accepts_zstd(request.headers.get('Accept-Encoding')):
+        headers['Content-Encoding'] = 'zstd'
+        headers['Content-Length'] = str(os.path.getsize(path))
+        return Response(archive.iter_raw(path), mimetype='text/csv', headers=headers)
+    return Response(stream_with_context(archive.iter_decompressed(path)), mimetype='text/csv', headers=headers)
 
 @app.route('/api/delete/<filename>', methods=['DELETE'])
 def delete_csv(filename):
     """Delete a specific CSV file"""
     filepath = os.path.join(DATA_FOLDER, filename)
-    if os.path.exists(filepath) and filename.endswith('.csv'):
+    path = archive.locate(filepath)
+    if path and filename.endswith('.csv'):
         try:
-            os.remove(filepath)
+            os.remove(path)
+            if os.path.exists(analysis.summary_path(filepath)):
+                os.remove(analysis.summary_path(filepath))
+            get_catalog().remove_session(filename)
             logger.info(f"Deleted CSV file: {filename}")
             return jsonify({'message': f'File {filename} deleted successfully'})
         except Exception as e:
@@ -372,18 +615,27 @@ def disable_simulation():
 @sock.route('/ws')
 def websocket_handler(ws):
     """Handle raw WebSocket connections (optimal for ESP32 and Flutter)"""
+    serve_client(ws, request.remote_addr)
+
+def serve_client(ws, remote_addr):
+    """Message loop of one client: a WebSocket, or an ESP32 on a USB serial
+    port (serial_ingest.SerialLink, remote_addr is the port)"""
     logger.info("WebSocket client connected")
     websocket_clients.add(ws)
     
     client_type = None
+    device = None  # Set when an ESP32 registers; its sample frames go to an ingest worker
     
     try:
         while True:
             message = ws.receive()
             if not message:
                 break
-                
 
+            # Sample frames are decoded by the device's ingest worker
+            if device and isinstance(message, str) and message.startswith(SAMPLE_FRAME_PREFIXES):
+                ingest_pool.submit_frame(device, message)
+                continue
             
             try:
                 data = json.loads(message)
@@ -393,6 +645,11 @@ def websocket_handler(ws):
                     client_type = data['type']
                     if client_type == 'esp32':
                         esp_clients.add(ws)
+                        global esp_device
+                        esp_device = data.get('device') or remote_addr
+                        device_by_addr[remote_addr] = esp_device
+                        if ingest_pool:
+                            device = esp_device
                         logger.info("ESP32 connected - Waiting for frontend to start test")
                         
                         # Don't create CSV file yet - wait for frontend command
@@ -412,6 +669,28 @@ def websocket_handler(ws):
                         logger.info("Flutter connected") 
                         ws.send('{"status":"registered","type":"flutter"}')
                         
+                # Start command to first sample, reported once per start
+                elif 'start_latency_us' in data:
+                    global start_latency_us, start_reported_at
+                    start_latency_us = data['start_latency_us']
+                    start_reported_at = time.monotonic()
+                    start_report.set()
+
+                # Handle telemetry reports from ESP32
+                elif 'telemetry' in data:
+                    global latest_telemetry
+                    latest_telemetry = data['telemetry']
+
+                # Sessions started by apps connected directly to the ESP32;
+                # the backend only archives them
+                elif 'session' in data:
+                    if data['session'] == 'start' and not is_testing:
+                        csv_file = begin_recording()
+                        logger.info(f"Direct-connect session started - CSV file: {csv_file}")
+                    elif data['session'] == 'stop' and is_testing:
+                        end_recording()
+                        logger.info(f"Direct-connect session stopped - Samples collected: {sample_counter}")
+
                 # Handle sensor data from ESP32
                 elif 'samples' in data:
                     handle_esp32_data(data, ws)
@@ -424,7 +703,7 @@ def websocket_handler(ws):
                 elif 'cmd' in data:
                     command = data['cmd']
                     logger.info(f"Command: {command}")
-                    send_command_to_esp32_websocket(command)
+                    send_command_to_esp32_websocket(command, data.get('value'))
                     ws.send(f'{{"command_ack":"{command}","success":true}}')
                     
             except json.JSONDecodeError:
@@ -456,9 +735,12 @@ def websocket_handler(ws):
         
         logger.info("WebSocket cleaned up")
 
-def send_command_to_esp32_websocket(command):
+def send_command_to_esp32_websocket(command, value=None):
     """Send command to ESP32 via Raw WebSocket"""
-    cmd_msg = json.dumps({'command': command})
+    payload = {'command': command}
+    if value is not None:
+        payload['value'] = value
+    cmd_msg = json.dumps(payload)
     
     # Send to ESP32 WebSocket clients
     for client in list(websocket_clients):
@@ -482,13 +764,18 @@ def handle_esp32_data(data, ws):
         if 'samples' in data:
             # Handle batch of samples
             samples = data['samples']
+            expand_sample_timestamps(data)
+            derive_plate_sides(data)
+            recorded_t_us, recorded_left, recorded_right = [], [], []
             
             for sample in samples:
                 # Update latest readings
                 latest_readings = {
                     'left': sample.get('l', 0),
                     'right': sample.get('r', 0),
-                    'timestamp': sample.get('t', int(time.time() * 1000))
+                    'timestamp': sample.get('t', int(time.time() * 1000)),
+                    'esp32_time_us': sample.get('t_us'),
+                    'channels': sample.get('v', [sample.get('l', 0), sample.get('r', 0)])
                 }
                 
                 # Create individual sample data for CSV
@@ -496,7 +783,9 @@ def handle_esp32_data(data, ws):
                     'left': sample.get('l', 0),
                     'right': sample.get('r', 0),
                     't': sample.get('t', 0),  # ESP32 internal timestamp
-                    'esp32_time': sample.get('t', 0)  # Alternative key for consistency
+                    'esp32_time': sample.get('t', 0),  # Alternative key for consistency
+                    't_us': sample.get('t_us', ''),
+                    'channels': latest_readings['channels']
                 }
                 
                 # Only save to CSV and session data when test is running
@@ -504,10 +793,18 @@ def handle_esp32_data(data, ws):
                     save_to_csv(sample_for_csv)
                     current_session_data.append(latest_readings.copy())
                     sample_counter += 1
+                    t_us = sample.get('t_us')
+                    recorded_t_us.append(t_us if t_us is not None else sample.get('t', 0) * 1000)
+                    recorded_left.append(sample_for_csv['left'])
+                    recorded_right.append(sample_for_csv['right'])
                 else:
                     # Just update latest readings for display
                     pass
             
+            # Running IMTP metrics, one vectorized update per batch
+            if recorded_t_us:
+                running_metrics.add(recorded_t_us, recorded_left, recorded_right)
+            
             # Forward to Raw WebSocket Flutter clients ONLY when test is running
             if is_testing:
                 forward_to_websocket_clients(data, exclude_sender=ws)
@@ -529,15 +826,17 @@ def handle_esp32_data(data, ws):
     except Exception as e:
         logger.error(f"Error processing ESP32 data: {e}")
 
-def send_command_to_esp32(command):
+def send_command_to_esp32(command, value=None):
     """Send command to ESP32 via Raw WebSocket"""
-    send_command_to_esp32_websocket(command)
+    send_command_to_esp32_websocket(command, value)
     logger.info(f"Sent command '{command}' to ESP32")
 
 def forward_to_websocket_clients(data, exclude_sender=None):
     """Forward data to WebSocket Flutter clients"""
-    message = json.dumps(data)
-    
+    forward_message_to_websocket_clients(json.dumps(data), exclude_sender)
+
+def forward_message_to_websocket_clients(message, exclude_sender=None):
+    """Send an already serialized frame to WebSocket Flutter clients"""
     for client in list(websocket_clients):
         if client != exclude_sender and client in flutter_clients:
             try:
@@ -555,6 +854,7 @@ def esp32_status():
         'num_connections': len(esp_clients),
         'latest_readings': latest_readings,
         'is_testing': is_testing,
+        'telemetry': latest_telemetry,
         'server_time': int(time.time() * 1000)
     })
 
@@ -566,11 +866,13 @@ def send_esp32_command():
         return jsonify({'error': 'Command is required'}), 400
     
     command = data['command']
-    send_command_to_esp32(command)
+    value = data.get('value')  # e.g. rate in SPS or PGA gain
+    send_command_to_esp32(command, value)
     
     return jsonify({
         'success': True,
         'command': command,
+        'value': value,
         'esp32_connected': len(esp_clients) > 0
     })
 
@@ -828,8 +1130,68 @@ def create_templates():
     with open(index_path, 'w') as f:
         f.write(index_html)
 
+def apply_ingested_batch(device, t_us, left, right, readings, forward, recording):
+    """A batch decoded (and, while recording, written) by an ingest worker;
+    runs on the pool's collector thread. readings holds every sample while
+    recording, else just the last."""
+    global latest_readings, sample_counter
+    latest_readings = readings[-1]
+    if recording:
+        sample_counter += len(t_us)
+        running_metrics.add(t_us, left, right)
+        current_session_data.extend(readings)
+    # Forwarded while the test runs, as in handle_esp32_data
+    if recording and forward:
+        forward_message_to_websocket_clients(forward.decode())
+
+def start_ingest_workers():
+    """Start the ingest worker processes (INGEST_WORKERS, 0 = none)"""
+    global ingest_pool
+    if INGEST_WORKERS <= 0:
+        return
+    ingest_pool = IngestPool(INGEST_WORKERS, apply_ingested_batch,
+                             on_nack=lambda device, seq: send_command_to_esp32_websocket('nack', seq))
+    ingest_pool.start()
+    atexit.register(ingest_pool.shutdown)
+
+def start_udp_ingest():
+    """Start the UDP sample receiver feeding the same path as WebSocket
+    samples; with ingest workers the datagrams are reassembled there"""
+    global udp_server
+    on_datagram = None
+    if ingest_pool:
+        on_datagram = lambda datagram, address: ingest_pool.submit_datagram(
+            device_by_addr.get(address[0], address[0]), datagram)
+    udp_server = UdpIngestServer(
+        UDP_PORT,
+        on_samples=lambda samples: handle_esp32_data({'samples': samples}, None),
+        on_nack=lambda seq: send_command_to_esp32_websocket('nack', seq),
+        on_datagram=on_datagram,
+    )
+    udp_server.start()
+
+def start_serial_ingest():
+    """Start watching serial ports for ESP32s connected over USB"""
+    global serial_ingest
+    if SERIAL_PORTS.lower() in ('', 'off', 'none'):
+        return
+    ports = DEFAULT_PORTS if SERIAL_PORTS == 'auto' else [p.strip() for p in SERIAL_PORTS.split(',') if p.strip()]
+    serial_ingest = SerialIngest(
+        on_device=lambda link: serve_client(link, link.path),
+        ports=ports,
+        on_log=lambda path, line: logger.info(f"ESP32 [{os.path.basename(path)}] {line}"),
+    )
+    serial_ingest.start()
+
 if __name__ == '__main__':
     create_templates()
+
+    # Only in the reloader child, which is the process serving requests
+    if os.environ.get('WERKZEUG_RUN_MAIN') == 'true':
+        start_ingest_workers()
+        start_udp_ingest()
+        start_serial_ingest()
+        threading.Thread(target=archive_leftover_sessions, daemon=True).start()
     
     # Start in quiet mode (suppress repetitive API logs when not testing)
     set_quiet_mode(True)
@@ -837,12 +1199,19 @@ if __name__ == '__main__':
     logger.info("Starting Flask server with Raw WebSocket support...")
     logger.info("Dashboard available at: http://localhost:5000")
     logger.info("Raw WebSocket endpoint: ws://localhost:5000/ws")
+    logger.info(f"UDP sample receiver: udp://0.0.0.0:{UDP_PORT}")
+    logger.info(f"Ingest worker processes: {INGEST_WORKERS}")
+    logger.info(f"USB serial ports: {SERIAL_PORTS}")
     logger.info("API endpoints:")
     logger.info("  GET  /api/status - Get system status")
     logger.info("  POST /api/start_test - Start test session")
     logger.info("  POST /api/stop_test - Stop test session")
     logger.info("  GET  /api/session_data - Get current session data")
     logger.info("  GET  /api/latest_reading - Get latest sensor reading")
+    logger.info("  GET  /api/live_metrics - IMTP metrics of the test in progress")
+    logger.info("  GET  /api/sessions - Session catalog (athlete/device/date filters, paginated)")
+    logger.info("  GET  /api/sessions/<file>/summary - Stored IMTP summary of a session")
+    logger.info("  GET  /api/sessions/<file>/samples - Session samples for charts")
     logger.info("Note: API request logs are suppressed when not testing to reduce noise")
     
     # Use Flask app with Raw WebSocket support
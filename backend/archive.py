@@ -0,0 +1,116 @@
+"""Compressed session archive.
+
+When a session closes its CSV is compressed to <name>.csv.zst and the plain
+file is removed. The archive is a sequence of independent zstd frames, one
+per BLOCK_SIZE bytes of CSV, each recording its content size. Concatenated
+frames are still a standard .zst file (`zstd -d` reads it), and a reader
+never holds more than one block: downloads stream straight from disk,
+either as the compressed bytes (clients sending Accept-Encoding: zstd) or
+decompressed on the fly.
+
+Sessions keep their .csv name everywhere else (catalog, API); locate()
+finds whichever file is on disk.
+"""
+import io
+import logging
+import os
+
+import zstandard
+
+logger = logging.getLogger(__name__)
+
+ARCHIVE_SUFFIX = '.zst'
+BLOCK_SIZE = 1 << 20    # CSV bytes per zstd frame
+LEVEL = 9               # See tools/archive_bench.py
+CHUNK_SIZE = 64 * 1024  # Bytes per streamed response chunk
+
+
+def locate(csv_path):
+    """Path of the session's file on disk: the archive if there is one, else
+    the plain CSV; None if neither exists"""
+    if os.path.exists(csv_path + ARCHIVE_SUFFIX):
+        return csv_path + ARCHIVE_SUFFIX
+    if os.path.exists(csv_path):
+        return csv_path
+    return None
+
+
+def is_archived(path):
+    return path.endswith(ARCHIVE_SUFFIX)
+
+
+def compress_session(csv_path, level=LEVEL, block_size=BLOCK_SIZE):
+    """Compress a closed session CSV into block frames and remove the CSV.
+    Returns (csv bytes, archive bytes)."""
+    archive_path = csv_path + ARCHIVE_SUFFIX
+    compressor = zstandard.ZstdCompressor(level=level, write_content_size=True, write_checksum=True)
+    with open(csv_path, 'rb') as src, open(archive_path + '.tmp', 'wb') as dst:
+        while True:
+            block = src.read(block_size)
+            if not block:
+                break
+            dst.write(compressor.compress(block))
+    # Readers switch to the archive once it is complete
+    os.replace(archive_path + '.tmp', archive_path)
+    original = os.path.getsize(csv_path)
+    os.remove(csv_path)
+    return original, os.path.getsize(archive_path)
+
+
+def archive_session(csv_path):
+    """compress_session for the recorder: logs and swallows errors, leaving
+    the CSV in place"""
+    try:
+        original, compressed = compress_session(csv_path)
+        logger.info(f"Archived {os.path.basename(csv_path)}: {original} -> {compressed} bytes "
+                    f"({original / max(compressed, 1):.1f}x)")
+    except Exception as e:
+        logger.error(f"Error archiving {csv_path}: {e}")
+        if os.path.exists(csv_path + ARCHIVE_SUFFIX + '.tmp'):
+            os.remove(csv_path + ARCHIVE_SUFFIX + '.tmp')
+
+
+def accepts_zstd(accept_encoding):
+    """True if an Accept-Encoding header allows zstd (q=0 refuses it)"""
+    for part in (accept_encoding or '').split(','):
+        fields = [f.strip() for f in part.split(';')]
+        if fields[0].lower() != 'zstd':
+            continue
+        for field in fields[1:]:
+            if field.startswith('q='):
+                try:
+                    return float(field[2:]) > 0
+                except ValueError:
+                    return False
+        return True
+    return False
+
+
+def iter_raw(path, chunk_size=CHUNK_SIZE):
+    """File bytes as stored, chunk by chunk"""
+    with open(path, 'rb') as f:
+        while True:
+            chunk = f.read(chunk_size)
+            if not chunk:
+                return
+            yield chunk
+
+
+def iter_decompressed(path, chunk_size=CHUNK_SIZE):
+    """CSV bytes of an archived session, decompressed chunk by chunk"""
+    with open(path, 'rb') as f:
+        reader = zstandard.ZstdDecompressor().stream_reader(f, read_across_frames=True)
+        while True:
+            chunk = reader.read(chunk_size)
+            if not chunk:
+                return
+            yield chunk
+
+
+def open_text(path):
+    """Session CSV as a text file, archived or not"""
+    if not is_archived(path):
+        return open(path, newline='')
+    reader = zstandard.ZstdDecompressor().stream_reader(open(path, 'rb'), read_across_frames=True,
+                                                        closefd=True)
+    return io.TextIOWrapper(reader, newline='')
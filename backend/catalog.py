@@ -0,0 +1,154 @@
+"""Session catalog: one SQLite row per recorded session.
+
+Listing and searching sessions reads this table instead of scanning the
+test_data folder, so it stays fast however many sessions have been recorded.
+The database runs in WAL mode: the recorder writes while API requests read,
+and neither blocks the other. Rows are written in a transaction at
+start_test (status 'recording') and again at stop_test (sample count, peak
+force, file size; status 'complete').
+
+Sessions are ordered by start time; athlete, device and date filters are
+served from indexes.
+"""
+import logging
+import os
+import sqlite3
+import threading
+from datetime import datetime
+
+logger = logging.getLogger(__name__)
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS sessions (
+    id INTEGER PRIMARY KEY,
+    filename TEXT NOT NULL UNIQUE,
+    athlete TEXT,
+    device TEXT,
+    started_at TEXT NOT NULL,
+    stopped_at TEXT,
+    sample_count INTEGER,
+    peak_force REAL,
+    size_bytes INTEGER,
+    status TEXT NOT NULL DEFAULT 'recording'
+);
+CREATE INDEX IF NOT EXISTS sessions_started ON sessions (started_at);
+CREATE INDEX IF NOT EXISTS sessions_athlete ON sessions (athlete, started_at);
+CREATE INDEX IF NOT EXISTS sessions_device ON sessions (device, started_at);
+"""
+
+COLUMNS = ('filename', 'athlete', 'device', 'started_at', 'stopped_at', 'sample_count',
+           'peak_force', 'size_bytes', 'status')
+MAX_PAGE_SIZE = 500
+
+
+class SessionCatalog:
+    """SQLite catalog of sessions; safe to use from any thread (one
+    connection per thread)"""
+
+    def __init__(self, path):
+        self.path = path
+        self._local = threading.local()
+        with self._connection() as db:
+            db.executescript(SCHEMA)
+
+    def _connection(self):
+        db = getattr(self._local, 'db', None)
+        if db is None:
+            db = sqlite3.connect(self.path, timeout=5.0)
+            db.row_factory = sqlite3.Row
+            db.execute('PRAGMA journal_mode=WAL')
+            db.execute('PRAGMA synchronous=NORMAL')
+            self._local.db = db
+        return db
+
+    def begin_session(self, filename, started_at, athlete=None, device=None):
+        with self._connection() as db:
+            db.execute('INSERT OR REPLACE INTO sessions (filename, athlete, device, started_at, status) '
+                       "VALUES (?, ?, ?, ?, 'recording')",
+                       (filename, athlete, device, started_at.isoformat()))
+
+    def finish_session(self, filename, stopped_at, sample_count, peak_force, size_bytes):
+        with self._connection() as db:
+            db.execute('UPDATE sessions SET stopped_at = ?, sample_count = ?, peak_force = ?, '
+                       "size_bytes = ?, status = 'complete' WHERE filename = ?",
+                       (stopped_at.isoformat(), sample_count, peak_force, size_bytes, filename))
+
+    def set_size(self, filename, size_bytes):
+        """File size after the session has been archived"""
+        with self._connection() as db:
+            db.execute('UPDATE sessions SET size_bytes = ? WHERE filename = ?', (size_bytes, filename))
+
+    def remove_session(self, filename):
+        with self._connection() as db:
+            db.execute('DELETE FROM sessions WHERE filename = ?', (filename,))
+
+    def list_sessions(self, athlete=None, device=None, date_from=None, date_to=None,
+                      page=1, per_page=50, offset=None):
+        """One page of sessions, newest first, plus the total matching count.
+        date_from/date_to are ISO dates or datetimes; date_to is inclusive.
+        An offset, if given, is used as is instead of the page's; per_page=None
+        returns every match from there."""
+        where, params = [], []
+        if athlete:
+            where.append('athlete = ?')
+            params.append(athlete)
+        if device:
+            where.append('device = ?')
+            params.append(device)
+        if date_from:
+            where.append('started_at >= ?')
+            params.append(date_from)
+        if date_to:
+            # A bare date covers the whole day
+            where.append('started_at <= ?' if 'T' in date_to else "started_at < date(?, '+1 day')")
+            params.append(date_to)
+        clause = ('WHERE ' + ' AND '.join(where)) if where else ''
+
+        if per_page is None:
+            limit = -1      # SQLite: no limit
+        else:
+            limit = per_page = max(1, min(int(per_page), MAX_PAGE_SIZE))
+        if offset is None:
+            offset = (max(1, int(page)) - 1) * max(1, limit)
+        db = self._connection()
+        total = db.execute(f'SELECT COUNT(*) FROM sessions {clause}', params).fetchone()[0]
+        rows = db.execute(f'SELECT {", ".join(COLUMNS)} FROM sessions {clause} '
+                          'ORDER BY started_at DESC, id DESC LIMIT ? OFFSET ?',
+                          params + [limit, max(0, int(offset))]).fetchall()
+        return [dict(row) for row in rows], total
+
+    def athletes(self):
+        """Athletes with their session counts"""
+        rows = self._connection().execute(
+            'SELECT athlete, COUNT(*) AS sessions FROM sessions WHERE athlete IS NOT NULL '
+            'GROUP BY athlete ORDER BY athlete').fetchall()
+        return [dict(row) for row in rows]
+
+    def import_folder(self, folder, summary_loader=None):
+        """Add CSV files recorded before the catalog existed (or copied in by
+        hand) and drop rows whose file is gone. Archived sessions (.csv.zst)
+        are listed under their .csv name. Runs once at startup."""
+        on_disk = {}
+        for name in os.listdir(folder):
+            if name.endswith('.csv'):
+                on_disk.setdefault(name, name)
+            elif name.endswith('.csv.zst'):
+                on_disk[name[:-len('.zst')]] = name
+        db = self._connection()
+        known = {row[0] for row in db.execute('SELECT filename FROM sessions')}
+
+        added = []
+        for name in sorted(on_disk.keys() - known):
+            stat = os.stat(os.path.join(folder, on_disk[name]))
+            summary = summary_loader(os.path.join(folder, name)) if summary_loader else None
+            metrics = (summary or {}).get('metrics') or {}
+            added.append((name, datetime.fromtimestamp(stat.st_ctime).isoformat(),
+                          datetime.fromtimestamp(stat.st_mtime).isoformat(),
+                          (summary or {}).get('sample_count'), metrics.get('peak_force'), stat.st_size))
+        with db:
+            db.executemany('INSERT INTO sessions (filename, started_at, stopped_at, sample_count, '
+                           "peak_force, size_bytes, status) VALUES (?, ?, ?, ?, ?, ?, 'complete')", added)
+            db.executemany('DELETE FROM sessions WHERE filename = ?', [(name,) for name in known - on_disk.keys()])
+        if added or known - on_disk.keys():
+            logger.info(f"Session catalog: imported {len(added)}, removed {len(known - on_disk.keys())}")
+        return len(added)
@@ -0,0 +1,506 @@
+"""Multi-process sample ingest.
+
+Decoding and storing samples is CPU work in Python, and in the Flask process
+every WebSocket thread shares one GIL. Here it runs in worker processes
+instead. Each device is assigned to one worker, which:
+- decodes its sample frames (JSON) or UDP datagrams (with reassembly)
+- writes the session CSV
+- builds the forwarded frame and the arrays for the running metrics
+
+The Flask front only moves bytes. Frames go to a worker through a
+shared-memory ring. Results come back through a second ring: one record per
+batch (arrays, readings and the frame to forward), UDP NACKs and session-stop
+acknowledgements. A collector thread in the front applies them, so control,
+the catalog and fan-out stay in one place.
+
+Records in a device's ring are handled in order, so a session start or stop
+sent through the same ring lands exactly between two frames.
+"""
+import csv
+import json
+import logging
+import multiprocessing
+import struct
+import threading
+import time
+from datetime import datetime
+from multiprocessing import shared_memory
+
+import numpy as np
+
+from udp_ingest import UdpStreamReassembler
+
+logger = logging.getLogger(__name__)
+
+RING_BYTES = 4 << 20        # Per ring; about 2 s of 8-channel frames at 1 kHz
+PUT_TIMEOUT = 1.0           # Seconds a full ring may hold up the producer before the record is dropped
+IDLE_WAIT = 0.05            # Seconds a worker sleeps when idle (UDP timeouts run at least this often)
+STOP_TIMEOUT = 5.0
+
+# Sample frames the front hands to workers without parsing them
+SAMPLE_FRAME_PREFIXES = ('{"t0":', '{"samples":')
+
+# Front -> worker records
+KIND_FRAME = 1          # device, WebSocket sample frame (JSON)
+KIND_DATAGRAM = 2       # device, UDP datagram
+KIND_START = 3          # device, CSV path
+KIND_STOP = 4           # device, token
+KIND_SHUTDOWN = 5
+# Worker -> front records
+KIND_BATCH = 11         # device, decoded batch
+KIND_NACK = 12          # device, UDP sequence number
+KIND_STOPPED = 13       # device, token, samples recorded
+KIND_PAD = 0xFF         # Skip to the start of the ring
+
+RECORD = struct.Struct('<IB')           # payload length, kind
+BATCH = struct.Struct('<IIIB')          # samples, readings JSON length, forward JSON length, recording
+STOPPED = struct.Struct('<IQ')          # token, samples recorded
+
+
+def expand_sample_timestamps(data):
+    """Expand a compact frame's 64-bit base time ('t0', microseconds) and
+    per-sample offsets ('dt') into per-sample 't_us' and millisecond 't'"""
+    base = data.get('t0')
+    if base is None:
+        return
+    for sample in data['samples']:
+        t_us = base + sample.get('dt', 0)
+        sample['t_us'] = t_us
+        sample['t'] = t_us // 1000
+
+
+def derive_plate_sides(data):
+    """Fill 'l' and 'r' from the per-channel values ('v') so clients that
+    know only two sensors keep working. With two channels they are the left
+    and right sensors; with more, the first half of the channels belongs to
+    the left plate and the second half to the right."""
+    for sample in data['samples']:
+        values = sample.get('v')
+        if values is None:
+            continue
+        half = (len(values) + 1) // 2
+        sample['l'] = sum(values[:half])
+        sample['r'] = sum(values[half:])
+
+
+class ShmRing:
+    """Byte ring in shared memory: one producer process, one consumer
+    process. Records are [length, kind, payload]. Positions are free-running
+    byte counts in the header, read and written only while holding `lock`, a
+    multiprocessing Lock shared by both sides. Taking and releasing it orders
+    memory on any CPU (a plain store would only do so on x86), so a position
+    is seen only after the record bytes it covers, and space is reused only
+    after the consumer has copied them out. Within a process, callers
+    serialise their own puts."""
+
+    HEADER = 64
+
+    def __init__(self, lock, capacity=RING_BYTES, name=None, event=None):
+        if name is None:
+            self.shm = shared_memory.SharedMemory(create=True, size=self.HEADER + capacity)
+        else:
+            self.shm = shared_memory.SharedMemory(name=name)
+        self.buf = self.shm.buf
+        self.pos = np.ndarray((4,), dtype=np.int64, buffer=self.buf)   # written, read, capacity, dropped
+        if name is None:
+            self.pos[:] = (0, 0, capacity, 0)
+        self.capacity = int(self.pos[2])
+        self.lock = lock
+        self.event = event  # Set after every put; the consumer sleeps on it
+
+    @property
+    def name(self):
+        return self.shm.name
+
+    @property
+    def dropped(self):
+        return int(self.pos[3])
+
+    def empty(self):
+        with self.lock:
+            return self.pos[0] == self.pos[1]
+
+    def put(self, kind, parts=(), timeout=PUT_TIMEOUT):
+        """Append a record made of bytes-like parts; waits up to timeout for
+        space, then drops it. Returns False if dropped."""
+        views = [memoryview(p).cast('B') for p in parts]
+        length = sum(len(v) for v in views)
+        need = RECORD.size + length
+        if need > self.capacity // 2:
+            raise ValueError(f'record of {need} bytes is too large for the ring')
+
+        deadline = None
+        while True:
+            with self.lock:
+                written, read = int(self.pos[0]), int(self.pos[1])
+            offset = written % self.capacity
+            pad = self.capacity - offset if self.capacity - offset < need else 0
+            if written + pad + need - read <= self.capacity:
+                break
+            now = time.monotonic()
+            deadline = deadline or now + timeout
+            if now >= deadline:
+                self.pos[3] += 1
+                return False
+            time.sleep(0.0002)
+
+        if pad:
+            if pad >= RECORD.size:
+                RECORD.pack_into(self.buf, self.HEADER + offset, 0, KIND_PAD)
+            offset = 0
+        start = self.HEADER + offset
+        RECORD.pack_into(self.buf, start, length, kind)
+        start += RECORD.size
+        for view in views:
+            self.buf[start:start + len(view)] = view
+            start += len(view)
+        with self.lock:
+            self.pos[0] = written + pad + need
+        if self.event is not None:
+            self.event.set()
+        return True
+
+    def get(self):
+        """Next record as (kind, payload bytes), or None if the ring is empty"""
+        with self.lock:
+            written, read = int(self.pos[0]), int(self.pos[1])
+        if read == written:
+            return None
+        offset = read % self.capacity
+        if self.capacity - offset < RECORD.size:
+            read += self.capacity - offset
+            offset = 0
+        else:
+            length, kind = RECORD.unpack_from(self.buf, self.HEADER + offset)
+            if kind == KIND_PAD:
+                read += self.capacity - offset
+                offset = 0
+        length, kind = RECORD.unpack_from(self.buf, self.HEADER + offset)
+        start = self.HEADER + offset + RECORD.size
+        payload = bytes(self.buf[start:start + length])
+        with self.lock:
+            self.pos[1] = read + RECORD.size + length
+        return kind, payload
+
+    def close(self, unlink=False):
+        self.pos = None
+        self.buf = None
+        self.shm.close()
+        if unlink:
+            self.shm.unlink()
+
+
+def pack_device(device, body=b''):
+    encoded = device.encode()
+    return bytes([len(encoded)]) + encoded, body
+
+
+def unpack_device(payload):
+    length = payload[0]
+    return payload[1:1 + length].decode(), memoryview(payload)[1 + length:]
+
+
+class DeviceStream:
+    """Per-device state in a worker: session file and UDP reassembly"""
+
+    def __init__(self):
+        self.file = None
+        self.writer = None
+        self.recorded = 0
+        self.reassembler = None
+
+
+class IngestWorker:
+    """Decode and storage for the devices assigned to one worker. emit(kind,
+    parts) sends a record back to the front. Runs in a worker process, or
+    in-process for the benchmark's single-process baseline."""
+
+    def __init__(self, emit):
+        self.emit = emit
+        self.devices = {}
+
+    def stream(self, device):
+        if device not in self.devices:
+            self.devices[device] = DeviceStream()
+        return self.devices[device]
+
+    def handle(self, kind, payload):
+        device, body = unpack_device(payload)
+        if kind == KIND_FRAME:
+            self.frame(device, body)
+        elif kind == KIND_DATAGRAM:
+            self.datagram(device, body)
+        elif kind == KIND_START:
+            self.start(device, bytes(body).decode())
+        elif kind == KIND_STOP:
+            self.stop(device, struct.unpack('<I', body)[0])
+
+    def frame(self, device, message):
+        try:
+            data = json.loads(bytes(message))
+        except ValueError:
+            logger.error(f"Invalid sample frame from {device}")
+            return
+        if 'samples' in data:
+            self.samples(device, data)
+
+    def datagram(self, device, datagram):
+        stream = self.stream(device)
+        if stream.reassembler is None:
+            stream.reassembler = UdpStreamReassembler(
+                lambda samples: self.samples(device, {'samples': samples}),
+                lambda seq: self.emit(KIND_NACK, pack_device(device, struct.pack('<I', seq))))
+        stream.reassembler.on_datagram(bytes(datagram))
+
+    def poll(self):
+        """UDP timeouts (NACKs, giving up on lost datagrams)"""
+        for stream in self.devices.values():
+            if stream.reassembler is not None:
+                stream.reassembler.poll()
+
+    def start(self, device, csv_path):
+        stream = self.stream(device)
+        self.stop(device, None)
+        # The front has written the header row
+        stream.file = open(csv_path, 'a', newline='')
+        stream.writer = csv.writer(stream.file)
+        stream.recorded = 0
+
+    def stop(self, device, token):
+        stream = self.stream(device)
+        if stream.file is not None:
+            stream.file.close()
+            stream.file = stream.writer = None
+        if token is not None:
+            self.emit(KIND_STOPPED, pack_device(device, STOPPED.pack(token, stream.recorded)))
+
+    def samples(self, device, data):
+        """One batch: CSV rows, arrays for the running metrics, the readings
+        (every sample while recording, else the last) and, while recording,
+        the frame forwarded to apps"""
+        stream = self.stream(device)
+        samples = data['samples']
+        if not samples:
+            return
+        expand_sample_timestamps(data)
+        derive_plate_sides(data)
+
+        recording = stream.writer is not None
+        if recording:
+            # Rows as app.save_to_csv writes them, with a receive time per sample
+            stream.writer.writerows(
+                (datetime.now().isoformat() + 'Z', s.get('l', 0), s.get('r', 0), s.get('t', 0),
+                 s.get('t_us', ''), ';'.join(str(v) for v in s.get('v', (s.get('l', 0), s.get('r', 0)))))
+                for s in samples)
+            stream.recorded += len(samples)
+            t_us = np.fromiter((s['t_us'] if s.get('t_us') is not None else s.get('t', 0) * 1000
+                                for s in samples), dtype=np.float64, count=len(samples))
+            left = np.fromiter((s.get('l', 0) for s in samples), dtype=np.float64, count=len(samples))
+            right = np.fromiter((s.get('r', 0) for s in samples), dtype=np.float64, count=len(samples))
+            forward = json.dumps(data).encode()
+        else:
+            t_us = left = right = np.empty(0)
+            forward = b''
+
+        # Readings as handle_esp32_data keeps them in current_session_data
+        readings = json.dumps([{
+            'left': s.get('l', 0),
+            'right': s.get('r', 0),
+            'timestamp': s.get('t', int(time.time() * 1000)),
+            'esp32_time_us': s.get('t_us'),
+            'channels': s.get('v', [s.get('l', 0), s.get('r', 0)])
+        } for s in (samples if recording else samples[-1:])]).encode()
+        head, _ = pack_device(device)
+        self.emit(KIND_BATCH, (head, BATCH.pack(len(t_us), len(readings), len(forward), recording),
+                               t_us, left, right, readings, forward))
+
+
+def decode_batch(body):
+    """(t_us, left, right, readings, forward frame bytes, recording)"""
+    count, readings_length, forward_length, recording = BATCH.unpack_from(body)
+    arrays = np.frombuffer(body, dtype=np.float64, count=3 * count, offset=BATCH.size)
+    start = BATCH.size + 24 * count
+    readings = json.loads(bytes(body[start:start + readings_length]))
+    forward = bytes(body[start + readings_length:start + readings_length + forward_length])
+    return arrays[:count], arrays[count:2 * count], arrays[2 * count:], readings, forward, bool(recording)
+
+
+def worker_main(inbound_name, outbound_name, inbound_lock, outbound_lock, inbound_event, outbound_event):
+    """Worker process: handle records until shutdown"""
+    logging.basicConfig(level=logging.INFO)
+    inbound = ShmRing(inbound_lock, name=inbound_name)
+    outbound = ShmRing(outbound_lock, name=outbound_name, event=outbound_event)
+    worker = IngestWorker(outbound.put)
+    try:
+        while True:
+            record = inbound.get()
+            if record is None:
+                worker.poll()
+                inbound_event.clear()
+                if inbound.empty():
+                    inbound_event.wait(IDLE_WAIT)
+                continue
+            kind, payload = record
+            if kind == KIND_SHUTDOWN:
+                break
+            try:
+                worker.handle(kind, payload)
+            except Exception as e:
+                logger.error(f"Ingest worker error: {e}")
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for device in list(worker.devices):
+            worker.stop(device, None)
+        inbound.close()
+        outbound.close()
+
+
+class IngestPool:
+    """Worker processes plus the front's side of their rings.
+
+    on_batch(device, t_us, left, right, readings, forward, recording) and
+    on_nack(device, seq) run on the collector thread."""
+
+    def __init__(self, workers, on_batch, on_nack=None, ring_bytes=RING_BYTES):
+        self.on_batch = on_batch
+        self.on_nack = on_nack
+        context = multiprocessing.get_context('spawn')
+        self.outbound_event = context.Event()
+        self.workers = []
+        for _ in range(max(1, workers)):
+            inbound_event = context.Event()
+            inbound = ShmRing(context.Lock(), ring_bytes, event=inbound_event)
+            outbound = ShmRing(context.Lock(), ring_bytes)
+            process = context.Process(target=worker_main, daemon=True,
+                                      args=(inbound.name, outbound.name, inbound.lock, outbound.lock,
+                                            inbound_event, self.outbound_event))
+            self.workers.append({'inbound': inbound, 'outbound': outbound, 'process': process,
+                                 'lock': threading.Lock()})
+        self.assignments = {}
+        self.assign_lock = threading.Lock()
+        self.stops = {}
+        self.next_token = 1
+        self.stats = {'frames': 0, 'datagrams': 0, 'batches': 0, 'samples': 0, 'dropped': 0}
+        self.running = False
+        self.collector = None
+
+    def start(self):
+        for worker in self.workers:
+            worker['process'].start()
+        self.running = True
+        self.collector = threading.Thread(target=self._collect, daemon=True)
+        self.collector.start()
+        logger.info(f"Ingest workers started: {len(self.workers)}")
+
+    def shutdown(self):
+        if not self.running:
+            return
+        for worker in self.workers:
+            with worker['lock']:
+                worker['inbound'].put(KIND_SHUTDOWN)
+        for worker in self.workers:
+            worker['process'].join(timeout=5)
+        self.running = False
+        self.outbound_event.set()
+        self.collector.join(timeout=1)
+        for worker in self.workers:
+            worker['inbound'].close(unlink=True)
+            worker['outbound'].close(unlink=True)
+
+    def worker_for(self, device):
+        """Devices are spread over the workers round robin, on first sight"""
+        with self.assign_lock:
+            if device not in self.assignments:
+                self.assignments[device] = self.workers[len(self.assignments) % len(self.workers)]
+            return self.assignments[device]
+
+    def _put(self, device, kind, body):
+        worker = self.worker_for(device)
+        with worker['lock']:
+            if worker['inbound'].put(kind, pack_device(device, body)):
+                return True
+        self.stats['dropped'] += 1
+        logger.warning(f"Ingest worker busy, dropped a record from {device}")
+        return False
+
+    def submit_frame(self, device, message):
+        """Sample frame (WebSocket text) from a device"""
+        self.stats['frames'] += 1
+        return self._put(device, KIND_FRAME, message.encode() if isinstance(message, str) else message)
+
+    def submit_datagram(self, device, datagram):
+        self.stats['datagrams'] += 1
+        return self._put(device, KIND_DATAGRAM, datagram)
+
+    def start_session(self, device, csv_path):
+        """Record the device's samples to csv_path (header already written)"""
+        self._put(device, KIND_START, csv_path.encode())
+
+    def stop_session(self, device, timeout=STOP_TIMEOUT, on_late=None):
+        """Stop recording; returns the number of samples recorded, once
+        every batch before the stop has been through on_batch and the worker
+        has closed the CSV (None on timeout). After a timeout, on_late is
+        called with the count if the worker confirms the stop later."""
+        done = threading.Event()
+        with self.assign_lock:
+            token = self.next_token
+            self.next_token += 1
+            self.stops[token] = [done, None, None]
+        self._put(device, KIND_STOP, struct.pack('<I', token))
+        done.wait(timeout)
+        with self.assign_lock:
+            stop = self.stops[token]
+            if done.is_set() or on_late is None:
+                del self.stops[token]
+                return stop[1]
+            stop[2] = on_late
+            return None
+
+    def _collect(self):
+        while self.running:
+            idle = True
+            for worker in self.workers:
+                record = worker['outbound'].get()
+                while record is not None:
+                    idle = False
+                    try:
+                        self._apply(*record)
+                    except Exception as e:
+                        logger.error(f"Error applying ingest result: {e}")
+                    record = worker['outbound'].get()
+            if idle:
+                self.outbound_event.clear()
+                if all(w['outbound'].empty() for w in self.workers):
+                    self.outbound_event.wait(IDLE_WAIT)
+
+    def _apply(self, kind, payload):
+        device, body = unpack_device(payload)
+        if kind == KIND_BATCH:
+            t_us, left, right, readings, forward, recording = decode_batch(body)
+            self.stats['batches'] += 1
+            self.stats['samples'] += len(t_us)
+            self.on_batch(device, t_us, left, right, readings, forward, recording)
+        elif kind == KIND_NACK and self.on_nack:
+            self.on_nack(device, struct.unpack('<I', body)[0])
+        elif kind == KIND_STOPPED:
+            token, recorded = STOPPED.unpack(body)
+            on_late = None
+            with self.assign_lock:
+                stop = self.stops.get(token)
+                if stop is not None:
+                    stop[1] = recorded
+                    stop[0].set()
+                    on_late = stop[2]
+                    if on_late is not None:
+                        del self.stops[token]
+            if on_late is not None:
+                on_late(recorded)
+
+    def status(self):
+        return {
+            'workers': len(self.workers),
+            'alive': sum(w['process'].is_alive() for w in self.workers),
+            'devices': len(self.assignments),
+            **self.stats,
+        }
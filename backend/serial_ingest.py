@@ -0,0 +1,298 @@
+"""USB serial transport: framing, CRC and the port reader.
+
+Mirrors the frame format in ESP32_PlatformIO_Project/include/usb_frame.h.
+With the ESP32 plugged in over USB, its backend link runs over the native USB
+CDC port instead of WiFi. It carries the same JSON messages as the WebSocket,
+each framed as
+
+    sync 0xA5 0x5A, type, reserved, uint16 length, uint32 CRC-32, payload
+
+The device's log lines share the port; they arrive between frames and are
+passed on as text. A frame that fails its CRC is dropped and the reader
+resynchronises on the next sync word. The ESP32 uses the USB link while the
+host pings it (every second) and falls back to WiFi a few seconds after the
+pings stop.
+
+SerialLink has the receive()/send() calls of a flask-sock WebSocket, so a
+USB device goes through the same handler in app.py as a WiFi one.
+"""
+import glob
+import logging
+import os
+import queue
+import select
+import struct
+import threading
+import time
+import tty
+import zlib
+
+logger = logging.getLogger(__name__)
+
+SYNC = b'\xa5\x5a'
+TYPE_MESSAGE = 1
+HEADER = struct.Struct('<2sBBHI')   # sync, type, reserved, payload length, CRC-32
+MAX_PAYLOAD = 0xFFFF
+
+HELLO = '{"type":"backend"}'
+PING = '{"ping":true}'
+PING_INTERVAL = 1.0         # USB_HOST_TIMEOUT_MS in the firmware is 3 s
+PROBE_TIMEOUT = 3.0         # Seconds a new port gets to send its first frame
+REPROBE_INTERVAL = 30.0     # Before a port that stayed silent is tried again
+SCAN_INTERVAL = 1.0
+WRITE_TIMEOUT = 2.0
+
+# Native USB CDC ports, and the USB vendors of the boards that have one
+# (Espressif for the ESP32-S3's own USB, Arduino for the Nano ESP32). Other
+# ACM devices on the host are not opened: opening a port can reset a board.
+DEFAULT_PORTS = ('/dev/ttyACM*', '/dev/cu.usbmodem*')
+DEVICE_VENDORS = {'303a', '2341'}
+
+
+def encode_frame(payload, kind=TYPE_MESSAGE):
+    """Frame a message (str or bytes) for the port"""
+    if isinstance(payload, str):
+        payload = payload.encode()
+    head = struct.pack('<BBH', kind, 0, len(payload))
+    return SYNC + head + struct.pack('<I', zlib.crc32(payload, zlib.crc32(head))) + payload
+
+
+class Deframer:
+    """Splits a received byte stream into (type, payload) frames. Bytes
+    between frames are collected into lines and passed to on_text."""
+
+    def __init__(self, on_text=None, max_payload=MAX_PAYLOAD):
+        self.on_text = on_text
+        self.max_payload = max_payload
+        self.buffer = bytearray()
+        self.text = bytearray()
+        self.stats = {'frames': 0, 'crc_errors': 0, 'oversize': 0, 'skipped_bytes': 0}
+
+    def feed(self, data):
+        """Add received bytes; returns the frames they complete, in order"""
+        buf = self.buffer
+        buf += data
+        frames = []
+        start = 0
+        while True:
+            sync = buf.find(SYNC, start)
+            if sync < 0:
+                # Keep a trailing first half of a sync word
+                sync = len(buf) - 1 if buf.endswith(SYNC[:1]) else len(buf)
+                sync = max(sync, start)
+            self._skip(buf[start:sync])
+            start = sync
+            if len(buf) - start < HEADER.size:
+                break
+            _, kind, _, length, crc = HEADER.unpack_from(buf, start)
+            if length > self.max_payload:
+                self.stats['oversize'] += 1
+                self._skip(buf[start:start + 1])
+                start += 1
+                continue
+            end = start + HEADER.size + length
+            if len(buf) < end:
+                break
+            payload = bytes(buf[start + HEADER.size:end])
+            if zlib.crc32(payload, zlib.crc32(buf[start + 2:start + 6])) != crc:
+                self.stats['crc_errors'] += 1
+                self._skip(buf[start:start + 1])
+                start += 1
+                continue
+            self.stats['frames'] += 1
+            frames.append((kind, payload))
+            start = end
+        del buf[:start]
+        return frames
+
+    def _skip(self, data):
+        if not data:
+            return
+        self.stats['skipped_bytes'] += len(data)
+        if self.on_text is None:
+            return
+        self.text += data
+        *lines, rest = self.text.split(b'\n')
+        self.text = bytearray(rest[-4096:])
+        for line in lines:
+            line = line.decode(errors='replace').strip()
+            if line:
+                self.on_text(line)
+
+
+class SerialLink:
+    """A device on a serial port, seen as a WebSocket: receive() returns the
+    next message text (None once the port is gone) and send() frames one.
+    A reader thread deframes the port and pings the device."""
+
+    def __init__(self, path, on_log=None):
+        self.path = path
+        self.deframer = Deframer(on_log)
+        self.messages = queue.Queue()
+        self.ready = threading.Event()      # First frame from the device
+        self.closed = threading.Event()
+        self.lock = threading.Lock()        # Commands are sent from several threads
+        self.fd = None
+        self.thread = None
+
+    def open(self):
+        self.fd = os.open(self.path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        try:
+            tty.setraw(self.fd)     # 8-bit clean: no echo, line editing or CR/LF mapping
+        except Exception:
+            os.close(self.fd)
+            self.fd = None
+            raise
+        self.thread = threading.Thread(target=self._run, daemon=True)
+        self.thread.start()
+        self.send(HELLO)
+
+    def receive(self):
+        return self.messages.get()
+
+    def send(self, message):
+        view = memoryview(encode_frame(message))
+        with self.lock:
+            # Checked under the lock: _run closes the descriptor holding it,
+            # and its number may already belong to another file
+            if self.closed.is_set() or self.fd is None:
+                raise ConnectionError(f'{self.path} is closed')
+            deadline = time.monotonic() + WRITE_TIMEOUT
+            while view:
+                try:
+                    view = view[os.write(self.fd, view):]
+                except BlockingIOError:
+                    remaining = deadline - time.monotonic()
+                    if remaining <= 0:
+                        raise ConnectionError(f'{self.path} is not reading')
+                    select.select([], [self.fd], [], remaining)
+
+    def close(self):
+        self.closed.set()
+
+    def _run(self):
+        next_ping = time.monotonic() + PING_INTERVAL
+        try:
+            while not self.closed.is_set():
+                readable, _, _ = select.select([self.fd], [], [], 0.1)
+                if readable:
+                    data = os.read(self.fd, 65536)
+                    if not data:
+                        break
+                    for kind, payload in self.deframer.feed(data):
+                        if kind == TYPE_MESSAGE:
+                            self.ready.set()
+                            self.messages.put(payload.decode(errors='replace'))
+                now = time.monotonic()
+                if now >= next_ping:
+                    self.send(PING)
+                    next_ping = now + PING_INTERVAL
+        except (OSError, ConnectionError) as e:
+            # Unplugged: reads fail with EIO
+            logger.info(f"Serial port {self.path} closed: {e}")
+        finally:
+            self.closed.set()
+            with self.lock:
+                os.close(self.fd)
+                self.fd = None
+            self.messages.put(None)
+
+
+def usb_vendor(path):
+    """USB vendor id of a tty (Linux sysfs), or None if unknown"""
+    try:
+        name = os.path.basename(os.path.realpath(path))
+        with open(f'/sys/class/tty/{name}/device/../idVendor') as f:
+            return f.read().strip().lower()
+    except OSError:
+        return None
+
+
+class SerialIngest:
+    """Watches serial ports for ESP32s and hands each one that answers to
+    on_device(link), which serves it on its own thread until the port goes.
+    A port that sends nothing within probe_timeout is left alone for
+    REPROBE_INTERVAL. ports lists paths or glob patterns; with the default
+    patterns, ports of other USB vendors are skipped."""
+
+    def __init__(self, on_device, ports=DEFAULT_PORTS, on_log=None, probe_timeout=PROBE_TIMEOUT):
+        self.on_device = on_device
+        self.ports = tuple(ports)
+        self.check_vendor = self.ports == DEFAULT_PORTS
+        self.on_log = on_log
+        self.probe_timeout = probe_timeout
+        self.links = {}         # path -> SerialLink, probing or serving
+        self.silent = {}        # path -> time it failed the probe
+        self.lock = threading.Lock()
+        self.running = False
+        self.thread = None
+
+    def start(self):
+        self.running = True
+        self.thread = threading.Thread(target=self._run, daemon=True)
+        self.thread.start()
+        logger.info(f"Serial ports watched for ESP32s: {', '.join(self.ports)}")
+
+    def stop(self):
+        self.running = False
+        if self.thread:
+            self.thread.join(timeout=2)
+        with self.lock:
+            links = list(self.links.values())
+        for link in links:
+            link.close()
+
+    def status(self):
+        with self.lock:
+            return {path: {'ready': link.ready.is_set(), **link.deframer.stats}
+                    for path, link in self.links.items()}
+
+    def candidates(self):
+        paths = sorted({p for pattern in self.ports for p in glob.glob(pattern)})
+        if self.check_vendor:
+            paths = [p for p in paths if usb_vendor(p) in DEVICE_VENDORS or usb_vendor(p) is None]
+        return paths
+
+    def _run(self):
+        while self.running:
+            now = time.monotonic()
+            for path in self.candidates():
+                with self.lock:
+                    if path in self.links or now - self.silent.get(path, -REPROBE_INTERVAL) < REPROBE_INTERVAL:
+                        continue
+                    link = SerialLink(path, self._log_for(path))
+                    self.links[path] = link
+                threading.Thread(target=self._serve, args=(link,), daemon=True).start()
+            time.sleep(SCAN_INTERVAL)
+
+    def _log_for(self, path):
+        if self.on_log is None:
+            return None
+        return lambda line: self.on_log(path, line)
+
+    def _serve(self, link):
+        try:
+            link.open()
+        except OSError as e:
+            logger.debug(f"Cannot open {link.path}: {e}")
+            self._forget(link, silent=True)
+            return
+        if not link.ready.wait(self.probe_timeout):
+            link.close()
+            self._forget(link, silent=True)
+            return
+        logger.info(f"ESP32 on USB serial port {link.path}")
+        try:
+            self.on_device(link)
+        except Exception as e:
+            logger.error(f"Error serving {link.path}: {e}")
+        finally:
+            link.close()
+            self._forget(link)
+
+    def _forget(self, link, silent=False):
+        with self.lock:
+            if self.links.get(link.path) is link:
+                del self.links[link.path]
+            if silent:
+                self.silent[link.path] = time.monotonic()
@@ -0,0 +1,136 @@
+"""IMTP metrics against values worked out by hand.
+
+The session: seven samples 50 ms apart, one of them with a negative right
+sensor reading.
+
+    t (s)   0    0.05  0.1  0.15  0.2  0.25  0.3
+    left    10   20    30   40    50   60    20
+    right   10   10    20   20    30   -10   10
+    total   20   30    50   60    80   50    30
+
+Impulse uses the rectangle rule from t = 0 (each sample counts for the time
+since the previous one): 0, 1.5, 4.0, 7.0, 11.0, 13.5, 15.0 count*s.
+"""
+import csv
+import os
+import sys
+
+import numpy as np
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+
+import analysis  # noqa: E402
+
+T = [0.0, 0.05, 0.1, 0.15, 0.2, 0.25, 0.3]
+LEFT = [10, 20, 30, 40, 50, 60, 20]
+RIGHT = [10, 10, 20, 20, 30, -10, 10]
+T0_US = 1_000_000
+
+
+def t_us(times):
+    return [T0_US + round(t * 1e6) for t in times]
+
+
+def test_analyze():
+    metrics = analysis.analyze(T, LEFT, RIGHT)
+    assert metrics['peak_force'] == 80
+    assert metrics['left_peak_force'] == 60
+    assert metrics['right_peak_force'] == 30
+    assert metrics['time_to_peak'] == 0.2
+    assert metrics['test_duration'] == 0.3
+    assert metrics['asymmetry'] == 37.5
+    assert metrics['force_ms'] == {'50': 30, '100': 50, '150': 60, '200': 80, '250': 50}
+    assert metrics['force_percent'] == {'50': 37.5, '100': 62.5, '150': 75, '200': 100, '250': 62.5}
+    assert metrics['rfd'] == pytest.approx({'50': 600, '100': 500, '150': 400, '200': 400, '250': 200})
+    assert metrics['impulse'] == pytest.approx({'50': 1.5, '100': 4.0, '150': 7.0, '200': 11.0, '250': 13.5})
+
+
+def test_analyze_positive_only():
+    # The -10 reading counts as zero: total 60 at 250 ms
+    metrics = analysis.analyze(T, LEFT, RIGHT, positive_only=True)
+    assert metrics['peak_force'] == 80
+    assert metrics['right_peak_force'] == 30
+    assert metrics['force_ms']['250'] == 60
+    assert metrics['impulse']['250'] == pytest.approx(14.0)
+
+
+def test_force_between_samples_and_past_the_end():
+    # First sample at or after the time, else the last one; nothing before 0
+    t = np.array(T)
+    total = np.array(LEFT) + np.array(RIGHT)
+    assert analysis.force_at(t, total, 0.07) == 50
+    assert analysis.force_at(t, total, 5.0) == 30
+    assert analysis.impulse_at(t, analysis.impulse_table(t, total), -0.01) == 0
+
+
+def test_summarize():
+    summary = analysis.summarize('session.csv', T, LEFT, RIGHT)
+    assert summary['filename'] == 'session.csv'
+    assert summary['sample_count'] == 7
+    assert summary['sample_rate_hz'] == 20.0
+    assert summary['metrics'] == analysis.analyze(T, LEFT, RIGHT)
+    assert summary['metrics_positive'] == analysis.analyze(T, LEFT, RIGHT, positive_only=True)
+    assert analysis.summarize('empty.csv', [], [], [])['metrics'] is None
+
+
+def test_chart_samples():
+    full = analysis.chart_samples(T, LEFT, RIGHT)
+    assert full == {'t': T, 'left': LEFT, 'right': RIGHT, 'total': [20, 30, 50, 60, 80, 50, 30]}
+    assert analysis.chart_samples(T, LEFT, RIGHT, points=4) == full
+
+    # Two runs, samples 0-2 and 3-6: min and max of each at its first time
+    assert analysis.chart_samples(T, LEFT, RIGHT, points=2) == {
+        't': [0.0, 0.0, 0.15, 0.15],
+        'left': [10, 30, 20, 60],
+        'right': [10, 20, -10, 30],
+        'total': [20, 50, 30, 80],
+    }
+
+
+def test_load_summary_reads_the_csv_once(tmp_path):
+    path = str(tmp_path / 'session.csv')
+    with open(path, 'w', newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(['timestamp', 'left_sensor', 'right_sensor', 'esp32_time_ms', 'esp32_time_us', 'channels'])
+        for time_us, left, right in zip(t_us(T), LEFT, RIGHT):
+            writer.writerow(['2024-01-01T00:00:00Z', left, right, time_us // 1000, time_us, f'{left};{right}'])
+
+    summary = analysis.load_summary(path)
+    assert summary['metrics']['impulse']['250'] == pytest.approx(13.5)
+    assert summary['metrics']['time_to_peak'] == pytest.approx(0.2)
+    assert os.path.exists(analysis.summary_path(path))
+    os.remove(path)
+    assert analysis.load_summary(path) == summary
+
+
+def test_running_metrics_over_batches():
+    running = analysis.RunningMetrics()
+    times = t_us(T)
+    running.add(times[:3], LEFT[:3], RIGHT[:3])
+    snapshot = running.snapshot()
+    # 0.1 s so far: only the 50 and 100 ms windows are reached
+    assert snapshot['force_ms'] == {'50': 30, '100': 50}
+    assert snapshot['peak_force'] == 50
+    assert snapshot['time_to_peak'] == 0.1
+    assert snapshot['impulse'] == pytest.approx(4.0)
+
+    running.add(times[3:], LEFT[3:], RIGHT[3:])
+    snapshot = running.snapshot()
+    assert snapshot['sample_count'] == 7
+    assert snapshot['elapsed'] == 0.3
+    assert snapshot['current_force'] == 30
+    assert snapshot['peak_force'] == 80
+    assert snapshot['time_to_peak'] == 0.2
+    assert snapshot['impulse'] == pytest.approx(15.0)
+    assert snapshot['force_ms'] == {'50': 30, '100': 50, '150': 60, '200': 80, '250': 50}
+    assert snapshot['rfd'] == pytest.approx({'50': 600, '100': 500, '150': 400, '200': 400, '250': 200})
+
+    # The whole session agrees with the one-pass analysis
+    metrics = analysis.analyze(*running.arrays())
+    assert metrics['force_ms'] == snapshot['force_ms']
+    assert metrics['time_to_peak'] == snapshot['time_to_peak']
+
+    running.reset()
+    assert running.snapshot()['sample_count'] == 0
+    assert len(running.arrays()[0]) == 0
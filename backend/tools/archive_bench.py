@@ -0,0 +1,101 @@
+"""Compression ratio and download throughput of the session archive.
+
+Each session CSV is compressed at a few zstd levels (archive.compress_session)
+and then read back the two ways /api/download serves an archived session:
+passed through compressed (client accepts zstd) and decompressed on the fly.
+Without arguments a synthetic session in the recorder's CSV format is used;
+pass real sessions from test_data/ to measure those. The originals are not
+touched.
+
+    venv/bin/python tools/archive_bench.py test_data/imtp_test_*.csv
+    venv/bin/python tools/archive_bench.py --seconds 600
+"""
+import argparse
+import math
+import os
+import random
+import shutil
+import sys
+import tempfile
+import time
+import tracemalloc
+from datetime import datetime, timedelta
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+
+import archive  # noqa: E402
+
+LEVELS = (3, archive.LEVEL, 19)
+
+
+def synthetic_session(path, seconds, rate, channels, seed):
+    """Quiet standing, a 3 s pull and rest, written like save_to_csv"""
+    rng = random.Random(seed)
+    wall = datetime(2025, 1, 1, 10, 0, 0)
+    with open(path, 'w', newline='') as f:
+        f.write('timestamp,left_sensor,right_sensor,esp32_time_ms,esp32_time_us,channels\n')
+        for i in range(int(seconds * rate)):
+            t = i / rate
+            pull = 1500.0 * (1 - math.exp(-4 * (t % 10 - 2))) if 2 <= t % 10 < 5 else 0.0
+            values = [round(400.0 + pull / channels + rng.gauss(0, 3), 2) for _ in range(channels)]
+            half = (channels + 1) // 2
+            t_us = 5_000_000 + i * (1_000_000 // rate)
+            stamp = (wall + timedelta(microseconds=t_us)).isoformat() + 'Z'
+            f.write(f'{stamp},{round(sum(values[:half]), 2)},{round(sum(values[half:]), 2)},'
+                    f'{t_us // 1000},{t_us},{";".join(str(v) for v in values)}\n')
+
+
+def read_all(chunks):
+    """Drain a chunk iterator; returns (bytes, seconds, peak traced memory)"""
+    tracemalloc.start()
+    started = time.perf_counter()
+    total = sum(len(chunk) for chunk in chunks)
+    elapsed = time.perf_counter() - started
+    peak = tracemalloc.get_traced_memory()[1]
+    tracemalloc.stop()
+    return total, elapsed, peak
+
+
+def bench(csv_path, workdir):
+    size = os.path.getsize(csv_path)
+    print(f'{os.path.basename(csv_path)}: {size / 1e6:.1f} MB CSV')
+    for level in LEVELS:
+        copy = os.path.join(workdir, 'session.csv')
+        shutil.copyfile(csv_path, copy)
+        started = time.perf_counter()
+        original, compressed = archive.compress_session(copy, level=level)
+        compress_s = time.perf_counter() - started
+
+        stored = copy + archive.ARCHIVE_SUFFIX
+        raw_bytes, raw_s, _ = read_all(archive.iter_raw(stored))
+        csv_bytes, csv_s, peak = read_all(archive.iter_decompressed(stored))
+        assert raw_bytes == compressed and csv_bytes == original
+        print(f'  level {level:2d}: {compressed / 1e6:6.2f} MB ({original / compressed:4.1f}x), '
+              f'compress {original / 1e6 / compress_s:6.1f} MB/s | '
+              f'download zstd {raw_bytes / 1e6 / raw_s:7.0f} MB/s, '
+              f'decompressed {csv_bytes / 1e6 / csv_s:6.0f} MB/s of CSV '
+              f'(peak {peak / 1024:.0f} KiB)')
+        os.remove(stored)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('files', nargs='*', help='session CSVs (default: a synthetic session)')
+    parser.add_argument('--seconds', type=float, default=120, help='synthetic session length')
+    parser.add_argument('--rate', type=int, default=1000, help='synthetic samples per second')
+    parser.add_argument('--channels', type=int, default=2, help='synthetic ADS1220 channels')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as workdir:
+        files = args.files
+        if not files:
+            path = os.path.join(workdir, f'synthetic_{int(args.seconds)}s.csv')
+            synthetic_session(path, args.seconds, args.rate, args.channels, args.seed)
+            files = [path]
+        for path in files:
+            bench(path, workdir)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,159 @@
+"""Aggregate ingest throughput: one process vs. worker processes.
+
+Replays recorded-format sample frames ({"t0":..,"ch":..,"samples":[..]}, as
+the firmware sends them) from several simulated devices, each recording its
+own session CSV, and measures samples/s end to end: front hand-off, decode,
+CSV write and the batch coming back to the front (running metrics).
+
+- threads: one thread per device doing the decode and storage in the front
+  process, as app.py did before workers (all under one GIL)
+- workers N: the same work in N ingest worker processes (ingest_workers.py)
+
+Every run checks that each session CSV holds every sample, in order.
+
+    venv/bin/python tools/ingest_bench.py --devices 8 --workers 1 2 4 8
+"""
+import argparse
+import csv
+import json
+import os
+import random
+import sys
+import tempfile
+import threading
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+
+import analysis  # noqa: E402
+from ingest_workers import (KIND_BATCH, IngestPool, IngestWorker, decode_batch,  # noqa: E402
+                            unpack_device)
+
+HEADER = ['timestamp', 'left_sensor', 'right_sensor', 'esp32_time_ms', 'esp32_time_us', 'channels']
+
+
+def make_frames(seconds, rate, channels, batch, seed):
+    """Sample frames for one device, encoded like the firmware's"""
+    rng = random.Random(seed)
+    frames = []
+    t0 = 5_000_000
+    step = 1_000_000 // rate
+    for start in range(0, int(seconds * rate), batch):
+        samples = [{'dt': k * step, 'v': [round(400 + rng.gauss(0, 3), 2) for _ in range(channels)]}
+                   for k in range(batch)]
+        frames.append(json.dumps({'t0': t0 + start * step, 'ch': channels, 'samples': samples},
+                                 separators=(',', ':')))
+    return frames
+
+
+def new_session(workdir, device):
+    path = os.path.join(workdir, f'{device}.csv')
+    with open(path, 'w', newline='') as f:
+        csv.writer(f).writerow(HEADER)
+    return path
+
+
+def check_session(path, expected):
+    with open(path, newline='') as f:
+        rows = list(csv.reader(f))[1:]
+    times = [int(row[4]) for row in rows]
+    assert len(rows) == expected, f'{path}: {len(rows)} rows, expected {expected}'
+    assert times == sorted(times), f'{path}: samples out of order'
+
+
+class FrontMetrics:
+    """The front's per-batch work: running metrics per device"""
+
+    def __init__(self, devices):
+        self.metrics = {device: analysis.RunningMetrics() for device in devices}
+
+    def on_batch(self, device, t_us, left, right, readings, forward, recording):
+        if recording:
+            self.metrics[device].add(t_us, left, right)
+
+
+def run_threads(devices, frames, workdir):
+    front = FrontMetrics(devices)
+
+    def replay(device):
+        def emit(kind, parts):
+            if kind == KIND_BATCH:
+                payload = b''.join(bytes(memoryview(p).cast('B')) for p in parts)
+                front.on_batch(device, *decode_batch(unpack_device(payload)[1]))
+        worker = IngestWorker(emit)
+        worker.start(device, new_session(workdir, device))
+        for message in frames:
+            worker.frame(device, message.encode())
+        worker.stop(device, None)
+
+    threads = [threading.Thread(target=replay, args=(device,)) for device in devices]
+    started = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return time.perf_counter() - started
+
+
+def run_workers(devices, frames, workdir, workers):
+    front = FrontMetrics(devices)
+    pool = IngestPool(workers, front.on_batch)
+    pool.start()
+    try:
+        for device in devices:
+            pool.start_session(device, new_session(workdir, device))
+
+        def replay(device):
+            for message in frames:
+                pool.submit_frame(device, message)
+
+        threads = [threading.Thread(target=replay, args=(device,)) for device in devices]
+        started = time.perf_counter()
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        recorded = [pool.stop_session(device, timeout=600) for device in devices]
+        elapsed = time.perf_counter() - started
+        assert pool.stats['dropped'] == 0, 'records dropped'
+        return elapsed, recorded
+    finally:
+        pool.shutdown()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--devices', type=int, default=4, help='simulated ESP32s')
+    parser.add_argument('--workers', type=int, nargs='+', default=[1, 2, 4])
+    parser.add_argument('--seconds', type=float, default=30, help='recording per device')
+    parser.add_argument('--rate', type=int, default=1000, help='samples per second')
+    parser.add_argument('--channels', type=int, default=2)
+    parser.add_argument('--batch', type=int, default=50, help='samples per frame')
+    args = parser.parse_args()
+
+    devices = [f'esp32-{i}' for i in range(args.devices)]
+    frames = make_frames(args.seconds, args.rate, args.channels, args.batch, seed=1)
+    expected = len(frames) * args.batch
+    total = expected * len(devices)
+    print(f'{len(devices)} devices x {expected} samples ({args.channels} channels, '
+          f'{args.batch} per frame), {os.cpu_count()} CPUs')
+
+    with tempfile.TemporaryDirectory() as workdir:
+        elapsed = run_threads(devices, frames, workdir)
+        for device in devices:
+            check_session(os.path.join(workdir, f'{device}.csv'), expected)
+        baseline = total / elapsed
+        print(f'  threads    : {baseline / 1e3:8.0f} k samples/s')
+
+        for workers in args.workers:
+            elapsed, recorded = run_workers(devices, frames, workdir, workers)
+            assert recorded == [expected] * len(devices), f'recorded {recorded}'
+            for device in devices:
+                check_session(os.path.join(workdir, f'{device}.csv'), expected)
+            rate = total / elapsed
+            print(f'  workers {workers:<3d}: {rate / 1e3:8.0f} k samples/s '
+                  f'({rate / baseline:4.1f}x threads)')
+
+
+if __name__ == '__main__':
+    main()
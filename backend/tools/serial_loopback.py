@@ -0,0 +1,192 @@
+"""End-to-end check of the USB serial transport over a pseudo-terminal.
+
+A stand-in device on a pty answers the backend's hello with its
+registration, and after the start command streams sample frames in the
+firmware's format with log lines between them; a few frames are corrupted on
+the way. The real SerialIngest probes the ports (a second, silent pty must be
+passed over), serves the device and reads the stream. Exits non-zero if a
+sample is missing, duplicated or out of order beyond the corrupted frames,
+or if a corrupted frame was not counted.
+
+    venv/bin/python tools/serial_loopback.py --frames 2000 --channels 4
+"""
+import argparse
+import json
+import os
+import random
+import sys
+import threading
+import time
+import tty
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+
+from serial_ingest import TYPE_MESSAGE, Deframer, SerialIngest, encode_frame  # noqa: E402
+from ingest_workers import expand_sample_timestamps  # noqa: E402
+
+
+class StandInDevice:
+    """Talks to the backend the way the firmware's USB transport does"""
+
+    def __init__(self, args):
+        self.args = args
+        self.master, self.slave = os.openpty()
+        tty.setraw(self.master)
+        self.path = os.ttyname(self.slave)
+        self.deframer = Deframer()
+        self.random = random.Random(args.seed)
+        self.sent = []          # Samples in frames that arrived intact
+        self.corrupted = 0
+        self.log_lines = 0
+        self.pings = 0
+        self.bytes_sent = 0
+        self.started = None
+        self.thread = threading.Thread(target=self._run, daemon=True)
+        self.thread.start()
+
+    def close(self):
+        os.close(self.master)
+        os.close(self.slave)
+
+    def _write(self, data):
+        self.bytes_sent += len(data)
+        view = memoryview(data)
+        while view:
+            view = view[os.write(self.master, view):]
+
+    def _run(self):
+        try:
+            while True:
+                data = os.read(self.master, 4096)
+                for kind, payload in self.deframer.feed(data):
+                    if kind == TYPE_MESSAGE:
+                        self._on_message(json.loads(payload))
+        except OSError:
+            return
+
+    def _on_message(self, message):
+        if message.get('type') == 'backend':
+            self._write(b'USB host link up\r\n')
+            self._write(encode_frame('{"type":"esp32","device":"24:6F:28:AA:BB:CC"}'))
+        elif message.get('ping'):
+            self.pings += 1
+        elif message.get('command') == 'start':
+            threading.Thread(target=self._stream, daemon=True).start()
+
+    def _stream(self):
+        args = self.args
+        period_us = 1000000 // args.rate
+        t = 0
+        self.started = time.monotonic()
+        for index in range(args.frames):
+            samples = []
+            for _ in range(args.batch):
+                samples.append(((1 << 33) + t * period_us,
+                                tuple(float((t * (c + 1)) % 977) - 400.0 + c * 0.5 for c in range(args.channels))))
+                t += 1
+            t0 = samples[0][0]
+            payload = json.dumps({'t0': t0, 'ch': args.channels,
+                                  'samples': [{'dt': t_us - t0, 'v': list(v)} for t_us, v in samples]},
+                                 separators=(',', ':'))
+            frame = bytearray(encode_frame(payload))
+            if self.random.random() < args.corrupt:
+                # CRC or payload bytes; a corrupted length at the end of the
+                # stream would wait for bytes that never come (resync after
+                # a bad length is covered by test_usb_frame)
+                frame[self.random.randrange(6, len(frame))] ^= 1 << self.random.randrange(8)
+                self.corrupted += 1
+            else:
+                self.sent.extend(samples)
+            if index % args.log_every == 0:
+                self._write(f'Frame {index}: heap ok\r\n'.encode())
+                self.log_lines += 1
+            self._write(bytes(frame))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--frames', type=int, default=1000)
+    parser.add_argument('--batch', type=int, default=50, help='samples per frame')
+    parser.add_argument('--channels', type=int, default=2, help='ADS1220 channels per sample')
+    parser.add_argument('--rate', type=int, default=1000, help='sample rate for the timestamps')
+    parser.add_argument('--corrupt', type=float, default=0.02, help='fraction of frames corrupted')
+    parser.add_argument('--log-every', type=int, default=10, help='frames per log line')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    device = StandInDevice(args)
+    silent_master, silent_slave = os.openpty()
+    silent_path = os.ttyname(silent_slave)
+
+    received = []
+    logs = []
+    done = threading.Event()
+    expected = args.frames * args.batch
+
+    def serve(link):
+        while True:
+            message = link.receive()
+            if message is None:
+                return
+            data = json.loads(message)
+            if data.get('type') == 'esp32':
+                link.send('{"status":"registered","type":"esp32"}')
+                link.send('{"command":"start"}')
+            elif 't0' in data:
+                expand_sample_timestamps(data)
+                received.extend((s['t_us'], tuple(s['v'])) for s in data['samples'])
+                if len(received) >= expected - device.corrupted * args.batch and device.started:
+                    done.set()
+
+    ingest = SerialIngest(serve, ports=[device.path, silent_path],
+                          on_log=lambda path, line: logs.append(line), probe_timeout=1.0)
+    ingest.start()
+    done.wait(timeout=30 + args.frames * 0.01)
+    finished = time.monotonic()
+    time.sleep(0.2)
+    stats = dict(ingest.status().get(device.path, {}))
+    deadline = time.monotonic() + 3.0   # The silent port's probe may still run
+    while silent_path not in ingest.silent and time.monotonic() < deadline:
+        time.sleep(0.05)
+    silent_skipped = silent_path in ingest.silent and silent_path not in ingest.links
+
+    # Unplugging ends the link
+    device.close()
+    deadline = time.monotonic() + 2.0
+    while device.path in ingest.links and time.monotonic() < deadline:
+        time.sleep(0.05)
+    released = device.path not in ingest.links
+    ingest.stop()
+    os.close(silent_master)
+    os.close(silent_slave)
+
+    elapsed = finished - (device.started or finished)
+    print(f"sent {args.frames} frames of {args.batch} samples x {args.channels} channels "
+          f"({device.bytes_sent / 1e6:.1f} MB), corrupted {device.corrupted}, {device.log_lines} log lines")
+    print(f"received {len(received)} samples: {stats.get('frames', 0)} frames, "
+          f"{stats.get('crc_errors', 0)} CRC errors, {stats.get('oversize', 0)} oversize, "
+          f"{len(logs)} log lines, {device.pings} pings from the host")
+    if elapsed > 0:
+        print(f"throughput {device.bytes_sent / elapsed / 1e6:.1f} MB/s, {len(received) / elapsed:.0f} samples/s "
+              f"(full-speed USB CDC carries about 1 MB/s)")
+
+    failures = []
+    if received != device.sent:
+        failures.append(f"{len(set(device.sent) - set(received))} samples missing or reordered")
+    if stats.get('crc_errors', 0) + stats.get('oversize', 0) < device.corrupted:
+        failures.append("corrupted frames not counted")
+    if not silent_skipped:
+        failures.append(f"silent port {silent_path} was not passed over")
+    if not released:
+        failures.append("link not released after the device went away")
+    if sum(1 for line in logs if line.startswith('Frame ')) < device.log_lines - device.corrupted:
+        failures.append("log lines lost")
+    if failures:
+        print("FAIL: " + "; ".join(failures))
+        return 1
+    print("OK: all intact frames delivered in order, corrupted frames dropped")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
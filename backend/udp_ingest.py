@@ -0,0 +1,294 @@
+"""UDP sample transport: datagram decoding, loss recovery and receiver thread.
+
+Mirrors the datagram format in ESP32_PlatformIO_Project/include/udp_frame.h.
+Data datagrams carry a sequence number; every few datagrams the ESP32 sends an
+XOR parity datagram that rebuilds one lost datagram per group. Anything else
+is requested again with a NACK sent over the WebSocket control channel. A
+parity datagram covering zero datagrams is a position marker: the device sends
+one when the stream pauses so losses at the tail are noticed too.
+"""
+import logging
+import socket
+import struct
+import threading
+import time
+
+logger = logging.getLogger(__name__)
+
+MAGIC = 0x4C55
+VERSION = 3
+TYPE_DATA = 0
+TYPE_PARITY = 1
+
+HEADER = struct.Struct('<HBBIHH')   # magic, version, type, seq, count/length, group
+BASE = struct.Struct('<BBQ')        # channels, reserved, t0 (microseconds)
+OFFSET = struct.Struct('<I')        # dt, microseconds after t0
+MAX_SAMPLES = 100
+MAX_DATAGRAM = 1400
+MAX_BLOCK = 2 + MAX_DATAGRAM - HEADER.size
+
+
+def sample_size(channels):
+    """Bytes per sample: dt followed by one float32 per channel"""
+    return OFFSET.size + 4 * channels
+
+
+def samples_per_datagram(channels):
+    return min(MAX_SAMPLES, (MAX_DATAGRAM - HEADER.size - BASE.size) // sample_size(channels))
+
+
+def encode_data(seq, samples):
+    """Encode a data datagram from a list of (t_us, [value per channel]) tuples"""
+    base = samples[0][0]
+    channels = len(samples[0][1])
+    values = struct.Struct(f'<I{channels}f')
+    body = b''.join(values.pack(t - base, *v) for t, v in samples)
+    return (HEADER.pack(MAGIC, VERSION, TYPE_DATA, seq, len(samples), 0)
+            + BASE.pack(channels, 0, base) + body)
+
+
+def data_block(datagram):
+    """Parity block of a data datagram: count field followed by the samples"""
+    return datagram[8:10] + datagram[HEADER.size:]
+
+
+def xor_blocks(blocks):
+    """XOR blocks of different lengths, zero-padding to the longest"""
+    length = max(len(b) for b in blocks)
+    acc = bytearray(length)
+    for block in blocks:
+        for i, byte in enumerate(block):
+            acc[i] ^= byte
+    return bytes(acc)
+
+
+def encode_parity(first_seq, datagrams):
+    """Encode the parity datagram covering consecutive data datagrams"""
+    block = xor_blocks([data_block(d) for d in datagrams])
+    return HEADER.pack(MAGIC, VERSION, TYPE_PARITY, first_seq, len(block), len(datagrams)) + block
+
+
+def encode_marker(next_seq):
+    """Encode a position marker announcing the next sequence number"""
+    return HEADER.pack(MAGIC, VERSION, TYPE_PARITY, next_seq, 0, 0)
+
+
+def block_size(block):
+    """Length of the data in a parity block, without the zero padding"""
+    count = struct.unpack_from('<H', block)[0]
+    channels = block[2] if count else 0
+    return 2 + BASE.size + count * sample_size(channels)
+
+
+def decode_block(block):
+    """Decode a parity block into sample dicts: 't_us' (microseconds), 't'
+    (milliseconds, as in WebSocket frames) and 'v', one value per channel"""
+    count = struct.unpack_from('<H', block)[0]
+    channels, _, base = BASE.unpack_from(block, 2)
+    values = struct.Struct(f'<I{channels}f')
+    samples = []
+    for dt, *v in values.iter_unpack(block[2 + BASE.size:2 + BASE.size + count * values.size]):
+        t_us = base + dt
+        samples.append({'t_us': t_us, 't': t_us // 1000, 'v': v})
+    return samples
+
+
+class UdpStreamReassembler:
+    """Delivers samples in sequence order, rebuilding lost datagrams from
+    parity or NACK retransmits and giving up on them after a timeout"""
+
+    def __init__(self, deliver, request_retransmit, jitter_window=0.05,
+                 nack_timeout=0.25, max_nacks=3, history=512, clock=time.monotonic):
+        self.deliver = deliver
+        self.request_retransmit = request_retransmit
+        self.jitter_window = jitter_window
+        self.nack_timeout = nack_timeout
+        self.max_nacks = max_nacks
+        self.history = history
+        self.clock = clock
+        self.lock = threading.Lock()
+        self.stats = {
+            'datagrams': 0, 'duplicates': 0, 'recovered_parity': 0,
+            'recovered_nack': 0, 'lost': 0, 'nacks_sent': 0, 'invalid': 0,
+        }
+        self.reset()
+
+    def reset(self):
+        self.expected = None
+        self.started_at = None  # first datagram; delivery waits one jitter window
+        self.lowest_seen = None # to pick the first sequence despite reordering
+        self.blocks = {}      # seq -> parity block, pending and recently delivered
+        self.parity = {}      # first seq -> (group, block)
+        self.gap_since = None
+        self.nacks = {}       # seq -> (times sent, last sent)
+        self.announced = 0    # next seq according to parity/marker datagrams
+
+    def on_datagram(self, data):
+        """Feed one received datagram"""
+        if len(data) < HEADER.size:
+            self.stats['invalid'] += 1
+            return
+        magic, version, kind, seq, count, group = HEADER.unpack_from(data)
+        if magic != MAGIC or version != VERSION:
+            self.stats['invalid'] += 1
+            return
+
+        with self.lock:
+            if self.expected is None:
+                if self.started_at is None:
+                    self.started_at = self.clock()
+                self.lowest_seen = seq if self.lowest_seen is None else min(self.lowest_seen, seq)
+            if kind == TYPE_PARITY:
+                self.announced = max(self.announced, seq + group)
+                if group:
+                    self.parity[seq] = (group, bytes(data[HEADER.size:HEADER.size + count]))
+            elif kind == TYPE_DATA:
+                self.stats['datagrams'] += 1
+                # Device restarted its sequence: start over
+                if self.expected is not None and seq + self.history < self.expected:
+                    logger.info(f"UDP sequence restarted at {seq}")
+                    self.reset()
+                    self.started_at = self.clock()
+                    self.lowest_seen = seq
+                if (self.expected is not None and seq < self.expected) or seq in self.blocks:
+                    self.stats['duplicates'] += 1
+                    return
+                if seq in self.nacks:
+                    self.stats['recovered_nack'] += 1
+                    del self.nacks[seq]
+                self.blocks[seq] = data_block(data)
+            else:
+                self.stats['invalid'] += 1
+                return
+
+            if self.expected is None:
+                self._start_if_settled()
+                return
+            self._recover_from_parity()
+            self._flush()
+
+    def poll(self):
+        """Run timeouts: NACK missing datagrams, then give up on them"""
+        with self.lock:
+            if self.expected is None:
+                self._start_if_settled()
+                return
+            if self.expected in self.blocks:
+                self.gap_since = None
+                return
+            horizon = max([s for s in self.blocks if s > self.expected] + [self.announced])
+            if horizon <= self.expected:
+                self.gap_since = None
+                return
+
+            now = self.clock()
+            if self.gap_since is None:
+                self.gap_since = now
+            if now - self.gap_since < self.jitter_window:
+                return
+
+            for seq in range(self.expected, horizon):
+                if seq in self.blocks:
+                    continue
+                sent, last = self.nacks.get(seq, (0, None))
+                if last is not None and now - last < self.nack_timeout:
+                    continue
+                if sent >= self.max_nacks:
+                    if seq == self.expected:
+                        self.stats['lost'] += 1
+                        self.nacks.pop(seq, None)
+                        self.expected += 1
+                        self.gap_since = None
+                        self._flush()
+                    continue
+                self.nacks[seq] = (sent + 1, now)
+                self.stats['nacks_sent'] += 1
+                self.request_retransmit(seq)
+
+    def _start_if_settled(self):
+        # Datagrams reordered at the start of a stream would otherwise be
+        # dropped as duplicates: start from the lowest sequence seen within
+        # the first jitter window
+        if self.started_at is None or self.clock() - self.started_at < self.jitter_window:
+            return
+        self.expected = self.lowest_seen
+        self._recover_from_parity()
+        self._flush()
+
+    def _recover_from_parity(self):
+        for first, (group, parity_block) in list(self.parity.items()):
+            covered = range(first, first + group)
+            missing = [s for s in covered if s not in self.blocks]
+            if not missing:
+                del self.parity[first]
+            elif len(missing) == 1 and missing[0] >= (self.expected or 0):
+                others = [self.blocks[s] for s in covered if s != missing[0]]
+                block = xor_blocks([parity_block] + others)
+                self.blocks[missing[0]] = block[:block_size(block)]
+                self.nacks.pop(missing[0], None)
+                self.stats['recovered_parity'] += 1
+                del self.parity[first]
+            elif first + group <= (self.expected or 0) - self.history:
+                del self.parity[first]
+
+    def _flush(self):
+        while self.expected in self.blocks:
+            self.deliver(decode_block(self.blocks[self.expected]))
+            self.expected += 1
+            self.gap_since = None
+        # Keep recent blocks around for parity of groups still in flight
+        floor = self.expected - self.history
+        for seq in [s for s in self.blocks if s < floor]:
+            del self.blocks[seq]
+
+
+class UdpIngestServer:
+    """Receives sample datagrams on a UDP port and feeds a reassembler, or
+    hands them to on_datagram(data, address) unparsed (the ingest workers
+    reassemble per device)"""
+
+    def __init__(self, port, on_samples, on_nack, host='0.0.0.0', on_datagram=None, **reassembler_options):
+        self.address = (host, port)
+        self.reassembler = UdpStreamReassembler(on_samples, on_nack, **reassembler_options)
+        self.on_datagram = on_datagram
+        self.sock = None
+        self.thread = None
+        self.running = False
+
+    @property
+    def port(self):
+        return self.sock.getsockname()[1] if self.sock else self.address[1]
+
+    def start(self):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+        self.sock.bind(self.address)
+        self.sock.settimeout(0.01)
+        self.running = True
+        self.thread = threading.Thread(target=self._run, daemon=True)
+        self.thread.start()
+        logger.info(f"UDP sample receiver listening on port {self.port}")
+
+    def stop(self):
+        self.running = False
+        if self.thread:
+            self.thread.join(timeout=1)
+        if self.sock:
+            self.sock.close()
+
+    def _run(self):
+        while self.running:
+            try:
+                data, address = self.sock.recvfrom(2048)
+                if self.on_datagram:
+                    self.on_datagram(data, address)
+                    continue
+                self.reassembler.on_datagram(data)
+            except socket.timeout:
+                pass
+            except OSError:
+                break
+            except Exception as e:
+                logger.error(f"Error processing UDP datagram: {e}")
+            if not self.on_datagram:
+                self.reassembler.poll()
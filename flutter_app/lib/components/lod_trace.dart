@@ -0,0 +1,100 @@
+import 'package:flutter/material.dart';
+import '../services/min_max_pyramid.dart';
+
+/// The whole of a [LodSeries] as a line per channel, drawn from one min/max
+/// bucket per physical pixel so the cost stays the same however long the
+/// series gets. Repaints when [repaint] notifies, without rebuilding.
+class LodTrace extends StatelessWidget {
+  final LodSeries series;
+  final List<Color> colors;
+  final Listenable? repaint;
+
+  const LodTrace({
+    super.key,
+    required this.series,
+    required this.colors,
+    this.repaint,
+  });
+
+  @override
+  Widget build(BuildContext context) {
+    return RepaintBoundary(
+      child: CustomPaint(
+        size: Size.infinite,
+        painter: _LodTracePainter(
+          series,
+          colors,
+          MediaQuery.devicePixelRatioOf(context),
+          repaint,
+        ),
+      ),
+    );
+  }
+}
+
+class _LodTracePainter extends CustomPainter {
+  final LodSeries series;
+  final List<Color> colors;
+  final double pixelRatio;
+
+  _LodTracePainter(
+    this.series,
+    this.colors,
+    this.pixelRatio,
+    Listenable? repaint,
+  ) : super(repaint: repaint);
+
+  @override
+  void paint(Canvas canvas, Size size) {
+    if (series.length < 2 || size.width <= 0 || size.height <= 0) return;
+
+    // Value range of the whole series, from the pyramids' top levels
+    var lo = double.infinity;
+    var hi = double.negativeInfinity;
+    for (var c = 0; c < series.channelCount; c++) {
+      final (min, max) = series.channel(c).range(0, series.length);
+      if (min < lo) lo = min;
+      if (max > hi) hi = max;
+    }
+    if (hi - lo < 1) {
+      hi = lo + 1;
+    }
+
+    final start = series.startTime;
+    final span = series.endTime - start;
+    if (span <= 0) return;
+    final points = series.points(
+      start,
+      series.endTime,
+      (size.width * pixelRatio).ceil(),
+    );
+    final xScale = size.width / span;
+    final yScale = size.height / (hi - lo);
+
+    for (var c = 0; c < series.channelCount; c++) {
+      final path = Path();
+      for (var i = 0; i < points.length; i++) {
+        final x = (points.timeAt(i) - start) * xScale;
+        final y = size.height - (points.valueAt(c, i) - lo) * yScale;
+        if (i == 0) {
+          path.moveTo(x, y);
+        } else {
+          path.lineTo(x, y);
+        }
+      }
+      canvas.drawPath(
+        path,
+        Paint()
+          ..color = colors[c % colors.length]
+          ..style = PaintingStyle.stroke
+          ..strokeWidth = 1.5,
+      );
+    }
+  }
+
+  @override
+  bool shouldRepaint(_LodTracePainter oldDelegate) =>
+      oldDelegate.series != series ||
+      oldDelegate.colors != colors ||
+      oldDelegate.pixelRatio != pixelRatio;
+}
@@ -1,11 +1,10 @@
 import 'package:flutter/material.dart';
 import 'package:google_fonts/google_fonts.dart';
 import 'package:fl_chart/fl_chart.dart';
-import 'package:http/http.dart' as http;
-import 'dart:convert';
 
 import '../models/user.dart';
-import '../services/backend_config.dart';
+import '../services/min_max_pyramid.dart';
+import '../services/session_results.dart';
 
 class PrintableResultsScreen extends StatefulWidget {
   final User user;
@@ -18,7 +17,12 @@ class PrintableResultsScreen extends StatefulWidget {
 }
 
 class _PrintableResultsScreenState extends State<PrintableResultsScreen> {
-  final List<Map<String, dynamic>> _testData = [];
+  // Min/max pairs fetched for the chart: one per pixel of a wide screen
+  static const int _chartPoints = 2048;
+
+  int _sampleCount = 0;
+  double _sampleRateHz = 0;
+  final LodSeries _chartSeries = LodSeries(3); // Left, right, total
   bool _isLoading = true;
   String? _error;
   Map<String, dynamic> _analysis = {};
@@ -31,197 +35,40 @@ class _PrintableResultsScreenState extends State<PrintableResultsScreen> {
 
   Future<void> _loadTestData() async {
     try {
-      // Get latest CSV file from backend
-      final response = await http.get(
-        Uri.parse('${BackendConfig.baseUrl}/api/csv_files'),
-      );
-
-      if (response.statusCode == 200) {
-        final data = json.decode(response.body);
-        final files = data['files'] as List;
-
-        if (files.isNotEmpty) {
-          // Get the most recent CSV file
-          final latestFile = files.first;
-          await _loadCsvData(latestFile['filename']);
-        } else {
-          setState(() {
-            _error = 'No test data available';
-            _isLoading = false;
-          });
-        }
-      } else {
-        throw Exception('Failed to get CSV files');
-      }
-    } catch (e) {
-      setState(() {
-        _error = 'Error loading test data: $e';
-        _isLoading = false;
-      });
-    }
-  }
-
-  Future<void> _loadCsvData(String filename) async {
-    try {
-      final response = await http.get(
-        Uri.parse('${BackendConfig.baseUrl}/api/download/$filename'),
-      );
-
-      if (response.statusCode == 200) {
-        final csvData = response.body;
-        _parseCsvData(csvData);
-        _calculateAnalysis();
-
+      // Summary of the latest session, and only the samples the chart draws
+      final session = await SessionResults.latest(points: _chartPoints);
+      if (session == null) {
         setState(() {
+          _error = 'No test data available';
           _isLoading = false;
         });
-      } else {
-        throw Exception('Failed to download CSV file');
+        return;
+      }
+      _sampleCount = session.sampleCount;
+      _sampleRateHz = session.sampleRateHz;
+      _analysis = session.analysis();
+
+      final samples = session.samples;
+      _chartSeries.clear();
+      for (int i = 0; i < samples.length; i++) {
+        _chartSeries.add(samples.times[i], [
+          samples.left[i],
+          samples.right[i],
+          samples.total[i],
+        ]);
       }
+
+      setState(() {
+        _isLoading = false;
+      });
     } catch (e) {
       setState(() {
-        _error = 'Error loading CSV data: $e';
+        _error = 'Error loading test data: $e';
         _isLoading = false;
       });
     }
   }
 
-  void _parseCsvData(String csvData) {
-    final lines = csvData.split('\n');
-    _testData.clear();
-
-    // Skip header row and parse data
-    for (int i = 1; i < lines.length; i++) {
-      final line = lines[i].trim();
-      if (line.isNotEmpty) {
-        final values = line.split(',');
-        if (values.length >= 4) {
-          try {
-            _testData.add({
-              'timestamp': values[0],
-              'left': double.parse(values[1]),
-              'right': double.parse(values[2]),
-              'esp32_time': int.parse(values[3]),
-            });
-          } catch (e) {
-            // Skip invalid rows
-          }
-        }
-      }
-    }
-  }
-
-  void _calculateAnalysis() {
-    if (_testData.isEmpty) return;
-
-    final leftValues = _testData.map((d) => d['left'] as double).toList();
-    final rightValues = _testData.map((d) => d['right'] as double).toList();
-
-    // Calculate peak forces
-    final leftPeak = leftValues.reduce((a, b) => a > b ? a : b);
-    final rightPeak = rightValues.reduce((a, b) => a > b ? a : b);
-    final totalPeak = leftPeak + rightPeak;
-
-    // Calculate force at specific time intervals
-    final force50ms = _getForceAtTime(50);
-    final force100ms = _getForceAtTime(100);
-    final force150ms = _getForceAtTime(150);
-    final force200ms = _getForceAtTime(200);
-    final force250ms = _getForceAtTime(250);
-
-    // Calculate RFD (Rate of Force Development)
-    final rfd50 = _calculateRFD(50);
-    final rfd100 = _calculateRFD(100);
-    final rfd150 = _calculateRFD(150);
-    final rfd200 = _calculateRFD(200);
-    final rfd250 = _calculateRFD(250);
-
-    // Calculate impulse
-    final impulse50 = _calculateImpulse(50);
-    final impulse100 = _calculateImpulse(100);
-    final impulse150 = _calculateImpulse(150);
-    final impulse200 = _calculateImpulse(200);
-    final impulse250 = _calculateImpulse(250);
-
-    // Calculate test duration and time to peak
-    final testDuration = _testData.length * 0.01;
-    final timeToPeak = _getTimeToPeak();
-
-    // Calculate asymmetry
-    final asymmetry = ((leftPeak - rightPeak) / totalPeak * 100);
-
-    _analysis = {
-      'peakForce': totalPeak.round(),
-      'leftPeakForce': leftPeak.round(),
-      'rightPeakForce': rightPeak.round(),
-      'force50ms': force50ms.round(),
-      'force100ms': force100ms.round(),
-      'force150ms': force150ms.round(),
-      'force200ms': force200ms.round(),
-      'force250ms': force250ms.round(),
-      'force50msPercent': ((force50ms / totalPeak) * 100).round(),
-      'force100msPercent': ((force100ms / totalPeak) * 100).round(),
-      'force150msPercent': ((force150ms / totalPeak) * 100).round(),
-      'force200msPercent': ((force200ms / totalPeak) * 100).round(),
-      'force250msPercent': ((force250ms / totalPeak) * 100).round(),
-      'rfd50': rfd50.round(),
-      'rfd100': rfd100.round(),
-      'rfd150': rfd150.round(),
-      'rfd200': rfd200.round(),
-      'rfd250': rfd250.round(),
-      'impulse50': impulse50.round(),
-      'impulse100': impulse100.round(),
-      'impulse150': impulse150.round(),
-      'impulse200': impulse200.round(),
-      'impulse250': impulse250.round(),
-      'testDuration': testDuration,
-      'timeToPeak': timeToPeak,
-      'asymmetry': asymmetry,
-    };
-  }
-
-  double _getForceAtTime(int milliseconds) {
-    final index = (milliseconds / 10).round();
-    if (index < _testData.length) {
-      final data = _testData[index];
-      return (data['left'] as double) + (data['right'] as double);
-    }
-    return 0.0;
-  }
-
-  double _calculateRFD(int milliseconds) {
-    final force = _getForceAtTime(milliseconds);
-    return force / (milliseconds / 1000.0);
-  }
-
-  double _calculateImpulse(int milliseconds) {
-    final endIndex = (milliseconds / 10).round();
-    double impulse = 0.0;
-
-    for (int i = 0; i < endIndex && i < _testData.length; i++) {
-      final data = _testData[i];
-      impulse += (data['left'] as double) + (data['right'] as double);
-    }
-
-    return impulse * 0.01;
-  }
-
-  double _getTimeToPeak() {
-    double maxForce = 0;
-    int peakIndex = 0;
-
-    for (int i = 0; i < _testData.length; i++) {
-      final data = _testData[i];
-      final totalForce = (data['left'] as double) + (data['right'] as double);
-      if (totalForce > maxForce) {
-        maxForce = totalForce;
-        peakIndex = i;
-      }
-    }
-
-    return peakIndex * 0.01;
-  }
-
   @override
   Widget build(BuildContext context) {
     return Scaffold(
@@ -377,7 +224,7 @@ class _PrintableResultsScreenState extends State<PrintableResultsScreen> {
                 ],
               ),
               Text(
-                'Data Points: ${_testData.length}',
+                'Data Points: $_sampleCount',
                 style: GoogleFonts.montserrat(
                   fontSize:
                       MediaQuery.of(context).size.width * 0.035 > 14
@@ -424,7 +271,11 @@ class _PrintableResultsScreenState extends State<PrintableResultsScreen> {
           SizedBox(
             height:
                 MediaQuery.of(context).size.height * 0.35, // Responsive height
-            child: LineChart(_createPrintChart()),
+            child: LayoutBuilder(
+              builder:
+                  (context, constraints) =>
+                      LineChart(_createPrintChart(constraints.maxWidth)),
+            ),
           ),
           const SizedBox(height: 10),
           // Responsive legend that wraps on smaller screens
@@ -468,21 +319,26 @@ class _PrintableResultsScreenState extends State<PrintableResultsScreen> {
     );
   }
 
-  LineChartData _createPrintChart() {
-    if (_testData.isEmpty) {
+  /// One min/max bucket per logical pixel of [width], however long the test
+  LineChartData _createPrintChart(double width) {
+    if (_chartSeries.isEmpty) {
       return LineChartData();
     }
 
+    final points = _chartSeries.points(
+      _chartSeries.startTime,
+      _chartSeries.endTime,
+      width.ceil(),
+    );
     final leftSpots = <FlSpot>[];
     final rightSpots = <FlSpot>[];
     final totalSpots = <FlSpot>[];
 
-    for (int i = 0; i < _testData.length; i++) {
-      final time = i * 0.01;
-      final data = _testData[i];
-      leftSpots.add(FlSpot(time, data['left']));
-      rightSpots.add(FlSpot(time, data['right']));
-      totalSpots.add(FlSpot(time, data['left'] + data['right']));
+    for (int i = 0; i < points.length; i++) {
+      final time = points.timeAt(i);
+      leftSpots.add(FlSpot(time, points.valueAt(0, i)));
+      rightSpots.add(FlSpot(time, points.valueAt(1, i)));
+      totalSpots.add(FlSpot(time, points.valueAt(2, i)));
     }
 
     return LineChartData(
@@ -744,7 +600,7 @@ class _PrintableResultsScreenState extends State<PrintableResultsScreen> {
             style: GoogleFonts.montserrat(fontSize: 11, color: Colors.black87),
           ),
           Text(
-            '• Sampling rate: 100 Hz (10ms intervals)',
+            '• Sampling rate: ${_sampleRateHz.round()} Hz',
             style: GoogleFonts.montserrat(fontSize: 11, color: Colors.black87),
           ),
           Text(
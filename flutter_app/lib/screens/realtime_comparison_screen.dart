@@ -3,6 +3,7 @@ import 'package:google_fonts/google_fonts.dart';
 import 'package:provider/provider.dart';
 import '../services/loadcell_api_service.dart';
 import '../services/websocket_service.dart';
+import '../components/lod_trace.dart';
 
 /// Demonstration screen showing both REST API and WebSocket data side-by-side
 /// This helps you choose between the two real-time options
@@ -149,6 +150,21 @@ class _RealtimeComparisonScreenState extends State<RealtimeComparisonScreen> {
                             ),
                           ),
                         ),
+                        const SizedBox(height: 12),
+                        // Session so far, one min/max bucket per pixel
+                        Container(
+                          height: 100,
+                          padding: const EdgeInsets.all(8),
+                          decoration: BoxDecoration(
+                            color: const Color(0xFF2A2A2A),
+                            borderRadius: BorderRadius.circular(12),
+                          ),
+                          child: LodTrace(
+                            series: _wsService.sessionTrace,
+                            colors: const [Colors.green, Colors.lightGreen],
+                            repaint: _wsService,
+                          ),
+                        ),
                       ],
                     ),
                   ),
@@ -1,6 +1,7 @@
 import 'package:flutter/material.dart';
 import '../services/websocket_service.dart';
 import '../services/backend_config.dart';
+import '../components/lod_trace.dart';
 import 'package:http/http.dart' as http;
 import 'dart:convert';
 import 'package:logging/logging.dart';
@@ -405,6 +406,23 @@ class _RealtimeLoadcellDashboardState extends State<RealtimeLoadcellDashboard> {
                 ],
               ),
             ),
+            const SizedBox(height: 12),
+
+            // Whole session, one min/max bucket per pixel
+            Container(
+              height: 120,
+              padding: const EdgeInsets.all(8),
+              decoration: BoxDecoration(
+                color: Colors.black,
+                borderRadius: BorderRadius.circular(8),
+                border: Border.all(color: Colors.grey[700]!),
+              ),
+              child: LodTrace(
+                series: _wsService.sessionTrace,
+                colors: const [Colors.red, Colors.green],
+                repaint: _wsService,
+              ),
+            ),
             const SizedBox(height: 20),
           ],
 
@@ -1,11 +1,11 @@
 import 'package:flutter/material.dart';
 import 'package:google_fonts/google_fonts.dart';
 import 'package:syncfusion_flutter_charts/charts.dart';
-import 'package:http/http.dart' as http;
-import 'dart:convert';
 import '../models/user.dart';
 import '../components/standard_page_layout.dart';
-import '../services/backend_config.dart';
+import '../services/force_analysis_index.dart';
+import '../services/min_max_pyramid.dart';
+import '../services/session_results.dart';
 
 class TestResultsScreenV2 extends StatefulWidget {
   final User user;
@@ -24,6 +24,14 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
   String? _error;
   bool _showOnlyPositive = true; // Default to showing only positive values
 
+  // _chartData (left, right, total) for plotting one bucket per pixel
+  final LodSeries _lod = LodSeries(3);
+  final List<double> _lodValues = [0, 0, 0];
+  double _viewStart = 0; // Visible time window (seconds)
+  double _viewEnd = 0;
+  (double, double, int)? _plotKey;
+  List<LoadCellData> _plotData = [];
+
   // Time interval settings for RFD analysis
   double _t1 = 0.0; // First time marker
   double _t2 = 0.1; // Second time marker (100ms default)
@@ -38,7 +46,9 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
   ];
 
   // Analysis results
+  SessionResults? _session;
   Map<String, dynamic> _analysis = {};
+  ForceAnalysisIndex _index = ForceAnalysisIndex.empty; // Over _chartData
 
   // Chart controller for interactions
   late ZoomPanBehavior _zoomPanBehavior;
@@ -57,210 +67,58 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
 
   Future<void> _loadTestData() async {
     try {
-      // Get latest CSV file from backend
-      final response = await http.get(
-        Uri.parse('${BackendConfig.baseUrl}/api/csv_files'),
-      );
-
-      if (response.statusCode == 200) {
-        final data = json.decode(response.body);
-        final files = data['files'] as List;
-
-        if (files.isNotEmpty) {
-          // Get the most recent CSV file
-          final latestFile = files.first;
-          await _loadCsvData(latestFile['filename']);
-        } else {
-          setState(() {
-            _error = 'No test data available';
-            _isLoading = false;
-          });
-        }
-      } else {
-        throw Exception('Failed to get CSV files');
-      }
-    } catch (e) {
-      setState(() {
-        _error = 'Error loading test data: $e';
-        _isLoading = false;
-      });
-    }
-  }
-
-  Future<void> _loadCsvData(String filename) async {
-    try {
-      final response = await http.get(
-        Uri.parse('${BackendConfig.baseUrl}/api/download/$filename'),
-      );
-
-      if (response.statusCode == 200) {
-        final csvData = response.body;
-        _parseCsvData(csvData);
-        _calculateAnalysis();
-
+      // Summary of the latest session, and every sample for the cursors
+      final session = await SessionResults.latest();
+      if (session == null) {
         setState(() {
+          _error = 'No test data available';
           _isLoading = false;
         });
-      } else {
-        throw Exception('Failed to download CSV file');
+        return;
       }
+      _session = session;
+      _setSamples(session.samples);
+      _calculateAnalysis();
+
+      setState(() {
+        _isLoading = false;
+      });
     } catch (e) {
       setState(() {
-        _error = 'Error loading CSV data: $e';
+        _error = 'Error loading test data: $e';
         _isLoading = false;
       });
     }
   }
 
-  void _parseCsvData(String csvData) {
-    final lines = csvData.split('\n');
+  void _setSamples(SessionSamples samples) {
     _rawChartData.clear();
-
-    // Skip header row and parse data
-    for (int i = 1; i < lines.length; i++) {
-      final line = lines[i].trim();
-      if (line.isNotEmpty) {
-        final values = line.split(',');
-        if (values.length >= 4) {
-          try {
-            final timeSeconds = i * 0.01; // 10ms intervals
-            final left = double.parse(values[1]);
-            final right = double.parse(values[2]);
-
-            // Store raw data (including negative values)
-            _rawChartData.add(
-              LoadCellData(
-                timeSeconds: timeSeconds,
-                leftForce: left,
-                rightForce: right,
-                totalForce: left + right,
-              ),
-            );
-          } catch (e) {
-            // Skip invalid rows
-          }
-        }
-      }
+    for (var i = 0; i < samples.length; i++) {
+      // Store raw data (including negative values)
+      _rawChartData.add(
+        LoadCellData(
+          timeSeconds: samples.times[i],
+          leftForce: samples.left[i],
+          rightForce: samples.right[i],
+          totalForce: samples.total[i],
+        ),
+      );
     }
 
     // Apply filtering based on current setting
     _applyDataFiltering();
-
-    // Limit data points for performance if needed
-    if (_chartData.length > 5000) {
-      final step = (_chartData.length / 5000).ceil();
-      _chartData =
-          _chartData
-              .where((element) => _chartData.indexOf(element) % step == 0)
-              .toList();
+    if (_lod.isNotEmpty) {
+      _viewStart = _lod.startTime;
+      _viewEnd = _lod.endTime;
     }
   }
 
+  /// The preset windows come from the stored summary, computed once on the
+  /// backend with the same definitions as [ForceAnalysisIndex]
   void _calculateAnalysis() {
-    if (_chartData.isEmpty) return;
-
-    final leftValues = _chartData.map((d) => d.leftForce).toList();
-    final rightValues = _chartData.map((d) => d.rightForce).toList();
-    final totalValues = _chartData.map((d) => d.totalForce).toList();
-
-    // Calculate peak forces
-    final leftPeak = leftValues.reduce((a, b) => a > b ? a : b);
-    final rightPeak = rightValues.reduce((a, b) => a > b ? a : b);
-    final totalPeak = totalValues.reduce((a, b) => a > b ? a : b);
-
-    // Calculate force at specific time intervals
-    final force50ms = _getForceAtTime(0.05);
-    final force100ms = _getForceAtTime(0.1);
-    final force150ms = _getForceAtTime(0.15);
-    final force200ms = _getForceAtTime(0.2);
-    final force250ms = _getForceAtTime(0.25);
-
-    // Calculate RFD (Rate of Force Development)
-    final rfd50 = force50ms / 0.05;
-    final rfd100 = force100ms / 0.1;
-    final rfd150 = force150ms / 0.15;
-    final rfd200 = force200ms / 0.2;
-    final rfd250 = force250ms / 0.25;
-
-    // Calculate impulse (area under curve)
-    final impulse50 = _calculateImpulse(0.05);
-    final impulse100 = _calculateImpulse(0.1);
-    final impulse150 = _calculateImpulse(0.15);
-    final impulse200 = _calculateImpulse(0.2);
-    final impulse250 = _calculateImpulse(0.25);
-
-    // Calculate test duration and time to peak
-    final testDuration = _chartData.last.timeSeconds;
-    final timeToPeak = _getTimeToPeak();
-
-    // Calculate asymmetry
-    final asymmetry = ((leftPeak - rightPeak) / totalPeak * 100);
-
-    _analysis = {
-      'peakForce': totalPeak.round(),
-      'leftPeakForce': leftPeak.round(),
-      'rightPeakForce': rightPeak.round(),
-      'force50ms': force50ms.round(),
-      'force100ms': force100ms.round(),
-      'force150ms': force150ms.round(),
-      'force200ms': force200ms.round(),
-      'force250ms': force250ms.round(),
-      'force50msPercent': ((force50ms / totalPeak) * 100).round(),
-      'force100msPercent': ((force100ms / totalPeak) * 100).round(),
-      'force150msPercent': ((force150ms / totalPeak) * 100).round(),
-      'force200msPercent': ((force200ms / totalPeak) * 100).round(),
-      'force250msPercent': ((force250ms / totalPeak) * 100).round(),
-      'rfd50': rfd50.round(),
-      'rfd100': rfd100.round(),
-      'rfd150': rfd150.round(),
-      'rfd200': rfd200.round(),
-      'rfd250': rfd250.round(),
-      'impulse50': impulse50.round(),
-      'impulse100': impulse100.round(),
-      'impulse150': impulse150.round(),
-      'impulse200': impulse200.round(),
-      'impulse250': impulse250.round(),
-      'testDuration': testDuration,
-      'timeToPeak': timeToPeak,
-      'asymmetry': asymmetry,
-    };
-  }
-
-  double _getForceAtTime(double timeSeconds) {
-    final targetData = _chartData.firstWhere(
-      (d) => d.timeSeconds >= timeSeconds,
-      orElse: () => _chartData.last,
-    );
-    return targetData.totalForce;
-  }
-
-  double _calculateImpulse(double timeSeconds) {
-    double impulse = 0.0;
-    double previousTime = 0.0;
-
-    for (final data in _chartData) {
-      if (data.timeSeconds > timeSeconds) break;
-
-      final deltaTime = data.timeSeconds - previousTime;
-      impulse += data.totalForce * deltaTime;
-      previousTime = data.timeSeconds;
-    }
-
-    return impulse;
-  }
-
-  double _getTimeToPeak() {
-    double maxForce = 0;
-    double peakTime = 0;
-
-    for (final data in _chartData) {
-      if (data.totalForce > maxForce) {
-        maxForce = data.totalForce;
-        peakTime = data.timeSeconds;
-      }
-    }
-
-    return peakTime;
+    _analysis =
+        _session?.analysis(positiveOnly: _showOnlyPositive) ??
+        <String, dynamic>{};
   }
 
   /// Returns positive value or 0 if negative (filters out noise/calibration issues)
@@ -289,6 +147,60 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
       // Show all values (including negative)
       _chartData = List.from(_rawChartData);
     }
+
+    _lod.clear();
+    for (final data in _chartData) {
+      _lodValues[0] = data.leftForce;
+      _lodValues[1] = data.rightForce;
+      _lodValues[2] = data.totalForce;
+      _lod.add(data.timeSeconds, _lodValues);
+    }
+    _plotKey = null;
+
+    _index = ForceAnalysisIndex(
+      times: [for (final data in _chartData) data.timeSeconds],
+      left: [for (final data in _chartData) data.leftForce],
+      right: [for (final data in _chartData) data.rightForce],
+      total: [for (final data in _chartData) data.totalForce],
+    );
+  }
+
+  /// Chart points for the visible window plus half a window either side
+  /// (so a pan has data until the next update), one min/max bucket per
+  /// logical pixel of [width]
+  List<LoadCellData> _plotPoints(double width) {
+    if (_lod.isEmpty) return const [];
+    final margin = (_viewEnd - _viewStart) / 2;
+    final start = (_viewStart - margin).clamp(_lod.startTime, _lod.endTime);
+    final end = (_viewEnd + margin).clamp(_lod.startTime, _lod.endTime);
+    final visible = _viewEnd - _viewStart;
+    final buckets =
+        visible > 0 ? (width * (end - start) / visible).ceil() : width.ceil();
+    final key = (start, end, buckets);
+    if (key == _plotKey) return _plotData;
+
+    final points = _lod.points(start, end, buckets);
+    _plotData = [
+      for (var i = 0; i < points.length; i++)
+        LoadCellData(
+          timeSeconds: points.timeAt(i),
+          leftForce: points.valueAt(0, i),
+          rightForce: points.valueAt(1, i),
+          totalForce: points.valueAt(2, i),
+        ),
+    ];
+    _plotKey = key;
+    return _plotData;
+  }
+
+  /// Follow zooming and panning on the time axis
+  void _onZoom(ZoomPanArgs args) {
+    if (args.axis?.name != 'time' || _lod.isEmpty) return;
+    final span = _lod.endTime - _lod.startTime;
+    setState(() {
+      _viewStart = _lod.startTime + args.currentZoomPosition * span;
+      _viewEnd = _viewStart + args.currentZoomFactor * span;
+    });
   }
 
   /// Toggle between showing all values vs only positive values
@@ -341,28 +253,6 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
     );
   }
 
-  /// Calculate RFD (Rate of Force Development) for current T1-T2 interval
-  double _calculateRFDForInterval() {
-    final forceAtT1 = _getForceAtTime(_t1);
-    final forceAtT2 = _getForceAtTime(_t2);
-    final timeDiff = _t2 - _t1;
-
-    if (timeDiff <= 0) return 0.0;
-
-    return (forceAtT2 - forceAtT1) / timeDiff; // N/s
-  }
-
-  /// Calculate slope (similar to RFD but can be used for any interval)
-  double _calculateSlopeForInterval(double startTime, double endTime) {
-    final forceAtStart = _getForceAtTime(startTime);
-    final forceAtEnd = _getForceAtTime(endTime);
-    final timeDiff = endTime - startTime;
-
-    if (timeDiff <= 0) return 0.0;
-
-    return (forceAtEnd - forceAtStart) / timeDiff;
-  }
-
   @override
   Widget build(BuildContext context) {
     return StandardPageLayout(
@@ -512,7 +402,14 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
                     const SizedBox(height: 15),
 
                     // Chart
-                    SizedBox(height: 300, child: _buildSyncfusionChart()),
+                    SizedBox(
+                      height: 300,
+                      child: LayoutBuilder(
+                        builder:
+                            (context, constraints) =>
+                                _buildSyncfusionChart(constraints.maxWidth),
+                      ),
+                    ),
 
                     const SizedBox(height: 20),
 
@@ -556,17 +453,25 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
     );
   }
 
-  Widget _buildSyncfusionChart() {
+  Widget _buildSyncfusionChart(double width) {
+    final plotData = _plotPoints(width);
     return SfCartesianChart(
       backgroundColor: Colors.transparent,
       plotAreaBackgroundColor: Colors.transparent,
       zoomPanBehavior: _zoomPanBehavior,
+      onZooming: _onZoom,
+      onZoomEnd: _onZoom,
+      onZoomReset: _onZoom,
       legend: Legend(
         isVisible: true,
         position: LegendPosition.bottom,
         textStyle: const TextStyle(color: Colors.white),
       ),
       primaryXAxis: NumericAxis(
+        name: 'time',
+        // Fixed to the whole session: only the visible part is plotted
+        minimum: _lod.isEmpty ? null : _lod.startTime,
+        maximum: _lod.isEmpty ? null : _lod.endTime,
         title: AxisTitle(
           text: 'Time (seconds)',
           textStyle: const TextStyle(color: Colors.white),
@@ -602,7 +507,7 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
       series: <CartesianSeries>[
         // Total Force (Area Chart)
         AreaSeries<LoadCellData, double>(
-          dataSource: _chartData,
+          dataSource: plotData,
           xValueMapper: (LoadCellData data, _) => data.timeSeconds,
           yValueMapper: (LoadCellData data, _) => data.totalForce,
           name: 'Total Force',
@@ -612,7 +517,7 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
         ),
         // Left Force
         LineSeries<LoadCellData, double>(
-          dataSource: _chartData,
+          dataSource: plotData,
           xValueMapper: (LoadCellData data, _) => data.timeSeconds,
           yValueMapper: (LoadCellData data, _) => data.leftForce,
           name: 'Left Force',
@@ -621,7 +526,7 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
         ),
         // Right Force
         LineSeries<LoadCellData, double>(
-          dataSource: _chartData,
+          dataSource: plotData,
           xValueMapper: (LoadCellData data, _) => data.timeSeconds,
           yValueMapper: (LoadCellData data, _) => data.rightForce,
           name: 'Right Force',
@@ -644,6 +549,12 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
 
   void _resetZoom() {
     _zoomPanBehavior.reset();
+    if (_lod.isNotEmpty) {
+      setState(() {
+        _viewStart = _lod.startTime;
+        _viewEnd = _lod.endTime;
+      });
+    }
   }
 
   Widget _buildRFDTable() {
@@ -654,7 +565,7 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
         'start': _t1,
         'end': _t2,
         'push': 1,
-        'rfd': _calculateRFDForInterval(),
+        'rfd': _index.slope(_t1, _t2),
       },
       ..._presetIntervals.map(
         (interval) => {
@@ -662,7 +573,7 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
           'start': interval['start'],
           'end': interval['end'],
           'push': 1,
-          'rfd': _calculateSlopeForInterval(
+          'rfd': _index.slope(
             interval['start'] as double,
             interval['end'] as double,
           ),
@@ -918,6 +829,10 @@ class _TestResultsScreenV2State extends State<TestResultsScreenV2> {
             'Impulse 0-250 ms, N',
             _analysis['impulse250'].toString(),
           ),
+          _buildAnalysisItem(
+            'Impulse T1-T2, N',
+            _index.impulseBetween(_t1, _t2).round().toString(),
+          ),
         ]),
 
         const SizedBox(height: 20),
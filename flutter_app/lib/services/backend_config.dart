@@ -106,6 +106,9 @@ class BackendConfig {
 
   /// Get the detected WebSocket URL (efficient direct WebSocket)
   static String get wsUrl {
+    // WEBSOCKET_URL wins, e.g. ws://<esp32-ip>:81 to stream from the device
+    // directly without the backend
+    if (AppConfig.websocketUrl.isNotEmpty) return AppConfig.websocketUrl;
     if (_detectedWsUrl != null) return _detectedWsUrl!;
 
     final host = baseUrl.replaceFirst('http://', '').split(':')[0];
@@ -0,0 +1,152 @@
+import 'dart:typed_data';
+
+/// One test's force-time samples arranged for analysis queries. Times are
+/// sorted, so force at a time is a binary search (O(log n)). Impulse is
+/// precomputed as a running sum, so impulse up to a time or over any
+/// interval costs two lookups instead of a pass over the samples. Built
+/// once per data set (O(n)); peaks and time to peak are found at the same
+/// time.
+///
+/// Results match the screen's original formulas exactly:
+/// - force at t is the total of the first sample at or after t, or of the
+///   last sample;
+/// - impulse to t sums total * (time - previous time) over the samples up
+///   to t, starting from time 0, in the same order.
+class ForceAnalysisIndex {
+  final Float64List _times;
+  final Float64List _totals;
+  // _impulse[k]: impulse of the first k samples
+  final Float64List _impulse;
+  final double leftPeak;
+  final double rightPeak;
+  final double totalPeak;
+  final double timeToPeak;
+
+  ForceAnalysisIndex._(
+    this._times,
+    this._totals,
+    this._impulse,
+    this.leftPeak,
+    this.rightPeak,
+    this.totalPeak,
+    this.timeToPeak,
+  );
+
+  /// [times] must be non-decreasing; all lists the same length
+  factory ForceAnalysisIndex({
+    required List<double> times,
+    required List<double> left,
+    required List<double> right,
+    required List<double> total,
+  }) {
+    final n = times.length;
+    if (left.length != n || right.length != n || total.length != n) {
+      throw ArgumentError('Sample lists differ in length');
+    }
+    final sortedTimes = Float64List(n);
+    final totals = Float64List(n);
+    final impulse = Float64List(n + 1);
+    var leftPeak = n > 0 ? left[0] : 0.0;
+    var rightPeak = n > 0 ? right[0] : 0.0;
+    var totalPeak = n > 0 ? total[0] : 0.0;
+    var maxForce = 0.0;
+    var peakTime = 0.0;
+    var sum = 0.0;
+    var previousTime = 0.0;
+    for (var i = 0; i < n; i++) {
+      final time = times[i];
+      if (i > 0 && time < times[i - 1]) {
+        throw ArgumentError.value(time, 'times[$i]', 'Not sorted');
+      }
+      sortedTimes[i] = time;
+      totals[i] = total[i];
+      sum += total[i] * (time - previousTime);
+      previousTime = time;
+      impulse[i + 1] = sum;
+
+      // As reduce((a, b) => a > b ? a : b): ties take the later value
+      if (!(leftPeak > left[i])) leftPeak = left[i];
+      if (!(rightPeak > right[i])) rightPeak = right[i];
+      if (!(totalPeak > total[i])) totalPeak = total[i];
+      if (total[i] > maxForce) {
+        maxForce = total[i];
+        peakTime = time;
+      }
+    }
+    return ForceAnalysisIndex._(
+      sortedTimes,
+      totals,
+      impulse,
+      leftPeak,
+      rightPeak,
+      totalPeak,
+      peakTime,
+    );
+  }
+
+  static final ForceAnalysisIndex empty = ForceAnalysisIndex(
+    times: const [],
+    left: const [],
+    right: const [],
+    total: const [],
+  );
+
+  int get length => _times.length;
+  bool get isEmpty => _times.isEmpty;
+
+  /// Time of the last sample
+  double get duration => _times.last;
+
+  /// Total force of the first sample at or after [time], or of the last
+  /// sample if there is none. Throws a [StateError] when empty.
+  double forceAt(double time) {
+    if (_times.isEmpty) throw StateError('No samples');
+    final index = _lowerBound(time);
+    return _totals[index < _times.length ? index : _times.length - 1];
+  }
+
+  /// Impulse (N·s) from time 0 up to and including the samples at [time]
+  double impulseTo(double time) => _impulse[_upperBound(time)];
+
+  /// Impulse (N·s) of the samples after [start] up to [end]
+  double impulseBetween(double start, double end) =>
+      impulseTo(end) - impulseTo(start);
+
+  /// Change in force per second from [start] to [end] (N/s); 0 for an
+  /// empty or reversed interval
+  double slope(double start, double end) {
+    final timeDiff = end - start;
+    if (timeDiff <= 0) return 0.0;
+    return (forceAt(end) - forceAt(start)) / timeDiff;
+  }
+
+  // First index with a time at or after [time]
+  int _lowerBound(double time) {
+    var lo = 0;
+    var hi = _times.length;
+    while (lo < hi) {
+      final mid = (lo + hi) >> 1;
+      if (_times[mid] < time) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  // First index with a time after [time]
+  int _upperBound(double time) {
+    var lo = 0;
+    var hi = _times.length;
+    while (lo < hi) {
+      final mid = (lo + hi) >> 1;
+      if (_times[mid] <= time) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+}
@@ -0,0 +1,272 @@
+import 'dart:typed_data';
+
+/// Min and max of a growing series at power-of-two bucket sizes, kept up to
+/// date as values are added (amortised O(1) per value). The min and max of
+/// any index range come from O(log n) stored buckets plus at most
+/// 2 * [leafSize] values, so a chart can ask for one bucket per pixel at any
+/// zoom for about the same cost.
+class MinMaxPyramid {
+  /// Values per bucket on the lowest stored level; shorter runs are read
+  /// from the values themselves
+  static const int leafSize = 16;
+
+  Float32List _values = Float32List(1024);
+  int _length = 0;
+  // Level k holds buckets of leafSize << k values
+  final List<Float32List> _mins = [];
+  final List<Float32List> _maxs = [];
+  final List<int> _counts = [];
+
+  int get length => _length;
+
+  double operator [](int index) {
+    IndexError.check(index, _length, indexable: this);
+    return _values[index];
+  }
+
+  void add(double value) {
+    if (_length == _values.length) {
+      _values = _grown(_values);
+    }
+    _values[_length++] = value;
+    if (_length % leafSize == 0) {
+      var lo = _values[_length - 1];
+      var hi = lo;
+      for (var i = _length - leafSize; i < _length - 1; i++) {
+        final v = _values[i];
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+      }
+      _push(0, lo, hi);
+    }
+  }
+
+  void _push(int level, double lo, double hi) {
+    if (level == _counts.length) {
+      _mins.add(Float32List(64));
+      _maxs.add(Float32List(64));
+      _counts.add(0);
+    }
+    final count = _counts[level];
+    if (count == _mins[level].length) {
+      _mins[level] = _grown(_mins[level]);
+      _maxs[level] = _grown(_maxs[level]);
+    }
+    final mins = _mins[level];
+    final maxs = _maxs[level];
+    mins[count] = lo;
+    maxs[count] = hi;
+    _counts[level] = count + 1;
+    if (count.isOdd) {
+      // Completed a pair: one bucket on the level above
+      final pairLo = mins[count - 1];
+      final pairHi = maxs[count - 1];
+      _push(
+        level + 1,
+        pairLo < lo ? pairLo : lo,
+        pairHi > hi ? pairHi : hi,
+      );
+    }
+  }
+
+  /// Min and max of the values in [start, end). An empty range gives
+  /// (infinity, -infinity).
+  (double, double) range(int start, int end) {
+    RangeError.checkValidRange(start, end, _length);
+    var lo = double.infinity;
+    var hi = double.negativeInfinity;
+    var i = start;
+    while (i < end) {
+      // Largest complete stored bucket that starts at i and ends by end
+      var level = -1;
+      var size = leafSize;
+      while (level + 1 < _counts.length &&
+          i % size == 0 &&
+          i + size <= end &&
+          i ~/ size < _counts[level + 1]) {
+        level++;
+        size <<= 1;
+      }
+      if (level < 0) {
+        final v = _values[i++];
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+      } else {
+        size >>= 1;
+        final bucket = i ~/ size;
+        final bucketLo = _mins[level][bucket];
+        final bucketHi = _maxs[level][bucket];
+        if (bucketLo < lo) lo = bucketLo;
+        if (bucketHi > hi) hi = bucketHi;
+        i += size;
+      }
+    }
+    return (lo, hi);
+  }
+
+  void clear() {
+    _length = 0;
+    _counts.fillRange(0, _counts.length, 0);
+  }
+
+  static Float32List _grown(Float32List list) {
+    return Float32List(list.length * 2)..setRange(0, list.length, list);
+  }
+}
+
+/// Samples of one or more channels against non-decreasing time, with a
+/// [MinMaxPyramid] per channel, for charts that draw one bucket per pixel
+/// however long the series is.
+class LodSeries {
+  final int channelCount;
+  final List<MinMaxPyramid> _channels;
+  Float64List _times = Float64List(1024);
+  int _length = 0;
+
+  LodSeries(this.channelCount)
+    : _channels = List.generate(channelCount, (_) => MinMaxPyramid());
+
+  int get length => _length;
+  bool get isEmpty => _length == 0;
+  bool get isNotEmpty => _length > 0;
+
+  double get startTime => timeAt(0);
+  double get endTime => timeAt(_length - 1);
+
+  double timeAt(int index) {
+    IndexError.check(index, _length, indexable: this);
+    return _times[index];
+  }
+
+  double valueAt(int channel, int index) => _channels[channel][index];
+
+  MinMaxPyramid channel(int channel) => _channels[channel];
+
+  /// Add a sample with one value per channel. [time] must not be before
+  /// the previous sample's.
+  void add(double time, List<double> values) {
+    if (values.length != channelCount) {
+      throw ArgumentError.value(values, 'values', 'Expected $channelCount');
+    }
+    if (_length > 0 && time < _times[_length - 1]) {
+      throw ArgumentError.value(time, 'time', 'Before the previous sample');
+    }
+    if (_length == _times.length) {
+      _times = Float64List(_length * 2)..setRange(0, _length, _times);
+    }
+    _times[_length++] = time;
+    for (var c = 0; c < channelCount; c++) {
+      _channels[c].add(values[c]);
+    }
+  }
+
+  void clear() {
+    _length = 0;
+    for (final channel in _channels) {
+      channel.clear();
+    }
+  }
+
+  /// Keep every other sample (the first, third, ...), in place, for series
+  /// that must stay under a size limit. O(n).
+  void halve() {
+    final count = _length;
+    clear();
+    final values = List<double>.filled(channelCount, 0);
+    // Sample i moves to i / 2, so it is read before anything overwrites it
+    for (var i = 0; i < count; i += 2) {
+      for (var c = 0; c < channelCount; c++) {
+        values[c] = _channels[c]._values[i];
+      }
+      add(_times[i], values);
+    }
+  }
+
+  /// Index of the first sample at or after [time] among [from, to)
+  int lowerBound(double time, [int from = 0, int? to]) {
+    var lo = from;
+    var hi = to ?? _length;
+    while (lo < hi) {
+      final mid = (lo + hi) >> 1;
+      if (_times[mid] < time) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  /// The samples from [startTime] to [endTime] (inclusive) reduced to at
+  /// most [count] equal time buckets, each drawn as its min and max. When
+  /// the range holds no more than [count] samples they are returned as
+  /// they are.
+  LodPoints points(double startTime, double endTime, int count) {
+    final first = lowerBound(startTime);
+    var last = lowerBound(endTime, first);
+    while (last < _length && _times[last] == endTime) {
+      last++;
+    }
+    if (last - first <= count || endTime <= startTime) {
+      final points = LodPoints._(last - first, channelCount);
+      for (var i = first; i < last; i++) {
+        points._add(_times[i]);
+        for (var c = 0; c < channelCount; c++) {
+          points._values[c][points.length - 1] = _channels[c]._values[i];
+        }
+      }
+      return points;
+    }
+
+    final points = LodPoints._(count * 2, channelCount);
+    final width = (endTime - startTime) / count;
+    var from = first;
+    for (var b = 0; b < count; b++) {
+      final to =
+          b == count - 1
+              ? last
+              : lowerBound(startTime + (b + 1) * width, from, last);
+      if (to > from) {
+        final time = _times[from];
+        points._add(time);
+        points._add(time);
+        for (var c = 0; c < channelCount; c++) {
+          final (lo, hi) = _channels[c].range(from, to);
+          points._values[c][points.length - 2] = lo;
+          points._values[c][points.length - 1] = hi;
+        }
+      }
+      from = to;
+    }
+    return points;
+  }
+}
+
+/// Points from [LodSeries.points] in time order: two per bucket (min, then
+/// max, at the time of the bucket's first sample), or one per sample.
+class LodPoints {
+  final Float64List _times;
+  final List<Float32List> _values;
+  int _length = 0;
+
+  LodPoints._(int capacity, int channels)
+    : _times = Float64List(capacity),
+      _values = List.generate(channels, (_) => Float32List(capacity));
+
+  int get length => _length;
+  bool get isEmpty => _length == 0;
+
+  double timeAt(int index) {
+    IndexError.check(index, _length, indexable: this);
+    return _times[index];
+  }
+
+  double valueAt(int channel, int index) {
+    IndexError.check(index, _length, indexable: this);
+    return _values[channel][index];
+  }
+
+  void _add(double time) {
+    _times[_length++] = time;
+  }
+}
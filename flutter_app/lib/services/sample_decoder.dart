@@ -0,0 +1,299 @@
+import 'dart:async';
+import 'dart:collection';
+import 'dart:convert';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+/// Samples decoded from one or more WebSocket frames, in arrival order.
+/// Timestamps are milliseconds, stored as offsets from [baseMs]; left and
+/// right are the plate sums.
+class SampleBatch {
+  final int baseMs;
+  final Int32List offsetsMs;
+  final Float32List left;
+  final Float32List right;
+
+  const SampleBatch(this.baseMs, this.offsetsMs, this.left, this.right);
+
+  int get length => offsetsMs.length;
+  bool get isEmpty => offsetsMs.isEmpty;
+  int timeAt(int index) => baseMs + offsetsMs[index];
+}
+
+/// Collects decoded samples into typed buffers until [take]
+class SampleBatchBuilder {
+  final List<int> _times = [];
+  Float32List _left = Float32List(256);
+  Float32List _right = Float32List(256);
+
+  int get length => _times.length;
+  bool get isEmpty => _times.isEmpty;
+  bool get isNotEmpty => _times.isNotEmpty;
+
+  void add(int timeMs, double left, double right) {
+    final index = _times.length;
+    if (index == _left.length) {
+      _left = _grown(_left);
+      _right = _grown(_right);
+    }
+    _times.add(timeMs);
+    _left[index] = left;
+    _right[index] = right;
+  }
+
+  /// Add the samples of a decoded frame. Frames straight from the ESP32
+  /// carry per-channel values ('v') and time offsets ('dt') from a base
+  /// time in microseconds ('t0'); the backend adds 'l', 'r' and 't' before
+  /// forwarding.
+  void addFrame(Map<String, dynamic> data, {int? nowMs}) {
+    final samples = data['samples'] as List;
+    final int? base = data['t0'];
+    for (final sample in samples) {
+      num left = sample['l'] ?? 0;
+      num right = sample['r'] ?? 0;
+      final values = sample['v'];
+      if (sample['l'] == null && values is List) {
+        // First half of the channels is the left plate
+        final half = (values.length + 1) ~/ 2;
+        left = 0;
+        right = 0;
+        for (var c = 0; c < values.length; c++) {
+          if (c < half) {
+            left += values[c] as num;
+          } else {
+            right += values[c] as num;
+          }
+        }
+      }
+      int? time = sample['t'];
+      if (time == null && base != null) {
+        time = (base + ((sample['dt'] ?? 0) as int)) ~/ 1000;
+      }
+      add(
+        time ?? nowMs ?? DateTime.now().millisecondsSinceEpoch,
+        left.toDouble(),
+        right.toDouble(),
+      );
+    }
+  }
+
+  SampleBatch take() {
+    final count = _times.length;
+    final baseMs = count > 0 ? _times.first : 0;
+    final offsets = Int32List(count);
+    for (var i = 0; i < count; i++) {
+      offsets[i] = _times[i] - baseMs;
+    }
+    final batch = SampleBatch(
+      baseMs,
+      offsets,
+      _left.sublist(0, count),
+      _right.sublist(0, count),
+    );
+    _times.clear();
+    return batch;
+  }
+
+  static Float32List _grown(Float32List list) {
+    return Float32List(list.length * 2)..setRange(0, list.length, list);
+  }
+}
+
+/// Decode one WebSocket message. Sample frames go into [into]; any other
+/// JSON object is returned. Returns null for sample frames and for
+/// messages that are not JSON objects.
+Map<String, dynamic>? decodeMessage(String message, SampleBatchBuilder into) {
+  Object? data;
+  try {
+    data = jsonDecode(message);
+  } on FormatException {
+    return null;
+  }
+  if (data is! Map<String, dynamic>) return null;
+  if (data['samples'] is List) {
+    into.addFrame(data);
+    return null;
+  }
+  return data;
+}
+
+/// The most recent [capacity] samples in fixed typed arrays. Adding is O(1)
+/// per sample; once full, each new sample overwrites the oldest.
+class SampleRing {
+  // Timestamps are offsets from one base time; a sample further than this
+  // from it (a different clock) restarts the ring
+  static const int _maxOffsetMs = 0x3FFFFFFF;
+
+  final int capacity;
+  final Int32List _offsets;
+  final Float32List _left;
+  final Float32List _right;
+  int _start = 0;
+  int _length = 0;
+  int _baseMs = 0;
+
+  SampleRing(this.capacity)
+    : _offsets = Int32List(capacity),
+      _left = Float32List(capacity),
+      _right = Float32List(capacity);
+
+  int get length => _length;
+  bool get isEmpty => _length == 0;
+  bool get isNotEmpty => _length > 0;
+
+  int _slot(int index) {
+    final slot = _start + index;
+    return slot < capacity ? slot : slot - capacity;
+  }
+
+  /// Oldest sample first
+  int timeAt(int index) => _baseMs + _offsets[_slot(index)];
+  double leftAt(int index) => _left[_slot(index)];
+  double rightAt(int index) => _right[_slot(index)];
+
+  void add(SampleBatch batch) {
+    for (var i = 0; i < batch.length; i++) {
+      push(batch.timeAt(i), batch.left[i], batch.right[i]);
+    }
+  }
+
+  void push(int timeMs, double left, double right) {
+    if (_length == 0) {
+      _baseMs = timeMs;
+    } else if ((timeMs - _baseMs).abs() > _maxOffsetMs) {
+      clear();
+      _baseMs = timeMs;
+    }
+    final int slot;
+    if (_length < capacity) {
+      slot = _slot(_length);
+      _length++;
+    } else {
+      slot = _start;
+      _start = _slot(1);
+    }
+    _offsets[slot] = timeMs - _baseMs;
+    _left[slot] = left;
+    _right[slot] = right;
+  }
+
+  void clear() {
+    _start = 0;
+    _length = 0;
+  }
+}
+
+/// A read-only list of reading maps ({'left', 'right', 'timestamp'}) over a
+/// [SampleRing]. Maps are built only for the entries read.
+class SampleRingReadings extends ListBase<Map<String, dynamic>> {
+  final SampleRing ring;
+
+  SampleRingReadings(this.ring);
+
+  @override
+  int get length => ring.length;
+
+  @override
+  set length(int value) => throw UnsupportedError('Read-only view');
+
+  @override
+  Map<String, dynamic> operator [](int index) {
+    IndexError.check(index, length, indexable: this);
+    return {
+      'left': ring.leftAt(index),
+      'right': ring.rightAt(index),
+      'timestamp': ring.timeAt(index),
+    };
+  }
+
+  @override
+  void operator []=(int index, Map<String, dynamic> value) =>
+      throw UnsupportedError('Read-only view');
+}
+
+/// Decodes WebSocket messages on a background isolate. Samples come back
+/// as one [SampleBatch] per [flushInterval] (a display frame), so the UI
+/// isolate handles one batch per frame however many messages arrived.
+/// Other messages come back decoded, as they arrive.
+class SampleDecoder {
+  final Duration flushInterval;
+
+  Isolate? _isolate;
+  ReceivePort? _fromWorker;
+  SendPort? _toWorker;
+  final List<String> _pending = []; // Messages sent while the isolate starts
+
+  SampleDecoder({this.flushInterval = const Duration(milliseconds: 16)});
+
+  bool get isRunning => _fromWorker != null;
+
+  Future<void> start(
+    void Function(SampleBatch batch) onBatch,
+    void Function(Map<String, dynamic> message) onMessage,
+  ) async {
+    if (_fromWorker != null) return;
+    final fromWorker = ReceivePort();
+    _fromWorker = fromWorker;
+    fromWorker.listen((message) {
+      if (message is SendPort) {
+        _toWorker = message;
+        _pending.forEach(message.send);
+        _pending.clear();
+      } else if (message is SampleBatch) {
+        onBatch(message);
+      } else if (message is Map<String, dynamic>) {
+        onMessage(message);
+      }
+    });
+    final isolate = await Isolate.spawn(_decoderMain, [
+      fromWorker.sendPort,
+      flushInterval.inMicroseconds,
+    ], debugName: 'SampleDecoder');
+    if (_fromWorker != fromWorker) {
+      // Stopped while starting
+      isolate.kill(priority: Isolate.immediate);
+      return;
+    }
+    _isolate = isolate;
+  }
+
+  void add(String message) {
+    final toWorker = _toWorker;
+    if (toWorker != null) {
+      toWorker.send(message);
+    } else if (_fromWorker != null) {
+      _pending.add(message);
+    }
+  }
+
+  void stop() {
+    _isolate?.kill(priority: Isolate.immediate);
+    _fromWorker?.close();
+    _isolate = null;
+    _fromWorker = null;
+    _toWorker = null;
+    _pending.clear();
+  }
+}
+
+void _decoderMain(List<Object> args) {
+  final toUi = args[0] as SendPort;
+  final flushInterval = Duration(microseconds: args[1] as int);
+  final inbox = ReceivePort();
+  final builder = SampleBatchBuilder();
+  Timer? flush;
+
+  toUi.send(inbox.sendPort);
+  inbox.listen((message) {
+    final other = decodeMessage(message as String, builder);
+    if (other != null) {
+      toUi.send(other);
+    }
+    if (builder.isNotEmpty) {
+      flush ??= Timer(flushInterval, () {
+        flush = null;
+        toUi.send(builder.take());
+      });
+    }
+  });
+}
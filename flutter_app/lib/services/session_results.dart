@@ -0,0 +1,119 @@
+import 'dart:convert';
+import 'dart:typed_data';
+import 'package:http/http.dart' as http;
+import 'backend_config.dart';
+
+/// A stored session as the results screens show it: the IMTP summary the
+/// backend computes once per session (backend/analysis.py) and the samples
+/// to chart, instead of the whole CSV. Sample times are seconds from the
+/// session's first sample by the ESP32 clock, the time base of the summary.
+class SessionResults {
+  /// Windows of the force, RFD and impulse rows, in milliseconds
+  static const List<int> windowsMs = [50, 100, 150, 200, 250];
+
+  final String filename;
+  final Map<String, dynamic> summary;
+  final SessionSamples samples;
+
+  SessionResults._(this.filename, this.summary, this.samples);
+
+  /// The newest session, or null if there is none yet. See [load] for
+  /// [points].
+  static Future<SessionResults?> latest({int? points}) async {
+    final response = await http.get(
+      Uri.parse('${BackendConfig.baseUrl}/api/csv_files?limit=1'),
+    );
+    if (response.statusCode != 200) {
+      throw Exception('Failed to get CSV files');
+    }
+    final files = json.decode(response.body)['files'] as List;
+    if (files.isEmpty) return null;
+    return load(files.first['filename'], points: points);
+  }
+
+  /// Summary and samples of one session. With [points], a longer session's
+  /// samples come as that many min/max pairs, enough for a chart of the
+  /// whole session; without, every sample.
+  static Future<SessionResults> load(String filename, {int? points}) async {
+    final base = '${BackendConfig.baseUrl}/api/sessions/$filename';
+    final responses = await Future.wait([
+      http.get(Uri.parse('$base/summary')),
+      http.get(
+        Uri.parse(
+          points == null ? '$base/samples' : '$base/samples?points=$points',
+        ),
+      ),
+    ]);
+    if (responses[0].statusCode != 200) {
+      throw Exception('Failed to load the summary of $filename');
+    }
+    if (responses[1].statusCode != 200) {
+      throw Exception('Failed to load the samples of $filename');
+    }
+    return SessionResults._(
+      filename,
+      json.decode(responses[0].body) as Map<String, dynamic>,
+      SessionSamples.fromJson(json.decode(responses[1].body)),
+    );
+  }
+
+  /// Samples recorded, whatever was fetched for the chart
+  int get sampleCount => (summary['sample_count'] as num?)?.toInt() ?? 0;
+
+  /// Mean sample rate by the ESP32 clock
+  double get sampleRateHz =>
+      (summary['sample_rate_hz'] as num?)?.toDouble() ?? 0;
+
+  /// The screens' analysis table (peakForce, force50ms, rfd50, ...) from
+  /// the summary's metrics, or from its positive-only metrics with
+  /// [positiveOnly]; empty for a session without samples
+  Map<String, dynamic> analysis({bool positiveOnly = false}) {
+    final metrics =
+        summary[positiveOnly ? 'metrics_positive' : 'metrics']
+            as Map<String, dynamic>?;
+    if (metrics == null) return {};
+    double value(String name) => (metrics[name] as num).toDouble();
+    int window(String name, int ms) =>
+        (metrics[name]['$ms'] as num).toDouble().round();
+
+    return {
+      'peakForce': value('peak_force').round(),
+      'leftPeakForce': value('left_peak_force').round(),
+      'rightPeakForce': value('right_peak_force').round(),
+      for (final ms in windowsMs) 'force${ms}ms': window('force_ms', ms),
+      for (final ms in windowsMs)
+        'force${ms}msPercent': window('force_percent', ms),
+      for (final ms in windowsMs) 'rfd$ms': window('rfd', ms),
+      for (final ms in windowsMs) 'impulse$ms': window('impulse', ms),
+      'testDuration': value('test_duration'),
+      'timeToPeak': value('time_to_peak'),
+      'asymmetry': value('asymmetry'),
+    };
+  }
+}
+
+/// Samples from /api/sessions/<file>/samples: time in seconds, forces as
+/// recorded (tared ADC counts per plate, not newtons)
+class SessionSamples {
+  final Float64List times;
+  final Float64List left;
+  final Float64List right;
+  final Float64List total;
+
+  SessionSamples._(this.times, this.left, this.right, this.total);
+
+  factory SessionSamples.fromJson(Map<String, dynamic> data) {
+    Float64List column(String name) => Float64List.fromList([
+      for (final value in data[name] as List) (value as num).toDouble(),
+    ]);
+    return SessionSamples._(
+      column('t'),
+      column('left'),
+      column('right'),
+      column('total'),
+    );
+  }
+
+  int get length => times.length;
+  bool get isEmpty => times.isEmpty;
+}
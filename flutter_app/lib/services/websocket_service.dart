@@ -3,16 +3,42 @@ import 'dart:async';
 import 'package:flutter/foundation.dart';
 import 'package:web_socket_channel/web_socket_channel.dart';
 import 'package:web_socket_channel/status.dart' as status;
+import '../config.dart';
 import 'backend_config.dart';
+import 'min_max_pyramid.dart';
+import 'sample_decoder.dart';
 
 /// Optional WebSocket service for true real-time loadcell data streaming
 /// Use this instead of polling for millisecond-level updates
+///
+/// Messages are decoded on a background isolate ([SampleDecoder]); samples
+/// arrive here as one typed batch per display frame, and listeners are
+/// notified once per batch.
 class WebSocketService with ChangeNotifier {
+  /// Samples kept in [recentSamples]
+  static const int recentCapacity = 1000;
+
+  /// Samples kept in [sessionTrace]: 20 minutes at 1 kHz before it is
+  /// thinned out
+  static const int sessionTraceLimit = 1200000;
+
   WebSocketChannel? _channel;
   bool _isConnected = false;
   bool _isConnecting = false;
   Map<String, dynamic> _latestReading = {};
-  final List<Map<String, dynamic>> _recentReadings = [];
+  final SampleRing _recentSamples = SampleRing(recentCapacity);
+  late final List<Map<String, dynamic>> _recentReadings = SampleRingReadings(
+    _recentSamples,
+  );
+  final LodSeries _sessionTrace = LodSeries(2);
+  final List<double> _traceValues = [0, 0];
+  // Every _traceStride-th sample goes into the trace; doubles each time the
+  // trace reaches the limit
+  int _traceStride = 1;
+  int _traceCount = 0;
+  final SampleDecoder _decoder = SampleDecoder();
+  final StreamController<SampleBatch> _batches =
+      StreamController<SampleBatch>.broadcast();
   StreamSubscription? _subscription;
   Timer? _reconnectTimer;
 
@@ -20,7 +46,20 @@ class WebSocketService with ChangeNotifier {
   bool get isConnected => _isConnected;
   bool get isConnecting => _isConnecting;
   Map<String, dynamic> get latestReading => _latestReading;
+
+  /// Read-only view of [recentSamples] as reading maps
   List<Map<String, dynamic>> get recentReadings => _recentReadings;
+  SampleRing get recentSamples => _recentSamples;
+
+  /// The session since the last [clearSession] (left, right against time
+  /// in milliseconds), for charts of the whole session at any length. Each
+  /// time it reaches [sessionTraceLimit] every other sample is dropped and
+  /// from then on it keeps half as many, so long sessions stay whole at a
+  /// lower rate. It starts over if the clock goes backwards.
+  LodSeries get sessionTrace => _sessionTrace;
+
+  /// Every decoded batch, for views that keep their own history
+  Stream<SampleBatch> get batches => _batches.stream;
 
   /// Connect to the WebSocket server
   Future<void> connect() async {
@@ -30,14 +69,17 @@ class WebSocketService with ChangeNotifier {
     notifyListeners();
 
     try {
-      // Auto-detect backend URL if not already detected
-      if (!BackendConfig.isDetected) {
+      // Auto-detect backend URL if not already detected; not needed when
+      // WEBSOCKET_URL points at the backend or an ESP32 directly
+      if (AppConfig.websocketUrl.isEmpty && !BackendConfig.isDetected) {
         await BackendConfig.autoDetectBackend();
       }
 
       final wsUrl = BackendConfig.wsUrl;
       debugPrint('Connecting to WebSocket: $wsUrl');
 
+      await _decoder.start(_onBatch, _onOtherMessage);
+
       _channel = WebSocketChannel.connect(Uri.parse(wsUrl));
 
       // Send registration message as Flutter client
@@ -63,41 +105,56 @@ class WebSocketService with ChangeNotifier {
     }
   }
 
-  /// Handle incoming WebSocket messages
+  /// Hand incoming WebSocket messages to the decoder isolate
   void _onMessage(dynamic message) {
-    try {
-      final data = jsonDecode(message);
-      debugPrint('WebSocket received: ${data.toString().substring(0, 100)}...');
-
-      // Handle sensor data
-      if (data['samples'] != null) {
-        final samples = data['samples'] as List;
-
-        for (var sample in samples) {
-          final reading = {
-            'left': sample['l'] ?? 0,
-            'right': sample['r'] ?? 0,
-            'timestamp': sample['t'] ?? DateTime.now().millisecondsSinceEpoch,
-          };
-
-          _latestReading = reading;
-          _recentReadings.add(reading);
-
-          // Keep only last 1000 readings to prevent memory issues
-          if (_recentReadings.length > 1000) {
-            _recentReadings.removeAt(0);
-          }
-        }
-
-        notifyListeners();
-      }
+    if (message is String) {
+      _decoder.add(message);
+    }
+  }
 
-      // Handle other message types
-      if (data['test_status'] != null) {
-        debugPrint('Test status: ${data['test_status']}');
+  /// Samples decoded since the last display frame
+  void _onBatch(SampleBatch batch) {
+    if (batch.isEmpty) return;
+    _recentSamples.add(batch);
+    _addToTrace(batch);
+    final last = batch.length - 1;
+    _latestReading = {
+      'left': batch.left[last],
+      'right': batch.right[last],
+      'timestamp': batch.timeAt(last),
+    };
+    _batches.add(batch);
+    notifyListeners();
+  }
+
+  void _addToTrace(SampleBatch batch) {
+    final trace = _sessionTrace;
+    for (var i = 0; i < batch.length; i++) {
+      final time = batch.timeAt(i).toDouble();
+      if (trace.isNotEmpty && time < trace.endTime) {
+        _clearTrace();
       }
-    } catch (e) {
-      debugPrint('Error parsing WebSocket message: $e');
+      if (_traceCount++ % _traceStride != 0) continue;
+      _traceValues[0] = batch.left[i];
+      _traceValues[1] = batch.right[i];
+      trace.add(time, _traceValues);
+      if (trace.length >= sessionTraceLimit) {
+        trace.halve();
+        _traceStride *= 2;
+      }
+    }
+  }
+
+  void _clearTrace() {
+    _sessionTrace.clear();
+    _traceStride = 1;
+    _traceCount = 0;
+  }
+
+  /// Messages other than sample frames
+  void _onOtherMessage(Map<String, dynamic> data) {
+    if (data['test_status'] != null) {
+      debugPrint('Test status: ${data['test_status']}');
     }
   }
 
@@ -156,18 +213,20 @@ class WebSocketService with ChangeNotifier {
   /// Get readings from the last N seconds
   List<Map<String, dynamic>> getReadingsFromLast(int seconds) {
     final cutoffTime = DateTime.now().millisecondsSinceEpoch - (seconds * 1000);
-    return _recentReadings.where((reading) {
-      final timestamp = reading['timestamp'] as int;
-      return timestamp >= cutoffTime;
-    }).toList();
+    var first = _recentSamples.length;
+    while (first > 0 && _recentSamples.timeAt(first - 1) >= cutoffTime) {
+      first--;
+    }
+    return _recentReadings.sublist(first);
   }
 
   /// Get readings count from current session
-  int get currentSessionSampleCount => _recentReadings.length;
+  int get currentSessionSampleCount => _recentSamples.length;
 
   /// Clear session data
   void clearSession() {
-    _recentReadings.clear();
+    _recentSamples.clear();
+    _clearTrace();
     _latestReading = {};
     notifyListeners();
   }
@@ -178,6 +237,7 @@ class WebSocketService with ChangeNotifier {
     _reconnectTimer?.cancel();
     _subscription?.cancel();
     _channel?.sink.close(status.goingAway);
+    _decoder.stop();
     _isConnected = false;
     _isConnecting = false;
     notifyListeners();
@@ -186,6 +246,7 @@ class WebSocketService with ChangeNotifier {
   @override
   void dispose() {
     disconnect();
+    _batches.close();
     super.dispose();
   }
 }
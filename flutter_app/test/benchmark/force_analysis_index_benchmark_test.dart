@@ -0,0 +1,64 @@
+@Tags(['benchmark'])
+library;
+
+import 'dart:math';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import '../support/pull_session.dart';
+
+void main() {
+  // Cursor drags over recorded sessions of increasing length: each step
+  // moves T1 or T2 and reads force, RFD and impulse for the interval, as
+  // the results screen does on every change
+  test('benchmark: cursor queries over recorded sessions', () {
+    for (final minutes in [1, 5, 10]) {
+      final data = pullSession(rows: minutes * 60 * 100);
+      const steps = 2000;
+      final random = Random(5);
+      final cursors = [
+        for (var i = 0; i < steps; i++)
+          (random.nextDouble() * data.last.time, random.nextDouble() * 2),
+      ];
+
+      var legacyChecksum = 0.0;
+      final legacy = Stopwatch()..start();
+      for (final (t1, width) in cursors) {
+        final t2 = t1 + width;
+        legacyChecksum +=
+            legacyForceAtTime(data, t2) +
+            legacySlope(data, t1, t2) +
+            legacyImpulse(data, t2) -
+            legacyImpulse(data, t1);
+      }
+      legacy.stop();
+
+      final build = Stopwatch()..start();
+      final index = indexOf(data);
+      build.stop();
+      var indexChecksum = 0.0;
+      final indexed = Stopwatch()..start();
+      for (final (t1, width) in cursors) {
+        final t2 = t1 + width;
+        indexChecksum +=
+            index.forceAt(t2) +
+            index.slope(t1, t2) +
+            index.impulseBetween(t1, t2);
+      }
+      indexed.stop();
+
+      debugPrint(
+        '$minutes min (${data.length} rows): '
+        '${(legacy.elapsedMicroseconds / steps).toStringAsFixed(1)} us per '
+        'cursor move before, '
+        '${(indexed.elapsedMicroseconds / steps).toStringAsFixed(2)} us with '
+        'the index (built in ${build.elapsedMilliseconds} ms)',
+      );
+      expect(
+        indexChecksum,
+        closeTo(legacyChecksum, legacyChecksum.abs() * 1e-9),
+      );
+    }
+  });
+}
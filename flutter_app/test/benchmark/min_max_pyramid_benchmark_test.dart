@@ -0,0 +1,76 @@
+@Tags(['benchmark'])
+library;
+
+import 'dart:math';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:idrott_app/services/min_max_pyramid.dart';
+
+/// A force-like 1 kHz signal with noise: seconds since start, left, right
+LodSeries chartSession({required int seconds, int rate = 1000}) {
+  final random = Random(7);
+  final series = LodSeries(2);
+  final values = <double>[0, 0];
+  for (var i = 0; i < seconds * rate; i++) {
+    final t = i / rate;
+    final pull = 800 * (1 - cos(t * 0.7)) / 2;
+    values[0] = pull + random.nextDouble() * 40 - 20;
+    values[1] = pull * 0.9 + random.nextDouble() * 40 - 20;
+    series.add(t, values);
+  }
+  return series;
+}
+
+void main() {
+  // Pan and zoom over a 10-minute 1 kHz session: cost of the chart data per
+  // frame, against plotting every sample of the visible window
+  test('benchmark: chart data per frame over a 10-minute 1 kHz session', () {
+    final build = Stopwatch()..start();
+    final series = chartSession(seconds: 600);
+    build.stop();
+    const width = 1080;
+
+    // Zoom from the whole session down to one second, then pan across it
+    final windows = <(double, double)>[];
+    for (var span = 600.0; span >= 1; span /= 1.2) {
+      windows.add((300 - span / 2, 300 + span / 2));
+    }
+    for (var start = 0.0; start < 590; start += 5) {
+      windows.add((start, start + 10));
+    }
+
+    var lodPoints = 0;
+    final lod = Stopwatch()..start();
+    for (final (start, end) in windows) {
+      lodPoints += series.points(start, end, width).length;
+    }
+    lod.stop();
+
+    var rawPoints = 0;
+    var checksum = 0.0;
+    final raw = Stopwatch()..start();
+    for (final (start, end) in windows) {
+      final first = series.lowerBound(start);
+      final last = series.lowerBound(end);
+      for (var i = first; i < last; i++) {
+        checksum += series.valueAt(0, i) + series.valueAt(1, i);
+      }
+      rawPoints += last - first;
+    }
+    raw.stop();
+
+    final perFrameMs = lod.elapsedMicroseconds / 1000 / windows.length;
+    final rawMs = raw.elapsedMicroseconds / 1000 / windows.length;
+    debugPrint(
+      'Built ${series.length} samples in ${build.elapsedMilliseconds} ms; '
+      '${windows.length} frames: ${perFrameMs.toStringAsFixed(2)} ms and '
+      '${lodPoints ~/ windows.length} points per frame with the pyramid, '
+      'against ${rawPoints ~/ windows.length} points per frame '
+      '(${rawMs.toStringAsFixed(2)} ms '
+      'just to read them, checksum ${checksum.round()})',
+    );
+    expect(lodPoints ~/ windows.length, lessThanOrEqualTo(2 * width));
+  });
+}
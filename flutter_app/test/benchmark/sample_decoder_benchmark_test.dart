@@ -0,0 +1,98 @@
+@Tags(['benchmark'])
+library;
+
+import 'dart:convert';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:idrott_app/services/sample_decoder.dart';
+
+import '../support/replay_stream.dart';
+
+/// What WebSocketService._onMessage did on the UI isolate before decoding
+/// moved to SampleDecoder: the baseline for the benchmark
+void legacyOnMessage(String message, List<Map<String, dynamic>> recent) {
+  final data = jsonDecode(message);
+  final preview = '${data.toString().substring(0, 100)}...';
+  if (preview.isEmpty) return;
+  final samples = data['samples'] as List;
+  final int? base = data['t0'];
+  for (var sample in samples) {
+    if (sample['l'] == null && sample['v'] != null) {
+      final values = (sample['v'] as List).cast<num>();
+      final half = (values.length + 1) ~/ 2;
+      sample['l'] = values.take(half).fold<num>(0, (a, b) => a + b);
+      sample['r'] = values.skip(half).fold<num>(0, (a, b) => a + b);
+    }
+    if (sample['t'] == null && base != null) {
+      sample['t'] = (base + ((sample['dt'] ?? 0) as int)) ~/ 1000;
+    }
+    recent.add({
+      'left': sample['l'] ?? 0,
+      'right': sample['r'] ?? 0,
+      'timestamp': sample['t'] ?? DateTime.now().millisecondsSinceEpoch,
+    });
+    if (recent.length > 1000) {
+      recent.removeAt(0);
+    }
+  }
+}
+
+void main() {
+  // UI-isolate cost of a replayed 1 kHz stream, before and after moving the
+  // decoding to the isolate. Frame time itself needs a device: run the app
+  // with `flutter run --profile` and read the UI thread in DevTools.
+  test('benchmark: UI-isolate work per second of a 1 kHz stream', () {
+    const seconds = 20;
+    final frames = replayStream(seconds: seconds);
+
+    final legacyRecent = <Map<String, dynamic>>[];
+    final legacy = Stopwatch()..start();
+    for (final frame in frames) {
+      legacyOnMessage(frame, legacyRecent);
+    }
+    legacy.stop();
+
+    // Worker: decode every message, one batch per 16 ms of stream
+    final builder = SampleBatchBuilder();
+    final decoded = <SampleBatch>[];
+    final framesPerFlush = (frames.length / (seconds * 1000 / 16)).ceil();
+    final worker = Stopwatch()..start();
+    for (var i = 0; i < frames.length; i++) {
+      decodeMessage(frames[i], builder);
+      if ((i + 1) % framesPerFlush == 0 || i == frames.length - 1) {
+        decoded.add(builder.take());
+      }
+    }
+    worker.stop();
+
+    // UI isolate: what WebSocketService._onBatch does per batch
+    final ring = SampleRing(1000);
+    var latest = <String, dynamic>{};
+    final ui = Stopwatch()..start();
+    for (final batch in decoded) {
+      ring.add(batch);
+      final last = batch.length - 1;
+      latest = {
+        'left': batch.left[last],
+        'right': batch.right[last],
+        'timestamp': batch.timeAt(last),
+      };
+    }
+    ui.stop();
+
+    expect(ring.length, legacyRecent.length);
+    expect(latest['timestamp'], legacyRecent.last['timestamp']);
+    expect(ring.leftAt(999), closeTo(legacyRecent.last['left'], 1e-3));
+
+    double perSecond(Stopwatch s) => s.elapsedMicroseconds / 1000 / seconds;
+    debugPrint(
+      'UI isolate per second of stream: before ${perSecond(legacy).toStringAsFixed(2)} ms '
+      '(${frames.length ~/ seconds} messages), after ${perSecond(ui).toStringAsFixed(3)} ms '
+      '(${decoded.length ~/ seconds} batches); decoder isolate '
+      '${perSecond(worker).toStringAsFixed(2)} ms',
+    );
+    expect(decoded.length, lessThan(frames.length));
+  });
+}
@@ -0,0 +1,78 @@
+import 'dart:math';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:idrott_app/services/force_analysis_index.dart';
+
+import 'support/pull_session.dart';
+
+void main() {
+  for (final positiveOnly in [false, true]) {
+    test('matches the original formulas exactly '
+        '(${positiveOnly ? 'positive only' : 'all values'})', () {
+      final data = pullSession(rows: 1500, positiveOnly: positiveOnly);
+      final index = indexOf(data);
+      final random = Random(11);
+
+      // Sample times, points between them, and outside the session
+      final times = <double>[
+        -1,
+        0,
+        0.05,
+        0.1,
+        0.15,
+        0.2,
+        0.25,
+        for (var i = 0; i < 200; i++) data[random.nextInt(data.length)].time,
+        for (var i = 0; i < 200; i++) random.nextDouble() * 16,
+        data.last.time,
+        100,
+      ];
+      for (final t in times) {
+        expect(index.forceAt(t), legacyForceAtTime(data, t), reason: 't=$t');
+        expect(index.impulseTo(t), legacyImpulse(data, t), reason: 't=$t');
+      }
+      for (var i = 0; i < 500; i++) {
+        final t1 = times[random.nextInt(times.length)];
+        final t2 = times[random.nextInt(times.length)];
+        expect(index.slope(t1, t2), legacySlope(data, t1, t2));
+      }
+
+      expect(index.timeToPeak, legacyTimeToPeak(data));
+      double peak(double a, double b) => a > b ? a : b;
+      expect(index.leftPeak, data.map((d) => d.left).reduce(peak));
+      expect(index.rightPeak, data.map((d) => d.right).reduce(peak));
+      expect(index.totalPeak, data.map((d) => d.total).reduce(peak));
+      expect(index.duration, data.last.time);
+    });
+  }
+
+  test('impulse over an interval counts the samples inside it', () {
+    final data = pullSession(rows: 800);
+    final index = indexOf(data);
+    expect(
+      index.impulseBetween(2.0, 5.0),
+      index.impulseTo(5) - index.impulseTo(2),
+    );
+    final scan = data
+        .where((d) => d.time > 2.0 && d.time <= 5.0)
+        .fold<double>(0, (sum, d) => sum + d.total * 0.01);
+    expect(index.impulseBetween(2.0, 5.0), closeTo(scan, 1e-6));
+    expect(index.impulseBetween(5.0, 5.0), 0);
+  });
+
+  test('rejects unsorted times and has nothing to say when empty', () {
+    expect(
+      () => ForceAnalysisIndex(
+        times: [0.01, 0.03, 0.02],
+        left: [1, 1, 1],
+        right: [1, 1, 1],
+        total: [2, 2, 2],
+      ),
+      throwsArgumentError,
+    );
+    expect(ForceAnalysisIndex.empty.isEmpty, isTrue);
+    expect(ForceAnalysisIndex.empty.impulseTo(1), 0);
+    expect(() => ForceAnalysisIndex.empty.forceAt(0), throwsStateError);
+  });
+}
@@ -0,0 +1,116 @@
+import 'dart:math';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:idrott_app/services/min_max_pyramid.dart';
+
+void main() {
+  group('MinMaxPyramid', () {
+    test('range matches a scan for any span', () {
+      final random = Random(1);
+      final pyramid = MinMaxPyramid();
+      final values = <double>[];
+      for (var i = 0; i < 5000; i++) {
+        // Representable as float32, like the stored values
+        final v = (random.nextInt(20001) - 10000) / 8;
+        values.add(v);
+        pyramid.add(v);
+      }
+      for (var n = 0; n < 2000; n++) {
+        final start = random.nextInt(values.length);
+        final end = start + 1 + random.nextInt(values.length - start);
+        final span = values.sublist(start, end);
+        expect(pyramid.range(start, end), (
+          span.reduce(min),
+          span.reduce(max),
+        ), reason: '[$start, $end)');
+      }
+      expect(pyramid.range(10, 10), (
+        double.infinity,
+        double.negativeInfinity,
+      ));
+      expect(() => pyramid.range(0, 5001), throwsRangeError);
+    });
+
+    test('covers a trailing partial bucket and starts over when cleared', () {
+      final pyramid = MinMaxPyramid();
+      for (var i = 0; i < 37; i++) {
+        pyramid.add(i.toDouble());
+      }
+      expect(pyramid.range(0, 37), (0.0, 36.0));
+      expect(pyramid.range(33, 37), (33.0, 36.0));
+      pyramid.clear();
+      expect(pyramid.length, 0);
+      for (var i = 0; i < 40; i++) {
+        pyramid.add(-i.toDouble());
+      }
+      expect(pyramid.range(0, 32), (-31.0, 0.0));
+    });
+  });
+
+  group('LodSeries', () {
+    test('returns samples as they are when there are no more than buckets', () {
+      final series = LodSeries(1);
+      for (var i = 0; i < 10; i++) {
+        series.add(i * 0.5, [i.toDouble()]);
+      }
+      final points = series.points(1.0, 3.0, 100);
+      expect(points.length, 5);
+      expect([for (var i = 0; i < 5; i++) points.timeAt(i)], [
+        1.0,
+        1.5,
+        2.0,
+        2.5,
+        3.0,
+      ]);
+      expect(points.valueAt(0, 4), 6);
+    });
+
+    test('one min/max pair per bucket, keeping every extreme', () {
+      final series = LodSeries(2);
+      for (var i = 0; i < 10000; i++) {
+        final spike = i % 100 == 37 ? 500.0 : 1.0;
+        series.add(i.toDouble(), [spike, -i.toDouble()]);
+      }
+      final points = series.points(0, 10000, 100);
+      expect(points.length, 200);
+      for (var b = 0; b < 100; b++) {
+        expect(points.timeAt(2 * b), b * 100);
+        expect(points.valueAt(0, 2 * b), 1);
+        expect(points.valueAt(0, 2 * b + 1), 500);
+        expect(points.valueAt(1, 2 * b), -(b * 100 + 99));
+        expect(points.valueAt(1, 2 * b + 1), -(b * 100));
+      }
+    });
+
+    test('skips empty buckets and rejects time going backwards', () {
+      final series = LodSeries(1);
+      for (var i = 0; i < 50; i++) {
+        series.add(i.toDouble(), [0]);
+      }
+      for (var i = 0; i < 50; i++) {
+        series.add(1000.0 + i, [1]);
+      }
+      final points = series.points(0, 1049, 20);
+      expect(points.length, lessThan(40));
+      expect(points.timeAt(points.length - 1), greaterThanOrEqualTo(1000));
+      expect(() => series.add(5, [0]), throwsArgumentError);
+    });
+
+    test('halving keeps every other sample and the ranges follow', () {
+      final series = LodSeries(2);
+      for (var i = 0; i < 101; i++) {
+        series.add(i.toDouble(), [i.toDouble(), -i.toDouble()]);
+      }
+      series.halve();
+      expect(series.length, 51);
+      expect(series.timeAt(50), 100);
+      expect(series.valueAt(0, 25), 50);
+      expect(series.valueAt(1, 25), -50);
+      expect(series.channel(0).range(0, 51), (0.0, 100.0));
+      expect(series.channel(0).range(16, 32), (32.0, 62.0));
+      series.add(101, [1000, 0]);
+      expect(series.channel(0).range(0, 52), (0.0, 1000.0));
+    });
+  });
+}
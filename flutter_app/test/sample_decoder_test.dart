@@ -0,0 +1,144 @@
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:idrott_app/services/sample_decoder.dart';
+
+import 'support/replay_stream.dart';
+
+void main() {
+  group('SampleBatchBuilder', () {
+    test('sums the channels of firmware frames into plates', () {
+      final builder = SampleBatchBuilder();
+      builder.addFrame({
+        't0': 5000000,
+        'ch': 4,
+        'samples': [
+          {
+            'dt': 0,
+            'v': [1.5, 2, 3, 4.25],
+          },
+          {
+            'dt': 1000,
+            'v': [-1, 1, 10, 20],
+          },
+        ],
+      });
+      final batch = builder.take();
+      expect(batch.length, 2);
+      expect(batch.timeAt(0), 5000);
+      expect(batch.timeAt(1), 5001);
+      expect(batch.left[0], 3.5);
+      expect(batch.right[0], 7.25);
+      expect(batch.left[1], 0);
+      expect(batch.right[1], 30);
+      expect(builder.isEmpty, isTrue);
+    });
+
+    test('keeps sides and times added by the backend', () {
+      final builder = SampleBatchBuilder();
+      builder.addFrame({
+        'samples': [
+          {'l': 12, 'r': 8.5, 't': 1700000000123},
+        ],
+      });
+      final batch = builder.take();
+      expect(batch.timeAt(0), 1700000000123);
+      expect(batch.left[0], 12);
+      expect(batch.right[0], 8.5);
+    });
+
+    test('grows past its initial buffers', () {
+      final builder = SampleBatchBuilder();
+      for (var i = 0; i < 1000; i++) {
+        builder.add(i, i.toDouble(), -i.toDouble());
+      }
+      final batch = builder.take();
+      expect(batch.length, 1000);
+      expect(batch.timeAt(999), 999);
+      expect(batch.right[999], -999);
+    });
+  });
+
+  test('decodeMessage returns other messages and skips junk', () {
+    final builder = SampleBatchBuilder();
+    expect(decodeMessage('{"test_status":"running"}', builder), {
+      'test_status': 'running',
+    });
+    expect(decodeMessage('not json', builder), isNull);
+    expect(decodeMessage('[1,2]', builder), isNull);
+    expect(decodeMessage(replayStream(seconds: 1).first, builder), isNull);
+    expect(builder.length, 20);
+  });
+
+  group('SampleRing', () {
+    test('keeps the newest samples once full', () {
+      final ring = SampleRing(5);
+      for (var i = 0; i < 12; i++) {
+        ring.push(1000 + i, i.toDouble(), i * 2.0);
+      }
+      expect(ring.length, 5);
+      expect([for (var i = 0; i < 5; i++) ring.timeAt(i)], [
+        1007,
+        1008,
+        1009,
+        1010,
+        1011,
+      ]);
+      expect(ring.leftAt(0), 7);
+      expect(ring.rightAt(4), 22);
+    });
+
+    test('restarts when the clock jumps out of range', () {
+      final ring = SampleRing(4);
+      ring.push(1000, 1, 1);
+      ring.push(1000 + (1 << 31), 2, 2);
+      expect(ring.length, 1);
+      expect(ring.timeAt(0), 1000 + (1 << 31));
+    });
+
+    test('reading view builds maps on access', () {
+      final ring = SampleRing(3);
+      final readings = SampleRingReadings(ring);
+      expect(readings, isEmpty);
+      for (var i = 0; i < 4; i++) {
+        ring.push(i, i.toDouble(), 0);
+      }
+      expect(readings.length, 3);
+      expect(readings.first['timestamp'], 1);
+      expect(readings.last, {'left': 3.0, 'right': 0.0, 'timestamp': 3});
+      expect(() => readings.add({}), throwsUnsupportedError);
+    });
+  });
+
+  test('decoder isolate delivers samples in order, batched per frame', () async {
+    final decoder = SampleDecoder();
+    final batches = <SampleBatch>[];
+    final others = <Map<String, dynamic>>[];
+    await decoder.start(batches.add, others.add);
+
+    final frames = replayStream(seconds: 2);
+    frames.forEach(decoder.add);
+    decoder.add('{"test_status":"running"}');
+
+    final deadline = DateTime.now().add(const Duration(seconds: 5));
+    while (batches.fold<int>(0, (n, b) => n + b.length) < 2000 &&
+        DateTime.now().isBefore(deadline)) {
+      await Future<void>.delayed(const Duration(milliseconds: 20));
+    }
+    decoder.stop();
+
+    final times = [
+      for (final batch in batches)
+        for (var i = 0; i < batch.length; i++) batch.timeAt(i),
+    ];
+    expect(times.length, 2000);
+    expect(times.first, (1 << 33) ~/ 1000);
+    for (var i = 1; i < times.length; i++) {
+      expect(times[i], times[i - 1] + 1);
+    }
+    // Sent all at once: far fewer batches than frames
+    expect(batches.length, lessThan(frames.length));
+    expect(others, [
+      {'test_status': 'running'},
+    ]);
+  });
+}
@@ -0,0 +1,85 @@
+import 'dart:math';
+
+import 'package:idrott_app/services/force_analysis_index.dart';
+
+typedef Sample = ({double time, double left, double right, double total});
+
+/// An IMTP-like pull sampled every 10 ms, in seconds from the start as
+/// TestResultsScreenV2 gets it, noise around zero before and after the pull
+List<Sample> pullSession({
+  required int rows,
+  int seed = 3,
+  bool positiveOnly = false,
+}) {
+  final random = Random(seed);
+  final samples = <Sample>[];
+  for (var i = 1; i <= rows; i++) {
+    final t = i * 0.01;
+    final phase = (t - 1.0) / (rows * 0.01 - 2.0);
+    final pull = phase > 0 && phase < 1 ? 1400 * sin(pi * phase) : 0.0;
+    var left = pull * 0.52 + random.nextDouble() * 30 - 15;
+    var right = pull * 0.48 + random.nextDouble() * 30 - 15;
+    if (positiveOnly) {
+      left = left > 0 ? left : 0;
+      right = right > 0 ? right : 0;
+    }
+    samples.add((time: t, left: left, right: right, total: left + right));
+  }
+  return samples;
+}
+
+ForceAnalysisIndex indexOf(List<Sample> samples) => ForceAnalysisIndex(
+  times: [for (final s in samples) s.time],
+  left: [for (final s in samples) s.left],
+  right: [for (final s in samples) s.right],
+  total: [for (final s in samples) s.total],
+);
+
+// TestResultsScreenV2's formulas before the index: the reference
+
+double legacyForceAtTime(List<Sample> data, double timeSeconds) {
+  final targetData = data.firstWhere(
+    (d) => d.time >= timeSeconds,
+    orElse: () => data.last,
+  );
+  return targetData.total;
+}
+
+double legacyImpulse(List<Sample> data, double timeSeconds) {
+  double impulse = 0.0;
+  double previousTime = 0.0;
+
+  for (final d in data) {
+    if (d.time > timeSeconds) break;
+
+    final deltaTime = d.time - previousTime;
+    impulse += d.total * deltaTime;
+    previousTime = d.time;
+  }
+
+  return impulse;
+}
+
+double legacySlope(List<Sample> data, double startTime, double endTime) {
+  final forceAtStart = legacyForceAtTime(data, startTime);
+  final forceAtEnd = legacyForceAtTime(data, endTime);
+  final timeDiff = endTime - startTime;
+
+  if (timeDiff <= 0) return 0.0;
+
+  return (forceAtEnd - forceAtStart) / timeDiff;
+}
+
+double legacyTimeToPeak(List<Sample> data) {
+  double maxForce = 0;
+  double peakTime = 0;
+
+  for (final d in data) {
+    if (d.total > maxForce) {
+      maxForce = d.total;
+      peakTime = d.time;
+    }
+  }
+
+  return peakTime;
+}
@@ -0,0 +1,29 @@
+import 'dart:convert';
+
+/// A 1 kHz stream in the firmware's frame format: 64-bit base time in
+/// microseconds, per-sample offsets and per-channel values
+List<String> replayStream({
+  required int seconds,
+  int rate = 1000,
+  int samplesPerFrame = 20,
+  int channels = 2,
+}) {
+  final frames = <String>[];
+  final periodUs = 1000000 ~/ rate;
+  var t = 0;
+  while (t < seconds * rate) {
+    final t0 = (1 << 33) + t * periodUs;
+    final samples = <Map<String, dynamic>>[];
+    for (var i = 0; i < samplesPerFrame; i++, t++) {
+      samples.add({
+        'dt': i * periodUs,
+        'v': [
+          for (var c = 0; c < channels; c++)
+            ((t * (c + 1)) % 977) - 400.0 + c * 0.5,
+        ],
+      });
+    }
+    frames.add(jsonEncode({'t0': t0, 'ch': channels, 'samples': samples}));
+  }
+  return frames;
+}